@@ -160,12 +160,25 @@ dep_list_TEST_blockers_CXXFLAGS = -I$(top_srcdir) $(AM_CXXFLAGS) @PALUDIS_CXXFLA
 
 TESTS = testlist
 
-check_PROGRAMS = $(TESTS) stripper_TEST_binary
+check_PROGRAMS = $(TESTS) stripper_TEST_binary version_spec_benchmark
 check_SCRIPTS = testscriptlist
 check_LTLIBRARIES = libpaludissohooks_TEST_@PALUDIS_PC_SLOT@.la
 
 stripper_TEST_binary_SOURCES = stripper_TEST_binary.cc
 
+version_spec_benchmark_SOURCES = version_spec_benchmark.cc
+version_spec_benchmark_LDADD = \
+	$(top_builddir)/paludis/util/benchmark_extras.o \
+	libpaludis_@PALUDIS_PC_SLOT@.la \
+	$(top_builddir)/paludis/util/libpaludisutil_@PALUDIS_PC_SLOT@.la \
+	$(DYNAMIC_LD_LIBS)
+version_spec_benchmark_CXXFLAGS = -I$(top_srcdir) $(AM_CXXFLAGS) @PALUDIS_CXXFLAGS_NO_DEBUGGING@
+
+benchmark : version_spec_benchmark
+	./version_spec_benchmark $(BENCHMARK_OPTIONS)
+
+.PHONY : benchmark
+
 paludis_libexecdir = $(libexecdir)/paludis
 paludis_libexec_SCRIPTS = hooker.bash
 
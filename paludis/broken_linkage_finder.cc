@@ -22,12 +22,17 @@
 #include <paludis/elf_linkage_checker.hh>
 #include <paludis/libtool_linkage_checker.hh>
 #include <paludis/linkage_checker.hh>
+#include <paludis/linkage_cache.hh>
 
 #include <paludis/util/realpath.hh>
 #include <paludis/util/fs_entry.hh>
 #include <paludis/util/dir_iterator.hh>
 #include <paludis/util/log.hh>
 #include <paludis/util/mutex.hh>
+#include <paludis/util/condition_variable.hh>
+#include <paludis/util/thread_pool.hh>
+#include <paludis/util/system.hh>
+#include <paludis/util/destringify.hh>
 #include <paludis/util/private_implementation_pattern-impl.hh>
 #include <paludis/util/set-impl.hh>
 #include <paludis/util/sequence-impl.hh>
@@ -50,9 +55,11 @@
 #include <tr1/functional>
 #include <algorithm>
 #include <iterator>
+#include <deque>
 #include <map>
 #include <set>
 #include <vector>
+#include <unistd.h>
 
 using namespace paludis;
 
@@ -74,6 +81,11 @@ namespace paludis
 
         Mutex mutex;
 
+        Mutex queue_mutex;
+        ConditionVariable queue_condition;
+        std::deque<FSEntry> queue;
+        unsigned busy;
+
         bool has_files;
         Files files;
 
@@ -85,13 +97,17 @@ namespace paludis
         void walk_directory(const FSEntry &);
         void check_file(const FSEntry &);
 
+        void walk_worker() throw ();
+
         void add_breakage(const FSEntry &, const std::string &);
         void gather_package(const std::tr1::shared_ptr<const PackageID> &);
+        void add_file(const std::tr1::shared_ptr<const PackageID> &, const std::string &);
 
         Implementation(const Environment * the_env, const std::string & the_library) :
             env(the_env),
             config(the_env->root()),
             library(the_library),
+            busy(0),
             has_files(false)
         {
         }
@@ -137,6 +153,26 @@ namespace
                 (parent_str.length() == child_str.length() || '/' == child_str[parent_str.length()]);
         }
     };
+
+    unsigned linkage_threads()
+    {
+        std::string threads(getenv_with_default("PALUDIS_LINKAGE_THREADS", ""));
+        if (! threads.empty())
+        {
+            try
+            {
+                return destringify<unsigned>(threads);
+            }
+            catch (const DestringifyError &)
+            {
+                Log::get_instance()->message("reconcilio.broken_linkage_finder.bad_threads", ll_warning, lc_context)
+                    << "Ignoring bad value '" << threads << "' for PALUDIS_LINKAGE_THREADS";
+            }
+        }
+
+        long processors(sysconf(_SC_NPROCESSORS_ONLN));
+        return processors > 0 ? processors : 1;
+    }
 }
 
 BrokenLinkageFinder::BrokenLinkageFinder(const Environment * env, const std::string & library) :
@@ -146,9 +182,13 @@ BrokenLinkageFinder::BrokenLinkageFinder(const Environment * env, const std::str
 
     Context ctx("When checking for broken linkage in '" + stringify(env->root()) + "':");
 
-    _imp->checkers.push_back(std::tr1::shared_ptr<LinkageChecker>(new ElfLinkageChecker(env->root(), library)));
+    /* most files won't have changed since last time, so remember what we
+     * found in each one */
+    std::tr1::shared_ptr<LinkageCache> cache(new LinkageCache(env->root() / "var" / "cache" / "paludis" / "linkage"));
+
+    _imp->checkers.push_back(std::tr1::shared_ptr<LinkageChecker>(new ElfLinkageChecker(env->root(), library, cache)));
     if (library.empty())
-        _imp->checkers.push_back(std::tr1::shared_ptr<LinkageChecker>(new LibtoolLinkageChecker(env->root())));
+        _imp->checkers.push_back(std::tr1::shared_ptr<LinkageChecker>(new LibtoolLinkageChecker(env->root(), cache)));
 
     std::vector<FSEntry> search_dirs_nosyms, search_dirs_pruned;
     std::transform(_imp->config.begin_search_dirs(), _imp->config.end_search_dirs(),
@@ -173,6 +213,18 @@ BrokenLinkageFinder::BrokenLinkageFinder(const Environment * env, const std::str
     std::for_each(search_dirs_pruned.begin(), search_dirs_pruned.end(),
                       std::tr1::bind(&Implementation<BrokenLinkageFinder>::search_directory, _imp.get(), _1));
 
+    unsigned threads(linkage_threads());
+    if (threads <= 1)
+        _imp->walk_worker();
+    else
+    {
+        ThreadPool pool;
+        for (unsigned n(0) ; n < threads ; ++n)
+            pool.create_thread(std::tr1::bind(&Implementation<BrokenLinkageFinder>::walk_worker, _imp.get()));
+    }
+
+    cache->save();
+
     for (std::set<FSEntry>::const_iterator it(_imp->extra_lib_dirs.begin()),
              it_end(_imp->extra_lib_dirs.end()); it_end != it; ++it)
     {
@@ -214,7 +266,10 @@ Implementation<BrokenLinkageFinder>::search_directory(const FSEntry & directory)
 
     FSEntry with_root(env->root() / directory);
     if (with_root.is_directory())
-        walk_directory(with_root);
+    {
+        Lock l(queue_mutex);
+        queue.push_back(with_root);
+    }
     else
         Log::get_instance()->message("reconcilio.broken_linkage_finder.missing", ll_debug, lc_context)
             << "'" << directory << "' is missing or not a directory";
@@ -242,8 +297,13 @@ Implementation<BrokenLinkageFinder>::walk_directory(const FSEntry & directory)
 
     try
     {
-        std::for_each(DirIterator(directory, DirIteratorOptions() + dio_include_dotfiles + dio_inode_sort), DirIterator(),
-                          std::tr1::bind(&Implementation<BrokenLinkageFinder>::check_file, this, _1));
+        /* a single directory can hold most of the files we care about, so
+         * hand out individual entries rather than whole directories */
+        std::vector<FSEntry> entries(DirIterator(directory, DirIteratorOptions() + dio_include_dotfiles + dio_inode_sort), DirIterator());
+
+        Lock l(queue_mutex);
+        queue.insert(queue.end(), entries.rbegin(), entries.rend());
+        queue_condition.broadcast();
     }
     catch (const FSError & ex)
     {
@@ -251,6 +311,52 @@ Implementation<BrokenLinkageFinder>::walk_directory(const FSEntry & directory)
     }
 }
 
+void
+Implementation<BrokenLinkageFinder>::walk_worker() throw ()
+{
+    FSEntry file("/");
+
+    while (true)
+    {
+        {
+            Lock l(queue_mutex);
+            while (queue.empty())
+            {
+                if (0 == busy)
+                    return;
+                queue_condition.wait(queue_mutex);
+            }
+
+            /* take from the end, so that we finish off one directory before
+             * starting on the next, and so visit files in inode order */
+            file = queue.back();
+            queue.pop_back();
+            ++busy;
+        }
+
+        try
+        {
+            check_file(file);
+        }
+        catch (const Exception & e)
+        {
+            Log::get_instance()->message("reconcilio.broken_linkage_finder.failure", ll_warning, lc_no_context)
+                << "Error checking '" << file << "': '" << e.message() << "' (" << e.what() << ")";
+        }
+        catch (const std::exception & e)
+        {
+            Log::get_instance()->message("reconcilio.broken_linkage_finder.failure", ll_warning, lc_no_context)
+                << "Error checking '" << file << "': " << e.what();
+        }
+
+        {
+            Lock l(queue_mutex);
+            if (0 == --busy && queue.empty())
+                queue_condition.broadcast();
+        }
+    }
+}
+
 void
 Implementation<BrokenLinkageFinder>::check_file(const FSEntry & file)
 {
@@ -335,20 +441,18 @@ Implementation<BrokenLinkageFinder>::gather_package(const std::tr1::shared_ptr<c
     if (! contents)
         return;
 
-    for (Contents::ConstIterator it(contents->begin()),
-             it_end(contents->end()); it_end != it; ++it)
-    {
-        const ContentsFileEntry * file(simple_visitor_cast<const ContentsFileEntry>(**it));
-        if (0 != file)
-        {
-            Lock l(mutex);
-            files.insert(std::make_pair(stringify(file->location_key()->value()), pkg));
-        }
-    }
+    contents->for_each_location(std::tr1::bind(&Implementation<BrokenLinkageFinder>::add_file, this, pkg, _1), true);
 
     pkg->can_drop_in_memory_cache();
 }
 
+void
+Implementation<BrokenLinkageFinder>::add_file(const std::tr1::shared_ptr<const PackageID> & pkg, const std::string & file)
+{
+    Lock l(mutex);
+    files.insert(std::make_pair(FSEntry(file), pkg));
+}
+
 BrokenLinkageFinder::BrokenPackageConstIterator
 BrokenLinkageFinder::begin_broken_packages() const
 {
@@ -20,13 +20,21 @@
 #include <paludis/contents.hh>
 #include <paludis/util/private_implementation_pattern-impl.hh>
 #include <paludis/util/wrapped_forward_iterator-impl.hh>
+#include <paludis/util/mutex.hh>
+#include <paludis/util/timestamp.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/fs_entry.hh>
+#include <paludis/util/simple_visitor_cast.hh>
+#include <paludis/util/make_shared_ptr.hh>
 #include <paludis/literal_metadata_key.hh>
-#include <list>
+#include <tr1/unordered_map>
+#include <iterator>
+#include <deque>
+#include <vector>
+#include <inttypes.h>
 
 using namespace paludis;
 
-typedef std::list<std::tr1::shared_ptr<const ContentsEntry> > Entries;
-
 namespace paludis
 {
     template <>
@@ -110,18 +118,190 @@ ContentsSymEntry::target_key() const
     return _imp->target_key;
 }
 
+namespace
+{
+    /* how each entry is held */
+    enum EntryForm
+    {
+        ef_file,
+        ef_dir,
+        ef_sym,
+        ef_other,
+        ef_object
+    };
+}
+
 namespace paludis
 {
+    /*
+     * Entries are held column by column. Each location is split into a
+     * directory, which is interned, and a name, which lives in a single
+     * arena of nul-terminated strings along with md5s and symlink targets.
+     * ContentsEntry objects are only made when an iterator reaches them, and
+     * are kept in a deque so that references to them remain valid.
+     */
     template<>
     struct Implementation<Contents>
     {
-        Entries c;
+        std::vector<unsigned char> forms;
+        std::vector<uint32_t> dirs;
+        std::vector<uint32_t> names;
+        std::vector<uint32_t> extras;
+        std::vector<std::time_t> mtimes;
+
+        std::vector<std::string> dir_strings;
+        std::tr1::unordered_map<std::string, uint32_t> dir_indices;
+        std::string arena;
+
+        mutable Mutex mutex;
+        mutable std::deque<std::tr1::shared_ptr<const ContentsEntry> > entries;
+
+        uint32_t intern_dir(const std::string & d)
+        {
+            std::tr1::unordered_map<std::string, uint32_t>::const_iterator i(dir_indices.find(d));
+            if (dir_indices.end() != i)
+                return i->second;
+
+            dir_strings.push_back(d);
+            return dir_indices.insert(std::make_pair(d, dir_strings.size() - 1)).first->second;
+        }
+
+        uint32_t add_string(const std::string & s)
+        {
+            uint32_t result(arena.length());
+            arena.append(s);
+            arena.append(1, '\0');
+            return result;
+        }
+
+        void add(const EntryForm form, const std::string & unnormalised_location, const uint32_t extra, const std::time_t mtime)
+        {
+            /* match what FSEntry would give us, without making one unless we
+             * have to */
+            const std::string location(unnormalised_location.empty() || std::string::npos != unnormalised_location.find("//") ||
+                    (1 < unnormalised_location.length() && '/' == unnormalised_location[unnormalised_location.length() - 1]) ?
+                    stringify(FSEntry(unnormalised_location)) : unnormalised_location);
+
+            std::string::size_type slash(location.rfind('/'));
+            std::string::size_type name_begin(std::string::npos == slash ? 0 : slash + 1);
+
+            forms.push_back(form);
+            dirs.push_back(intern_dir(location.substr(0, name_begin)));
+            names.push_back(add_string(location.substr(name_begin)));
+            extras.push_back(extra);
+            mtimes.push_back(mtime);
+
+            Lock l(mutex);
+            entries.push_back(std::tr1::shared_ptr<const ContentsEntry>());
+        }
+
+        void location(const std::size_t n, std::string & result) const
+        {
+            result.assign(dir_strings[dirs[n]]);
+            result.append(&arena[names[n]]);
+        }
+
+        const std::tr1::shared_ptr<const ContentsEntry> & entry(const std::size_t n) const
+        {
+            Lock l(mutex);
+            if (! entries[n])
+            {
+                std::string path;
+                location(n, path);
+
+                switch (forms[n])
+                {
+                    case ef_file:
+                        {
+                            std::tr1::shared_ptr<ContentsEntry> e(new ContentsFileEntry(path));
+                            e->add_metadata_key(make_shared_ptr(new LiteralMetadataTimeKey("mtime", "mtime", mkt_normal,
+                                            Timestamp(mtimes[n], 0))));
+                            e->add_metadata_key(make_shared_ptr(new LiteralMetadataValueKey<std::string>("md5", "md5", mkt_normal,
+                                            std::string(&arena[extras[n]]))));
+                            entries[n] = e;
+                        }
+                        break;
+
+                    case ef_dir:
+                        entries[n].reset(new ContentsDirEntry(path));
+                        break;
+
+                    case ef_sym:
+                        {
+                            std::tr1::shared_ptr<ContentsEntry> e(new ContentsSymEntry(path, std::string(&arena[extras[n]])));
+                            e->add_metadata_key(make_shared_ptr(new LiteralMetadataTimeKey("mtime", "mtime", mkt_normal,
+                                            Timestamp(mtimes[n], 0))));
+                            entries[n] = e;
+                        }
+                        break;
+
+                    case ef_other:
+                        entries[n].reset(new ContentsOtherEntry(path));
+                        break;
+
+                    case ef_object:
+                        throw InternalError(PALUDIS_HERE, "ef_object entry with no object");
+                }
+            }
+
+            return entries[n];
+        }
+    };
+
+    /*
+     * Iterates over Implementation<Contents>, creating entries as needed.
+     */
+    class ContentsEntriesIterator
+    {
+        private:
+            const Implementation<Contents> * _imp;
+            std::size_t _n;
+
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef const std::tr1::shared_ptr<const ContentsEntry> value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const std::tr1::shared_ptr<const ContentsEntry> * pointer;
+            typedef const std::tr1::shared_ptr<const ContentsEntry> & reference;
+
+            ContentsEntriesIterator() :
+                _imp(0),
+                _n(0)
+            {
+            }
+
+            ContentsEntriesIterator(const Implementation<Contents> * const i, const std::size_t n) :
+                _imp(i),
+                _n(n)
+            {
+            }
+
+            reference operator* () const
+            {
+                return _imp->entry(_n);
+            }
+
+            pointer operator-> () const
+            {
+                return &_imp->entry(_n);
+            }
+
+            ContentsEntriesIterator & operator++ ()
+            {
+                ++_n;
+                return *this;
+            }
+
+            bool operator== (const ContentsEntriesIterator & other) const
+            {
+                return _n == other._n;
+            }
     };
 
     template <>
     struct WrappedForwardIteratorTraits<Contents::ConstIteratorTag>
     {
-        typedef Entries::const_iterator UnderlyingIterator;
+        typedef ContentsEntriesIterator UnderlyingIterator;
     };
 }
 
@@ -137,19 +317,79 @@ Contents::~Contents()
 void
 Contents::add(const std::tr1::shared_ptr<const ContentsEntry> & c)
 {
-    _imp->c.push_back(c);
+    _imp->forms.push_back(ef_object);
+    _imp->dirs.push_back(0);
+    _imp->names.push_back(0);
+    _imp->extras.push_back(0);
+    _imp->mtimes.push_back(0);
+
+    Lock l(_imp->mutex);
+    _imp->entries.push_back(c);
+}
+
+void
+Contents::add_file(const std::string & location, const std::string & md5, const Timestamp & mtime)
+{
+    _imp->add(ef_file, location, _imp->add_string(md5), mtime.seconds());
+}
+
+void
+Contents::add_dir(const std::string & location)
+{
+    _imp->add(ef_dir, location, 0, 0);
+}
+
+void
+Contents::add_sym(const std::string & location, const std::string & target, const Timestamp & mtime)
+{
+    _imp->add(ef_sym, location, _imp->add_string(target), mtime.seconds());
+}
+
+void
+Contents::add_other(const std::string & location)
+{
+    _imp->add(ef_other, location, 0, 0);
+}
+
+void
+Contents::for_each_location(const std::tr1::function<void (const std::string &)> & f, const bool files_only) const
+{
+    std::string path;
+    for (std::size_t n(0), n_end(_imp->forms.size()) ; n != n_end ; ++n)
+    {
+        if (ef_object == _imp->forms[n])
+        {
+            std::tr1::shared_ptr<const ContentsEntry> e;
+            {
+                Lock l(_imp->mutex);
+                e = _imp->entries[n];
+            }
+
+            if (files_only && ! simple_visitor_cast<const ContentsFileEntry>(*e))
+                continue;
+            path = stringify(e->location_key()->value());
+        }
+        else
+        {
+            if (files_only && ef_file != _imp->forms[n])
+                continue;
+            _imp->location(n, path);
+        }
+
+        f(path);
+    }
 }
 
 Contents::ConstIterator
 Contents::begin() const
 {
-    return ConstIterator(_imp->c.begin());
+    return ConstIterator(ContentsEntriesIterator(_imp.get(), 0));
 }
 
 Contents::ConstIterator
 Contents::end() const
 {
-    return ConstIterator(_imp->c.end());
+    return ConstIterator(ContentsEntriesIterator(_imp.get(), _imp->forms.size()));
 }
 
 template class InstantiationPolicy<Contents, instantiation_method::NonCopyableTag>;
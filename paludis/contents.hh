@@ -27,8 +27,10 @@
 #include <paludis/util/type_list.hh>
 #include <paludis/util/wrapped_forward_iterator.hh>
 #include <paludis/util/fs_entry-fwd.hh>
+#include <paludis/util/timestamp-fwd.hh>
 #include <paludis/metadata_key_holder.hh>
 #include <tr1/memory>
+#include <tr1/functional>
 #include <string>
 
 /** \file
@@ -196,6 +198,12 @@ namespace paludis
     /**
      * A package's contents, obtainable by PackageID::contents_key.
      *
+     * Entries added using add_file, add_dir, add_sym or add_other are held
+     * in a compact form, and a ContentsEntry is only created for them when
+     * they are reached by iteration. For large contents where only locations
+     * are needed, for_each_location avoids creating ContentsEntry objects at
+     * all.
+     *
      * \ingroup g_contents
      * \nosubgrouping
      */
@@ -215,6 +223,49 @@ namespace paludis
             /// Add a new entry.
             void add(const std::tr1::shared_ptr<const ContentsEntry> & c);
 
+            ///\name Add entries in compact form
+            ///\{
+
+            /**
+             * Add a ContentsFileEntry, with md5 and mtime keys.
+             *
+             * \since 0.48
+             */
+            void add_file(const std::string & location, const std::string & md5, const Timestamp & mtime);
+
+            /**
+             * Add a ContentsDirEntry.
+             *
+             * \since 0.48
+             */
+            void add_dir(const std::string & location);
+
+            /**
+             * Add a ContentsSymEntry, with an mtime key.
+             *
+             * \since 0.48
+             */
+            void add_sym(const std::string & location, const std::string & target, const Timestamp & mtime);
+
+            /**
+             * Add a ContentsOtherEntry.
+             *
+             * \since 0.48
+             */
+            void add_other(const std::string & location);
+
+            ///\}
+
+            /**
+             * Call a function with the location of every entry, or of every
+             * ContentsFileEntry if files_only is set, without creating
+             * ContentsEntry objects for them.
+             *
+             * \since 0.48
+             */
+            void for_each_location(const std::tr1::function<void (const std::string &)> &,
+                    const bool files_only = false) const;
+
             ///\name Iterate over our entries
             ///\{
 
@@ -0,0 +1,105 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/contents.hh>
+#include <paludis/metadata_key.hh>
+#include <paludis/util/fs_entry.hh>
+#include <paludis/util/simple_visitor_cast.hh>
+#include <paludis/util/timestamp.hh>
+#include <paludis/util/make_shared_ptr.hh>
+#include <paludis/util/join.hh>
+#include <test/test_framework.hh>
+#include <test/test_runner.hh>
+#include <tr1/functional>
+#include <vector>
+
+using namespace test;
+using namespace paludis;
+
+namespace
+{
+    void add_path(std::vector<std::string> & paths, const std::string & path)
+    {
+        paths.push_back(path);
+    }
+}
+
+namespace test_cases
+{
+    struct ContentsTest : TestCase
+    {
+        ContentsTest() : TestCase("contents") { }
+
+        void run()
+        {
+            Contents contents;
+            contents.add_dir("/usr");
+            contents.add_file("/usr/bin/foo", "0123456789abcdef0123456789abcdef", Timestamp(1234, 0));
+            contents.add_sym("/usr/bin/bar", "foo", Timestamp(2345, 0));
+            contents.add(make_shared_ptr(new ContentsFileEntry(FSEntry("/usr/bin/baz"))));
+            contents.add_other("/dev//null/");
+
+            std::vector<std::string> paths;
+            contents.for_each_location(std::tr1::bind(&add_path, std::tr1::ref(paths), std::tr1::placeholders::_1));
+            TEST_CHECK_EQUAL(join(paths.begin(), paths.end(), " "), "/usr /usr/bin/foo /usr/bin/bar /usr/bin/baz /dev/null");
+
+            paths.clear();
+            contents.for_each_location(std::tr1::bind(&add_path, std::tr1::ref(paths), std::tr1::placeholders::_1), true);
+            TEST_CHECK_EQUAL(join(paths.begin(), paths.end(), " "), "/usr/bin/foo /usr/bin/baz");
+
+            Contents::ConstIterator i(contents.begin());
+
+            TEST_CHECK(i != contents.end());
+            TEST_CHECK(simple_visitor_cast<const ContentsDirEntry>(**i));
+            TEST_CHECK_EQUAL((*i)->location_key()->value(), FSEntry("/usr"));
+
+            ++i;
+            TEST_CHECK(i != contents.end());
+            TEST_CHECK(simple_visitor_cast<const ContentsFileEntry>(**i));
+            TEST_CHECK_EQUAL((*i)->location_key()->value(), FSEntry("/usr/bin/foo"));
+            TEST_CHECK_EQUAL(simple_visitor_cast<const MetadataValueKey<std::string> >(
+                        **(*i)->find_metadata("md5"))->value(), "0123456789abcdef0123456789abcdef");
+            TEST_CHECK_EQUAL(simple_visitor_cast<const MetadataTimeKey>(
+                        **(*i)->find_metadata("mtime"))->value().seconds(), 1234);
+
+            ++i;
+            TEST_CHECK(i != contents.end());
+            const ContentsSymEntry * sym(simple_visitor_cast<const ContentsSymEntry>(**i));
+            TEST_CHECK(sym);
+            TEST_CHECK_EQUAL(sym->location_key()->value(), FSEntry("/usr/bin/bar"));
+            TEST_CHECK_EQUAL(sym->target_key()->value(), "foo");
+
+            ++i;
+            TEST_CHECK(i != contents.end());
+            TEST_CHECK(simple_visitor_cast<const ContentsFileEntry>(**i));
+            TEST_CHECK_EQUAL((*i)->location_key()->value(), FSEntry("/usr/bin/baz"));
+
+            ++i;
+            TEST_CHECK(i != contents.end());
+            TEST_CHECK(simple_visitor_cast<const ContentsOtherEntry>(**i));
+            TEST_CHECK_EQUAL((*i)->location_key()->value(), FSEntry("/dev/null"));
+
+            ++i;
+            TEST_CHECK(i == contents.end());
+
+            /* entries are only made once */
+            TEST_CHECK(contents.begin()->get() == contents.begin()->get());
+        }
+    } test_contents;
+}
@@ -17,13 +17,13 @@
  * Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include "config.h"
 #include "elf_linkage_checker.hh"
+#include <paludis/linkage_cache.hh>
 
 #include <paludis/util/elf.hh>
-#include <paludis/util/elf_dynamic_section.hh>
 #include <paludis/util/elf_types.hh>
-#include <paludis/util/elf_relocation_section.hh>
-#include <paludis/util/elf_symbol_section.hh>
+#include <paludis/util/byte_swap.hh>
 
 #include <paludis/util/realpath.hh>
 #include <paludis/util/fs_entry.hh>
@@ -35,19 +35,276 @@
 #include <paludis/util/member_iterator-impl.hh>
 #include <paludis/util/simple_visitor_cast.hh>
 #include <paludis/util/wrapped_forward_iterator.hh>
-#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/instantiation_policy.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/destringify.hh>
 
+#include <tr1/functional>
 #include <algorithm>
+#include <iterator>
 #include <cerrno>
 #include <cstring>
 #include <map>
 #include <set>
 #include <vector>
 
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 using namespace paludis;
 
 namespace
 {
+    /*
+     * The contents of a file, mapped into memory where possible so that we
+     * only read in the pages we actually look at.
+     */
+    class MappedFile :
+        private InstantiationPolicy<MappedFile, instantiation_method::NonCopyableTag>
+    {
+        private:
+            void * _map;
+            std::size_t _size;
+            std::vector<char> _buffer;
+
+        public:
+            MappedFile(const FSEntry & file) :
+                _map(0),
+                _size(0)
+            {
+                int fd(::open(stringify(file).c_str(), O_RDONLY | O_CLOEXEC));
+                if (-1 == fd)
+                    throw FSError("Cannot open '" + stringify(file) + "': " + std::strerror(errno));
+
+                try
+                {
+                    struct ::stat st;
+                    if (0 != ::fstat(fd, &st))
+                        throw FSError("Cannot fstat '" + stringify(file) + "': " + std::strerror(errno));
+
+                    if (0 < st.st_size && static_cast<uint64_t>(st.st_size) == static_cast<std::size_t>(st.st_size))
+                    {
+                        _size = st.st_size;
+                        _map = ::mmap(0, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+                        if (MAP_FAILED == _map)
+                        {
+                            /* not everything can be mapped, so fall back to
+                             * reading it in */
+                            _map = 0;
+                            _buffer.resize(_size);
+                            std::size_t done(0);
+                            while (done < _size)
+                            {
+                                ssize_t n(::pread(fd, &_buffer[done], _size - done, done));
+                                if (-1 == n && EINTR == errno)
+                                    continue;
+                                if (-1 == n)
+                                    throw FSError("Cannot read '" + stringify(file) + "': " + std::strerror(errno));
+                                if (0 == n)
+                                    break;
+                                done += n;
+                            }
+                            _size = done;
+                        }
+                    }
+                }
+                catch (...)
+                {
+                    ::close(fd);
+                    throw;
+                }
+
+                ::close(fd);
+            }
+
+            ~MappedFile()
+            {
+                if (_map)
+                    ::munmap(_map, _size);
+            }
+
+            const char * data() const
+            {
+                return _map ? static_cast<const char *>(_map) : _buffer.empty() ? 0 : &_buffer[0];
+            }
+
+            std::size_t size() const
+            {
+                return _size;
+            }
+    };
+
+    /*
+     * Just enough of an ELF reader to get at the architecture information
+     * and the NEEDED entries from a mapped file. Unlike ElfObject, this
+     * doesn't load every section, so we don't pay for symbol and relocation
+     * tables we'd never look at.
+     */
+    template <typename ElfType_>
+    class MappedElf
+    {
+        private:
+            const MappedFile & _file;
+            typename ElfType_::Header _hdr;
+            bool _need_byte_swap;
+
+            template <typename T_>
+            T_ swapped(const T_ & t) const
+            {
+                return _need_byte_swap ? byte_swap(t) : t;
+            }
+
+            template <typename T_>
+            T_ read(const uint64_t offset, const std::string & what) const
+            {
+                if (offset > _file.size() || _file.size() - offset < sizeof(T_))
+                    throw InvalidElfFileError("file is truncated, or the offset of " + what + " points past the end of the file");
+
+                T_ result;
+                std::memcpy(&result, _file.data() + offset, sizeof(T_));
+                return result;
+            }
+
+            typename ElfType_::SectionHeader section_header(const uint64_t n) const
+            {
+                typename ElfType_::SectionHeader result(read<typename ElfType_::SectionHeader>(
+                            _hdr.e_shoff + n * sizeof(typename ElfType_::SectionHeader), "section header " + stringify(n)));
+                result.sh_type = swapped(result.sh_type);
+                result.sh_offset = swapped(result.sh_offset);
+                result.sh_size = swapped(result.sh_size);
+                result.sh_link = swapped(result.sh_link);
+                result.sh_entsize = swapped(result.sh_entsize);
+                return result;
+            }
+
+        public:
+            static bool is_valid_elf(const MappedFile & file)
+            {
+                if (file.size() < EI_NIDENT)
+                    return false;
+
+                const char * const ident(file.data());
+                return ident[EI_MAG0] == ELFMAG0 && ident[EI_MAG1] == ELFMAG1 &&
+                    ident[EI_MAG2] == ELFMAG2 && ident[EI_MAG3] == ELFMAG3 &&
+                    ident[EI_VERSION] == EV_CURRENT &&
+                    (ident[EI_DATA] == ELFDATA2LSB || ident[EI_DATA] == ELFDATA2MSB) &&
+                    ident[EI_CLASS] == ElfType_::elf_class;
+            }
+
+            MappedElf(const MappedFile & file) :
+                _file(file),
+                _hdr(read<typename ElfType_::Header>(0, "the ELF header")),
+#ifdef WORDS_BIGENDIAN
+                _need_byte_swap(_hdr.e_ident[EI_DATA] != ELFDATA2MSB)
+#else
+                _need_byte_swap(_hdr.e_ident[EI_DATA] != ELFDATA2LSB)
+#endif
+            {
+                _hdr.e_type = swapped(_hdr.e_type);
+                _hdr.e_machine = swapped(_hdr.e_machine);
+                _hdr.e_shoff = swapped(_hdr.e_shoff);
+                _hdr.e_flags = swapped(_hdr.e_flags);
+                _hdr.e_shentsize = swapped(_hdr.e_shentsize);
+                _hdr.e_shnum = swapped(_hdr.e_shnum);
+            }
+
+            unsigned int get_type() const
+            {
+                return _hdr.e_type;
+            }
+
+            unsigned int get_arch() const
+            {
+                return _hdr.e_machine;
+            }
+
+            unsigned char get_os_abi() const
+            {
+                return _hdr.e_ident[EI_OSABI];
+            }
+
+            unsigned char get_os_abi_version() const
+            {
+                return _hdr.e_ident[EI_ABIVERSION];
+            }
+
+            unsigned int get_flags() const
+            {
+                return _hdr.e_flags;
+            }
+
+            bool is_big_endian() const
+            {
+                return _hdr.e_ident[EI_DATA] == ELFDATA2MSB;
+            }
+
+            /*
+             * Find the NEEDED entries in every dynamic section, resolving
+             * them against the string table that section links to.
+             */
+            template <typename Iter_>
+            void needed(Iter_ out) const
+            {
+                if (! _hdr.e_shoff)
+                    return;
+
+                if (sizeof(typename ElfType_::SectionHeader) != _hdr.e_shentsize)
+                    throw InvalidElfFileError(
+                        "bad e_shentsize: got " + stringify(_hdr.e_shentsize) + ", expected " +
+                        stringify(sizeof(typename ElfType_::SectionHeader)));
+
+                uint64_t shnum(_hdr.e_shnum);
+                if (0 == shnum)
+                {
+                    shnum = section_header(0).sh_size;
+                    if (0 == shnum)
+                        throw InvalidElfFileError("got non-zero e_shoff and zero e_shnum, but sh_size of the first section is zero");
+                }
+
+                for (uint64_t n(0) ; n < shnum ; ++n)
+                {
+                    const typename ElfType_::SectionHeader dyn(section_header(n));
+                    if (SHT_DYNAMIC != dyn.sh_type)
+                        continue;
+
+                    if (sizeof(typename ElfType_::DynamicEntry) != dyn.sh_entsize)
+                        throw InvalidElfFileError(
+                            "bad sh_entsize for section " + stringify(n) + ": got " + stringify(dyn.sh_entsize) + ", expected " +
+                            stringify(sizeof(typename ElfType_::DynamicEntry)));
+
+                    if (dyn.sh_link >= shnum)
+                        throw InvalidElfFileError("section " + stringify(n) + " references non-existent section " +
+                                stringify(dyn.sh_link) + " in sh_link");
+
+                    const typename ElfType_::SectionHeader strtab(section_header(dyn.sh_link));
+                    if (SHT_STRTAB != strtab.sh_type)
+                        continue;
+                    if (strtab.sh_offset > _file.size() || _file.size() - strtab.sh_offset < strtab.sh_size)
+                        throw InvalidElfFileError("file is truncated, or the string table for section " +
+                                stringify(n) + " points past the end of the file");
+
+                    const char * const strings(_file.data() + strtab.sh_offset);
+                    for (uint64_t e(0) ; e < dyn.sh_size / sizeof(typename ElfType_::DynamicEntry) ; ++e)
+                    {
+                        const typename ElfType_::DynamicEntry entry(read<typename ElfType_::DynamicEntry>(
+                                    dyn.sh_offset + e * sizeof(typename ElfType_::DynamicEntry), "section " + stringify(n)));
+                        if (DT_NEEDED != swapped(entry.d_tag))
+                            continue;
+
+                        const uint64_t index(swapped(entry.d_un.d_val));
+                        if (index >= strtab.sh_size)
+                            throw InvalidElfFileError("section " + stringify(n) + " has out-of-range string index " +
+                                    stringify(index) + " (max " + stringify(strtab.sh_size) + ")");
+
+                        *out++ = std::string(strings + index, strnlen(strings + index, strtab.sh_size - index));
+                    }
+                }
+            }
+    };
+
     struct ElfArchitecture
     {
         // not in elf.h; from glibc-2.5/sysdeps/s390/s390-32/dl-machine.h
@@ -74,7 +331,7 @@ namespace
         }
 
         template <typename ElfType_>
-        ElfArchitecture(const ElfObject<ElfType_> & elf) :
+        ElfArchitecture(const MappedElf<ElfType_> & elf) :
             _machine(normalise_arch(elf.get_arch())),
             _class(ElfType_::elf_class),
             _os_abi(elf.get_os_abi()),
@@ -83,6 +340,29 @@ namespace
             _mips_n32(EM_MIPS == _machine && MIPS_ABI2 & elf.get_flags())
         {
         }
+
+        /* for use with LinkageCache */
+        ElfArchitecture(std::vector<std::string>::const_iterator fields) :
+            _machine(destringify<unsigned>(fields[0])),
+            _class(destringify<unsigned>(fields[1])),
+            _os_abi(destringify<unsigned>(fields[2])),
+            _os_abi_version(destringify<unsigned>(fields[3])),
+            _bigendian(destringify<unsigned>(fields[4])),
+            _mips_n32(destringify<unsigned>(fields[5]))
+        {
+        }
+
+        static const unsigned number_of_fields = 6;
+
+        void append_fields(std::vector<std::string> & fields) const
+        {
+            fields.push_back(stringify(_machine));
+            fields.push_back(stringify(unsigned(_class)));
+            fields.push_back(stringify(unsigned(_os_abi)));
+            fields.push_back(stringify(unsigned(_os_abi_version)));
+            fields.push_back(stringify(unsigned(_bigendian)));
+            fields.push_back(stringify(unsigned(_mips_n32)));
+        }
     };
 
     bool
@@ -103,8 +383,40 @@ namespace
 }
 
 typedef std::multimap<FSEntry, FSEntry> Symlinks;
+typedef std::map<ElfArchitecture, std::vector<std::string> > Libraries;
 typedef std::map<ElfArchitecture, std::map<std::string, std::vector<FSEntry> > > Needed;
 
+namespace
+{
+    /*
+     * Files are checked from several threads at once, so what we find is
+     * split between several shards, each with its own lock, according to
+     * the library's path. A library and the symlinks to it always end up in
+     * the same shard.
+     */
+    struct Shard
+    {
+        Mutex mutex;
+
+        std::map<FSEntry, ElfArchitecture> seen;
+        Symlinks symlinks;
+
+        Libraries libraries;
+        Needed needed;
+    };
+
+    const unsigned number_of_shards(16);
+
+    bool usable_record(const std::vector<std::string> & record)
+    {
+        if (record.empty())
+            return false;
+        if ("elf" == record.front())
+            return record.size() >= 2 + ElfArchitecture::number_of_fields;
+        return "none" == record.front() || "other" == record.front();
+    }
+}
+
 namespace paludis
 {
     template <>
@@ -113,30 +425,35 @@ namespace paludis
         FSEntry root;
         std::string library;
 
-        Mutex mutex;
+        Shard shards[number_of_shards];
 
-        std::map<FSEntry, ElfArchitecture> seen;
-        Symlinks symlinks;
+        std::vector<FSEntry> extra_lib_dirs;
 
-        std::map<ElfArchitecture, std::vector<std::string> > libraries;
-        Needed needed;
+        Shard & shard_for(const FSEntry & f)
+        {
+            return shards[std::tr1::hash<std::string>()(stringify(f)) % number_of_shards];
+        }
 
-        std::vector<FSEntry> extra_lib_dirs;
+        const std::tr1::shared_ptr<LinkageCache> cache;
 
-        template <typename> bool check_elf(const FSEntry &, std::istream &);
-        void handle_library(const FSEntry &, const ElfArchitecture &);
-        template <typename> bool check_extra_elf(const FSEntry &, std::istream &, std::set<ElfArchitecture> &);
+        template <typename> bool read_elf(const FSEntry &, const MappedFile &, std::vector<std::string> &);
+        bool check_record(const FSEntry &, const std::vector<std::string> &);
+        void handle_library(Shard &, const FSEntry &, const ElfArchitecture &);
+        template <typename> bool check_extra_elf(const FSEntry &, const MappedFile &, std::set<ElfArchitecture> &);
 
-        Implementation(const FSEntry & the_root, const std::string & the_library) :
+        Implementation(const FSEntry & the_root, const std::string & the_library,
+                const std::tr1::shared_ptr<LinkageCache> & the_cache) :
             root(the_root),
-            library(the_library)
+            library(the_library),
+            cache(the_cache)
         {
         }
     };
 }
 
-ElfLinkageChecker::ElfLinkageChecker(const FSEntry & root, const std::string & library) :
-    PrivateImplementationPattern<ElfLinkageChecker>(new Implementation<ElfLinkageChecker>(root, library))
+ElfLinkageChecker::ElfLinkageChecker(const FSEntry & root, const std::string & library,
+        const std::tr1::shared_ptr<LinkageCache> & cache) :
+    PrivateImplementationPattern<ElfLinkageChecker>(new Implementation<ElfLinkageChecker>(root, library, cache))
 {
 }
 
@@ -153,76 +470,112 @@ ElfLinkageChecker::check_file(const FSEntry & file)
            file.has_permission(fs_ug_owner, fs_perm_execute)))
         return false;
 
-    SafeIFStream stream(file);
-    return _imp->check_elf<Elf32Type>(file, stream) || _imp->check_elf<Elf64Type>(file, stream);
+    std::vector<std::string> record;
+    if (! (_imp->cache && _imp->cache->get("elf", file, record) && usable_record(record)))
+    {
+        record.clear();
+
+        MappedFile mapped(file);
+        if (! (_imp->read_elf<Elf32Type>(file, mapped, record) || _imp->read_elf<Elf64Type>(file, mapped, record)))
+            record.push_back("none");
+
+        /* don't remember broken files, so we keep on complaining about them */
+        if (_imp->cache && "invalid" != record.front())
+            _imp->cache->put("elf", file, record);
+    }
+
+    return _imp->check_record(file, record);
 }
 
+/*
+ * What we need to know about a file is kept as a record, which can come
+ * from the LinkageCache rather than from the file itself. The first field
+ * is "none" for something that isn't ELF, "invalid" for a broken ELF file,
+ * "other" for an ELF file that isn't an executable or a shared library,
+ * and "elf" otherwise, in which case it's followed by the type, the
+ * ElfArchitecture fields and the NEEDED entries.
+ */
 template <typename ElfType_>
 bool
-Implementation<ElfLinkageChecker>::check_elf(const FSEntry & file, std::istream & stream)
+Implementation<ElfLinkageChecker>::read_elf(const FSEntry & file, const MappedFile & mapped, std::vector<std::string> & record)
 {
-    if (! ElfObject<ElfType_>::is_valid_elf(stream))
+    if (! MappedElf<ElfType_>::is_valid_elf(mapped))
         return false;
 
     try
     {
         Context ctx("When checking '" + stringify(file) + "' as a " +
                     stringify<int>(ElfType_::elf_class * 32) + "-bit ELF file:");
-        ElfObject<ElfType_> elf(stream);
+        MappedElf<ElfType_> elf(mapped);
         if (ET_EXEC != elf.get_type() && ET_DYN != elf.get_type())
         {
-            Log::get_instance()->message("reconcilio.broken_linkage_finder.not_interesting", ll_debug, lc_context)
-                << "File is not an executable or shared library";
+            record.push_back("other");
             return true;
         }
 
-        ElfArchitecture arch(elf);
-        elf.resolve_all_strings();
-
-        Lock l(mutex);
-
-        if (library.empty() && ET_DYN == elf.get_type())
-            handle_library(file, arch);
-
-        for (typename ElfObject<ElfType_>::SectionIterator sec_it(elf.section_begin()),
-                 sec_it_end(elf.section_end()); sec_it_end != sec_it; ++sec_it)
-        {
-            const DynamicSection<ElfType_> * dyn_sec(simple_visitor_cast<const DynamicSection<ElfType_> >(*sec_it));
-
-            if (0 != dyn_sec)
-                for (typename DynamicSection<ElfType_>::EntryIterator ent_it(dyn_sec->entry_begin()),
-                         ent_it_end(dyn_sec->entry_end()); ent_it_end != ent_it; ++ent_it)
-                {
-                    const DynamicEntryString<ElfType_> * ent_str(simple_visitor_cast<const DynamicEntryString<ElfType_> >(*ent_it));
+        std::vector<std::string> reqs;
+        elf.needed(std::back_inserter(reqs));
 
-                    if (0 != ent_str && "NEEDED" == ent_str->tag_name())
-                    {
-                        const std::string & req((*ent_str)());
-                        if (library.empty() || library == req)
-                        {
-                            Log::get_instance()->message("reconcilio.broken_linkage_finder.depends", ll_debug, lc_context)
-                                << "File depends on " << req;
-                            needed[arch][req].push_back(file);
-                        }
-                    }
-                }
-        }
+        record.push_back("elf");
+        record.push_back(stringify(elf.get_type()));
+        ElfArchitecture(elf).append_fields(record);
+        std::copy(reqs.begin(), reqs.end(), std::back_inserter(record));
     }
     catch (const InvalidElfFileError & e)
     {
         Log::get_instance()->message("reconcilio.broken_linkage_finder.invalid", ll_warning, lc_no_context)
             << "'" << file << "' appears to be invalid or corrupted: " << e.message();
+        record.assign(1, "invalid");
     }
 
     return true;
 }
 
+bool
+Implementation<ElfLinkageChecker>::check_record(const FSEntry & file, const std::vector<std::string> & record)
+{
+    if ("none" == record.front())
+        return false;
+
+    if ("invalid" == record.front())
+        return true;
+
+    Context ctx("When checking '" + stringify(file) + "' as an ELF file:");
+
+    if ("other" == record.front())
+    {
+        Log::get_instance()->message("reconcilio.broken_linkage_finder.not_interesting", ll_debug, lc_context)
+            << "File is not an executable or shared library";
+        return true;
+    }
+
+    const unsigned type(destringify<unsigned>(record[1]));
+    const ElfArchitecture arch(record.begin() + 2);
+
+    Shard & shard(shard_for(file));
+    Lock l(shard.mutex);
+
+    if (library.empty() && ET_DYN == type)
+        handle_library(shard, file, arch);
+
+    for (std::vector<std::string>::const_iterator req(record.begin() + 2 + ElfArchitecture::number_of_fields),
+             req_end(record.end()) ; req != req_end ; ++req)
+        if (library.empty() || library == *req)
+        {
+            Log::get_instance()->message("reconcilio.broken_linkage_finder.depends", ll_debug, lc_context)
+                << "File depends on " << *req;
+            shard.needed[arch][*req].push_back(file);
+        }
+
+    return true;
+}
+
 void
-Implementation<ElfLinkageChecker>::handle_library(const FSEntry & file, const ElfArchitecture & arch)
+Implementation<ElfLinkageChecker>::handle_library(Shard & shard, const FSEntry & file, const ElfArchitecture & arch)
 {
-    seen.insert(std::make_pair(file, arch));
-    std::pair<Symlinks::const_iterator, Symlinks::const_iterator> range(symlinks.equal_range(file));
-    libraries[arch].push_back(file.basename());
+    shard.seen.insert(std::make_pair(file, arch));
+    std::pair<Symlinks::const_iterator, Symlinks::const_iterator> range(shard.symlinks.equal_range(file));
+    shard.libraries[arch].push_back(file.basename());
 
     if (range.first != range.second)
     {
@@ -230,7 +583,7 @@ Implementation<ElfLinkageChecker>::handle_library(const FSEntry & file, const El
                 ll_debug, lc_context) << "Known symlinks are " <<
             join(second_iterator(range.first), second_iterator(range.second), " ");
         std::transform(second_iterator(range.first), second_iterator(range.second),
-                       std::back_inserter(libraries[arch]), std::tr1::mem_fn(&FSEntry::basename));
+                       std::back_inserter(shard.libraries[arch]), std::tr1::mem_fn(&FSEntry::basename));
     }
 }
 
@@ -239,17 +592,18 @@ ElfLinkageChecker::note_symlink(const FSEntry & link, const FSEntry & target)
 {
     if (_imp->library.empty())
     {
-        Lock l(_imp->mutex);
+        Shard & shard(_imp->shard_for(target));
+        Lock l(shard.mutex);
 
-        std::map<FSEntry, ElfArchitecture>::const_iterator it(_imp->seen.find(target));
-        if (_imp->seen.end() != it)
+        std::map<FSEntry, ElfArchitecture>::const_iterator it(shard.seen.find(target));
+        if (shard.seen.end() != it)
         {
             Log::get_instance()->message("reconcilio.broken_linkage_finder.note_symlink", ll_debug, lc_context)
                 << "'" << link << "' is a symlink to known library '" << target << "'";
-            _imp->libraries[it->second].push_back(link.basename());
+            shard.libraries[it->second].push_back(link.basename());
         }
         else
-            _imp->symlinks.insert(std::make_pair(target, link));
+            shard.symlinks.insert(std::make_pair(target, link));
     }
 }
 
@@ -265,23 +619,38 @@ ElfLinkageChecker::need_breakage_added(
 {
     using namespace std::tr1::placeholders;
 
+    Libraries libraries;
+    Needed needed;
+    for (unsigned n(0) ; n < number_of_shards ; ++n)
+    {
+        for (Libraries::const_iterator it(_imp->shards[n].libraries.begin()),
+                 it_end(_imp->shards[n].libraries.end()); it_end != it; ++it)
+            std::copy(it->second.begin(), it->second.end(), std::back_inserter(libraries[it->first]));
+
+        for (Needed::const_iterator arch_it(_imp->shards[n].needed.begin()),
+                 arch_it_end(_imp->shards[n].needed.end()); arch_it_end != arch_it; ++arch_it)
+            for (std::map<std::string, std::vector<FSEntry> >::const_iterator it(arch_it->second.begin()),
+                     it_end(arch_it->second.end()); it_end != it; ++it)
+                std::copy(it->second.begin(), it->second.end(), std::back_inserter(needed[arch_it->first][it->first]));
+    }
+
     typedef std::map<std::string, std::set<ElfArchitecture> > AllMissing;
     AllMissing all_missing;
 
-    for (Needed::iterator arch_it(_imp->needed.begin()),
-             arch_it_end(_imp->needed.end()); arch_it_end != arch_it; ++arch_it)
+    for (Needed::iterator arch_it(needed.begin()),
+             arch_it_end(needed.end()); arch_it_end != arch_it; ++arch_it)
     {
-        std::sort(_imp->libraries[arch_it->first].begin(), _imp->libraries[arch_it->first].end());
-        _imp->libraries[arch_it->first].erase(
-            std::unique(_imp->libraries[arch_it->first].begin(),
-                        _imp->libraries[arch_it->first].end()),
-            _imp->libraries[arch_it->first].end());
+        std::sort(libraries[arch_it->first].begin(), libraries[arch_it->first].end());
+        libraries[arch_it->first].erase(
+            std::unique(libraries[arch_it->first].begin(),
+                        libraries[arch_it->first].end()),
+            libraries[arch_it->first].end());
 
         std::vector<std::string> missing;
         std::set_difference(first_iterator(arch_it->second.begin()),
                             first_iterator(arch_it->second.end()),
-                            _imp->libraries[arch_it->first].begin(),
-                            _imp->libraries[arch_it->first].end(),
+                            libraries[arch_it->first].begin(),
+                            libraries[arch_it->first].end(),
                             std::back_inserter(missing));
         for (std::vector<std::string>::const_iterator it(missing.begin()),
                  it_end(missing.end()); it_end != it; ++it)
@@ -309,14 +678,14 @@ ElfLinkageChecker::need_breakage_added(
 
             try
             {
-                SafeIFStream stream(file);
+                MappedFile mapped(file);
 
-                if (! (_imp->check_extra_elf<Elf32Type>(file, stream, missing_it->second) ||
-                       _imp->check_extra_elf<Elf64Type>(file, stream, missing_it->second)))
+                if (! (_imp->check_extra_elf<Elf32Type>(file, mapped, missing_it->second) ||
+                       _imp->check_extra_elf<Elf64Type>(file, mapped, missing_it->second)))
                     Log::get_instance()->message("reconcilio.broken_linkage_finder.not_an_elf", ll_debug, lc_no_context)
                         << "'" << file << "' is not an ELF file";
             }
-            catch (const SafeIFStreamError & e)
+            catch (const FSError & e)
             {
                 Log::get_instance()->message("reconcilio.broken_linkage_finder.failure", ll_warning, lc_no_context)
                     << "Error opening '" << file << "': '" << e.message() << "' (" << e.what() << ")";
@@ -329,24 +698,24 @@ ElfLinkageChecker::need_breakage_added(
              missing_it_end(all_missing.end()); missing_it_end != missing_it; ++missing_it)
         for (std::set<ElfArchitecture>::const_iterator arch_it(missing_it->second.begin()),
                  arch_it_end(missing_it->second.end()); arch_it_end != arch_it; ++arch_it)
-            std::for_each(_imp->needed[*arch_it][missing_it->first].begin(),
-                          _imp->needed[*arch_it][missing_it->first].end(),
+            std::for_each(needed[*arch_it][missing_it->first].begin(),
+                          needed[*arch_it][missing_it->first].end(),
                           std::tr1::bind(callback, _1, missing_it->first));
 
 }
 
 template <typename ElfType_>
 bool
-Implementation<ElfLinkageChecker>::check_extra_elf(const FSEntry & file, std::istream & stream, std::set<ElfArchitecture> & arches)
+Implementation<ElfLinkageChecker>::check_extra_elf(const FSEntry & file, const MappedFile & mapped, std::set<ElfArchitecture> & arches)
 {
-    if (! ElfObject<ElfType_>::is_valid_elf(stream))
+    if (! MappedElf<ElfType_>::is_valid_elf(mapped))
         return false;
 
     Context ctx("When checking '" + stringify(file) + "' as a " + stringify<int>(ElfType_::elf_class * 32) + "-bit ELF file");
 
     try
     {
-        ElfObject<ElfType_> elf(stream);
+        MappedElf<ElfType_> elf(mapped);
         if (ET_DYN == elf.get_type())
         {
             Log::get_instance()->message("reconcilio.broken_linkage_finder.is_library", ll_debug, lc_context)
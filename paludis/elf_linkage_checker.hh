@@ -23,16 +23,20 @@
 #include <paludis/linkage_checker.hh>
 #include <paludis/util/private_implementation_pattern.hh>
 #include <tr1/functional>
+#include <tr1/memory>
 #include <iosfwd>
 
 namespace paludis
 {
+    class LinkageCache;
+
     class ElfLinkageChecker :
         public LinkageChecker,
         private paludis::PrivateImplementationPattern<ElfLinkageChecker>
     {
         public:
-            ElfLinkageChecker(const paludis::FSEntry &, const std::string &);
+            ElfLinkageChecker(const paludis::FSEntry &, const std::string &,
+                    const std::tr1::shared_ptr<LinkageCache> &);
             virtual ~ElfLinkageChecker();
 
             virtual bool check_file(const paludis::FSEntry &) PALUDIS_ATTRIBUTE((warn_unused_result));
@@ -40,7 +40,8 @@ namespace
 
     void parse_annotations(SimpleParser & parser, const ELikeDepParserCallbacks & callbacks)
     {
-        Context context("When parsing annotation block at offset '" + stringify(parser.offset()) + "':");
+        const std::string::size_type offset(parser.offset());
+        Context context("When parsing annotation block at offset '", offset, "':");
 
         if (! parser.consume(*simple_parser::any_of(" \t\r\n") & simple_parser::exact("[[")))
             return;
@@ -134,7 +135,8 @@ namespace
     {
         while (true)
         {
-            Context context("When parsing from offset '" + stringify(parser.offset()) + "':");
+            const std::string::size_type offset(parser.offset());
+            Context context("When parsing from offset '", offset, "':");
             std::string word;
 
             if (parser.eof())
@@ -242,7 +244,7 @@ namespace
 void
 paludis::parse_elike_dependencies(const std::string & s, const ELikeDepParserCallbacks & callbacks)
 {
-    Context context("When parsing '" + s + "':");
+    Context context("When parsing '", s, "':");
 
     SimpleParser parser(s);
     parse(parser, callbacks, false, false);
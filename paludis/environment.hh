@@ -221,7 +221,7 @@ namespace paludis
             /**
              * Select some packages.
              */
-            virtual std::tr1::shared_ptr<PackageIDSequence> operator[] (const Selection &) const
+            virtual std::tr1::shared_ptr<const PackageIDSequence> operator[] (const Selection &) const
                 PALUDIS_ATTRIBUTE((warn_unused_result)) = 0;
 
             /**
@@ -193,7 +193,7 @@ EnvironmentImplementation::is_paludis_package(const QualifiedPackageName & n) co
     return stringify(n) == (*DistributionData::get_instance()->distribution_from_string(distribution())).paludis_package();
 }
 
-std::tr1::shared_ptr<PackageIDSequence>
+std::tr1::shared_ptr<const PackageIDSequence>
 EnvironmentImplementation::operator[] (const Selection & selection) const
 {
     if (_imp->selection_caches.empty())
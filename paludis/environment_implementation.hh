@@ -88,7 +88,7 @@ namespace paludis
             virtual bool is_paludis_package(const QualifiedPackageName &) const
                 PALUDIS_ATTRIBUTE((warn_unused_result));
 
-            virtual std::tr1::shared_ptr<PackageIDSequence> operator[] (const Selection &) const
+            virtual std::tr1::shared_ptr<const PackageIDSequence> operator[] (const Selection &) const
                 PALUDIS_ATTRIBUTE((warn_unused_result));
 
             virtual NotifierCallbackID add_notifier_callback(const NotifierCallbackFunction &);
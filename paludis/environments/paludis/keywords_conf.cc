@@ -24,6 +24,7 @@
 #include <paludis/spec_tree.hh>
 #include <paludis/user_dep_spec.hh>
 #include <paludis/match_package.hh>
+#include <paludis/package_dep_spec_collection.hh>
 #include <paludis/util/config_file.hh>
 #include <paludis/util/options.hh>
 #include <paludis/package_id.hh>
@@ -36,6 +37,7 @@
 #include <paludis/util/wrapped_forward_iterator.hh>
 #include <paludis/util/mutex.hh>
 #include <paludis/util/set.hh>
+#include <paludis/util/sequence.hh>
 #include <paludis/util/hashes.hh>
 #include <paludis/util/make_shared_ptr.hh>
 #include <tr1/unordered_map>
@@ -48,10 +50,9 @@ using namespace paludis::paludis_environment;
 
 typedef std::list<KeywordName> KeywordsList;
 typedef std::map<std::tr1::shared_ptr<const PackageDepSpec>, KeywordsList> PDSToKeywordsList;
-typedef std::pair<std::tr1::shared_ptr<const SetSpecTree>, KeywordsList> SetNameEntry;
+typedef std::pair<std::tr1::shared_ptr<const PackageDepSpecCollection>, KeywordsList> SetNameEntry;
 
 typedef std::tr1::unordered_map<QualifiedPackageName, PDSToKeywordsList, Hash<QualifiedPackageName> > SpecificMap;
-typedef PDSToKeywordsList UnspecificMap;
 typedef std::tr1::unordered_map<SetName, SetNameEntry, Hash<SetName> > NamedSetMap;
 
 namespace paludis
@@ -62,7 +63,8 @@ namespace paludis
         const PaludisEnvironment * const env;
 
         SpecificMap qualified;
-        UnspecificMap unqualified;
+        PackageDepSpecCollection unqualified;
+        std::vector<KeywordsList> unqualified_keywords;
         mutable NamedSetMap set;
         mutable Mutex set_mutex;
 
@@ -114,7 +116,8 @@ KeywordsConf::add(const FSEntry & filename)
             }
             else
             {
-                KeywordsList & k(_imp->unqualified[d]);
+                _imp->unqualified.insert(*d);
+                KeywordsList & k(*_imp->unqualified_keywords.insert(_imp->unqualified_keywords.end(), KeywordsList()));
                 for (std::vector<std::string>::const_iterator t(next(tokens.begin())), t_end(tokens.end()) ;
                         t != t_end ; ++t)
                     k.push_back(KeywordName(*t));
@@ -181,16 +184,17 @@ KeywordsConf::query(const std::tr1::shared_ptr<const KeywordNameSet> & k, const
         {
             if (! i->second.first)
             {
-                i->second.first = _imp->env->set(i->first);
-                if (! i->second.first)
-                {
+                std::tr1::shared_ptr<PackageDepSpecCollection> specs(new PackageDepSpecCollection);
+                std::tr1::shared_ptr<const SetSpecTree> set(_imp->env->set(i->first));
+                if (set)
+                    specs->insert_all(_imp->env, *set);
+                else
                     Log::get_instance()->message("paludis_environment.keywords_conf.unknown_set", ll_warning, lc_no_context) << "Set name '"
                         << i->first << "' does not exist";
-                    i->second.first.reset(new SetSpecTree(make_shared_ptr(new AllDepSpec)));
-                }
+                i->second.first = specs;
             }
 
-            if (! match_package_in_set(*_imp->env, *i->second.first, e, MatchPackageOptions()))
+            if (! i->second.first->match_any(*_imp->env, e, MatchPackageOptions()))
                 continue;
 
             for (KeywordsList::const_iterator l(i->second.second.begin()), l_end(i->second.second.end()) ;
@@ -213,13 +217,12 @@ KeywordsConf::query(const std::tr1::shared_ptr<const KeywordNameSet> & k, const
         return false;
 
     /* last: unspecific */
-    for (PDSToKeywordsList::const_iterator j(_imp->unqualified.begin()), j_end(_imp->unqualified.end()) ;
+    std::tr1::shared_ptr<const Sequence<unsigned> > unqualified(_imp->unqualified.match_all(*_imp->env, e, MatchPackageOptions()));
+    for (Sequence<unsigned>::ConstIterator j(unqualified->begin()), j_end(unqualified->end()) ;
             j != j_end ; ++j)
     {
-        if (! match_package(*_imp->env, *j->first, e, MatchPackageOptions()))
-            continue;
-
-        for (KeywordsList::const_iterator l(j->second.begin()), l_end(j->second.end()) ;
+        const KeywordsList & keywords(_imp->unqualified_keywords[*j]);
+        for (KeywordsList::const_iterator l(keywords.begin()), l_end(keywords.end()) ;
                 l != l_end ; ++l)
         {
             if (k->end() != k->find(*l))
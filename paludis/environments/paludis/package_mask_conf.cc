@@ -24,6 +24,7 @@
 #include <paludis/spec_tree.hh>
 #include <paludis/user_dep_spec.hh>
 #include <paludis/match_package.hh>
+#include <paludis/package_dep_spec_collection.hh>
 #include <paludis/util/config_file.hh>
 #include <paludis/package_id.hh>
 #include <paludis/environments/paludis/paludis_environment.hh>
@@ -33,18 +34,14 @@
 #include <paludis/util/options.hh>
 #include <paludis/util/tokeniser.hh>
 #include <paludis/util/private_implementation_pattern-impl.hh>
-#include <paludis/util/indirect_iterator-impl.hh>
 #include <paludis/util/mutex.hh>
 #include <paludis/util/hashes.hh>
-#include <paludis/util/make_shared_ptr.hh>
 #include <list>
-#include <algorithm>
-#include <tr1/functional>
 
 using namespace paludis;
 using namespace paludis::paludis_environment;
 
-typedef std::list<std::pair<SetName, std::tr1::shared_ptr<const SetSpecTree> > > Sets;
+typedef std::list<std::pair<SetName, std::tr1::shared_ptr<const PackageDepSpecCollection> > > Sets;
 
 namespace paludis
 {
@@ -52,7 +49,7 @@ namespace paludis
     struct Implementation<PackageMaskConf>
     {
         const PaludisEnvironment * const env;
-        std::list<std::tr1::shared_ptr<const PackageDepSpec> > masks;
+        PackageDepSpecCollection masks;
         mutable Sets sets;
         mutable Mutex set_mutex;
 
@@ -86,9 +83,9 @@ PackageMaskConf::add(const FSEntry & filename)
     {
         try
         {
-            _imp->masks.push_back(std::tr1::shared_ptr<PackageDepSpec>(new PackageDepSpec(parse_user_package_dep_spec(
-                                *line, _imp->env,
-                                UserPackageDepSpecOptions() + updso_allow_wildcards + updso_no_disambiguation + updso_throw_if_set))));
+            _imp->masks.insert(parse_user_package_dep_spec(
+                        *line, _imp->env,
+                        UserPackageDepSpecOptions() + updso_allow_wildcards + updso_no_disambiguation + updso_throw_if_set));
         }
         catch (const GotASetNotAPackageDepSpec &)
         {
@@ -100,11 +97,7 @@ PackageMaskConf::add(const FSEntry & filename)
 bool
 PackageMaskConf::query(const PackageID & e) const
 {
-    using namespace std::tr1::placeholders;
-    if (indirect_iterator(_imp->masks.end()) != std::find_if(
-            indirect_iterator(_imp->masks.begin()),
-            indirect_iterator(_imp->masks.end()),
-            std::tr1::bind(&match_package, std::tr1::ref(*_imp->env), _1, std::tr1::cref(e), MatchPackageOptions())))
+    if (_imp->masks.match_any(*_imp->env, e, MatchPackageOptions()))
         return true;
 
     {
@@ -115,16 +108,17 @@ PackageMaskConf::query(const PackageID & e) const
         {
             if (! it->second)
             {
-                it->second = _imp->env->set(it->first);
-                if (! it->second)
-                {
+                std::tr1::shared_ptr<PackageDepSpecCollection> specs(new PackageDepSpecCollection);
+                std::tr1::shared_ptr<const SetSpecTree> set(_imp->env->set(it->first));
+                if (set)
+                    specs->insert_all(_imp->env, *set);
+                else
                     Log::get_instance()->message("paludis_environment.package_mask.unknown_set", ll_warning, lc_no_context) << "Set name '"
                         << it->first << "' does not exist";
-                    it->second.reset(new SetSpecTree(make_shared_ptr(new AllDepSpec)));
-                }
+                it->second = specs;
             }
 
-            if (match_package_in_set(*_imp->env, *it->second, e, MatchPackageOptions()))
+            if (it->second->match_any(*_imp->env, e, MatchPackageOptions()))
                 return true;
         }
     }
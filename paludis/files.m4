@@ -17,7 +17,7 @@ add(`broken_linkage_finder',             `hh', `cc')
 add(`buffer_output_manager',             `hh', `cc', `fwd')
 add(`choice',                            `hh', `cc', `fwd')
 add(`common_sets',                       `hh', `cc', `fwd')
-add(`contents',                          `hh', `cc', `fwd')
+add(`contents',                          `hh', `cc', `fwd', `test')
 add(`create_output_manager_info',        `hh', `cc', `fwd', `se')
 add(`dep_label',                         `hh', `cc', `fwd')
 add(`dep_list',                          `hh', `cc', `fwd', `test')
@@ -55,6 +55,7 @@ add(`hooker',                            `hh', `cc', `test', `testscript')
 add(`install_task',                      `hh', `cc', `se')
 add(`ipc_output_manager',                `hh', `cc', `fwd')
 add(`libtool_linkage_checker',           `hh', `cc')
+add(`linkage_cache',                     `hh', `cc', `test', `testscript')
 add(`linkage_checker',                   `hh', `cc')
 add(`literal_metadata_key',              `hh', `cc')
 add(`mask',                              `hh', `cc', `fwd', `se')
@@ -72,7 +73,9 @@ add(`output_manager',                    `hh', `fwd', `cc', `se')
 add(`output_manager_factory',            `hh', `fwd', `cc')
 add(`output_manager_from_environment',   `hh', `fwd', `cc')
 add(`override_functions',                `hh', `cc')
+add(`owners_index',                      `hh', `cc')
 add(`package_database',                  `hh', `cc', `fwd', `test')
+add(`package_dep_spec_collection',       `hh', `cc', `fwd', `test')
 add(`package_dep_spec_properties',       `hh', `cc', `fwd')
 add(`package_id',                        `hh', `cc', `fwd', `se')
 add(`paludis',                           `hh')
@@ -80,7 +83,7 @@ add(`paludislike_options_conf',          `hh', `cc', `fwd')
 add(`query_visitor',                     `hh', `cc')
 add(`range_rewriter',                    `hh', `cc', `test')
 add(`report_task',                       `hh', `cc')
-add(`repository',                        `hh', `fwd', `cc')
+add(`repository',                        `hh', `fwd', `cc', `se')
 add(`repository_factory',                `hh', `fwd', `cc')
 add(`repository_name_cache',             `hh', `cc', `test', `testscript')
 add(`selection',                         `hh', `cc', `fwd', `test')
@@ -166,21 +166,12 @@ namespace
         {
             std::tr1::shared_ptr<PackageIDSet> result(new PackageIDSet);
 
-            for (RepositoryNameSet::ConstIterator r(repos->begin()), r_end(repos->end()) ;
-                    r != r_end ; ++r)
-            {
-                for (QualifiedPackageNameSet::ConstIterator q(qpns->begin()), q_end(qpns->end()) ;
-                        q != q_end ; ++q)
-                {
-                    std::tr1::shared_ptr<const PackageIDSequence> id(
-                            env->package_database()->fetch_repository(*r)->package_ids(*q));
-                    for (PackageIDSequence::ConstIterator i(id->begin()), i_end(id->end()) ;
-                            i != i_end ; ++i)
-                        if ((*i)->from_repositories_key() && ((*i)->from_repositories_key()->value()->end() !=
-                                    (*i)->from_repositories_key()->value()->find(stringify(name))))
-                            result->insert(*i);
-                }
-            }
+            std::tr1::shared_ptr<const PackageIDSet> id(AllGeneratorHandlerBase::ids(env, repos, qpns));
+            for (PackageIDSet::ConstIterator i(id->begin()), i_end(id->end()) ;
+                    i != i_end ; ++i)
+                if ((*i)->from_repositories_key() && ((*i)->from_repositories_key()->value()->end() !=
+                            (*i)->from_repositories_key()->value()->find(stringify(name))))
+                    result->insert(*i);
 
             return result;
         }
@@ -437,20 +428,13 @@ namespace
         {
             std::tr1::shared_ptr<PackageIDSet> result(new PackageIDSet);
 
-            for (RepositoryNameSet::ConstIterator r(repos->begin()), r_end(repos->end()) ;
-                    r != r_end ; ++r)
-            {
-                for (QualifiedPackageNameSet::ConstIterator q(qpns->begin()), q_end(qpns->end()) ;
-                        q != q_end ; ++q)
-                {
-                    std::tr1::shared_ptr<const PackageIDSequence> id(
-                            env->package_database()->fetch_repository(*r)->package_ids(*q));
-                    for (PackageIDSequence::ConstIterator i(id->begin()), i_end(id->end()) ;
-                            i != i_end ; ++i)
-                        if (match_package(*env, spec, **i, options))
-                            result->insert(*i);
-                }
-            }
+            /* fetching ids may be done in parallel, but matching uses the
+             * environment, so do it here */
+            std::tr1::shared_ptr<const PackageIDSet> id(AllGeneratorHandlerBase::ids(env, repos, qpns));
+            for (PackageIDSet::ConstIterator i(id->begin()), i_end(id->end()) ;
+                    i != i_end ; ++i)
+                if (match_package(*env, spec, **i, options))
+                    result->insert(*i);
 
             return result;
         }
@@ -22,18 +22,122 @@
 #include <paludis/util/sequence.hh>
 #include <paludis/util/wrapped_output_iterator.hh>
 #include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/util/forward_parallel_for_each.hh>
+#include <paludis/util/mutex.hh>
+#include <paludis/util/system.hh>
+#include <paludis/util/destringify.hh>
+#include <paludis/util/log.hh>
 #include <paludis/name.hh>
 #include <paludis/environment.hh>
 #include <paludis/package_database.hh>
 #include <tr1/functional>
 #include <algorithm>
+#include <list>
 
 using namespace paludis;
 
+namespace
+{
+    unsigned generator_threads()
+    {
+        std::string threads(getenv_with_default("PALUDIS_GENERATOR_THREADS", ""));
+        if (! threads.empty())
+        {
+            try
+            {
+                return destringify<unsigned>(threads);
+            }
+            catch (const DestringifyError &)
+            {
+                Log::get_instance()->message("generator.bad_threads", ll_warning, lc_context)
+                    << "Ignoring bad value '" << threads << "' for PALUDIS_GENERATOR_THREADS";
+            }
+        }
+
+        return 1;
+    }
+
+    void call_noting_failures(const std::tr1::function<void (const RepositoryName &)> & f,
+            Mutex & mutex, std::list<RepositoryName> & failures, const RepositoryName & r)
+    {
+        try
+        {
+            f(r);
+        }
+        catch (...)
+        {
+            Lock lock(mutex);
+            failures.push_back(r);
+        }
+    }
+
+    void add_categories(const Environment * const env, Mutex & mutex,
+            const std::tr1::shared_ptr<CategoryNamePartSet> & result, const RepositoryName & r)
+    {
+        std::tr1::shared_ptr<const CategoryNamePartSet> cats(env->package_database()->fetch_repository(r)->category_names());
+
+        Lock lock(mutex);
+        std::copy(cats->begin(), cats->end(), result->inserter());
+    }
+
+    void add_packages(const Environment * const env, const std::tr1::shared_ptr<const CategoryNamePartSet> & cats,
+            Mutex & mutex, const std::tr1::shared_ptr<QualifiedPackageNameSet> & result, const RepositoryName & r)
+    {
+        const std::tr1::shared_ptr<const Repository> repo(env->package_database()->fetch_repository(r));
+        for (CategoryNamePartSet::ConstIterator c(cats->begin()), c_end(cats->end()) ;
+                c != c_end ; ++c)
+        {
+            std::tr1::shared_ptr<const QualifiedPackageNameSet> pkgs(repo->package_names(*c));
+
+            Lock lock(mutex);
+            std::copy(pkgs->begin(), pkgs->end(), result->inserter());
+        }
+    }
+
+    void add_ids(const Environment * const env, const std::tr1::shared_ptr<const QualifiedPackageNameSet> & qpns,
+            Mutex & mutex, const std::tr1::shared_ptr<PackageIDSet> & result, const RepositoryName & r)
+    {
+        const std::tr1::shared_ptr<const Repository> repo(env->package_database()->fetch_repository(r));
+        for (QualifiedPackageNameSet::ConstIterator q(qpns->begin()), q_end(qpns->end()) ;
+                q != q_end ; ++q)
+        {
+            std::tr1::shared_ptr<const PackageIDSequence> i(repo->package_ids(*q));
+
+            Lock lock(mutex);
+            std::copy(i->begin(), i->end(), result->inserter());
+        }
+    }
+}
+
 GeneratorHandler::~GeneratorHandler()
 {
 }
 
+void
+AllGeneratorHandlerBase::for_each_repository(
+        const std::tr1::shared_ptr<const RepositoryNameSet> & repos,
+        const std::tr1::function<void (const RepositoryName &)> & f)
+{
+    using namespace std::tr1::placeholders;
+
+    unsigned n_threads(std::min<unsigned>(generator_threads(), std::distance(repos->begin(), repos->end())));
+    if (n_threads <= 1)
+    {
+        std::for_each(repos->begin(), repos->end(), f);
+        return;
+    }
+
+    Mutex mutex;
+    std::list<RepositoryName> failures;
+    forward_parallel_for_each(repos->begin(), repos->end(),
+            std::tr1::bind(&call_noting_failures, std::tr1::cref(f), std::tr1::ref(mutex), std::tr1::ref(failures), _1),
+            n_threads, 1);
+
+    /* exceptions can't cross threads, so do anything that failed again
+     * here, in order. results go into sets, so repeating work is harmless. */
+    std::for_each(failures.begin(), failures.end(), f);
+}
+
 std::tr1::shared_ptr<const RepositoryNameSet>
 AllGeneratorHandlerBase::repositories(
         const Environment * const env) const
@@ -50,15 +154,11 @@ AllGeneratorHandlerBase::categories(
         const Environment * const env,
         const std::tr1::shared_ptr<const RepositoryNameSet> & repos) const
 {
-    std::tr1::shared_ptr<CategoryNamePartSet> result(new CategoryNamePartSet);
-
-    for (RepositoryNameSet::ConstIterator r(repos->begin()), r_end(repos->end()) ;
-            r != r_end ; ++r)
-    {
-        std::tr1::shared_ptr<const CategoryNamePartSet> cats(env->package_database()->fetch_repository(*r)->category_names());
-        std::copy(cats->begin(), cats->end(), result->inserter());
-    }
+    using namespace std::tr1::placeholders;
 
+    std::tr1::shared_ptr<CategoryNamePartSet> result(new CategoryNamePartSet);
+    Mutex mutex;
+    for_each_repository(repos, std::tr1::bind(&add_categories, env, std::tr1::ref(mutex), result, _1));
     return result;
 }
 
@@ -68,20 +168,11 @@ AllGeneratorHandlerBase::packages(
         const std::tr1::shared_ptr<const RepositoryNameSet> & repos,
         const std::tr1::shared_ptr<const CategoryNamePartSet> & cats) const
 {
-    std::tr1::shared_ptr<QualifiedPackageNameSet> result(new QualifiedPackageNameSet);
-
-    for (RepositoryNameSet::ConstIterator r(repos->begin()), r_end(repos->end()) ;
-            r != r_end ; ++r)
-    {
-        for (CategoryNamePartSet::ConstIterator c(cats->begin()), c_end(cats->end()) ;
-                c != c_end ; ++c)
-        {
-            std::tr1::shared_ptr<const QualifiedPackageNameSet> pkgs(
-                    env->package_database()->fetch_repository(*r)->package_names(*c));
-            std::copy(pkgs->begin(), pkgs->end(), result->inserter());
-        }
-    }
+    using namespace std::tr1::placeholders;
 
+    std::tr1::shared_ptr<QualifiedPackageNameSet> result(new QualifiedPackageNameSet);
+    Mutex mutex;
+    for_each_repository(repos, std::tr1::bind(&add_packages, env, cats, std::tr1::ref(mutex), result, _1));
     return result;
 }
 
@@ -91,20 +182,11 @@ AllGeneratorHandlerBase::ids(
         const std::tr1::shared_ptr<const RepositoryNameSet> & repos,
         const std::tr1::shared_ptr<const QualifiedPackageNameSet> & qpns) const
 {
-    std::tr1::shared_ptr<PackageIDSet> result(new PackageIDSet);
-
-    for (RepositoryNameSet::ConstIterator r(repos->begin()), r_end(repos->end()) ;
-            r != r_end ; ++r)
-    {
-        for (QualifiedPackageNameSet::ConstIterator q(qpns->begin()), q_end(qpns->end()) ;
-                q != q_end ; ++q)
-        {
-            std::tr1::shared_ptr<const PackageIDSequence> i(
-                    env->package_database()->fetch_repository(*r)->package_ids(*q));
-            std::copy(i->begin(), i->end(), result->inserter());
-        }
-    }
+    using namespace std::tr1::placeholders;
 
+    std::tr1::shared_ptr<PackageIDSet> result(new PackageIDSet);
+    Mutex mutex;
+    for_each_repository(repos, std::tr1::bind(&add_ids, env, qpns, std::tr1::ref(mutex), result, _1));
     return result;
 }
 
@@ -26,6 +26,7 @@
 #include <paludis/package_id-fwd.hh>
 #include <paludis/util/attributes.hh>
 #include <tr1/memory>
+#include <tr1/functional>
 
 namespace paludis
 {
@@ -62,6 +63,23 @@ namespace paludis
     class PALUDIS_VISIBLE AllGeneratorHandlerBase :
         public GeneratorHandler
     {
+        protected:
+            /**
+             * Call the function once for each repository.
+             *
+             * If PALUDIS_GENERATOR_THREADS is set to more than 1, several
+             * repositories may be handled at once, but no repository is
+             * ever used by more than one thread at a time. The function
+             * must therefore lock anything it shares between repositories.
+             * If it throws, it is called again for that repository in the
+             * calling thread, so that the exception is seen there.
+             *
+             * \since 0.48
+             */
+            static void for_each_repository(
+                    const std::tr1::shared_ptr<const RepositoryNameSet> &,
+                    const std::tr1::function<void (const RepositoryName &)> &);
+
         public:
             virtual std::tr1::shared_ptr<const RepositoryNameSet> repositories(
                     const Environment * const env) const;
@@ -904,7 +904,7 @@ InstallTask::_one(const DepList::Iterator dep, const int x, const int y, const i
             output_manager_holder.reset(new OutputManagerFromEnvironment(_imp->env, dep->package_id(),
                         oe_exclusive, ClientOutputFeatures()));
 
-            std::tr1::shared_ptr<PackageIDSequence> replacing;
+            std::tr1::shared_ptr<const PackageIDSequence> replacing;
 
             // look for packages with the same name in the same slot in the destination repos
             if (dep->destination())
@@ -18,6 +18,7 @@
  */
 
 #include <paludis/libtool_linkage_checker.hh>
+#include <paludis/linkage_cache.hh>
 
 #include <paludis/util/realpath.hh>
 #include <paludis/util/config_file.hh>
@@ -46,13 +47,15 @@ namespace paludis
     struct Implementation<LibtoolLinkageChecker>
     {
         FSEntry root;
+        const std::tr1::shared_ptr<LinkageCache> cache;
 
         Mutex mutex;
 
         Breakage breakage;
 
-        Implementation(const FSEntry & the_root) :
-            root(the_root)
+        Implementation(const FSEntry & the_root, const std::tr1::shared_ptr<LinkageCache> & the_cache) :
+            root(the_root),
+            cache(the_cache)
         {
         }
     };
@@ -69,8 +72,8 @@ namespace
     };
 }
 
-LibtoolLinkageChecker::LibtoolLinkageChecker(const FSEntry & root) :
-    PrivateImplementationPattern<LibtoolLinkageChecker>(new Implementation<LibtoolLinkageChecker>(root))
+LibtoolLinkageChecker::LibtoolLinkageChecker(const FSEntry & root, const std::tr1::shared_ptr<LinkageCache> & cache) :
+    PrivateImplementationPattern<LibtoolLinkageChecker>(new Implementation<LibtoolLinkageChecker>(root, cache))
 {
 }
 
@@ -88,24 +91,30 @@ LibtoolLinkageChecker::check_file(const FSEntry & file)
 
     Context ctx("When checking '" + stringify(file) + "' as a libtool library:");
 
-    SafeIFStream stream(file);
-
-    KeyValueConfigFileOptions opts;
-    opts += kvcfo_disallow_space_around_equals;
-    opts += kvcfo_disallow_space_inside_unquoted_values;
-
     std::vector<std::string> deps;
 
-    try
-    {
-        KeyValueConfigFile kvs(stream, opts,
-                &KeyValueConfigFile::no_defaults, &KeyValueConfigFile::no_transformation);
-        tokenise_whitespace(kvs.get("dependency_libs"), std::back_inserter(deps));
-    }
-    catch (const ConfigFileError & ex)
+    if (! (_imp->cache && _imp->cache->get("libtool", file, deps)))
     {
-        Log::get_instance()->message("reconcilio.broken_linkage_finder.failure", ll_warning, lc_context) << ex.message();
-        return true;
+        SafeIFStream stream(file);
+
+        KeyValueConfigFileOptions opts;
+        opts += kvcfo_disallow_space_around_equals;
+        opts += kvcfo_disallow_space_inside_unquoted_values;
+
+        try
+        {
+            KeyValueConfigFile kvs(stream, opts,
+                    &KeyValueConfigFile::no_defaults, &KeyValueConfigFile::no_transformation);
+            tokenise_whitespace(kvs.get("dependency_libs"), std::back_inserter(deps));
+        }
+        catch (const ConfigFileError & ex)
+        {
+            Log::get_instance()->message("reconcilio.broken_linkage_finder.failure", ll_warning, lc_context) << ex.message();
+            return true;
+        }
+
+        if (_imp->cache)
+            _imp->cache->put("libtool", file, deps);
     }
 
     deps.erase(std::remove_if(deps.begin(), deps.end(), IsNotAbsolutePath()), deps.end());
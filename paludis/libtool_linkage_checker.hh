@@ -25,12 +25,14 @@
 
 namespace paludis
 {
+    class LinkageCache;
+
     class LibtoolLinkageChecker :
         public LinkageChecker,
         private paludis::PrivateImplementationPattern<LibtoolLinkageChecker>
     {
         public:
-            LibtoolLinkageChecker(const paludis::FSEntry &);
+            LibtoolLinkageChecker(const paludis::FSEntry &, const std::tr1::shared_ptr<LinkageCache> &);
             virtual ~LibtoolLinkageChecker();
 
             virtual bool check_file(const paludis::FSEntry &) PALUDIS_ATTRIBUTE((warn_unused_result));
@@ -0,0 +1,221 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/linkage_cache.hh>
+
+#include <paludis/util/fs_entry.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/mutex.hh>
+#include <paludis/util/private_implementation_pattern-impl.hh>
+#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/timestamp.hh>
+#include <paludis/util/tokeniser.hh>
+#include <paludis/util/join.hh>
+
+#include <iterator>
+#include <map>
+#include <unistd.h>
+
+using namespace paludis;
+
+namespace
+{
+    const std::string magic("paludis-linkage-cache-1");
+
+    struct Record
+    {
+        std::string key;
+        std::vector<std::string> values;
+        bool used;
+    };
+
+    typedef std::map<std::pair<std::string, std::string>, Record> Records;
+
+    /* the fields that have to match for a record to be used, in the form
+     * they're written to the cache file */
+    std::string file_key(const FSEntry & f)
+    {
+        return stringify(f.file_size()) + "\t" + stringify(f.lowlevel_id().second) + "\t" +
+            stringify(f.mtim().seconds()) + "\t" + stringify(f.mtim().nanoseconds()) + "\t" +
+            stringify(f.ctim().seconds()) + "\t" + stringify(f.ctim().nanoseconds());
+    }
+
+    const unsigned key_fields(6);
+
+    bool writable(const std::string & s)
+    {
+        return std::string::npos == s.find_first_of("\t\n") && ! s.empty();
+    }
+}
+
+namespace paludis
+{
+    template <>
+    struct Implementation<LinkageCache>
+    {
+        const FSEntry location;
+
+        mutable Mutex mutex;
+        mutable Records records;
+        bool changed;
+
+        Implementation(const FSEntry & l) :
+            location(l),
+            changed(false)
+        {
+        }
+    };
+}
+
+LinkageCache::LinkageCache(const FSEntry & f) :
+    PrivateImplementationPattern<LinkageCache>(new Implementation<LinkageCache>(f))
+{
+    Context context("When loading linkage cache '" + stringify(f) + "':");
+
+    if (! f.exists())
+        return;
+
+    try
+    {
+        SafeIFStream file(f);
+
+        std::string line;
+        if ((! std::getline(file, line)) || line != magic)
+        {
+            Log::get_instance()->message("reconcilio.broken_linkage_finder.cache.bad_format", ll_warning, lc_context)
+                << "Linkage cache '" << f << "' is not in a supported format, ignoring it";
+            _imp->changed = true;
+            return;
+        }
+
+        while (std::getline(file, line))
+        {
+            std::vector<std::string> tokens;
+            tokenise<delim_kind::AnyOfTag, delim_mode::DelimiterTag>(line, "\t", "", std::back_inserter(tokens));
+            if (tokens.size() < 2 + key_fields)
+                throw InternalError(PALUDIS_HERE, "bad line '" + line + "'");
+
+            Record record;
+            record.key = join(tokens.begin() + 2, tokens.begin() + 2 + key_fields, "\t");
+            record.values.assign(tokens.begin() + 2 + key_fields, tokens.end());
+            record.used = false;
+            _imp->records.insert(std::make_pair(std::make_pair(tokens[0], tokens[1]), record));
+        }
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("reconcilio.broken_linkage_finder.cache.broken", ll_warning, lc_context)
+            << "Linkage cache '" << f << "' is broken, ignoring it: '" << e.message() << "' (" << e.what() << ")";
+        _imp->records.clear();
+        _imp->changed = true;
+    }
+}
+
+LinkageCache::~LinkageCache()
+{
+}
+
+bool
+LinkageCache::get(const std::string & checker, const FSEntry & file, std::vector<std::string> & result) const
+{
+    const std::string key(file_key(file));
+
+    Lock lock(_imp->mutex);
+    Records::iterator r(_imp->records.find(std::make_pair(checker, stringify(file))));
+    if (_imp->records.end() == r || r->second.key != key)
+        return false;
+
+    r->second.used = true;
+    result = r->second.values;
+    return true;
+}
+
+void
+LinkageCache::put(const std::string & checker, const FSEntry & file, const std::vector<std::string> & values)
+{
+    if (! writable(stringify(file)))
+        return;
+    for (std::vector<std::string>::const_iterator v(values.begin()), v_end(values.end()) ;
+            v != v_end ; ++v)
+        if (! writable(*v))
+            return;
+
+    Record record;
+    record.key = file_key(file);
+    record.values = values;
+    record.used = true;
+
+    Lock lock(_imp->mutex);
+    _imp->records[std::make_pair(checker, stringify(file))] = record;
+    _imp->changed = true;
+}
+
+void
+LinkageCache::save()
+{
+    Context context("When saving linkage cache '" + stringify(_imp->location) + "':");
+
+    Lock lock(_imp->mutex);
+
+    bool all_used(true);
+    for (Records::const_iterator r(_imp->records.begin()), r_end(_imp->records.end()) ;
+            r != r_end && all_used ; ++r)
+        all_used = r->second.used;
+
+    if (all_used && ! _imp->changed)
+        return;
+
+    FSEntry tmp(_imp->location.dirname() / ("." + _imp->location.basename() + "." + stringify(::getpid())));
+    try
+    {
+        if (! _imp->location.dirname().exists())
+            _imp->location.dirname().mkdir();
+
+        {
+            SafeOFStream file(tmp);
+            file << magic << std::endl;
+            for (Records::const_iterator r(_imp->records.begin()), r_end(_imp->records.end()) ;
+                    r != r_end ; ++r)
+                if (r->second.used)
+                {
+                    file << r->first.first << "\t" << r->first.second << "\t" << r->second.key;
+                    for (std::vector<std::string>::const_iterator v(r->second.values.begin()), v_end(r->second.values.end()) ;
+                            v != v_end ; ++v)
+                        file << "\t" << *v;
+                    file << std::endl;
+                }
+        }
+        tmp.rename(_imp->location);
+        _imp->changed = false;
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("reconcilio.broken_linkage_finder.cache.not_saved", ll_debug, lc_context)
+            << "Couldn't save linkage cache: '" << e.message() << "' (" << e.what() << ")";
+        try
+        {
+            tmp.unlink();
+        }
+        catch (const FSError &)
+        {
+        }
+    }
+}
@@ -0,0 +1,70 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_LINKAGE_CACHE_HH
+#define PALUDIS_GUARD_PALUDIS_LINKAGE_CACHE_HH 1
+
+#include <paludis/util/attributes.hh>
+#include <paludis/util/private_implementation_pattern.hh>
+#include <paludis/util/fs_entry-fwd.hh>
+#include <string>
+#include <vector>
+
+namespace paludis
+{
+    /**
+     * Remembers what each LinkageChecker found in each file between runs, so
+     * that only files which have changed since need to be read again.
+     *
+     * A record is only used if the file's size, inode, mtime and ctime all
+     * still match. The ctime is needed because merging preserves mtimes, so a
+     * newly merged library can have the same mtime as the one it replaced.
+     *
+     * Safe to use from several threads at once.
+     *
+     * \since 0.48
+     */
+    class PALUDIS_VISIBLE LinkageCache :
+        private paludis::PrivateImplementationPattern<LinkageCache>
+    {
+        public:
+            LinkageCache(const paludis::FSEntry &);
+            ~LinkageCache();
+
+            /**
+             * If the named checker recorded something for this file, and the
+             * file hasn't changed since, put it in the vector and return true.
+             */
+            bool get(const std::string &, const paludis::FSEntry &, std::vector<std::string> &) const
+                PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * Record what the named checker found for this file.
+             */
+            void put(const std::string &, const paludis::FSEntry &, const std::vector<std::string> &);
+
+            /**
+             * Write out records for every file passed to get or put, if
+             * anything has changed. Records for other files are dropped.
+             */
+            void save();
+    };
+}
+
+#endif
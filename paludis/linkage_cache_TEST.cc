@@ -0,0 +1,189 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/linkage_cache.hh>
+#include <paludis/util/fs_entry.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/stringify.hh>
+#include <test/test_framework.hh>
+#include <test/test_runner.hh>
+
+using namespace test;
+using namespace paludis;
+
+namespace
+{
+    const FSEntry liba("linkage_cache_TEST_dir/lib/liba.so");
+    const FSEntry libb("linkage_cache_TEST_dir/lib/libb.so");
+
+    std::vector<std::string> make_values(const std::string & a, const std::string & b)
+    {
+        std::vector<std::string> result;
+        result.push_back(a);
+        result.push_back(b);
+        return result;
+    }
+}
+
+namespace test_cases
+{
+    struct LinkageCacheBadFormatTest : TestCase
+    {
+        LinkageCacheBadFormatTest() : TestCase("bad format") { }
+
+        void run()
+        {
+            std::vector<std::string> values;
+
+            {
+                LinkageCache cache(FSEntry("linkage_cache_TEST_dir/bad_format/cache"));
+                TEST_CHECK(! cache.get("elf", liba, values));
+                cache.put("elf", liba, make_values("libc.so.6", "libm.so.6"));
+                cache.save();
+            }
+
+            {
+                LinkageCache cache(FSEntry("linkage_cache_TEST_dir/bad_format/cache"));
+                TEST_CHECK(cache.get("elf", liba, values));
+                TEST_CHECK(values == make_values("libc.so.6", "libm.so.6"));
+            }
+        }
+
+        bool repeatable() const
+        {
+            return false;
+        }
+    } test_linkage_cache_bad_format;
+
+    struct LinkageCacheBadLineTest : TestCase
+    {
+        LinkageCacheBadLineTest() : TestCase("bad line") { }
+
+        void run()
+        {
+            std::vector<std::string> values;
+            LinkageCache cache(FSEntry("linkage_cache_TEST_dir/bad_line/cache"));
+            TEST_CHECK(! cache.get("elf", liba, values));
+            TEST_CHECK(values.empty());
+        }
+    } test_linkage_cache_bad_line;
+
+    struct LinkageCacheRoundTripTest : TestCase
+    {
+        LinkageCacheRoundTripTest() : TestCase("round trip") { }
+
+        void run()
+        {
+            std::vector<std::string> values;
+
+            {
+                LinkageCache cache(FSEntry("linkage_cache_TEST_dir/round_trip/cache"));
+                TEST_CHECK(! cache.get("elf", liba, values));
+                cache.put("elf", liba, make_values("libc.so.6", "libm.so.6"));
+                cache.put("libtool", liba, std::vector<std::string>());
+                cache.save();
+            }
+
+            {
+                LinkageCache cache(FSEntry("linkage_cache_TEST_dir/round_trip/cache"));
+                TEST_CHECK(cache.get("elf", liba, values));
+                TEST_CHECK(values == make_values("libc.so.6", "libm.so.6"));
+                TEST_CHECK(cache.get("libtool", liba, values));
+                TEST_CHECK(values.empty());
+                TEST_CHECK(! cache.get("elf", libb, values));
+            }
+        }
+
+        bool repeatable() const
+        {
+            return false;
+        }
+    } test_linkage_cache_round_trip;
+
+    struct LinkageCacheStaleTest : TestCase
+    {
+        LinkageCacheStaleTest() : TestCase("stale") { }
+
+        void run()
+        {
+            std::vector<std::string> values;
+
+            {
+                LinkageCache cache(FSEntry("linkage_cache_TEST_dir/stale/cache"));
+                cache.put("elf", libb, make_values("libc.so.6", "libz.so.1"));
+                cache.save();
+            }
+
+            {
+                SafeOFStream file(libb);
+                file << "second, but longer" << std::endl;
+            }
+
+            /* libb has already been stat()ed, so look at the file afresh */
+            {
+                LinkageCache cache(FSEntry("linkage_cache_TEST_dir/stale/cache"));
+                TEST_CHECK(! cache.get("elf", FSEntry(stringify(libb)), values));
+                TEST_CHECK(values.empty());
+            }
+        }
+
+        bool repeatable() const
+        {
+            return false;
+        }
+    } test_linkage_cache_stale;
+
+    struct LinkageCacheDropTest : TestCase
+    {
+        LinkageCacheDropTest() : TestCase("drop") { }
+
+        void run()
+        {
+            std::vector<std::string> values;
+
+            {
+                LinkageCache cache(FSEntry("linkage_cache_TEST_dir/drop/cache"));
+                cache.put("elf", liba, make_values("libc.so.6", "libm.so.6"));
+                cache.put("libtool", liba, make_values("libfoo.la", "libbar.la"));
+                cache.save();
+            }
+
+            {
+                LinkageCache cache(FSEntry("linkage_cache_TEST_dir/drop/cache"));
+                TEST_CHECK(cache.get("elf", liba, values));
+                cache.save();
+            }
+
+            {
+                LinkageCache cache(FSEntry("linkage_cache_TEST_dir/drop/cache"));
+                TEST_CHECK(cache.get("elf", liba, values));
+                TEST_CHECK(values == make_values("libc.so.6", "libm.so.6"));
+                values.clear();
+                TEST_CHECK(! cache.get("libtool", liba, values));
+                TEST_CHECK(values.empty());
+            }
+        }
+
+        bool repeatable() const
+        {
+            return false;
+        }
+    } test_linkage_cache_drop;
+}
+
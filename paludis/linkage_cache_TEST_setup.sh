@@ -0,0 +1,18 @@
+#!/usr/bin/env bash
+# vim: set ft=sh sw=4 sts=4 et :
+
+mkdir linkage_cache_TEST_dir || exit 1
+cd linkage_cache_TEST_dir || exit 1
+
+mkdir -p lib
+echo "first" > lib/liba.so
+echo "second" > lib/libb.so
+
+mkdir -p bad_format
+echo "monkey" > bad_format/cache
+
+mkdir -p bad_line
+echo "paludis-linkage-cache-1" > bad_line/cache
+echo "elf	/lib/liba.so" >> bad_line/cache
+
+mkdir -p round_trip stale drop
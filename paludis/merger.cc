@@ -28,6 +28,8 @@
 #include <paludis/util/private_implementation_pattern-impl.hh>
 #include <paludis/util/set.hh>
 #include <paludis/util/timestamp.hh>
+#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/md5.hh>
 #include <paludis/selinux/security_context.hh>
 #include <paludis/environment.hh>
 #include <paludis/hook.hh>
@@ -40,12 +42,19 @@
 #include <cstdio>
 #include <list>
 #include <set>
+#include <map>
+#include <vector>
+#include <istream>
 #include <tr1/unordered_map>
 
 #include "config.h"
 #ifdef HAVE_XATTRS
 #  include <attr/xattr.h>
 #endif
+#ifdef HAVE_FICLONE
+#  include <sys/ioctl.h>
+#  include <linux/fs.h>
+#endif
 
 using namespace paludis;
 
@@ -53,6 +62,99 @@ using namespace paludis;
 
 typedef std::tr1::unordered_map<std::pair<dev_t, ino_t>, std::string, Hash<std::pair<dev_t, ino_t> > > MergedMap;
 
+struct CopiedFile
+{
+    std::string md5;
+    Timestamp mtim;
+    Timestamp ctim;
+    off_t size;
+    ino_t ino;
+
+    CopiedFile(const std::string & m, const struct stat & st) :
+        md5(m),
+        mtim(st.st_mtim),
+        ctim(st.st_ctim),
+        size(st.st_size),
+        ino(st.st_ino)
+    {
+    }
+};
+
+typedef std::map<FSEntry, CopiedFile> CopiedFilesMap;
+
+namespace
+{
+    /**
+     * Copies everything read through us from one fd to another, so that a
+     * checksum can be calculated as we go.
+     */
+    class CopyingStreamBuf :
+        public std::streambuf
+    {
+        private:
+            const int _in_fd, _out_fd;
+            std::vector<char> _buffer;
+            std::string _error;
+
+        protected:
+            virtual int_type underflow()
+            {
+                if (gptr() < egptr())
+                    return traits_type::to_int_type(*gptr());
+
+                if (! _error.empty())
+                    return traits_type::eof();
+
+                ssize_t count(::read(_in_fd, &_buffer[0], _buffer.size()));
+                if (-1 == count)
+                {
+                    _error = "read failed: " + stringify(::strerror(errno));
+                    return traits_type::eof();
+                }
+                else if (0 == count)
+                    return traits_type::eof();
+
+                for (ssize_t done(0) ; done < count ; )
+                {
+                    ssize_t w(::write(_out_fd, &_buffer[done], count - done));
+                    if (-1 == w)
+                    {
+                        _error = "write failed: " + stringify(::strerror(errno));
+                        return traits_type::eof();
+                    }
+                    done += w;
+                }
+
+                setg(&_buffer[0], &_buffer[0], &_buffer[0] + count);
+                return traits_type::to_int_type(*gptr());
+            }
+
+        public:
+            CopyingStreamBuf(const int i, const int o) :
+                _in_fd(i),
+                _out_fd(o),
+                _buffer(128 * 1024)
+            {
+            }
+
+            const std::string error() const
+            {
+                return _error;
+            }
+    };
+
+    bool try_to_clone(const int in_fd, const int out_fd)
+    {
+#ifdef HAVE_FICLONE
+        return 0 == ::ioctl(out_fd, FICLONE, in_fd);
+#else
+        (void) in_fd;
+        (void) out_fd;
+        return false;
+#endif
+    }
+}
+
 namespace paludis
 {
     template <>
@@ -60,6 +162,7 @@ namespace paludis
     {
         std::set<FSEntry> fixed_entries;
         MergedMap merged_ids;
+        CopiedFilesMap copied_files;
         MergerParams params;
         bool result;
         bool skip_dir;
@@ -794,7 +897,7 @@ Merger::install_file(const FSEntry & src, const FSEntry & dst_dir, const std::st
     if (do_copy)
     {
         Log::get_instance()->message("merger.file.will_copy", ll_debug, lc_context) <<
-            "rename/link failed: " << ::strerror(errno) << ". Falling back to regular read/write copy";
+            "rename/link failed: " << ::strerror(errno) << ". Falling back to copying";
 
         FDHolder input_fd(::open(stringify(src).c_str(), O_RDONLY), false);
         if (-1 == input_fd)
@@ -813,13 +916,19 @@ Merger::install_file(const FSEntry & src, const FSEntry & dst_dir, const std::st
             throw MergerError("Cannot fchmod '" + stringify(dst) + "': " + stringify(::strerror(errno)));
         try_to_copy_xattrs(src, output_fd, result);
 
-        char buf[4096];
-        ssize_t count;
-        while ((count = read(input_fd, buf, 4096)) > 0)
-            if (-1 == write(output_fd, buf, count))
-                throw MergerError("write failed: " + stringify(::strerror(errno)));
-        if (-1 == count)
-            throw MergerError("read failed: " + stringify(::strerror(errno)));
+        /* if the filesystem can share the data, we don't need to copy it, but
+         * otherwise calculate the checksum as we go, so that
+         * record_install_file doesn't have to read the file again */
+        std::string md5sum;
+        if (! try_to_clone(input_fd, output_fd))
+        {
+            CopyingStreamBuf buf(input_fd, output_fd);
+            std::istream copy_stream(&buf);
+            MD5 md5(copy_stream);
+            if (! buf.error().empty())
+                throw MergerError(buf.error());
+            md5sum = md5.hexsum();
+        }
 
         /* might need to copy mtime */
         if (_imp->params.options()[mo_preserve_mtimes])
@@ -834,10 +943,21 @@ Merger::install_file(const FSEntry & src, const FSEntry & dst_dir, const std::st
                 throw MergerError("Cannot futimens '" + stringify(dst) + "': " + stringify(::strerror(errno)));
         }
 
+        _imp->copied_files.erase(dst_real);
+
         if (0 != std::rename(stringify(dst).c_str(), stringify(dst_real).c_str()))
             throw MergerError(
                     "rename(" + stringify(dst) + ", " + stringify(dst_real) + ") failed: " + stringify(::strerror(errno)));
 
+        /* renaming can change the ctime, so only look once we're done */
+        if (! md5sum.empty())
+        {
+            struct stat st;
+            if (0 != ::fstat(output_fd, &st))
+                throw MergerError("Cannot fstat '" + stringify(dst_real) + "': " + stringify(::strerror(errno)));
+            _imp->copied_files.insert(std::make_pair(dst_real, CopiedFile(md5sum, st)));
+        }
+
         _imp->merged_ids.insert(make_pair(src.lowlevel_id(), stringify(dst_real)));
     }
 
@@ -1274,6 +1394,31 @@ Merger::track_install_file(const FSEntry & src, const FSEntry & dst_dir, const s
     record_install_file(src, dst_dir, dst_name, flags);
 }
 
+const std::string
+Merger::installed_file_md5(const FSEntry & f)
+{
+    CopiedFilesMap::iterator i(_imp->copied_files.find(f));
+    if (_imp->copied_files.end() != i)
+    {
+        CopiedFile copied(i->second);
+        _imp->copied_files.erase(i);
+
+        /* a post hook might have changed or replaced it, possibly keeping
+         * its mtime and size, but it can't do that without changing the
+         * ctime */
+        if (copied.ctim == f.ctim() && copied.mtim == f.mtim() && copied.size == f.file_size()
+                && copied.ino == f.lowlevel_id().second)
+            return copied.md5;
+    }
+
+    SafeIFStream infile(f);
+    if (! infile)
+        throw MergerError("Cannot read '" + stringify(f) + "'");
+
+    MD5 md5(infile);
+    return md5.hexsum();
+}
+
 void
 Merger::track_install_dir(const FSEntry & src, const FSEntry & dst_dir, const MergeStatusFlags & flags)
 {
@@ -179,6 +179,16 @@ namespace paludis
             void track_install_under_dir(const FSEntry &, const MergeStatusFlags &);
             void track_install_sym(const FSEntry &, const FSEntry &, const MergeStatusFlags &);
 
+            /**
+             * The MD5 of a file we have just installed, for use by
+             * record_install_file. If install_file had to copy the file, the
+             * checksum calculated during the copy is used rather than reading
+             * the file again.
+             *
+             * \since 0.48
+             */
+            const std::string installed_file_md5(const FSEntry &) PALUDIS_ATTRIBUTE((warn_unused_result));
+
             ///\}
 
             ///\name Handle filesystem entry things
@@ -37,6 +37,12 @@ namespace paludis
     class PackageNamePartError;
     class PackageNamePartValidator;
 
+    template <>
+    struct ValidatedInterning<PackageNamePartValidator>
+    {
+        enum { value = true };
+    };
+
     /**
      * A PackageNamePart holds a std::string that is a valid name for the
      * package part of a QualifiedPackageName.
@@ -55,6 +61,12 @@ namespace paludis
     class CategoryNamePartError;
     class CategoryNamePartValidator;
 
+    template <>
+    struct ValidatedInterning<CategoryNamePartValidator>
+    {
+        enum { value = true };
+    };
+
     /**
      * A CategoryNamePart holds a std::string that is a valid name for the
      * category part of a QualifiedPackageName.
@@ -99,6 +111,12 @@ namespace paludis
     class SlotNameError;
     class SlotNameValidator;
 
+    template <>
+    struct ValidatedInterning<SlotNameValidator>
+    {
+        enum { value = true };
+    };
+
     /**
      * A SlotName holds a std::string that is a valid name for a SLOT.
      *
@@ -109,6 +127,12 @@ namespace paludis
     class RepositoryNameError;
     class RepositoryNameValidator;
 
+    template <>
+    struct ValidatedInterning<RepositoryNameValidator>
+    {
+        enum { value = true };
+    };
+
     /**
      * A RepositoryName holds a std::string that is a valid name for a
      * Repository.
@@ -27,11 +27,23 @@
 #include <paludis/util/wrapped_output_iterator-impl.hh>
 #include <paludis/util/options.hh>
 #include <paludis/util/hashes.hh>
+#include <paludis/util/intern_table.hh>
 #include <ostream>
 #include <utility>
 
 using namespace paludis;
 
+namespace
+{
+    /* never deleted, so that names in static objects stay valid during exit */
+    template <typename Validator_>
+    InternTable & intern_table()
+    {
+        static InternTable * const table(new InternTable);
+        return *table;
+    }
+}
+
 template struct Sequence<RepositoryName>;
 template struct WrappedForwardIterator<Sequence<RepositoryName>::ConstIteratorTag, const RepositoryName>;
 
@@ -108,6 +120,12 @@ SlotNameValidator::validate(const std::string & s)
     throw SlotNameError(s);
 }
 
+const std::string *
+SlotNameValidator::intern(const std::string & s)
+{
+    return intern_table<SlotNameValidator>().intern(s, &SlotNameValidator::validate);
+}
+
 PackageNamePartError::PackageNamePartError(const std::string & name) throw () :
     NameError(name, "package name part")
 {
@@ -147,6 +165,12 @@ PackageNamePartValidator::validate(const std::string & s)
     }
 }
 
+const std::string *
+PackageNamePartValidator::intern(const std::string & s)
+{
+    return intern_table<PackageNamePartValidator>().intern(s, &PackageNamePartValidator::validate);
+}
+
 void
 CategoryNamePartValidator::validate(const std::string & s)
 {
@@ -178,6 +202,12 @@ CategoryNamePartValidator::validate(const std::string & s)
     throw CategoryNamePartError(s);
 }
 
+const std::string *
+CategoryNamePartValidator::intern(const std::string & s)
+{
+    return intern_table<CategoryNamePartValidator>().intern(s, &CategoryNamePartValidator::validate);
+}
+
 CategoryNamePartError::CategoryNamePartError(const std::string & name) throw () :
     NameError(name, "category name part")
 {
@@ -210,6 +240,12 @@ RepositoryNameValidator::validate(const std::string & s)
     throw RepositoryNameError(s);
 }
 
+const std::string *
+RepositoryNameValidator::intern(const std::string & s)
+{
+    return intern_table<RepositoryNameValidator>().intern(s, &RepositoryNameValidator::validate);
+}
+
 RepositoryNameError::RepositoryNameError(const std::string & name) throw () :
     NameError(name, "repository")
 {
@@ -323,10 +359,8 @@ QualifiedPackageName::QualifiedPackageName(const CategoryNamePart & c, const Pac
 bool
 QualifiedPackageName::operator< (const QualifiedPackageName & other) const
 {
-    if (category() < other.category())
-        return true;
-    if (category() > other.category())
-        return false;
+    if (category() != other.category())
+        return category() < other.category();
 
     return package() < other.package();
 }
@@ -393,6 +427,6 @@ SetNameError::SetNameError(const std::string & name) throw () :
 std::size_t
 QualifiedPackageName::hash() const
 {
-    return Hash<std::string>()(stringify(*this));
+    return Hash<CategoryNamePart>()(category()) ^ (Hash<PackageNamePart>()(package()) << 1);
 }
 
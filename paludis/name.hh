@@ -78,6 +78,14 @@ namespace paludis
          * throw a PackageNamePartError.
          */
         static void validate(const std::string &);
+
+        /**
+         * Return the shared copy of the parameter, validating it if it
+         * has not been seen before.
+         *
+         * \since 0.48
+         */
+        static const std::string * intern(const std::string &);
     };
 
     /**
@@ -111,6 +119,14 @@ namespace paludis
          * throw a CategoryNamePartError.
          */
         static void validate(const std::string &);
+
+        /**
+         * Return the shared copy of the parameter, validating it if it
+         * has not been seen before.
+         *
+         * \since 0.48
+         */
+        static const std::string * intern(const std::string &);
     };
 
     /**
@@ -187,6 +203,14 @@ namespace paludis
          * throw a SlotNameError.
          */
         static void validate(const std::string &);
+
+        /**
+         * Return the shared copy of the parameter, validating it if it
+         * has not been seen before.
+         *
+         * \since 0.48
+         */
+        static const std::string * intern(const std::string &);
     };
 
     /**
@@ -219,6 +243,14 @@ namespace paludis
          * throw a RepositoryNameError.
          */
         static void validate(const std::string &);
+
+        /**
+         * Return the shared copy of the parameter, validating it if it
+         * has not been seen before.
+         *
+         * \since 0.48
+         */
+        static const std::string * intern(const std::string &);
     };
 
     /**
@@ -19,6 +19,7 @@
 
 #include <paludis/name.hh>
 #include <paludis/util/exception.hh>
+#include <paludis/util/hashes.hh>
 #include <test/test_framework.hh>
 #include <test/test_runner.hh>
 
@@ -196,6 +197,29 @@ namespace test_cases
         }
     } test_package_name_part_comparison;
 
+    /**
+     * \test Test PackageNamePart interning.
+     *
+     */
+    struct PackageNamePartInterningTest : public TestCase
+    {
+        PackageNamePartInterningTest() : TestCase("interning") { }
+
+        void run()
+        {
+            PackageNamePart p1("interned"), p2(std::string("intern") + "ed"), p3("other");
+
+            TEST_CHECK(&p1.data() == &p2.data());
+            TEST_CHECK(&p1.data() != &p3.data());
+            TEST_CHECK(Hash<PackageNamePart>()(p1) == Hash<PackageNamePart>()(p2));
+
+            QualifiedPackageName q1("cat/interned"), q2(CategoryNamePart("cat") + p2);
+            TEST_CHECK(q1 == q2);
+            TEST_CHECK(q1.hash() == q2.hash());
+            TEST_CHECK(&q1.package().data() == &p1.data());
+        }
+    } test_package_name_part_interning;
+
     /**
      * \test Test RepositoryName creation.
      *
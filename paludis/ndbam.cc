@@ -31,7 +31,9 @@
 #include <paludis/util/make_named_values.hh>
 #include <paludis/util/safe_ofstream.hh>
 #include <paludis/util/timestamp.hh>
+#include <paludis/util/mutex.hh>
 #include <paludis/ndbam.hh>
+#include <paludis/owners_index.hh>
 #include <paludis/package_id.hh>
 #include <paludis/metadata_key.hh>
 #include <paludis/name.hh>
@@ -94,6 +96,9 @@ namespace paludis
         mutable Mutex category_names_containing_package_mutex;
         mutable CategoryNamesContainingPackage category_names_containing_package;
 
+        mutable Mutex owners_index_mutex;
+        mutable std::tr1::shared_ptr<OwnersIndex> owners_index;
+
         Implementation(const FSEntry & l, const VersionSpecOptions & o) :
             location(l),
             version_options(o)
@@ -435,162 +440,236 @@ NDBAM::remove_entry(const QualifiedPackageName & q, const FSEntry & d)
     }
 }
 
-void
-NDBAM::parse_contents(const PackageID & id,
-        const std::tr1::function<void (const std::tr1::shared_ptr<const ContentsEntry> &)> & on_file,
-        const std::tr1::function<void (const std::tr1::shared_ptr<const ContentsEntry> &)> & on_dir,
-        const std::tr1::function<void (const std::tr1::shared_ptr<const ContentsEntry> &)> & on_sym
-        ) const
+namespace
 {
-    Context c("When fetching contents for '" + stringify(id) + "':");
+    template <typename Sink_>
+    void parse_contents_file(const PackageID & id, Sink_ & sink)
+    {
+        Context c("When fetching contents for '" + stringify(id) + "':");
 
-    if (! id.fs_location_key())
-        throw InternalError(PALUDIS_HERE, "No id.fs_location_key");
+        if (! id.fs_location_key())
+            throw InternalError(PALUDIS_HERE, "No id.fs_location_key");
 
-    FSEntry ff(id.fs_location_key()->value() / "contents");
-    if (! ff.is_regular_file_or_symlink_to_regular_file())
-    {
-        Log::get_instance()->message("ndbam.contents.skipping", ll_warning, lc_context)
-            << "Contents file '" << ff << "' not a regular file, skipping";
-        return;
-    }
+        FSEntry ff(id.fs_location_key()->value() / "contents");
+        if (! ff.is_regular_file_or_symlink_to_regular_file())
+        {
+            Log::get_instance()->message("ndbam.contents.skipping", ll_warning, lc_context)
+                << "Contents file '" << ff << "' not a regular file, skipping";
+            return;
+        }
 
-    LineConfigFile f(ff, LineConfigFileOptions());
-    for (LineConfigFile::ConstIterator line(f.begin()), line_end(f.end()) ;
-            line != line_end ; ++line)
-    {
-        std::map<std::string, std::string> tokens;
-        std::string::size_type p(0);
-        bool error(false);
-        while ((! error) && (p < line->length()) && (std::string::npos != p))
+        LineConfigFile f(ff, LineConfigFileOptions());
+        for (LineConfigFile::ConstIterator line(f.begin()), line_end(f.end()) ;
+                line != line_end ; ++line)
         {
-            std::string::size_type q(line->find('=', p));
-            if (std::string::npos == q)
+            std::map<std::string, std::string> tokens;
+            std::string::size_type p(0);
+            bool error(false);
+            while ((! error) && (p < line->length()) && (std::string::npos != p))
             {
-                Log::get_instance()->message("ndbam.contents.invalid", ll_warning, lc_context)
-                    << "Malformed line '" << *line << "' in '" << ff << "'";
-                error = true;
-                continue;
-            }
+                std::string::size_type q(line->find('=', p));
+                if (std::string::npos == q)
+                {
+                    Log::get_instance()->message("ndbam.contents.invalid", ll_warning, lc_context)
+                        << "Malformed line '" << *line << "' in '" << ff << "'";
+                    error = true;
+                    continue;
+                }
 
-            std::string key(line->substr(p, q - p)), value;
-            p = q + 1;
-            while (p < line->length() && std::string::npos != p)
-            {
-                if ('\\' == (*line)[p])
+                std::string key(line->substr(p, q - p)), value;
+                p = q + 1;
+                while (p < line->length() && std::string::npos != p)
                 {
-                    ++p;
-                    if (p >= line->length() || std::string::npos == p)
+                    if ('\\' == (*line)[p])
+                    {
+                        ++p;
+                        if (p >= line->length() || std::string::npos == p)
+                        {
+                            Log::get_instance()->message("ndbam.contents.invalid", ll_warning, lc_context)
+                                << "Malformed line '" << *line << "' in '" << ff << "'";
+                            error = true;
+                            break;
+                        }
+                        if ('n' == (*line)[p])
+                            value.append("\n");
+                        else
+                            value.append(1, (*line)[p]);
+                        ++p;
+                    }
+                    else if (' ' == (*line)[p])
                     {
-                        Log::get_instance()->message("ndbam.contents.invalid", ll_warning, lc_context)
-                            << "Malformed line '" << *line << "' in '" << ff << "'";
-                        error = true;
+                        if (! tokens.insert(std::make_pair(key, value)).second)
+                            Log::get_instance()->message("ndbam.contents.duplicate", ll_warning, lc_context)
+                                << "Duplicate token '" << key << "' on line '" << *line << "' in '" << ff << "'";
+                        key.clear();
+                        value.clear();
+                        ++p;
                         break;
                     }
-                    if ('n' == (*line)[p])
-                        value.append("\n");
                     else
+                    {
                         value.append(1, (*line)[p]);
-                    ++p;
+                        ++p;
+                    }
                 }
-                else if (' ' == (*line)[p])
+
+                if ((! error) && (! key.empty()))
                 {
                     if (! tokens.insert(std::make_pair(key, value)).second)
                         Log::get_instance()->message("ndbam.contents.duplicate", ll_warning, lc_context)
                             << "Duplicate token '" << key << "' on line '" << *line << "' in '" << ff << "'";
-                    key.clear();
-                    value.clear();
-                    ++p;
-                    break;
-                }
-                else
-                {
-                    value.append(1, (*line)[p]);
-                    ++p;
                 }
             }
 
-            if ((! error) && (! key.empty()))
+            if (error)
+                continue;
+
+            if (! tokens.count("type"))
             {
-                if (! tokens.insert(std::make_pair(key, value)).second)
-                    Log::get_instance()->message("ndbam.contents.duplicate", ll_warning, lc_context)
-                        << "Duplicate token '" << key << "' on line '" << *line << "' in '" << ff << "'";
+                Log::get_instance()->message("ndbam.contents.no_key.type", ll_warning, lc_context) <<
+                    "No key 'type' found on line '" << *line << "' in '" << ff << "'";
+                continue;
             }
-        }
+            std::string type(tokens.find("type")->second);
 
-        if (error)
-            continue;
+            if (! tokens.count("path"))
+            {
+                Log::get_instance()->message("ndbam.contents.no_key.path", ll_warning, lc_context) <<
+                    "No key 'path' found on line '" << *line << "' in '" << ff << "'";
+                continue;
+            }
+            std::string path(tokens.find("path")->second);
 
-        if (! tokens.count("type"))
-        {
-            Log::get_instance()->message("ndbam.contents.no_key.type", ll_warning, lc_context) <<
-                "No key 'type' found on line '" << *line << "' in '" << ff << "'";
-            continue;
-        }
-        std::string type(tokens.find("type")->second);
+            if ("file" == type)
+            {
+                if (! tokens.count("md5"))
+                {
+                    Log::get_instance()->message("ndbam.contents.no_key.md5", ll_warning, lc_context) <<
+                        "No key 'md5' found on sym line '" << *line << "' in '" << ff << "'";
+                    continue;
+                }
+                std::string md5(tokens.find("md5")->second);
 
-        if (! tokens.count("path"))
-        {
-            Log::get_instance()->message("ndbam.contents.no_key.path", ll_warning, lc_context) <<
-                "No key 'path' found on line '" << *line << "' in '" << ff << "'";
-            continue;
-        }
-        std::string path(tokens.find("path")->second);
+                if (! tokens.count("mtime"))
+                {
+                    Log::get_instance()->message("ndbam.contents.no_key.mtime", ll_warning, lc_context) <<
+                        "No key 'mtime' found on sym line '" << *line << "' in '" << ff << "'";
+                    continue;
+                }
+                time_t mtime(destringify<time_t>(tokens.find("mtime")->second));
 
-        if ("file" == type)
-        {
-            if (! tokens.count("md5"))
+                sink.file(path, md5, Timestamp(mtime, 0));
+            }
+            else if ("dir" == type)
             {
-                Log::get_instance()->message("ndbam.contents.no_key.md5", ll_warning, lc_context) <<
-                    "No key 'md5' found on sym line '" << *line << "' in '" << ff << "'";
-                continue;
+                sink.dir(path);
             }
-            std::string md5(tokens.find("md5")->second);
-
-            if (! tokens.count("mtime"))
+            else if ("sym" == type)
             {
-                Log::get_instance()->message("ndbam.contents.no_key.mtime", ll_warning, lc_context) <<
-                    "No key 'mtime' found on sym line '" << *line << "' in '" << ff << "'";
-                continue;
+                if (! tokens.count("target"))
+                {
+                    Log::get_instance()->message("ndbam.contents.no_key.target", ll_warning, lc_context) <<
+                        "No key 'target' found on sym line '" << *line << "' in '" << ff << "'";
+                    continue;
+                }
+                std::string target(tokens.find("target")->second);
+
+                if (! tokens.count("mtime"))
+                {
+                    Log::get_instance()->message("ndbam.contents.no_key.mtime", ll_warning, lc_context) <<
+                        "No key 'mtime' found on sym line '" << *line << "' in '" << ff << "'";
+                    continue;
+                }
+                time_t mtime(destringify<time_t>(tokens.find("mtime")->second));
+
+                sink.sym(path, target, Timestamp(mtime, 0));
             }
-            time_t mtime(destringify<time_t>(tokens.find("mtime")->second));
+            else
+                Log::get_instance()->message("ndbam.contents.unknown_type", ll_warning, lc_context) <<
+                    "Unknown type '" << type << "' found on line '" << *line << "' in '" << ff << "'";
+        }
+    }
+
+    struct CallbackContentsSink
+    {
+        const std::tr1::function<void (const std::tr1::shared_ptr<const ContentsEntry> &)> & on_file;
+        const std::tr1::function<void (const std::tr1::shared_ptr<const ContentsEntry> &)> & on_dir;
+        const std::tr1::function<void (const std::tr1::shared_ptr<const ContentsEntry> &)> & on_sym;
+
+        CallbackContentsSink(
+                const std::tr1::function<void (const std::tr1::shared_ptr<const ContentsEntry> &)> & f,
+                const std::tr1::function<void (const std::tr1::shared_ptr<const ContentsEntry> &)> & d,
+                const std::tr1::function<void (const std::tr1::shared_ptr<const ContentsEntry> &)> & s) :
+            on_file(f),
+            on_dir(d),
+            on_sym(s)
+        {
+        }
 
+        void file(const std::string & path, const std::string & md5, const Timestamp & mtime)
+        {
             std::tr1::shared_ptr<ContentsFileEntry> entry(make_shared_ptr(new ContentsFileEntry(path)));
             entry->add_metadata_key(make_shared_ptr(new LiteralMetadataValueKey<std::string>("md5", "md5", mkt_normal, md5)));
-            entry->add_metadata_key(make_shared_ptr(new LiteralMetadataTimeKey("mtime", "mtime", mkt_normal, Timestamp(mtime, 0))));
+            entry->add_metadata_key(make_shared_ptr(new LiteralMetadataTimeKey("mtime", "mtime", mkt_normal, mtime)));
             on_file(entry);
         }
-        else if ("dir" == type)
+
+        void dir(const std::string & path)
         {
             std::tr1::shared_ptr<ContentsDirEntry> entry(make_shared_ptr(new ContentsDirEntry(path)));
             on_dir(entry);
         }
-        else if ("sym" == type)
-        {
-            if (! tokens.count("target"))
-            {
-                Log::get_instance()->message("ndbam.contents.no_key.target", ll_warning, lc_context) <<
-                    "No key 'target' found on sym line '" << *line << "' in '" << ff << "'";
-                continue;
-            }
-            std::string target(tokens.find("target")->second);
-
-            if (! tokens.count("mtime"))
-            {
-                Log::get_instance()->message("ndbam.contents.no_key.mtime", ll_warning, lc_context) <<
-                    "No key 'mtime' found on sym line '" << *line << "' in '" << ff << "'";
-                continue;
-            }
-            time_t mtime(destringify<time_t>(tokens.find("mtime")->second));
 
+        void sym(const std::string & path, const std::string & target, const Timestamp & mtime)
+        {
             std::tr1::shared_ptr<ContentsSymEntry> entry(make_shared_ptr(new ContentsSymEntry(path, target)));
-            entry->add_metadata_key(make_shared_ptr(new LiteralMetadataTimeKey("mtime", "mtime", mkt_normal, Timestamp(mtime, 0))));
+            entry->add_metadata_key(make_shared_ptr(new LiteralMetadataTimeKey("mtime", "mtime", mkt_normal, mtime)));
             on_sym(entry);
         }
-        else
-            Log::get_instance()->message("ndbam.contents.unknown_type", ll_warning, lc_context) <<
-                "Unknown type '" << type << "' found on line '" << *line << "' in '" << ff << "'";
-    }
+    };
+
+    struct CompactContentsSink
+    {
+        Contents & contents;
+
+        CompactContentsSink(Contents & c) :
+            contents(c)
+        {
+        }
+
+        void file(const std::string & path, const std::string & md5, const Timestamp & mtime)
+        {
+            contents.add_file(path, md5, mtime);
+        }
+
+        void dir(const std::string & path)
+        {
+            contents.add_dir(path);
+        }
+
+        void sym(const std::string & path, const std::string & target, const Timestamp & mtime)
+        {
+            contents.add_sym(path, target, mtime);
+        }
+    };
+}
+
+void
+NDBAM::parse_contents(const PackageID & id,
+        const std::tr1::function<void (const std::tr1::shared_ptr<const ContentsEntry> &)> & on_file,
+        const std::tr1::function<void (const std::tr1::shared_ptr<const ContentsEntry> &)> & on_dir,
+        const std::tr1::function<void (const std::tr1::shared_ptr<const ContentsEntry> &)> & on_sym
+        ) const
+{
+    CallbackContentsSink sink(on_file, on_dir, on_sym);
+    parse_contents_file(id, sink);
+}
+
+void
+NDBAM::parse_contents(const PackageID & id, Contents & contents) const
+{
+    CompactContentsSink sink(contents);
+    parse_contents_file(id, sink);
 }
 
 std::tr1::shared_ptr<const CategoryNamePartSet>
@@ -672,7 +751,21 @@ NDBAM::index(const QualifiedPackageName & q, const std::string & d) const
         pc_index_sym.symlink("../../../data/" + d);
 }
 
+const std::tr1::shared_ptr<OwnersIndex>
+NDBAM::owners_index(const bool create) const
+{
+    Lock l(_imp->owners_index_mutex);
+
+    if (! _imp->owners_index)
+    {
+        FSEntry f(_imp->location / "indices" / "owners");
+        if (create || f.exists())
+            _imp->owners_index.reset(new OwnersIndex(f, "contents"));
+    }
+
+    return _imp->owners_index;
+}
+
 template class Sequence<std::tr1::shared_ptr<NDBAMEntry> >;
 template class WrappedForwardIterator<Sequence<std::tr1::shared_ptr<NDBAMEntry> >::ConstIteratorTag, const std::tr1::shared_ptr<NDBAMEntry> >;
 
-
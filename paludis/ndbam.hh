@@ -35,6 +35,8 @@
 
 namespace paludis
 {
+    class OwnersIndex;
+
     namespace n
     {
         struct fs_location;
@@ -122,6 +124,14 @@ namespace paludis
                     const std::tr1::function<void (const std::tr1::shared_ptr<const ContentsEntry> &)> & on_sym
                     ) const;
 
+            /**
+             * Parse the contents file for a given ID, adding its entries to a
+             * Contents in compact form.
+             *
+             * \since 0.48
+             */
+            void parse_contents(const PackageID &, Contents &) const;
+
             /**
              * Index a newly added QualifiedPackageName, using the provided data directory
              * name part.
@@ -132,6 +142,17 @@ namespace paludis
              * Deindex a QualifiedPackageName that no longer has any versions installed.
              */
             void deindex(const QualifiedPackageName &) const;
+
+            /**
+             * Our owners index, which is kept alongside our other indices.
+             *
+             * If create is false and no index has been written yet, returns
+             * a null pointer, since building one means loading the contents
+             * of every ID.
+             *
+             * \since 0.48
+             */
+            const std::tr1::shared_ptr<OwnersIndex> owners_index(const bool create) const;
     };
 }
 
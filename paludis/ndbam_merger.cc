@@ -155,11 +155,7 @@ NDBAMMerger::record_install_file(const FSEntry & src, const FSEntry & dst_dir, c
             tidy_real(stringify((dst_dir / src.basename()).strip_leading(_imp->realroot)));
     time_t timestamp((dst_dir / dst_name).mtim().seconds());
 
-    SafeIFStream infile(FSEntry(dst_dir / dst_name));
-    if (! infile)
-        throw MergerError("Cannot read '" + stringify(FSEntry(dst_dir / dst_name)) + "'");
-
-    MD5 md5(infile);
+    std::string md5(installed_file_md5(dst_dir / dst_name));
 
     std::string line(make_arrows(flags) + " [obj] " + tidy_real);
     if (tidy_real != tidy)
@@ -168,7 +164,7 @@ NDBAMMerger::record_install_file(const FSEntry & src, const FSEntry & dst_dir, c
 
     *_imp->contents_file << "type=file";
     *_imp->contents_file << " path=" << escape(tidy_real);
-    *_imp->contents_file << " md5=" << md5.hexsum();
+    *_imp->contents_file << " md5=" << md5;
     *_imp->contents_file << " mtime=" << timestamp;
     *_imp->contents_file << std::endl;
 }
@@ -0,0 +1,748 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/owners_index.hh>
+#include <paludis/util/private_implementation_pattern-impl.hh>
+#include <paludis/util/fs_entry.hh>
+#include <paludis/util/dir_iterator.hh>
+#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/util/wrapped_output_iterator.hh>
+#include <paludis/util/make_named_values.hh>
+#include <paludis/util/destringify.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/timestamp.hh>
+#include <paludis/util/mutex.hh>
+#include <paludis/util/md5.hh>
+#include <paludis/util/log.hh>
+#include <paludis/package_id.hh>
+#include <paludis/metadata_key.hh>
+#include <paludis/contents.hh>
+#include <paludis/name.hh>
+#include <tr1/functional>
+#include <algorithm>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#include <set>
+#include <map>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace paludis;
+
+template class PrivateImplementationPattern<OwnersIndex>;
+
+namespace
+{
+    const std::string magic("paludis-owners-2");
+
+    /* a record in one of our sorted files is a key, a nul, a value and a
+     * newline. keys are paths or bits of paths, which can't contain nuls, and
+     * which can't contain newlines either since contents files can't
+     * represent them. */
+    struct Record
+    {
+        const char * key;
+        std::size_t key_size;
+        const char * value;
+        std::size_t value_size;
+        const char * next;
+    };
+
+    Record parse_record(const char * const r, const char * const end)
+    {
+        const char * n(static_cast<const char *>(std::memchr(r, '\n', end - r)));
+        if (! n)
+            n = end;
+
+        const char * z(static_cast<const char *>(std::memchr(r, '\0', n - r)));
+        if (! z)
+            throw InternalError(PALUDIS_HERE, "bad record '" + std::string(r, n) + "'");
+
+        Record result = { r, std::size_t(z - r), z + 1, std::size_t(n - z - 1), n == end ? end : n + 1 };
+        return result;
+    }
+
+    bool key_has_prefix(const Record & r, const std::string & prefix)
+    {
+        return r.key_size >= prefix.length() && 0 == std::memcmp(r.key, prefix.data(), prefix.length());
+    }
+
+    bool key_equals(const Record & r, const std::string & key)
+    {
+        return r.key_size == key.length() && 0 == std::memcmp(r.key, key.data(), key.length());
+    }
+
+    /* one of our sorted files, either mapped into memory or, if we couldn't
+     * save it, held in a string */
+    class SortedFile
+    {
+        private:
+            void * _map;
+            std::size_t _map_size;
+            std::string _data;
+
+            const char * _start;
+            const char * _begin;
+            const char * _end;
+
+            SortedFile(const SortedFile &);
+            SortedFile & operator= (const SortedFile &);
+
+            const char * _record_at_or_after(const char * const p) const
+            {
+                if (p == _begin)
+                    return p;
+                const char * n(static_cast<const char *>(std::memchr(p - 1, '\n', _end - p + 1)));
+                return n ? n + 1 : _end;
+            }
+
+        public:
+            SortedFile(const FSEntry & f, const std::string & header) :
+                _map(MAP_FAILED),
+                _map_size(0),
+                _start(0),
+                _begin(0),
+                _end(0)
+            {
+                int fd(::open(stringify(f).c_str(), O_RDONLY | O_CLOEXEC));
+                if (-1 == fd)
+                    throw InternalError(PALUDIS_HERE, "cannot open '" + stringify(f) + "': " + std::strerror(errno));
+
+                struct stat st;
+                if (0 == ::fstat(fd, &st) && st.st_size > 0)
+                {
+                    _map_size = st.st_size;
+                    _map = ::mmap(0, _map_size, PROT_READ, MAP_SHARED, fd, 0);
+                }
+                ::close(fd);
+
+                if (MAP_FAILED == _map)
+                    throw InternalError(PALUDIS_HERE, "cannot map '" + stringify(f) + "'");
+
+                const char * const begin(static_cast<const char *>(_map));
+                if (_map_size < header.length() || 0 != std::memcmp(begin, header.data(), header.length()))
+                {
+                    ::munmap(_map, _map_size);
+                    throw InternalError(PALUDIS_HERE, "'" + stringify(f) + "' does not belong to this index");
+                }
+
+                _start = begin;
+                _begin = begin + header.length();
+                _end = begin + _map_size;
+            }
+
+            SortedFile(const std::string & data, const std::string & header) :
+                _map(MAP_FAILED),
+                _map_size(0),
+                _data(data)
+            {
+                _start = _data.data();
+                _begin = _data.data() + header.length();
+                _end = _data.data() + _data.length();
+            }
+
+            ~SortedFile()
+            {
+                if (MAP_FAILED != _map)
+                    ::munmap(_map, _map_size);
+            }
+
+            const char * begin() const
+            {
+                return _begin;
+            }
+
+            const char * end() const
+            {
+                return _end;
+            }
+
+            bool in_memory() const
+            {
+                return MAP_FAILED == _map;
+            }
+
+            /* offsets are from the start of the file, header included */
+            const char * at(const std::size_t offset) const
+            {
+                return _start + offset;
+            }
+
+            /* the first record whose key is not less than k */
+            const char * lower_bound(const std::string & k) const
+            {
+                const char * lo(_begin), * hi(_end);
+                while (lo < hi)
+                {
+                    const char * mid(_record_at_or_after(lo + (hi - lo) / 2));
+                    if (mid >= hi)
+                        mid = lo;
+
+                    Record r(parse_record(mid, _end));
+                    int c(std::memcmp(r.key, k.data(), std::min(r.key_size, k.length())));
+                    if (c < 0 || (0 == c && r.key_size < k.length()))
+                        lo = r.next;
+                    else
+                        hi = mid;
+                }
+
+                return lo;
+            }
+    };
+
+    struct OwnerRecord
+    {
+        Timestamp mtime;
+        std::string name;
+        std::string owner;
+
+        OwnerRecord(const Timestamp & t, const std::string & n, const std::string & o) :
+            mtime(t),
+            name(n),
+            owner(o)
+        {
+        }
+    };
+
+    typedef std::pair<std::string, unsigned> OwnedPath;
+
+    struct SuffixComparator
+    {
+        const std::vector<OwnedPath> & paths;
+
+        bool operator() (const std::pair<unsigned, unsigned> & a, const std::pair<unsigned, unsigned> & b) const
+        {
+            int c(paths[a.first].first.compare(a.second, std::string::npos, paths[b.first].first, b.second, std::string::npos));
+            if (0 != c)
+                return c < 0;
+            return a < b;
+        }
+    };
+
+    void add_path(std::vector<std::string> & paths, const std::string & path)
+    {
+        paths.push_back(path);
+    }
+
+    void write_file(const FSEntry & f, const std::string & data)
+    {
+        FSEntry tmp(f.dirname() / ("-" + f.basename()));
+        {
+            SafeOFStream s(tmp);
+            s << data;
+        }
+        tmp.rename(f);
+    }
+
+    void add_directory_stamp(std::ostream & s, const FSEntry & dir, const std::string & name, const int depth)
+    {
+        for (DirIterator d(dir), d_end ; d != d_end ; ++d)
+        {
+            if (! d->is_directory())
+                continue;
+
+            Timestamp t(d->mtim());
+            s << name << "/" << d->basename() << " " << t.seconds() << "." << t.nanoseconds() << std::endl;
+            if (depth > 1)
+                add_directory_stamp(s, *d, name + "/" + d->basename(), depth - 1);
+        }
+    }
+}
+
+namespace paludis
+{
+    template <>
+    struct Implementation<OwnersIndex>
+    {
+        const FSEntry index_dir;
+        const std::string contents_file_name;
+
+        mutable Mutex mutex;
+
+        mutable std::string generation;
+        mutable std::string stamp;
+        mutable std::vector<OwnerRecord> owners;
+        mutable std::tr1::shared_ptr<const SortedFile> paths;
+        mutable std::tr1::shared_ptr<const SortedFile> suffixes;
+        mutable std::tr1::shared_ptr<const SortedFile> components;
+
+        Implementation(const FSEntry & f, const std::string & c) :
+            index_dir(f),
+            contents_file_name(c)
+        {
+        }
+
+        void load() const;
+        void clear() const;
+
+        void add_exact(std::set<OwnedPath> &, const SortedFile &, const std::string &) const;
+        void add_prefixed(std::set<OwnedPath> &, const SortedFile &, const std::string &,
+                const std::string & head, const bool component) const;
+    };
+}
+
+void
+Implementation<OwnersIndex>::clear() const
+{
+    generation.clear();
+    stamp.clear();
+    owners.clear();
+    paths.reset();
+    suffixes.reset();
+    components.reset();
+}
+
+void
+Implementation<OwnersIndex>::load() const
+{
+    FSEntry stamp_file(index_dir / "stamp");
+    if (! stamp_file.is_regular_file())
+    {
+        /* if we couldn't save our last update, keep using it */
+        if (paths && paths->in_memory())
+            return;
+        clear();
+        return;
+    }
+
+    Context context("When loading owners index from '" + stringify(index_dir) + "':");
+
+    try
+    {
+        std::string m, g, s;
+        {
+            SafeIFStream f(stamp_file);
+            if (! (std::getline(f, m) && std::getline(f, g) && std::getline(f, s)))
+                throw InternalError(PALUDIS_HERE, "truncated stamp file");
+        }
+
+        if (m != magic)
+        {
+            Log::get_instance()->message("owners_index.unsupported", ll_warning, lc_context)
+                << "Owners index '" << index_dir << "' is not in a supported format, rebuilding it";
+            clear();
+            return;
+        }
+
+        if (g == generation)
+            return;
+
+        clear();
+
+        const std::string header(magic + " " + g + "\n");
+
+        {
+            SafeIFStream f(index_dir / "owners");
+            std::string line;
+            if ((! std::getline(f, line)) || line + "\n" != header)
+                throw InternalError(PALUDIS_HERE, "owners file does not belong to this index");
+
+            while (std::getline(f, line))
+            {
+                std::string::size_type p1(line.find(' ')), p2(line.find('\t')), p3(std::string::npos);
+                if (std::string::npos != p2)
+                    p3 = line.find('\t', p2 + 1);
+                if (std::string::npos == p1 || std::string::npos == p3 || p1 > p2)
+                    throw InternalError(PALUDIS_HERE, "bad line '" + line + "'");
+
+                owners.push_back(OwnerRecord(
+                            Timestamp(destringify<time_t>(line.substr(0, p1)), destringify<long>(line.substr(p1 + 1, p2 - p1 - 1))),
+                            line.substr(p2 + 1, p3 - p2 - 1),
+                            line.substr(p3 + 1)));
+            }
+        }
+
+        paths.reset(new SortedFile(index_dir / "paths", header));
+        suffixes.reset(new SortedFile(index_dir / "suffixes", header));
+        components.reset(new SortedFile(index_dir / "components", header));
+
+        generation = g;
+        stamp = s;
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("owners_index.broken", ll_warning, lc_context)
+            << "Owners index '" << index_dir << "' is broken, rebuilding it: '" << e.message() << "' (" << e.what() << ")";
+        clear();
+    }
+}
+
+void
+Implementation<OwnersIndex>::add_exact(std::set<OwnedPath> & found, const SortedFile & f, const std::string & path) const
+{
+    for (const char * r(f.lower_bound(path)) ; r != f.end() ; )
+    {
+        Record record(parse_record(r, f.end()));
+        if (! key_equals(record, path))
+            break;
+
+        found.insert(std::make_pair(path, destringify<unsigned>(std::string(record.value, record.value_size))));
+        r = record.next;
+    }
+}
+
+void
+Implementation<OwnersIndex>::add_prefixed(std::set<OwnedPath> & found, const SortedFile & f, const std::string & prefix,
+        const std::string & head, const bool component) const
+{
+    const bool is_paths(&f == paths.get());
+
+    for (const char * r(f.lower_bound(prefix)) ; r != f.end() ; )
+    {
+        Record record(parse_record(r, f.end()));
+        if (! key_has_prefix(record, prefix))
+            break;
+        r = record.next;
+
+        /* for a component, the prefix must be followed by a slash or by the
+         * end of the path */
+        if (component && record.key_size > prefix.length() && '/' != record.key[prefix.length()])
+            continue;
+
+        Record path(record);
+        if (! is_paths)
+            path = parse_record(paths->at(destringify<std::size_t>(std::string(record.value, record.value_size))), paths->end());
+
+        /* whatever comes before the slash in the pattern must come
+         * immediately before where the suffix starts */
+        std::size_t start(path.key_size - record.key_size);
+        if (start < head.length() || 0 != std::memcmp(path.key + start - head.length(), head.data(), head.length()))
+            continue;
+
+        found.insert(std::make_pair(std::string(path.key, path.key_size),
+                    destringify<unsigned>(std::string(path.value, path.value_size))));
+    }
+}
+
+OwnersIndex::OwnersIndex(const FSEntry & f, const std::string & c) :
+    PrivateImplementationPattern<OwnersIndex>(new Implementation<OwnersIndex>(f, c))
+{
+}
+
+OwnersIndex::~OwnersIndex()
+{
+}
+
+std::string
+OwnersIndex::directory_stamp(const FSEntry & dir, const int depth)
+{
+    std::stringstream s;
+    try
+    {
+        add_directory_stamp(s, dir, "", depth);
+    }
+    catch (const FSError &)
+    {
+        /* something changed while we were looking, so we'll be different
+         * next time anyway */
+        s << "-" << std::endl;
+    }
+
+    return MD5(s).hexsum();
+}
+
+bool
+OwnersIndex::is_current(const std::string & s) const
+{
+    Lock lock(_imp->mutex);
+
+    _imp->load();
+    return _imp->paths && _imp->stamp == s;
+}
+
+void
+OwnersIndex::update(const std::tr1::shared_ptr<const PackageIDSequence> & ids, const std::string & stamp)
+{
+    Lock lock(_imp->mutex);
+
+    _imp->load();
+
+    std::map<std::string, unsigned> old_numbers;
+    for (std::vector<OwnerRecord>::const_iterator o(_imp->owners.begin()), o_end(_imp->owners.end()) ;
+            o != o_end ; ++o)
+        old_numbers.insert(std::make_pair(o->owner, o - _imp->owners.begin()));
+
+    /* work out which IDs have unchanged contents, and load the contents of
+     * everything else */
+    std::vector<OwnerRecord> owners;
+    std::vector<OwnedPath> paths;
+    std::map<unsigned, unsigned> reused;
+    for (PackageIDSequence::ConstIterator i(ids->begin()), i_end(ids->end()) ;
+            i != i_end ; ++i)
+    {
+        if ((! (*i)->fs_location_key()) || (! (*i)->contents_key()))
+            continue;
+
+        const std::string owner(stringify((*i)->fs_location_key()->value()));
+        FSEntry contents_file((*i)->fs_location_key()->value() / _imp->contents_file_name);
+        Timestamp mtime(contents_file.exists() ? contents_file.mtim() : Timestamp(0, 0));
+
+        const unsigned number(owners.size());
+        owners.push_back(OwnerRecord(mtime, stringify((*i)->name()), owner));
+
+        std::map<std::string, unsigned>::const_iterator o(old_numbers.find(owner));
+        if (old_numbers.end() != o && _imp->owners[o->second].mtime == mtime)
+        {
+            reused.insert(std::make_pair(o->second, number));
+            continue;
+        }
+
+        Context context("When indexing the contents of '" + stringify(**i) + "':");
+
+        std::vector<std::string> owned;
+        (*i)->contents_key()->value()->for_each_location(
+                std::tr1::bind(&add_path, std::tr1::ref(owned), std::tr1::placeholders::_1));
+        for (std::vector<std::string>::const_iterator p(owned.begin()), p_end(owned.end()) ;
+                p != p_end ; ++p)
+            paths.push_back(std::make_pair(*p, number));
+    }
+
+    if (! reused.empty())
+        for (const char * r(_imp->paths->begin()) ; r != _imp->paths->end() ; )
+        {
+            Record record(parse_record(r, _imp->paths->end()));
+            r = record.next;
+
+            std::map<unsigned, unsigned>::const_iterator n(reused.find(
+                        destringify<unsigned>(std::string(record.value, record.value_size))));
+            if (reused.end() != n)
+                paths.push_back(std::make_pair(std::string(record.key, record.key_size), n->second));
+        }
+
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+    /* every part of every path that starts at a slash, other than the whole
+     * path, and every distinct component */
+    std::vector<std::pair<unsigned, unsigned> > suffixes;
+    std::set<std::string> components;
+    for (std::vector<OwnedPath>::const_iterator p(paths.begin()), p_end(paths.end()) ;
+            p != p_end ; ++p)
+        for (std::string::size_type s(p->first.find('/')) ; std::string::npos != s ; )
+        {
+            if (0 != s)
+                suffixes.push_back(std::make_pair(p - paths.begin(), s));
+
+            std::string::size_type e(p->first.find('/', s + 1));
+            if (e != s + 1 && s + 1 != p->first.length())
+                components.insert(p->first.substr(s + 1, std::string::npos == e ? std::string::npos : e - s - 1));
+            s = e;
+        }
+
+    SuffixComparator comparator = { paths };
+    std::sort(suffixes.begin(), suffixes.end(), comparator);
+
+    const Timestamp now(Timestamp::now());
+    const std::string generation(stringify(now.seconds()) + "." + stringify(now.nanoseconds()) + "." + stringify(::getpid()));
+    const std::string header(magic + " " + generation + "\n");
+
+    std::string owners_data(header), paths_data(header), suffixes_data(header), components_data(header);
+
+    for (std::vector<OwnerRecord>::const_iterator o(owners.begin()), o_end(owners.end()) ;
+            o != o_end ; ++o)
+        owners_data.append(stringify(o->mtime.seconds()) + " " + stringify(o->mtime.nanoseconds()) + "\t" +
+                o->name + "\t" + o->owner + "\n");
+
+    std::vector<std::size_t> offsets;
+    offsets.reserve(paths.size());
+    for (std::vector<OwnedPath>::const_iterator p(paths.begin()), p_end(paths.end()) ;
+            p != p_end ; ++p)
+    {
+        offsets.push_back(paths_data.length());
+        paths_data.append(p->first);
+        paths_data.append(1, '\0');
+        paths_data.append(stringify(p->second) + "\n");
+    }
+
+    for (std::vector<std::pair<unsigned, unsigned> >::const_iterator s(suffixes.begin()), s_end(suffixes.end()) ;
+            s != s_end ; ++s)
+    {
+        suffixes_data.append(paths[s->first].first, s->second, std::string::npos);
+        suffixes_data.append(1, '\0');
+        suffixes_data.append(stringify(offsets[s->first]) + "\n");
+    }
+
+    for (std::set<std::string>::const_iterator c(components.begin()), c_end(components.end()) ;
+            c != c_end ; ++c)
+    {
+        components_data.append(*c);
+        components_data.append(1, '\0');
+        components_data.append("\n");
+    }
+
+    Context context("When writing owners index to '" + stringify(_imp->index_dir) + "':");
+
+    try
+    {
+        /* older versions kept the index in a single file */
+        if (_imp->index_dir.exists() && ! _imp->index_dir.is_directory())
+            FSEntry(_imp->index_dir).unlink();
+        _imp->index_dir.dirname().mkdir();
+        FSEntry(_imp->index_dir).mkdir();
+
+        /* without a stamp, a half written index is never used */
+        FSEntry stamp_file(_imp->index_dir / "stamp");
+        if (stamp_file.exists())
+            stamp_file.unlink();
+
+        write_file(_imp->index_dir / "owners", owners_data);
+        write_file(_imp->index_dir / "paths", paths_data);
+        write_file(_imp->index_dir / "suffixes", suffixes_data);
+        write_file(_imp->index_dir / "components", components_data);
+        write_file(stamp_file, magic + "\n" + generation + "\n" + stamp + "\n");
+
+        _imp->load();
+        if (_imp->generation == generation)
+            return;
+    }
+    catch (const FSError & e)
+    {
+        Log::get_instance()->message("owners_index.write_failed", ll_warning, lc_context) << "Cannot write to '" <<
+                _imp->index_dir << "': '" << e.message() << "' (" << e.what() << ")";
+    }
+    catch (const SafeOFStreamError & e)
+    {
+        Log::get_instance()->message("owners_index.write_failed", ll_warning, lc_context) << "Cannot write to '" <<
+                _imp->index_dir << "': '" << e.message() << "' (" << e.what() << ")";
+    }
+
+    /* we couldn't save it, so just use it from memory */
+    _imp->generation = generation;
+    _imp->stamp = stamp;
+    _imp->owners = owners;
+    _imp->paths.reset(new SortedFile(paths_data, header));
+    _imp->suffixes.reset(new SortedFile(suffixes_data, header));
+    _imp->components.reset(new SortedFile(components_data, header));
+}
+
+std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence>
+OwnersIndex::owners(const Repository & repo, const std::string & pattern, const OwnersMatch m) const
+{
+    Lock lock(_imp->mutex);
+
+    _imp->load();
+
+    std::tr1::shared_ptr<RepositoryOwnersInterface::OwnersSequence> result(new RepositoryOwnersInterface::OwnersSequence);
+    if (! _imp->paths)
+        return result;
+
+    std::set<OwnedPath> found;
+
+    switch (m)
+    {
+        case om_full:
+            _imp->add_exact(found, *_imp->paths, pattern);
+            break;
+
+        case om_basename:
+            if (std::string::npos == pattern.find('/'))
+            {
+                _imp->add_prefixed(found, *_imp->paths, "/" + pattern, "", true);
+                _imp->add_prefixed(found, *_imp->suffixes, "/" + pattern, "", true);
+
+                /* only the last component counts */
+                for (std::set<OwnedPath>::iterator f(found.begin()), f_end(found.end()) ; f != f_end ; )
+                    if (0 != f->first.compare(f->first.rfind('/') + 1, std::string::npos, pattern))
+                        found.erase(f++);
+                    else
+                        ++f;
+            }
+            break;
+
+        case om_partial:
+            {
+                std::string::size_type slash(pattern.find('/'));
+                if (std::string::npos != slash)
+                {
+                    /* the pattern from its first slash onwards is a prefix of
+                     * a suffix, and the bit before the slash has to be
+                     * checked against what precedes it */
+                    const std::string head(pattern.substr(0, slash)), tail(pattern.substr(slash));
+                    if (head.empty())
+                        _imp->add_prefixed(found, *_imp->paths, tail, head, false);
+                    _imp->add_prefixed(found, *_imp->suffixes, tail, head, false);
+                }
+                else
+                {
+                    /* the pattern is inside a single component, so find
+                     * every component it's in and look those up */
+                    for (const char * r(_imp->components->begin()) ; r != _imp->components->end() ; )
+                    {
+                        Record record(parse_record(r, _imp->components->end()));
+                        r = record.next;
+
+                        if (record.key + record.key_size == std::search(record.key, record.key + record.key_size,
+                                    pattern.begin(), pattern.end()))
+                            continue;
+
+                        const std::string component("/" + std::string(record.key, record.key_size));
+                        _imp->add_prefixed(found, *_imp->paths, component, "", true);
+                        _imp->add_prefixed(found, *_imp->suffixes, component, "", true);
+                    }
+                }
+            }
+            break;
+
+        case last_om:
+            throw InternalError(PALUDIS_HERE, "Bad OwnersMatch");
+    }
+
+    /* only load IDs for the packages that own something we found */
+    std::map<unsigned, std::tr1::shared_ptr<const PackageID> > ids;
+    for (std::set<OwnedPath>::const_iterator f(found.begin()), f_end(found.end()) ;
+            f != f_end ; ++f)
+    {
+        if (f->second >= _imp->owners.size())
+            continue;
+
+        std::map<unsigned, std::tr1::shared_ptr<const PackageID> >::iterator i(ids.find(f->second));
+        if (ids.end() == i)
+        {
+            const OwnerRecord & o(_imp->owners[f->second]);
+            i = ids.insert(std::make_pair(f->second, std::tr1::shared_ptr<const PackageID>())).first;
+
+            const std::tr1::shared_ptr<const PackageIDSequence> q_ids(repo.package_ids(QualifiedPackageName(o.name)));
+            for (PackageIDSequence::ConstIterator q(q_ids->begin()), q_end(q_ids->end()) ;
+                    q != q_end ; ++q)
+                if ((*q)->fs_location_key() && stringify((*q)->fs_location_key()->value()) == o.owner)
+                {
+                    i->second = *q;
+                    break;
+                }
+        }
+
+        if (! i->second)
+            continue;
+
+        result->push_back(make_named_values<RepositoryOwnersEntry>(
+                    value_for<n::package_id>(i->second),
+                    value_for<n::path>(FSEntry(f->first))
+                    ));
+    }
+
+    return result;
+}
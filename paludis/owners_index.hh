@@ -0,0 +1,113 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_OWNERS_INDEX_HH
+#define PALUDIS_GUARD_PALUDIS_OWNERS_INDEX_HH 1
+
+#include <paludis/util/private_implementation_pattern.hh>
+#include <paludis/util/fs_entry-fwd.hh>
+#include <paludis/repository.hh>
+#include <paludis/package_id-fwd.hh>
+#include <string>
+
+/** \file
+ * Declarations for the OwnersIndex class.
+ *
+ * \ingroup g_repository
+ */
+
+namespace paludis
+{
+    /**
+     * A persistent index from paths to the installed IDs that own them,
+     * used by installed repositories to implement RepositoryOwnersInterface.
+     *
+     * The index is a directory of sorted files which are mapped into memory
+     * and binary searched, so a query only touches the parts of the index
+     * that can match: full and basename queries are exact lookups, and
+     * partial queries are range lookups on the parts of each path that start
+     * at a slash, or, for patterns without a slash, a scan of the distinct
+     * path components followed by lookups for the ones that match.
+     *
+     * The index records a stamp supplied by the repository, which should be
+     * cheap to work out and which should change whenever an ID is installed,
+     * uninstalled or replaced. When it has changed, the index must be
+     * updated, which only loads the contents of IDs that are new or whose
+     * contents file has changed.
+     *
+     * \ingroup g_repository
+     * \since 0.48
+     */
+    class PALUDIS_VISIBLE OwnersIndex :
+        private PrivateImplementationPattern<OwnersIndex>
+    {
+        public:
+            ///\name Basic operations
+            ///\{
+
+            /**
+             * \param index_dir Where the index is stored.
+             * \param contents_file_name The name of the contents file in
+             *     each ID's fs_location_key directory.
+             */
+            OwnersIndex(const FSEntry & index_dir, const std::string & contents_file_name);
+            ~OwnersIndex();
+
+            ///\}
+
+            /**
+             * A stamp made from the modification times of every directory
+             * under the specified directory, down to the specified depth.
+             *
+             * Suitable for repositories that create or rename a directory
+             * whenever they install, uninstall or replace an ID.
+             */
+            static std::string directory_stamp(const FSEntry &, const int depth)
+                PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * Was the index last updated with this stamp?
+             */
+            bool is_current(const std::string & stamp) const
+                PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * Bring the index up to date, given every ID in the repository and
+             * the repository's current stamp, and save it.
+             */
+            void update(const std::tr1::shared_ptr<const PackageIDSequence> &, const std::string & stamp);
+
+            /**
+             * Find owned paths matching a pattern.
+             *
+             * Owners are looked up in the specified repository by name, so
+             * only the packages that own a matching path have their IDs
+             * loaded.
+             */
+            std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence> owners(
+                    const Repository &, const std::string &, const OwnersMatch) const
+                PALUDIS_ATTRIBUTE((warn_unused_result));
+    };
+
+#ifdef PALUDIS_HAVE_EXTERN_TEMPLATE
+    extern template class PrivateImplementationPattern<OwnersIndex>;
+#endif
+}
+
+#endif
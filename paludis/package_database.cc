@@ -40,6 +40,7 @@
 #include <paludis/util/sequence-impl.hh>
 #include <paludis/util/wrapped_forward_iterator-impl.hh>
 #include <paludis/util/member_iterator.hh>
+#include <paludis/util/make_shared_ptr.hh>
 #include <tr1/functional>
 #include <algorithm>
 #include <list>
@@ -417,6 +418,27 @@ PackageDatabase::more_important_than(const RepositoryName & lhs,
     return l->second > r->second;
 }
 
+void
+PackageDatabase::prefetch_metadata(const std::tr1::shared_ptr<const PackageIDSequence> & ids) const
+{
+    typedef std::map<RepositoryName, std::tr1::shared_ptr<PackageIDSequence>, RepositoryNameComparator> IDsByRepository;
+    IDsByRepository ids_by_repository;
+
+    for (PackageIDSequence::ConstIterator i(ids->begin()), i_end(ids->end()) ;
+            i != i_end ; ++i)
+    {
+        IDsByRepository::iterator r(ids_by_repository.find((*i)->repository()->name()));
+        if (ids_by_repository.end() == r)
+            r = ids_by_repository.insert(std::make_pair((*i)->repository()->name(),
+                        make_shared_ptr(new PackageIDSequence))).first;
+        r->second->push_back(*i);
+    }
+
+    for (IDsByRepository::const_iterator r(ids_by_repository.begin()), r_end(ids_by_repository.end()) ;
+            r != r_end ; ++r)
+        fetch_repository(r->first)->prefetch_metadata(r->second);
+}
+
 PackageDatabase::RepositoryConstIterator
 PackageDatabase::begin_repositories() const
 {
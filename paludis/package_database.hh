@@ -290,6 +290,15 @@ namespace paludis
             bool more_important_than(const RepositoryName &, const RepositoryName &) const
                 PALUDIS_ATTRIBUTE((warn_unused_result));
 
+            /**
+             * Ask the repositories owning the given IDs to load or generate
+             * metadata for them ahead of it being needed.
+             *
+             * \see Repository::prefetch_metadata
+             * \since 0.48
+             */
+            void prefetch_metadata(const std::tr1::shared_ptr<const PackageIDSequence> &) const;
+
             ///\name Iterate over our repositories
             ///\{
 
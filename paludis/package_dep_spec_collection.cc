@@ -0,0 +1,151 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/package_dep_spec_collection.hh>
+#include <paludis/util/private_implementation_pattern-impl.hh>
+#include <paludis/util/sequence-impl.hh>
+#include <paludis/util/wrapped_forward_iterator-impl.hh>
+#include <paludis/util/wrapped_output_iterator-impl.hh>
+#include <paludis/util/hashes.hh>
+#include <paludis/util/make_shared_copy.hh>
+#include <paludis/dep_spec.hh>
+#include <paludis/dep_spec_flattener.hh>
+#include <paludis/match_package.hh>
+#include <paludis/package_id.hh>
+#include <paludis/name.hh>
+#include <tr1/unordered_map>
+#include <algorithm>
+#include <vector>
+
+using namespace paludis;
+
+template class PrivateImplementationPattern<PackageDepSpecCollection>;
+template class Sequence<unsigned>;
+template class WrappedForwardIterator<Sequence<unsigned>::ConstIteratorTag, const unsigned>;
+
+namespace
+{
+    typedef std::vector<unsigned> Positions;
+    typedef std::tr1::unordered_map<QualifiedPackageName, Positions, Hash<QualifiedPackageName> > ByPackage;
+    typedef std::tr1::unordered_map<CategoryNamePart, Positions, Hash<CategoryNamePart> > ByCategory;
+}
+
+namespace paludis
+{
+    template <>
+    struct Implementation<PackageDepSpecCollection>
+    {
+        std::vector<std::tr1::shared_ptr<const PackageDepSpec> > specs;
+
+        ByPackage by_package;
+        ByCategory by_category;
+        Positions wildcards;
+
+        /* every spec that could match something with this name, in no
+         * particular order */
+        void candidates(const QualifiedPackageName & name, Positions & result) const
+        {
+            ByPackage::const_iterator p(by_package.find(name));
+            if (by_package.end() != p)
+                result.insert(result.end(), p->second.begin(), p->second.end());
+
+            ByCategory::const_iterator c(by_category.find(name.category()));
+            if (by_category.end() != c)
+                result.insert(result.end(), c->second.begin(), c->second.end());
+
+            result.insert(result.end(), wildcards.begin(), wildcards.end());
+        }
+    };
+}
+
+PackageDepSpecCollection::PackageDepSpecCollection() :
+    PrivateImplementationPattern<PackageDepSpecCollection>(new Implementation<PackageDepSpecCollection>)
+{
+}
+
+PackageDepSpecCollection::~PackageDepSpecCollection()
+{
+}
+
+void
+PackageDepSpecCollection::insert(const PackageDepSpec & spec)
+{
+    const unsigned position(_imp->specs.size());
+    _imp->specs.push_back(make_shared_copy(spec));
+
+    if (spec.package_ptr())
+        _imp->by_package[*spec.package_ptr()].push_back(position);
+    else if (spec.category_name_part_ptr())
+        _imp->by_category[*spec.category_name_part_ptr()].push_back(position);
+    else
+        _imp->wildcards.push_back(position);
+}
+
+void
+PackageDepSpecCollection::insert_all(const Environment * const env, const SetSpecTree & set)
+{
+    DepSpecFlattener<SetSpecTree, PackageDepSpec> f(env);
+    set.root()->accept(f);
+
+    for (DepSpecFlattener<SetSpecTree, PackageDepSpec>::ConstIterator s(f.begin()), s_end(f.end()) ;
+            s != s_end ; ++s)
+        insert(**s);
+}
+
+unsigned
+PackageDepSpecCollection::size() const
+{
+    return _imp->specs.size();
+}
+
+bool
+PackageDepSpecCollection::match_any(
+        const Environment & env,
+        const PackageID & id,
+        const MatchPackageOptions & options) const
+{
+    Positions candidates;
+    _imp->candidates(id.name(), candidates);
+
+    for (Positions::const_iterator c(candidates.begin()), c_end(candidates.end()) ;
+            c != c_end ; ++c)
+        if (match_package(env, *_imp->specs[*c], id, options))
+            return true;
+
+    return false;
+}
+
+const std::tr1::shared_ptr<const Sequence<unsigned> >
+PackageDepSpecCollection::match_all(
+        const Environment & env,
+        const PackageID & id,
+        const MatchPackageOptions & options) const
+{
+    Positions candidates;
+    _imp->candidates(id.name(), candidates);
+    std::sort(candidates.begin(), candidates.end());
+
+    const std::tr1::shared_ptr<Sequence<unsigned> > result(new Sequence<unsigned>);
+    for (Positions::const_iterator c(candidates.begin()), c_end(candidates.end()) ;
+            c != c_end ; ++c)
+        if (match_package(env, *_imp->specs[*c], id, options))
+            result->push_back(*c);
+
+    return result;
+}
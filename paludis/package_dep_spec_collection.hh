@@ -0,0 +1,106 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_PACKAGE_DEP_SPEC_COLLECTION_HH
+#define PALUDIS_GUARD_PALUDIS_PACKAGE_DEP_SPEC_COLLECTION_HH 1
+
+#include <paludis/package_dep_spec_collection-fwd.hh>
+#include <paludis/util/private_implementation_pattern.hh>
+#include <paludis/util/attributes.hh>
+#include <paludis/util/sequence-fwd.hh>
+#include <paludis/dep_spec-fwd.hh>
+#include <paludis/spec_tree-fwd.hh>
+#include <paludis/environment-fwd.hh>
+#include <paludis/package_id-fwd.hh>
+#include <paludis/match_package-fwd.hh>
+#include <tr1/memory>
+
+/** \file
+ * Declarations for the PackageDepSpecCollection class.
+ *
+ * \ingroup g_query
+ */
+
+namespace paludis
+{
+    /**
+     * A collection of PackageDepSpec instances, indexed so that the ones
+     * that could match a given PackageID can be found without trying every
+     * spec against it.
+     *
+     * Specs are bucketed by package name, by category, and otherwise kept
+     * in a small list of wildcards. Each spec is numbered by the order in
+     * which it was added, which lets callers keep things like the rest of a
+     * configuration file line alongside it.
+     *
+     * \ingroup g_query
+     * \since 0.48
+     */
+    class PALUDIS_VISIBLE PackageDepSpecCollection :
+        private PrivateImplementationPattern<PackageDepSpecCollection>
+    {
+        public:
+            ///\name Basic operations
+            ///\{
+
+            PackageDepSpecCollection();
+            ~PackageDepSpecCollection();
+
+            ///\}
+
+            /**
+             * Add a spec. Specs are numbered from zero, in the order in
+             * which they are added.
+             */
+            void insert(const PackageDepSpec &);
+
+            /**
+             * Add every spec in a set, expanding any named sets it contains.
+             */
+            void insert_all(const Environment * const, const SetSpecTree &);
+
+            /**
+             * How many specs have been added?
+             */
+            unsigned size() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * Does any of our specs match?
+             */
+            bool match_any(
+                    const Environment &,
+                    const PackageID &,
+                    const MatchPackageOptions &) const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * The numbers of every spec that matches, in the order in which
+             * they were added.
+             */
+            const std::tr1::shared_ptr<const Sequence<unsigned> > match_all(
+                    const Environment &,
+                    const PackageID &,
+                    const MatchPackageOptions &) const PALUDIS_ATTRIBUTE((warn_unused_result));
+    };
+
+#ifdef PALUDIS_HAVE_EXTERN_TEMPLATE
+    extern template class PrivateImplementationPattern<PackageDepSpecCollection>;
+#endif
+}
+
+#endif
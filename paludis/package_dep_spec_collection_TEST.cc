@@ -0,0 +1,113 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/package_dep_spec_collection.hh>
+#include <paludis/user_dep_spec.hh>
+#include <paludis/dep_spec.hh>
+#include <paludis/spec_tree.hh>
+#include <paludis/package_database.hh>
+#include <paludis/environments/test/test_environment.hh>
+#include <paludis/repositories/fake/fake_repository.hh>
+#include <paludis/repositories/fake/fake_package_id.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/util/make_named_values.hh>
+#include <paludis/util/make_shared_ptr.hh>
+#include <paludis/util/join.hh>
+#include <test/test_runner.hh>
+#include <test/test_framework.hh>
+
+using namespace paludis;
+using namespace test;
+
+namespace
+{
+    std::string matches(const Environment & env, const PackageDepSpecCollection & c, const PackageID & id)
+    {
+        std::tr1::shared_ptr<const Sequence<unsigned> > m(c.match_all(env, id, MatchPackageOptions()));
+        return join(m->begin(), m->end(), " ");
+    }
+}
+
+namespace test_cases
+{
+    struct PackageDepSpecCollectionTest : TestCase
+    {
+        PackageDepSpecCollectionTest() : TestCase("package dep spec collection") { }
+
+        void run()
+        {
+            TestEnvironment env;
+            std::tr1::shared_ptr<FakeRepository> repo(new FakeRepository(make_named_values<FakeRepositoryParams>(
+                            value_for<n::environment>(&env),
+                            value_for<n::name>(RepositoryName("repo"))
+                            )));
+            env.package_database()->add_repository(1, repo);
+
+            std::tr1::shared_ptr<const PackageID> cat_a(repo->add_version("cat", "a", "1"));
+            std::tr1::shared_ptr<const PackageID> cat_b(repo->add_version("cat", "b", "2"));
+            std::tr1::shared_ptr<const PackageID> other_a(repo->add_version("other", "a", "3"));
+            std::tr1::shared_ptr<const PackageID> other_c(repo->add_version("other", "c", "4"));
+
+            PackageDepSpecCollection c;
+            TEST_CHECK(! c.match_any(env, *cat_a, MatchPackageOptions()));
+
+            const char * const specs[] = { "*/a", "cat/a", "cat/*", ">=cat/b-3", "*/*:0", "other/a", "cat/a" };
+            for (unsigned n(0) ; n < sizeof(specs) / sizeof(specs[0]) ; ++n)
+                c.insert(parse_user_package_dep_spec(specs[n], &env, UserPackageDepSpecOptions() + updso_allow_wildcards));
+            TEST_CHECK_EQUAL(c.size(), 7u);
+
+            TEST_CHECK_EQUAL(matches(env, c, *cat_a), "0 1 2 4 6");
+            TEST_CHECK_EQUAL(matches(env, c, *cat_b), "2 4");
+            TEST_CHECK_EQUAL(matches(env, c, *other_a), "0 4 5");
+            TEST_CHECK_EQUAL(matches(env, c, *other_c), "4");
+
+            TEST_CHECK(c.match_any(env, *cat_a, MatchPackageOptions()));
+            TEST_CHECK(c.match_any(env, *other_c, MatchPackageOptions()));
+        }
+    } test_package_dep_spec_collection;
+
+    struct PackageDepSpecCollectionSetTest : TestCase
+    {
+        PackageDepSpecCollectionSetTest() : TestCase("package dep spec collection set") { }
+
+        void run()
+        {
+            TestEnvironment env;
+            std::tr1::shared_ptr<FakeRepository> repo(new FakeRepository(make_named_values<FakeRepositoryParams>(
+                            value_for<n::environment>(&env),
+                            value_for<n::name>(RepositoryName("repo"))
+                            )));
+            env.package_database()->add_repository(1, repo);
+
+            std::tr1::shared_ptr<const PackageID> cat_a(repo->add_version("cat", "a", "1"));
+            std::tr1::shared_ptr<const PackageID> cat_b(repo->add_version("cat", "b", "2"));
+
+            SetSpecTree set(make_shared_ptr(new AllDepSpec));
+            set.root()->append(make_shared_ptr(new PackageDepSpec(parse_user_package_dep_spec("cat/b",
+                                &env, UserPackageDepSpecOptions()))));
+
+            PackageDepSpecCollection c;
+            c.insert_all(&env, set);
+            TEST_CHECK_EQUAL(c.size(), 1u);
+            TEST_CHECK(! c.match_any(env, *cat_a, MatchPackageOptions()));
+            TEST_CHECK(c.match_any(env, *cat_b, MatchPackageOptions()));
+        }
+    } test_package_dep_spec_collection_set;
+}
@@ -31,6 +31,7 @@
 #include <paludis/util/iterator_funcs.hh>
 #include <paludis/util/make_named_values.hh>
 #include <paludis/util/set.hh>
+#include <paludis/util/sequence.hh>
 #include <paludis/util/active_object_ptr.hh>
 #include <paludis/util/deferred_construction_ptr.hh>
 #include <paludis/choice.hh>
@@ -38,6 +39,7 @@
 #include <paludis/name.hh>
 #include <paludis/user_dep_spec.hh>
 #include <paludis/match_package.hh>
+#include <paludis/package_dep_spec_collection.hh>
 #include <paludis/package_id.hh>
 #include <paludis/environment.hh>
 #include <paludis/spec_tree.hh>
@@ -123,7 +125,7 @@ namespace
     struct SetNameWithValuesGroups
     {
         NamedValue<n::set_name, SetName> set_name;
-        NamedValue<n::set_value, ActiveObjectPtr<DeferredConstructionPtr<std::tr1::shared_ptr<const SetSpecTree> > > > set_value;
+        NamedValue<n::set_value, ActiveObjectPtr<DeferredConstructionPtr<std::tr1::shared_ptr<const PackageDepSpecCollection> > > > set_value;
         NamedValue<n::values_groups, ValuesGroups> values_groups;
     };
 
@@ -131,18 +133,18 @@ namespace
 
     typedef std::tr1::unordered_map<QualifiedPackageName, SpecsWithValuesGroups, Hash<QualifiedPackageName> > SpecificSpecs;
 
-    const std::tr1::shared_ptr<const SetSpecTree> make_set_value(
+    const std::tr1::shared_ptr<const PackageDepSpecCollection> make_set_value(
             const Environment * const env,
             const FSEntry from,
             const SetName name)
     {
-        std::tr1::shared_ptr<const SetSpecTree> result(env->set(name));
-        if (! result)
-        {
+        const std::tr1::shared_ptr<PackageDepSpecCollection> result(new PackageDepSpecCollection);
+        const std::tr1::shared_ptr<const SetSpecTree> set(env->set(name));
+        if (set)
+            result->insert_all(env, *set);
+        else
             Log::get_instance()->message("paludislike_options_conf.bad_set", ll_warning, lc_context)
                 << "Set '" << name << "' in '" << from << "' does not exist";
-            result.reset(new SetSpecTree(make_shared_ptr(new AllDepSpec)));
-        }
 
         return result;
     }
@@ -158,11 +160,16 @@ namespace paludis
         SpecificSpecs specific_specs;
         SetNamesWithValuesGroups set_specs;
         SpecsWithValuesGroups wildcard_specs;
+        PackageDepSpecCollection wildcard_specs_index;
+        std::vector<const SpecWithValuesGroups *> wildcard_specs_by_index;
 
         Implementation(const PaludisLikeOptionsConfParams & p) :
             params(p)
         {
         }
+
+        const std::vector<const SpecWithValuesGroups *> matching_wildcard_specs(
+                const std::tr1::shared_ptr<const PackageID> & maybe_id) const;
     };
 }
 
@@ -221,11 +228,14 @@ PaludisLikeOptionsConf::add_file(const FSEntry & f)
             }
             else
             {
-                values_groups = &_imp->wildcard_specs.insert(_imp->wildcard_specs.end(),
+                SpecsWithValuesGroups::iterator i(_imp->wildcard_specs.insert(_imp->wildcard_specs.end(),
                         make_named_values<SpecWithValuesGroups>(
                             value_for<n::spec>(*d),
                             value_for<n::values_groups>(ValuesGroups())
-                            ))->values_groups();
+                            )));
+                _imp->wildcard_specs_index.insert(*d);
+                _imp->wildcard_specs_by_index.push_back(&*i);
+                values_groups = &i->values_groups();
             }
         }
         catch (const GotASetNotAPackageDepSpec &)
@@ -235,7 +245,7 @@ PaludisLikeOptionsConf::add_file(const FSEntry & f)
             values_groups = &_imp->set_specs.insert(_imp->set_specs.end(),
                     make_named_values<SetNameWithValuesGroups>(
                         value_for<n::set_name>(n),
-                        value_for<n::set_value>(DeferredConstructionPtr<std::tr1::shared_ptr<const SetSpecTree> >(
+                        value_for<n::set_value>(DeferredConstructionPtr<std::tr1::shared_ptr<const PackageDepSpecCollection> >(
                                 std::tr1::bind(&make_set_value, _imp->params.environment(), f, n))),
                         value_for<n::values_groups>(ValuesGroups())
                         ))->values_groups();
@@ -468,6 +478,31 @@ namespace
     }
 }
 
+const std::vector<const SpecWithValuesGroups *>
+Implementation<PaludisLikeOptionsConf>::matching_wildcard_specs(
+        const std::tr1::shared_ptr<const PackageID> & maybe_id) const
+{
+    std::vector<const SpecWithValuesGroups *> result;
+
+    if (maybe_id)
+    {
+        std::tr1::shared_ptr<const Sequence<unsigned> > matches(wildcard_specs_index.match_all(
+                    *params.environment(), *maybe_id, MatchPackageOptions()));
+        for (Sequence<unsigned>::ConstIterator m(matches->begin()), m_end(matches->end()) ;
+                m != m_end ; ++m)
+            result.push_back(wildcard_specs_by_index[*m]);
+    }
+    else
+    {
+        for (SpecsWithValuesGroups::const_iterator i(wildcard_specs.begin()), i_end(wildcard_specs.end()) ;
+                i != i_end ; ++i)
+            if (match_anything(i->spec()))
+                result.push_back(&*i);
+    }
+
+    return result;
+}
+
 const std::pair<Tribool, bool>
 PaludisLikeOptionsConf::want_choice_enabled_locked(
         const std::tr1::shared_ptr<const PackageID> & maybe_id,
@@ -502,8 +537,7 @@ PaludisLikeOptionsConf::want_choice_enabled_locked(
         for (SetNamesWithValuesGroups::const_iterator r(_imp->set_specs.begin()), r_end(_imp->set_specs.end()) ;
                 r != r_end ; ++r)
         {
-            if (! match_package_in_set(*_imp->params.environment(), *r->set_value().value().value(),
-                        *maybe_id, MatchPackageOptions()))
+            if (! r->set_value().value().value()->match_any(*_imp->params.environment(), *maybe_id, MatchPackageOptions()))
                 continue;
 
             check_values_groups(_imp->params.environment(), maybe_id, prefix, unprefixed_name, r->values_groups(),
@@ -517,8 +551,11 @@ PaludisLikeOptionsConf::want_choice_enabled_locked(
     /* Wildcards? */
     if (! seen_minus_star)
     {
-        check_specs_with_values_groups(_imp->params.environment(), maybe_id, prefix, unprefixed_name,
-                _imp->wildcard_specs, seen_minus_star, result, dummy);
+        const std::vector<const SpecWithValuesGroups *> wildcards(_imp->matching_wildcard_specs(maybe_id));
+        for (std::vector<const SpecWithValuesGroups *>::const_iterator w(wildcards.begin()), w_end(wildcards.end()) ;
+                w != w_end ; ++w)
+            check_values_groups(_imp->params.environment(), maybe_id, prefix, unprefixed_name, (*w)->values_groups(),
+                    seen_minus_star, result, dummy);
 
         if (! result.first.is_indeterminate())
             return result;
@@ -562,7 +599,7 @@ PaludisLikeOptionsConf::value_for_choice_parameter(
         for (SetNamesWithValuesGroups::const_iterator r(_imp->set_specs.begin()), r_end(_imp->set_specs.end()) ;
                 r != r_end ; ++r)
         {
-            if (! match_package_in_set(*_imp->params.environment(), *r->set_value().value().value(), *id, MatchPackageOptions()))
+            if (! r->set_value().value().value()->match_any(*_imp->params.environment(), *id, MatchPackageOptions()))
                 continue;
 
             check_values_groups(_imp->params.environment(), id, prefix, unprefixed_name, r->values_groups(),
@@ -575,8 +612,11 @@ PaludisLikeOptionsConf::value_for_choice_parameter(
 
     /* Wildcards? */
     {
-        check_specs_with_values_groups(_imp->params.environment(), id, prefix, unprefixed_name, _imp->wildcard_specs,
-                dummy_seen_minus_star, dummy_result, equals_value);
+        const std::vector<const SpecWithValuesGroups *> wildcards(_imp->matching_wildcard_specs(id));
+        for (std::vector<const SpecWithValuesGroups *>::const_iterator w(wildcards.begin()), w_end(wildcards.end()) ;
+                w != w_end ; ++w)
+            check_values_groups(_imp->params.environment(), id, prefix, unprefixed_name, (*w)->values_groups(),
+                    dummy_seen_minus_star, dummy_result, equals_value);
 
         if (! equals_value.empty())
             return equals_value;
@@ -607,8 +647,7 @@ PaludisLikeOptionsConf::known_choice_value_names(
         for (SetNamesWithValuesGroups::const_iterator r(_imp->set_specs.begin()), r_end(_imp->set_specs.end()) ;
                 r != r_end ; ++r)
         {
-            if (! match_package_in_set(*_imp->params.environment(), *r->set_value().value().value(),
-                        *maybe_id, MatchPackageOptions()))
+            if (! r->set_value().value().value()->match_any(*_imp->params.environment(), *maybe_id, MatchPackageOptions()))
                 continue;
 
             collect_known_from_values_groups(_imp->params.environment(), maybe_id, prefix, r->values_groups(), result);
@@ -617,8 +656,10 @@ PaludisLikeOptionsConf::known_choice_value_names(
 
     /* Wildcards? */
     {
-        collect_known_from_specs_with_values_groups(_imp->params.environment(), maybe_id, prefix,
-                _imp->wildcard_specs, result);
+        const std::vector<const SpecWithValuesGroups *> wildcards(_imp->matching_wildcard_specs(maybe_id));
+        for (std::vector<const SpecWithValuesGroups *>::const_iterator w(wildcards.begin()), w_end(wildcards.end()) ;
+                w != w_end ; ++w)
+            collect_known_from_values_groups(_imp->params.environment(), maybe_id, prefix, (*w)->values_groups(), result);
     }
 
     return result;
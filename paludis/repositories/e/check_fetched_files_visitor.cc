@@ -40,6 +40,8 @@
 #include <paludis/util/sha1.hh>
 #include <paludis/util/sha256.hh>
 #include <paludis/util/md5.hh>
+#include <paludis/util/digests.hh>
+#include <paludis/util/options.hh>
 #include <paludis/util/make_named_values.hh>
 #include <paludis/util/sequence.hh>
 #include <paludis/util/wrapped_forward_iterator.hh>
@@ -248,6 +250,17 @@ CheckFetchedFilesVisitor::check_distfile_manifest(const FSEntry & distfile)
 
             MemoisedHashes * hashes = MemoisedHashes::get_instance();
 
+            DigestKinds kinds;
+            if (! m->rmd160().empty())
+                kinds += dk_rmd160;
+            if (! m->sha1().empty())
+                kinds += dk_sha1;
+            if (! m->sha256().empty())
+                kinds += dk_sha256;
+            if (! m->md5().empty())
+                kinds += dk_md5;
+            hashes->prefetch(distfile, kinds);
+
             if (! m->rmd160().empty())
             {
                 std::string rmd160hexsum(hashes->get<RMD160>(distfile, file_stream));
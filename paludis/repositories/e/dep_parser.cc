@@ -632,7 +632,7 @@ paludis::erepository::parse_uri_label(const std::string & s, const EAPI & e)
 std::tr1::shared_ptr<PlainTextLabelDepSpec>
 paludis::erepository::parse_plain_text_label(const std::string & s)
 {
-    Context context("When parsing label string '" + s + "':");
+    Context context("When parsing label string '", s, "':");
 
     if (s.empty())
         throw EDepParseError(s, "Empty label");
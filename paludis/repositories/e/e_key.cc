@@ -996,12 +996,13 @@ EContentsKey::value() const
     SafeIFStream ff(f);
 
     std::string line;
+    std::vector<std::string> tokens;
     unsigned line_number(0);
     while (std::getline(ff, line))
     {
         ++line_number;
 
-        std::vector<std::string> tokens;
+        tokens.clear();
         if (! VDBContentsTokeniser::tokenise(line, std::back_inserter(tokens)))
         {
             Log::get_instance()->message("e.contents.broken", ll_warning, lc_context) << "CONTENTS has broken line '" <<
@@ -1010,27 +1011,13 @@ EContentsKey::value() const
         }
 
         if ("obj" == tokens.at(0))
-        {
-            std::tr1::shared_ptr<ContentsEntry> e(new ContentsFileEntry(tokens.at(1)));
-            e->add_metadata_key(make_shared_ptr(new LiteralMetadataTimeKey("mtime", "mtime", mkt_normal,
-                            Timestamp(destringify<time_t>(tokens.at(3)), 0))));
-            e->add_metadata_key(make_shared_ptr(new LiteralMetadataValueKey<std::string>("md5", "md5", mkt_normal, tokens.at(2))));
-            _imp->value->add(e);
-        }
+            _imp->value->add_file(tokens.at(1), tokens.at(2), Timestamp(destringify<time_t>(tokens.at(3)), 0));
         else if ("dir" == tokens.at(0))
-        {
-            std::tr1::shared_ptr<ContentsEntry> e(new ContentsDirEntry(tokens.at(1)));
-            _imp->value->add(e);
-        }
+            _imp->value->add_dir(tokens.at(1));
         else if ("sym" == tokens.at(0))
-        {
-            std::tr1::shared_ptr<ContentsEntry> e(new ContentsSymEntry(tokens.at(1), tokens.at(2)));
-            e->add_metadata_key(make_shared_ptr(new LiteralMetadataTimeKey("mtime", "mtime", mkt_normal,
-                            Timestamp(destringify<time_t>(tokens.at(3)), 0))));
-            _imp->value->add(e);
-        }
+            _imp->value->add_sym(tokens.at(1), tokens.at(2), Timestamp(destringify<time_t>(tokens.at(3)), 0));
         else if ("misc" == tokens.at(0) || "fif" == tokens.at(0) || "dev" == tokens.at(0))
-            _imp->value->add(std::tr1::shared_ptr<ContentsEntry>(new ContentsOtherEntry(tokens.at(1))));
+            _imp->value->add_other(tokens.at(1));
         else
             Log::get_instance()->message("e.contents.unknown", ll_warning, lc_context) << "CONTENTS has unsupported entry type '" <<
                 tokens.at(0) << "', skipping";
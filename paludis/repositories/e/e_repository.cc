@@ -39,6 +39,8 @@
 #include <paludis/repositories/e/extra_distribution_data.hh>
 #include <paludis/repositories/e/memoised_hashes.hh>
 #include <paludis/repositories/e/ebuild_id.hh>
+#include <paludis/repositories/e/ebuild_packed_metadata_cache.hh>
+#include <paludis/repositories/e/ebuild_metadata_server.hh>
 #include <paludis/repositories/e/check_fetched_files_visitor.hh>
 #include <paludis/repositories/e/fetch_visitor.hh>
 #include <paludis/repositories/e/eapi_phase.hh>
@@ -85,6 +87,7 @@
 #include <paludis/util/options.hh>
 #include <paludis/util/private_implementation_pattern-impl.hh>
 #include <paludis/util/random.hh>
+#include <paludis/util/digests.hh>
 #include <paludis/util/rmd160.hh>
 #include <paludis/util/safe_ifstream.hh>
 #include <paludis/util/safe_ofstream.hh>
@@ -95,6 +98,7 @@
 #include <paludis/util/stringify.hh>
 #include <paludis/util/strip.hh>
 #include <paludis/util/system.hh>
+#include <paludis/util/thread_pool.hh>
 #include <paludis/util/timestamp.hh>
 #include <paludis/util/tokeniser.hh>
 #include <paludis/util/wrapped_forward_iterator.hh>
@@ -114,6 +118,7 @@
 
 #include <dlfcn.h>
 #include <stdint.h>
+#include <unistd.h>
 
 #define STUPID_CAST(type, val) reinterpret_cast<type>(reinterpret_cast<uintptr_t>(val))
 
@@ -188,6 +193,7 @@ namespace paludis
             Mutex profile_ptr_mutex;
             Mutex news_ptr_mutex;
             Mutex eapi_for_file_mutex;
+            Mutex packed_metadata_cache_mutex;
         };
 
         ERepository * const repo;
@@ -218,6 +224,11 @@ namespace paludis
 
         mutable EAPIForFileMap eapi_for_file_map;
 
+        mutable bool has_packed_metadata_cache;
+        mutable std::tr1::shared_ptr<const erepository::EbuildPackedMetadataCache> packed_metadata_cache;
+
+        const std::tr1::shared_ptr<erepository::EbuildMetadataServerPool> metadata_server_pool;
+
         Implementation(ERepository * const, const ERepositoryParams &, std::tr1::shared_ptr<Mutexes> = make_shared_ptr(new Mutexes));
         ~Implementation();
 
@@ -272,6 +283,8 @@ namespace paludis
         sets_ptr(new ERepositorySets(params.environment(), r, p)),
         layout(LayoutFactory::get_instance()->create(params.layout(), r, params.location(), get_master_locations(
                         params.master_repositories()))),
+        has_packed_metadata_cache(false),
+        metadata_server_pool(new erepository::EbuildMetadataServerPool),
         format_key(new LiteralMetadataValueKey<std::string> ("format", "format",
                     mkt_significant, params.entry_format())),
         layout_key(new LiteralMetadataValueKey<std::string> ("layout", "layout",
@@ -500,6 +513,7 @@ ERepository::ERepository(const ERepositoryParams & p) :
                 value_for<n::environment_variable_interface>(this),
                 value_for<n::make_virtuals_interface>(static_cast<RepositoryMakeVirtualsInterface *>(0)),
                 value_for<n::manifest_interface>(this),
+                value_for<n::owners_interface>(static_cast<RepositoryOwnersInterface *>(0)),
                 value_for<n::provides_interface>(static_cast<RepositoryProvidesInterface *>(0)),
                 value_for<n::virtuals_interface>((*DistributionData::get_instance()->distribution_from_string(p.environment()->distribution())).support_old_style_virtuals() ? this : 0)
                 )),
@@ -937,6 +951,191 @@ void
 ERepository::regenerate_cache() const
 {
     _imp->names_cache->regenerate_cache();
+
+    FSEntry packed_metadata_cache_file(_packed_metadata_cache_file());
+    if (packed_metadata_cache_file == FSEntry("/var/empty"))
+        return;
+
+    Context context("When regenerating packed metadata cache '" + stringify(packed_metadata_cache_file) + "':");
+
+    try
+    {
+        FSEntry main_dir(_imp->params.write_cache());
+        if (! main_dir.exists())
+        {
+            Log::get_instance()->message("e.cache.packed.no_dir", ll_warning, lc_no_context) << "Directory '"
+                << main_dir << "' does not exist, so cannot save packed metadata cache '" << packed_metadata_cache_file << "' "
+                << "(see the faq for why this directory will not be created automatically)";
+            return;
+        }
+
+        FSEntry repo_dir(packed_metadata_cache_file.dirname());
+        if (repo_dir.mkdir(main_dir.permissions()))
+            repo_dir.chmod(main_dir.permissions());
+
+        EbuildPackedMetadataCacheWriter writer(packed_metadata_cache_file);
+
+        std::tr1::shared_ptr<PackageIDSequence> ids(new PackageIDSequence);
+        std::tr1::shared_ptr<const CategoryNamePartSet> cats(category_names());
+        for (CategoryNamePartSet::ConstIterator c(cats->begin()), c_end(cats->end()) ;
+                c != c_end ; ++c)
+        {
+            std::tr1::shared_ptr<const QualifiedPackageNameSet> pkgs(package_names(*c));
+            for (QualifiedPackageNameSet::ConstIterator p(pkgs->begin()), p_end(pkgs->end()) ;
+                    p != p_end ; ++p)
+            {
+                std::tr1::shared_ptr<const PackageIDSequence> p_ids(package_ids(*p));
+                std::copy(p_ids->begin(), p_ids->end(), ids->back_inserter());
+            }
+        }
+
+        prefetch_metadata(ids);
+
+        for (PackageIDSequence::ConstIterator i(ids->begin()), i_end(ids->end()) ;
+                i != i_end ; ++i)
+            std::tr1::static_pointer_cast<const EbuildID>(*i)->add_to_packed_metadata_cache(writer);
+
+        writer.done();
+    }
+    catch (const SafeOFStreamError & e)
+    {
+        Log::get_instance()->message("e.cache.packed.write_failed", ll_warning, lc_no_context) << "Couldn't write packed metadata cache '"
+            << packed_metadata_cache_file << "': " << e.message() << " (" << e.what() << ")";
+    }
+    catch (const FSError & e)
+    {
+        Log::get_instance()->message("e.cache.packed.write_failed", ll_warning, lc_no_context) << "Couldn't write packed metadata cache '"
+            << packed_metadata_cache_file << "': " << e.message() << " (" << e.what() << ")";
+    }
+
+    Lock l(_imp->mutexes->packed_metadata_cache_mutex);
+    _imp->has_packed_metadata_cache = false;
+    _imp->packed_metadata_cache.reset();
+}
+
+namespace
+{
+    unsigned metadata_threads()
+    {
+        std::string threads(getenv_with_default("PALUDIS_METADATA_THREADS", ""));
+        if (! threads.empty())
+        {
+            try
+            {
+                return destringify<unsigned>(threads);
+            }
+            catch (const DestringifyError &)
+            {
+                Log::get_instance()->message("e.metadata.prefetch.bad_threads", ll_warning, lc_context)
+                    << "Ignoring bad value '" << threads << "' for PALUDIS_METADATA_THREADS";
+            }
+        }
+
+        long processors(sysconf(_SC_NPROCESSORS_ONLN));
+        return processors > 0 ? processors : 1;
+    }
+
+    void prefetch_metadata_worker(Mutex & mutex, std::list<std::tr1::shared_ptr<const EbuildID> > & ids) throw ()
+    {
+        while (true)
+        {
+            std::tr1::shared_ptr<const EbuildID> id;
+            {
+                Lock lock(mutex);
+                if (ids.empty())
+                    return;
+                id = ids.front();
+                ids.pop_front();
+            }
+
+            try
+            {
+                Context context("When prefetching metadata for ID '" + stringify(*id) + "':");
+                const std::tr1::shared_ptr<const EAPI> PALUDIS_ATTRIBUTE((unused)) eapi(id->eapi());
+            }
+            catch (const Exception & e)
+            {
+                Log::get_instance()->message("e.metadata.prefetch.failure", ll_warning, lc_no_context)
+                    << "Couldn't prefetch metadata for '" << *id << "': '" << e.message() << "' (" << e.what() << ")";
+            }
+            catch (const std::exception & e)
+            {
+                Log::get_instance()->message("e.metadata.prefetch.failure", ll_warning, lc_no_context)
+                    << "Couldn't prefetch metadata for '" << *id << "': " << e.what();
+            }
+        }
+    }
+}
+
+void
+ERepository::prefetch_metadata(const std::tr1::shared_ptr<const PackageIDSequence> & ids) const
+{
+    std::list<std::tr1::shared_ptr<const EbuildID> > pending;
+    for (PackageIDSequence::ConstIterator i(ids->begin()), i_end(ids->end()) ;
+            i != i_end ; ++i)
+    {
+        if ((*i)->repository()->name() != name())
+            throw InternalError(PALUDIS_HERE, "Asked to prefetch metadata for '" + stringify(**i) + "', which isn't ours");
+
+        std::tr1::shared_ptr<const EbuildID> id(std::tr1::static_pointer_cast<const EbuildID>(*i));
+        if (! id->keys_added())
+            pending.push_back(id);
+    }
+
+    /* with only one thread or ID, there's nothing to gain over loading on demand */
+    unsigned threads(std::min<std::size_t>(metadata_threads(), pending.size()));
+    if (threads <= 1)
+        return;
+
+    Context context("When prefetching metadata for " + stringify(pending.size()) + " IDs in '" + stringify(name()) + "':");
+
+    Mutex mutex;
+    {
+        ThreadPool pool;
+        for (unsigned n(0) ; n < threads ; ++n)
+            pool.create_thread(std::tr1::bind(&prefetch_metadata_worker, std::tr1::ref(mutex), std::tr1::ref(pending)));
+    }
+}
+
+FSEntry
+ERepository::_packed_metadata_cache_file() const
+{
+    FSEntry result(_imp->params.write_cache());
+    if (result == FSEntry("/var/empty"))
+        return result;
+
+    if (_imp->params.append_repository_name_to_write_cache())
+        result /= stringify(name());
+
+    /* categories can't start with a dot, so this can't clash with cache
+     * entries */
+    return result / ".packed";
+}
+
+const std::tr1::shared_ptr<const EbuildPackedMetadataCache>
+ERepository::packed_metadata_cache() const
+{
+    Lock l(_imp->mutexes->packed_metadata_cache_mutex);
+    if (! _imp->has_packed_metadata_cache)
+    {
+        _imp->has_packed_metadata_cache = true;
+
+        FSEntry packed_metadata_cache_file(_packed_metadata_cache_file());
+        if (packed_metadata_cache_file != FSEntry("/var/empty") && packed_metadata_cache_file.exists())
+        {
+            std::tr1::shared_ptr<EbuildPackedMetadataCache> p(new EbuildPackedMetadataCache(packed_metadata_cache_file));
+            if (p->usable())
+                _imp->packed_metadata_cache = p;
+        }
+    }
+
+    return _imp->packed_metadata_cache;
+}
+
+const std::tr1::shared_ptr<EbuildMetadataServerPool>
+ERepository::metadata_server_pool() const
+{
+    return _imp->metadata_server_pool;
 }
 
 std::tr1::shared_ptr<const CategoryNamePartSet>
@@ -1079,21 +1278,14 @@ ERepository::make_manifest(const QualifiedPackageName & qpn)
             filename = stringify(file).substr(stringify(package_dir / "files").length()+1);
         }
 
-        SafeIFStream file_stream(file);
+        Digests digests(DigestKinds() + dk_rmd160 + dk_sha1 + dk_sha256);
+        digests.update(file);
+        digests.finish();
 
-        RMD160 rmd160sum(file_stream);
         manifest << file_type << " " << filename << " "
-            << file.file_size() << " RMD160 " << rmd160sum.hexsum();
-
-        file_stream.clear();
-        file_stream.seekg(0, std::ios::beg);
-        SHA1 sha1sum(file_stream);
-        manifest << " SHA1 " << sha1sum.hexsum();
-
-        file_stream.clear();
-        file_stream.seekg(0, std::ios::beg);
-        SHA256 sha256sum(file_stream);
-        manifest << " SHA256 " << sha256sum.hexsum() << std::endl;
+            << file.file_size() << " RMD160 " << digests.hexsum(dk_rmd160)
+            << " SHA1 " << digests.hexsum(dk_sha1)
+            << " SHA256 " << digests.hexsum(dk_sha256) << std::endl;
     }
 
     std::tr1::shared_ptr<const PackageIDSequence> versions;
@@ -1126,6 +1318,7 @@ ERepository::make_manifest(const QualifiedPackageName & qpn)
             SafeIFStream file_stream(f);
 
             MemoisedHashes * hashes = MemoisedHashes::get_instance();
+            hashes->prefetch(f, DigestKinds() + dk_rmd160 + dk_sha1 + dk_sha256);
 
             manifest << "DIST " << f.basename() << " "
                 << f.file_size()
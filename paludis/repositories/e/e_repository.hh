@@ -42,6 +42,12 @@ namespace paludis
 {
     class ERepositoryNews;
 
+    namespace erepository
+    {
+        class EbuildPackedMetadataCache;
+        class EbuildMetadataServerPool;
+    }
+
     /**
      * A ERepository is a Repository that handles the layout used by
      * Portage for the main Gentoo tree.
@@ -66,6 +72,8 @@ namespace paludis
 
             const std::string _guess_eapi(const QualifiedPackageName &, const FSEntry & e) const;
 
+            FSEntry _packed_metadata_cache_file() const;
+
         protected:
             virtual void need_keys_added() const;
 
@@ -165,6 +173,24 @@ namespace paludis
 
             void regenerate_cache() const;
 
+            virtual void prefetch_metadata(const std::tr1::shared_ptr<const PackageIDSequence> &) const;
+
+            /**
+             * Our packed metadata cache, if we have a usable one.
+             *
+             * \since 0.48
+             */
+            const std::tr1::shared_ptr<const erepository::EbuildPackedMetadataCache> packed_metadata_cache() const
+                PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * Our pool of ebuild metadata servers.
+             *
+             * \since 0.48
+             */
+            const std::tr1::shared_ptr<erepository::EbuildMetadataServerPool> metadata_server_pool() const
+                PALUDIS_ATTRIBUTE((warn_unused_result));
+
             /* Keys */
 
             virtual const std::tr1::shared_ptr<const MetadataValueKey<std::string> > format_key() const;
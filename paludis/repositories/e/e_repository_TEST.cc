@@ -23,6 +23,7 @@
 #include <paludis/repositories/e/vdb_repository.hh>
 #include <paludis/repositories/e/eapi.hh>
 #include <paludis/repositories/e/dep_spec_pretty_printer.hh>
+#include <paludis/repositories/e/ebuild_id.hh>
 #include <paludis/repositories/fake/fake_installed_repository.hh>
 #include <paludis/repositories/fake/fake_package_id.hh>
 #include <paludis/environments/test/test_environment.hh>
@@ -34,6 +35,7 @@
 #include <paludis/util/set.hh>
 #include <paludis/standard_output_manager.hh>
 #include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/mutex.hh>
 #include <paludis/package_id.hh>
 #include <paludis/metadata_key.hh>
 #include <paludis/action.hh>
@@ -45,6 +47,7 @@
 #include <paludis/selection.hh>
 #include <paludis/repository_factory.hh>
 #include <paludis/choice.hh>
+#include <paludis/notifier_callback.hh>
 
 #include <paludis/util/indirect_iterator-impl.hh>
 
@@ -53,6 +56,7 @@
 #include <tr1/functional>
 #include <set>
 #include <string>
+#include <stdlib.h>
 
 #include "config.h"
 
@@ -86,6 +90,12 @@ namespace
     {
         return wp_yes;
     }
+
+    void count_notifier_events(Mutex & mutex, unsigned & count, const NotifierCallbackEvent &)
+    {
+        Lock lock(mutex);
+        ++count;
+    }
 }
 
 namespace test_cases
@@ -542,6 +552,62 @@ namespace test_cases
         }
     } test_e_repository_metadata_uncached;
 
+    struct ERepositoryMetadataPrefetchTest : TestCase
+    {
+        ERepositoryMetadataPrefetchTest() : TestCase("metadata prefetch") { }
+
+        unsigned max_run_time() const
+        {
+            return 3000;
+        }
+
+        void run()
+        {
+            ::setenv("PALUDIS_METADATA_THREADS", "3", 1);
+
+            TestEnvironment env;
+            env.set_paludis_command("/bin/false");
+            std::tr1::shared_ptr<Map<std::string, std::string> > keys(
+                    new Map<std::string, std::string>);
+            keys->insert("format", "ebuild");
+            keys->insert("names_cache", "/var/empty");
+            keys->insert("write_cache", "/var/empty");
+            keys->insert("location", stringify(FSEntry::cwd() / "e_repository_TEST_dir" / "repo7"));
+            keys->insert("profiles", stringify(FSEntry::cwd() / "e_repository_TEST_dir" / "repo7/profiles/profile"));
+            keys->insert("builddir", stringify(FSEntry::cwd() / "e_repository_TEST_dir" / "build"));
+            std::tr1::shared_ptr<Repository> repo(ERepository::repository_factory_create(&env,
+                        std::tr1::bind(from_keys, keys, std::tr1::placeholders::_1)));
+            env.package_database()->add_repository(1, repo);
+
+            Mutex mutex;
+            unsigned count(0);
+            ScopedNotifierCallback counter(&env, NotifierCallbackFunction(std::tr1::bind(&count_notifier_events,
+                            std::tr1::ref(mutex), std::tr1::ref(count), std::tr1::placeholders::_1)));
+
+            const std::tr1::shared_ptr<const PackageIDSequence> ids(env[selection::AllVersionsSorted(
+                        generator::Package(QualifiedPackageName("cat-one/pkg-one")))]);
+            TEST_CHECK_EQUAL(std::distance(ids->begin(), ids->end()), 3);
+            for (PackageIDSequence::ConstIterator i(ids->begin()), i_end(ids->end()) ;
+                    i != i_end ; ++i)
+                TEST_CHECK(! std::tr1::static_pointer_cast<const erepository::EbuildID>(*i)->keys_added());
+
+            env.package_database()->prefetch_metadata(ids);
+
+            for (PackageIDSequence::ConstIterator i(ids->begin()), i_end(ids->end()) ;
+                    i != i_end ; ++i)
+                TEST_CHECK(std::tr1::static_pointer_cast<const erepository::EbuildID>(*i)->keys_added());
+            TEST_CHECK_EQUAL(count, 3u);
+
+            TEST_CHECK((*ids->begin())->short_description_key());
+            TEST_CHECK_EQUAL((*ids->begin())->short_description_key()->value(), "The Description");
+            TEST_CHECK((*ids->rbegin())->long_description_key());
+            TEST_CHECK_EQUAL((*ids->rbegin())->long_description_key()->value(), "This is the long description");
+
+            env.package_database()->prefetch_metadata(ids);
+            TEST_CHECK_EQUAL(count, 3u);
+        }
+    } test_e_repository_metadata_prefetch;
+
     struct ERepositoryMetadataUnparsableTest : TestCase
     {
         ERepositoryMetadataUnparsableTest() : TestCase("metadata unparsable") { }
@@ -586,6 +652,72 @@ namespace test_cases
         }
     } test_e_repository_metadata_unparsable;
 
+    struct ERepositoryMetadataServerTest : TestCase
+    {
+        ERepositoryMetadataServerTest() : TestCase("metadata server") { }
+
+        bool skip() const
+        {
+            return ! getenv_with_default("SANDBOX_ON", "").empty();
+        }
+
+        unsigned max_run_time() const
+        {
+            return 3000;
+        }
+
+        std::tr1::shared_ptr<const PackageID> get_id(const Environment & env, const std::string & s)
+        {
+            return *env[selection::RequireExactlyOne(generator::Matches(
+                        PackageDepSpec(parse_user_package_dep_spec(s, &env, UserPackageDepSpecOptions())),
+                        MatchPackageOptions()))]->begin();
+        }
+
+        void run()
+        {
+            for (int pass = 1 ; pass <= 2 ; ++pass)
+            {
+                TestMessageSuffix pass_suffix(stringify(pass), true);
+
+                if (2 == pass)
+                    ::setenv("PALUDIS_NO_METADATA_SERVER", "yes", 1);
+
+                TestEnvironment env;
+                env.set_paludis_command("/bin/false");
+                std::tr1::shared_ptr<Map<std::string, std::string> > keys(
+                        new Map<std::string, std::string>);
+                keys->insert("format", "ebuild");
+                keys->insert("names_cache", "/var/empty");
+                keys->insert("write_cache", "/var/empty");
+                keys->insert("location", stringify(FSEntry::cwd() / "e_repository_TEST_dir" / "repo20"));
+                keys->insert("profiles", stringify(FSEntry::cwd() / "e_repository_TEST_dir" / "repo20/profiles/profile"));
+                keys->insert("builddir", stringify(FSEntry::cwd() / "e_repository_TEST_dir" / "build"));
+                std::tr1::shared_ptr<Repository> repo(ERepository::repository_factory_create(&env,
+                            std::tr1::bind(from_keys, keys, std::tr1::placeholders::_1)));
+                env.package_database()->add_repository(1, repo);
+
+                const std::tr1::shared_ptr<const PackageID> id1(get_id(env, "=cat-one/pkg-one-1"));
+                TEST_CHECK(id1->short_description_key());
+                TEST_CHECK_EQUAL(id1->short_description_key()->value(), "Version 1");
+
+                const std::tr1::shared_ptr<const PackageID> id2(get_id(env, "=cat-one/pkg-one-2"));
+                TEST_CHECK_EQUAL(std::tr1::static_pointer_cast<const erepository::ERepositoryID>(id2)->eapi()->name(), "UNKNOWN");
+                TEST_CHECK(! id2->short_description_key());
+
+                const std::tr1::shared_ptr<const PackageID> id3(get_id(env, "=cat-one/pkg-one-3"));
+                TEST_CHECK(id3->short_description_key());
+                TEST_CHECK_EQUAL(id3->short_description_key()->value(), "Version 3");
+
+                const std::tr1::shared_ptr<const PackageID> id4(get_id(env, "=cat-one/pkg-one-4"));
+                TEST_CHECK_EQUAL(std::tr1::static_pointer_cast<const erepository::ERepositoryID>(id4)->eapi()->name(), "exheres-0");
+                TEST_CHECK(id4->short_description_key());
+                TEST_CHECK_EQUAL(id4->short_description_key()->value(), "Version 4");
+            }
+
+            ::unsetenv("PALUDIS_NO_METADATA_SERVER");
+        }
+    } test_e_repository_metadata_server;
+
     struct ERepositoryQueryUseTest : TestCase
     {
         ERepositoryQueryUseTest() : TestCase("USE query") { }
@@ -678,6 +810,77 @@ namespace test_cases
         }
     } test_e_repository_query_use;
 
+    struct ERepositoryQueryUseOverridesTest : TestCase
+    {
+        ERepositoryQueryUseOverridesTest() : TestCase("USE query overrides") { }
+
+        void test_choice(const std::tr1::shared_ptr<const PackageID> & p, const std::string & n, bool enabled, bool enabled_by_default, bool locked)
+        {
+            TestMessageSuffix s(stringify(*p) + "[" + n + "]", true);
+            std::tr1::shared_ptr<const ChoiceValue> choice(p->choices_key()->value()->find_by_name_with_prefix(ChoiceNameWithPrefix(n)));
+            TEST_CHECK(choice);
+            TEST_CHECK_EQUAL(choice->enabled(), enabled);
+            TEST_CHECK_EQUAL(choice->enabled_by_default(), enabled_by_default);
+            TEST_CHECK_EQUAL(choice->locked(), locked);
+        }
+
+        void run()
+        {
+            TestEnvironment env;
+            env.set_paludis_command("/bin/false");
+            std::tr1::shared_ptr<Map<std::string, std::string> > keys(
+                    new Map<std::string, std::string>);
+            keys->insert("format", "ebuild");
+            keys->insert("names_cache", "/var/empty");
+            keys->insert("location", stringify(FSEntry::cwd() / "e_repository_TEST_dir" / "repo21"));
+            keys->insert("profiles", stringify(FSEntry::cwd() / "e_repository_TEST_dir" / "repo21/profiles/child"));
+            keys->insert("builddir", stringify(FSEntry::cwd() / "e_repository_TEST_dir" / "build"));
+            std::tr1::shared_ptr<ERepository> repo(std::tr1::static_pointer_cast<ERepository>(ERepository::repository_factory_create(&env,
+                            std::tr1::bind(from_keys, keys, std::tr1::placeholders::_1))));
+            env.package_database()->add_repository(1, repo);
+
+            const std::tr1::shared_ptr<const PackageID> p1(*env[selection::RequireExactlyOne(generator::Matches(
+                            PackageDepSpec(parse_user_package_dep_spec("=cat-one/pkg-one-1",
+                                    &env, UserPackageDepSpecOptions())), MatchPackageOptions()))]->begin());
+            const std::tr1::shared_ptr<const PackageID> p2(*env[selection::RequireExactlyOne(generator::Matches(
+                            PackageDepSpec(parse_user_package_dep_spec("=cat-one/pkg-one-2",
+                                    &env, UserPackageDepSpecOptions())), MatchPackageOptions()))]->begin());
+
+            /* results are remembered per ID, so ask about the second version
+             * first on the first pass, and make sure neither leaks into the
+             * other on the second */
+            for (int pass = 1 ; pass <= 2 ; ++pass)
+            {
+                TestMessageSuffix pass_suffix(stringify(pass), true);
+                const std::tr1::shared_ptr<const PackageID> first(1 == pass ? p2 : p1), second(1 == pass ? p1 : p2);
+
+                /* later lines in a file override earlier ones, whichever is
+                 * more specific */
+                test_choice(first,  "flag1", false, false, p1 == first);
+                test_choice(second, "flag1", false, false, p1 == second);
+                test_choice(first,  "flag2", false, false, true);
+                test_choice(second, "flag2", false, false, true);
+                test_choice(p1, "flag7", true,  true,  false);
+                test_choice(p2, "flag7", false, false, false);
+
+                /* child profiles override their parents */
+                test_choice(p1, "flag3", false, false, true);
+                test_choice(p2, "flag3", false, false, false);
+                test_choice(p1, "flag6", false, false, false);
+                test_choice(p2, "flag6", true,  true,  false);
+                test_choice(p1, "flag8", false, false, false);
+                test_choice(p2, "flag8", true,  true,  true);
+
+                /* package entries override global ones, even from a child
+                 * profile */
+                test_choice(p1, "flag4", false, false, true);
+                test_choice(p2, "flag4", false, false, true);
+                test_choice(p1, "flag5", false, false, false);
+                test_choice(p2, "flag5", false, false, false);
+            }
+        }
+    } test_e_repository_query_use_overrides;
+
     struct ERepositoryRepositoryMasksTest : TestCase
     {
         ERepositoryRepositoryMasksTest() : TestCase("repository masks") { }
@@ -588,5 +588,99 @@ KEYWORDS="test"
 END
 cd ..
 
+mkdir -p repo20/{eclass,distfiles,profiles/profile} || exit 1
+mkdir -p repo20/cat-one/pkg-one || exit 1
+cd repo20 || exit 1
+echo "test-repo-20" > profiles/repo_name || exit 1
+cat <<END > profiles/categories || exit 1
+cat-one
+END
+cat <<END > profiles/profile/make.defaults
+ARCH=test
+END
+cat <<"END" > cat-one/pkg-one/pkg-one-1.ebuild || exit 1
+DESCRIPTION="Version ${PV}"
+SLOT="0"
+KEYWORDS="test"
+LEAKED_VARIABLE="leaked"
+leaked_function() { : ; }
+END
+cat <<"END" > cat-one/pkg-one/pkg-one-2.ebuild || exit 1
+die "global scope die"
+END
+cat <<"END" > cat-one/pkg-one/pkg-one-3.ebuild || exit 1
+DESCRIPTION="Version ${PV}${LEAKED_VARIABLE:+ leaked variable}"
+type leaked_function &>/dev/null && DESCRIPTION="leaked function"
+SLOT="0"
+KEYWORDS="test"
+END
+cat <<"END" > cat-one/pkg-one/pkg-one-4.ebuild || exit 1
+EAPI="exheres-0"
+SUMMARY="Version ${PV}"
+SLOT="0"
+PLATFORMS="test"
+END
+cd ..
+
+mkdir -p repo21/{eclass,distfiles,profiles/{profile,child},cat-one/pkg-one} || exit 1
+cd repo21 || exit 1
+echo "test-repo-21" > profiles/repo_name || exit 1
+cat <<END >profiles/categories || exit 1
+cat-one
+END
+cat <<END > profiles/arch.list || exit 1
+test
+END
+cat <<END >profiles/profile/make.defaults || exit 1
+ARCH=test
+USE="flag6 flag7"
+END
+cat <<END >profiles/profile/use.mask || exit 1
+flag5
+END
+cat <<END >profiles/profile/package.use || exit 1
+cat-one/pkg-one -flag6
+cat-one/pkg-one -flag7
+=cat-one/pkg-one-1 flag7
+END
+cat <<END >profiles/profile/package.use.mask || exit 1
+cat-one/pkg-one flag1
+>=cat-one/pkg-one-2 -flag1
+=cat-one/pkg-one-1 -flag2
+cat-one/pkg-one flag2
+cat-one/pkg-one flag3
+cat-one/pkg-one flag4
+cat-one/pkg-one -flag5
+END
+cat <<END >profiles/profile/package.use.force || exit 1
+cat-one/pkg-one flag8
+END
+cat <<END >profiles/child/use.mask || exit 1
+-flag4
+END
+cat <<END >profiles/child/package.use || exit 1
+=cat-one/pkg-one-2 flag6
+END
+cat <<END >profiles/child/package.use.mask || exit 1
+=cat-one/pkg-one-2 -flag3
+END
+cat <<END >profiles/child/package.use.force || exit 1
+=cat-one/pkg-one-1 -flag8
+END
+cat <<END >profiles/child/parent || exit 1
+../profile
+END
+cat <<END > cat-one/pkg-one/pkg-one-1.ebuild || exit 1
+EAPI=1
+IUSE="flag1 flag2 flag3 flag4 flag5 flag6 flag7 flag8"
+SLOT="0"
+END
+cat <<END > cat-one/pkg-one/pkg-one-2.ebuild || exit 1
+EAPI=1
+IUSE="flag1 flag2 flag3 flag4 flag5 flag6 flag7 flag8"
+SLOT="0"
+END
+cd ..
+
 cd ..
 
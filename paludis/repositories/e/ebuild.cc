@@ -24,6 +24,7 @@
 #include <paludis/repositories/e/dep_parser.hh>
 #include <paludis/repositories/e/pipe_command_handler.hh>
 #include <paludis/repositories/e/dependencies_rewriter.hh>
+#include <paludis/repositories/e/ebuild_metadata_server.hh>
 
 #include <paludis/util/system.hh>
 #include <paludis/util/strip.hh>
@@ -403,6 +404,23 @@ namespace
         tokenise_whitespace(s, std::back_inserter(tokens));
         return join(tokens.begin(), tokens.end(), " \\n ");
     }
+
+    bool run_using_metadata_server(const EbuildCommandParams & params, const Command & cmd,
+            const std::string & ebuild_file, const std::string & commands,
+            std::string & captured_stdout, std::string & captured_stderr, int & exit_status)
+    {
+        /* sydbox's magic commands affect the whole process, so we can't share
+         * one process between ebuilds */
+        if (params.sydbox() || ! getenv_with_default("PALUDIS_NO_METADATA_SERVER", "").empty())
+            return false;
+
+        std::tr1::shared_ptr<const EbuildID> id(std::tr1::dynamic_pointer_cast<const EbuildID>(params.package_id()));
+        if (! id)
+            return false;
+
+        return id->e_repository()->metadata_server_pool()->run(id->eapi()->name(), cmd, ebuild_file, commands,
+                captured_stdout, captured_stderr, exit_status);
+    }
 }
 
 bool
@@ -416,10 +434,17 @@ EbuildMetadataCommand::do_run_command(const Command & cmd)
     {
         Context context("When running ebuild command to generate metadata for '" + stringify(*params.package_id()) + "':");
 
-        std::stringstream prog, prog_err;
-        Command real_cmd(cmd);
-        int exit_status(run_command(real_cmd.with_captured_stdout_stream(&prog).with_captured_stderr_stream(&prog_err)));
-        input.assign((std::istreambuf_iterator<char>(prog)), std::istreambuf_iterator<char>());
+        std::string prog_err;
+        int exit_status(0);
+        if (! run_using_metadata_server(params, cmd, ebuild_file(), commands(), input, prog_err, exit_status))
+        {
+            std::stringstream prog, prog_err_stream;
+            Command real_cmd(cmd);
+            exit_status = run_command(real_cmd.with_captured_stdout_stream(&prog).with_captured_stderr_stream(&prog_err_stream));
+            input.assign((std::istreambuf_iterator<char>(prog)), std::istreambuf_iterator<char>());
+            prog_err = prog_err_stream.str();
+        }
+
         std::stringstream input_stream(input);
         KeyValueConfigFile f(input_stream, KeyValueConfigFileOptions() + kvcfo_disallow_continuations + kvcfo_disallow_comments
                 + kvcfo_disallow_space_around_equals + kvcfo_disallow_unquoted_values + kvcfo_disallow_source
@@ -430,7 +455,7 @@ EbuildMetadataCommand::do_run_command(const Command & cmd)
         if (0 == exit_status)
             ok = true;
 
-        captured_stderr = prog_err.str();
+        captured_stderr = prog_err;
     }
     catch (const InternalError &)
     {
@@ -131,7 +131,8 @@ EBUILD_MODULES_DIRS="${EBUILD_MODULES_DIRS} ${EBUILD_MODULES_DIR}"
 export PALUDIS_EBUILD_MODULES_DIR="${EBUILD_MODULES_DIR}"
 
 export EBUILD_KILL_PID=$$
-declare -r EBUILD_KILL_PID
+# a metadata server sets this again, for each subshell it runs
+[[ -z "${PALUDIS_EBUILD_METADATA_SERVER}" ]] && declare -r EBUILD_KILL_PID
 
 ebuild_load_module()
 {
@@ -672,5 +673,32 @@ ebuild_main()
     fi
 }
 
-ebuild_main "$@"
+ebuild_metadata_server()
+{
+    local request status
+
+    while true ; do
+        request=$(paludis_pipe_command METADATA_SERVER_NEXT $$ )
+        [[ -z "${request}" ]] && break
+
+        (
+            eval "${request}"
+            unset -v PALUDIS_EBUILD_METADATA_SERVER
+            export EBUILD_KILL_PID=${BASHPID:-$(exec sh -c 'echo ${PPID}' )}
+            declare -r EBUILD_KILL_PID
+            trap 'echo "die trap: exiting with error." 1>&2 ; exit 250' SIGUSR1
+            [[ -n "${PALUDIS_TRACE}" ]] && set -x
+            ebuild_main "${PALUDIS_METADATA_SERVER_EBUILD}" ${PALUDIS_METADATA_SERVER_COMMANDS}
+        )
+        status=$?
+
+        paludis_pipe_command METADATA_SERVER_DONE ${status} >/dev/null
+    done
+}
+
+if [[ -n "${PALUDIS_EBUILD_METADATA_SERVER}" ]] ; then
+    ebuild_metadata_server
+else
+    ebuild_main "$@"
+fi
 
@@ -300,9 +300,7 @@ EbuildFlatMetadataCache::~EbuildFlatMetadataCache()
 bool
 EbuildFlatMetadataCache::load(const std::tr1::shared_ptr<const EbuildID> & id, const bool silent_on_stale)
 {
-    using namespace std::tr1::placeholders;
-
-    Context context("When loading version metadata from '" + stringify(_imp->filename) + "':");
+    Context context("When loading version metadata from '", _imp->filename, "':");
 
     if (! _imp->filename.exists())
     {
@@ -318,6 +316,30 @@ EbuildFlatMetadataCache::load(const std::tr1::shared_ptr<const EbuildID> & id, c
     while (std::getline(cache, line))
         lines.push_back(line);
 
+    return _load_lines(id, lines, silent_on_stale);
+}
+
+bool
+EbuildFlatMetadataCache::load_from(const std::tr1::shared_ptr<const EbuildID> & id, const char * const data,
+        const std::size_t size, const bool silent_on_stale)
+{
+    Context context("When loading version metadata for '", *id, "' from '", _imp->filename, "':");
+
+    std::vector<std::string> lines;
+    for (const char * p(data), * p_end(data + size) ; p != p_end ; )
+    {
+        const char * eol(std::find(p, p_end, '\n'));
+        lines.push_back(std::string(p, eol));
+        p = (eol == p_end) ? eol : eol + 1;
+    }
+
+    return _load_lines(id, lines, silent_on_stale);
+}
+
+bool
+EbuildFlatMetadataCache::_load_lines(const std::tr1::shared_ptr<const EbuildID> & id,
+        const std::vector<std::string> & lines, const bool silent_on_stale)
+{
     try
     {
         std::map<std::string, std::string> keys;
@@ -658,45 +680,16 @@ namespace
     }
 }
 
-void
-EbuildFlatMetadataCache::save(const std::tr1::shared_ptr<const EbuildID> & id)
+bool
+EbuildFlatMetadataCache::_write_entry(std::ostream & cache, const std::tr1::shared_ptr<const EbuildID> & id)
 {
-    Context context("When saving version metadata to '" + stringify(_imp->filename) + "':");
-
-    try
-    {
-        FSEntry cat_dir(_imp->filename.dirname());
-        FSEntry repo_dir(cat_dir.dirname());
-        FSEntry main_dir(repo_dir.dirname());
-
-        if (! main_dir.exists())
-        {
-            Log::get_instance()->message("e.cache.save.no_dir", ll_warning, lc_no_context) << "Directory '"
-                << main_dir << "' does not exist, so cannot save cache file '" << _imp->filename << "' "
-                << "(see the faq for why this directory will not be created automatically)";
-            return;
-        }
-
-        if (repo_dir.mkdir(main_dir.permissions()))
-            repo_dir.chmod(main_dir.permissions());
-
-        if (cat_dir.mkdir(main_dir.permissions()))
-            cat_dir.chmod(main_dir.permissions());
-    }
-    catch (const FSError & e)
-    {
-        Log::get_instance()->message("e.cache.save.failure", ll_warning, lc_no_context) << "Couldn't create cache directory: " << e.message();
-        return;
-    }
-
     if (! id->eapi()->supported())
     {
         Log::get_instance()->message("e.cache.save.eapi_unsupoprted", ll_warning, lc_no_context) << "Not writing cache file to '"
             << _imp->filename << "' because EAPI '" << id->eapi()->name() << "' is not supported";
-        return;
+        return false;
     }
 
-    std::ostringstream cache;
     write_kv(cache, "_mtime_", _imp->ebuild.mtim().seconds());
     write_kv(cache, "_guessed_eapi_", id->guessed_eapi_name());
 
@@ -832,9 +825,47 @@ EbuildFlatMetadataCache::save(const std::tr1::shared_ptr<const EbuildID> & id)
     {
         Log::get_instance()->message("e.cache.save.failure", ll_warning, lc_no_context) << "Not writing cache file to '"
             << _imp->filename << "' due to exception '" << e.message() << "' (" << e.what() << ")";
+        return false;
+    }
+
+    return true;
+}
+
+void
+EbuildFlatMetadataCache::save(const std::tr1::shared_ptr<const EbuildID> & id)
+{
+    Context context("When saving version metadata to '", _imp->filename, "':");
+
+    try
+    {
+        FSEntry cat_dir(_imp->filename.dirname());
+        FSEntry repo_dir(cat_dir.dirname());
+        FSEntry main_dir(repo_dir.dirname());
+
+        if (! main_dir.exists())
+        {
+            Log::get_instance()->message("e.cache.save.no_dir", ll_warning, lc_no_context) << "Directory '"
+                << main_dir << "' does not exist, so cannot save cache file '" << _imp->filename << "' "
+                << "(see the faq for why this directory will not be created automatically)";
+            return;
+        }
+
+        if (repo_dir.mkdir(main_dir.permissions()))
+            repo_dir.chmod(main_dir.permissions());
+
+        if (cat_dir.mkdir(main_dir.permissions()))
+            cat_dir.chmod(main_dir.permissions());
+    }
+    catch (const FSError & e)
+    {
+        Log::get_instance()->message("e.cache.save.failure", ll_warning, lc_no_context) << "Couldn't create cache directory: " << e.message();
         return;
     }
 
+    std::ostringstream cache;
+    if (! _write_entry(cache, id))
+        return;
+
     try
     {
         {
@@ -850,5 +881,18 @@ EbuildFlatMetadataCache::save(const std::tr1::shared_ptr<const EbuildID> & id)
     }
 }
 
+bool
+EbuildFlatMetadataCache::save_to(const std::tr1::shared_ptr<const EbuildID> & id, std::string & result)
+{
+    Context context("When generating cache entry for '", *id, "':");
+
+    std::ostringstream cache;
+    if (! _write_entry(cache, id))
+        return false;
+
+    result = cache.str();
+    return true;
+}
+
 template class PrivateImplementationPattern<EbuildFlatMetadataCache>;
 
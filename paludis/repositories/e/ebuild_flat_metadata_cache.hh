@@ -25,6 +25,10 @@
 #include <paludis/util/fs_entry.hh>
 #include <paludis/repositories/e/eclass_mtimes.hh>
 #include <paludis/util/private_implementation_pattern.hh>
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <cstddef>
 
 namespace paludis
 {
@@ -42,6 +46,11 @@ namespace paludis
         class EbuildFlatMetadataCache :
             private PrivateImplementationPattern<EbuildFlatMetadataCache>
         {
+            private:
+                bool _load_lines(const std::tr1::shared_ptr<const EbuildID> &, const std::vector<std::string> &,
+                        const bool silent_on_stale);
+                bool _write_entry(std::ostream &, const std::tr1::shared_ptr<const EbuildID> &);
+
             public:
                 ///\name Basic operations
                 ///\{
@@ -58,6 +67,21 @@ namespace paludis
                 bool load(const std::tr1::shared_ptr<const EbuildID> &, const bool silent_on_stale);
                 void save(const std::tr1::shared_ptr<const EbuildID> &);
 
+                /**
+                 * Load from a cache entry held in memory, rather than from
+                 * our file. Used for packed metadata caches.
+                 *
+                 * \see EbuildPackedMetadataCache
+                 */
+                bool load_from(const std::tr1::shared_ptr<const EbuildID> &, const char * const data,
+                        const std::size_t size, const bool silent_on_stale);
+
+                /**
+                 * Generate the flat_hash cache entry that save() would write,
+                 * without writing it anywhere.
+                 */
+                bool save_to(const std::tr1::shared_ptr<const EbuildID> &, std::string &);
+
                 ///\}
         };
     }
@@ -32,6 +32,7 @@
 #include <paludis/util/simple_visitor_cast.hh>
 #include <paludis/util/wrapped_forward_iterator.hh>
 #include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/safe_ofstream.hh>
 #include <paludis/util/fs_entry.hh>
 #include <paludis/util/timestamp.hh>
 #include <test/test_framework.hh>
@@ -1336,5 +1337,81 @@ namespace test_cases
             TEST_CHECK_EQUAL(FSEntry("ebuild_flat_metadata_cache_TEST_dir/cache/test-repo/cat/write-exlibs-1").mtim().seconds(), 60);
         }
     } test_metadata_write_exlibs;
+
+    struct MetadataPackedTest : TestCase
+    {
+        MetadataPackedTest() : TestCase("metadata packed") { }
+
+        bool repeatable() const
+        {
+            return false;
+        }
+
+        std::tr1::shared_ptr<Repository> make_repo(TestEnvironment & env)
+        {
+            env.set_paludis_command("/bin/false");
+            std::tr1::shared_ptr<Map<std::string, std::string> > keys(new Map<std::string, std::string>);
+            keys->insert("format", "ebuild");
+            keys->insert("names_cache", "/var/empty");
+            keys->insert("location", stringify(FSEntry::cwd() / "ebuild_flat_metadata_cache_TEST_dir/packed_repo"));
+            keys->insert("profiles", stringify(FSEntry::cwd() / "ebuild_flat_metadata_cache_TEST_dir/packed_repo/profiles/profile"));
+            keys->insert("write_cache", "ebuild_flat_metadata_cache_TEST_dir/packed_cache");
+            keys->insert("builddir", stringify(FSEntry::cwd() / "ebuild_flat_metadata_cache_TEST_dir" / "build"));
+            std::tr1::shared_ptr<Repository> repo(ERepository::repository_factory_create(&env,
+                        std::tr1::bind(from_keys, keys, std::tr1::placeholders::_1)));
+            env.package_database()->add_repository(1, repo);
+            return repo;
+        }
+
+        std::string description(const Environment & env, const std::string & spec)
+        {
+            std::tr1::shared_ptr<const PackageID> id(*env[selection::RequireExactlyOne(generator::Matches(
+                            PackageDepSpec(parse_user_package_dep_spec(spec, &env, UserPackageDepSpecOptions())),
+                            MatchPackageOptions()))]->begin());
+            return id->short_description_key() ? id->short_description_key()->value() : "";
+        }
+
+        void run()
+        {
+            const std::string packed("ebuild_flat_metadata_cache_TEST_dir/packed_cache/packed-repo/.packed");
+            const std::string flat_one("ebuild_flat_metadata_cache_TEST_dir/packed_cache/packed-repo/cat/packed-1");
+            const std::string flat_two("ebuild_flat_metadata_cache_TEST_dir/packed_cache/packed-repo/cat/packed-2");
+
+            {
+                TestEnvironment env;
+                make_repo(env)->regenerate_cache();
+                TEST_CHECK(FSEntry(packed).is_regular_file());
+            }
+
+            FSEntry(flat_one).unlink();
+            FSEntry(flat_two).unlink();
+
+            {
+                TestEnvironment env;
+                make_repo(env);
+                TEST_CHECK_EQUAL(description(env, "=cat/packed-1"), "The packed description one");
+                TEST_CHECK_EQUAL(description(env, "=cat/packed-2"), "The packed description two");
+                TEST_CHECK(! FSEntry(flat_one).exists());
+                TEST_CHECK(! FSEntry(flat_two).exists());
+            }
+
+            FSEntry ebuild("ebuild_flat_metadata_cache_TEST_dir/packed_repo/cat/packed/packed-2.ebuild");
+            {
+                SafeOFStream s(ebuild);
+                s << "DESCRIPTION=\"The changed description\"" << std::endl;
+                s << "SLOT=\"0\"" << std::endl;
+            }
+            ebuild.utime(Timestamp(120, 0));
+
+            {
+                TestEnvironment env;
+                make_repo(env);
+                TEST_CHECK_EQUAL(description(env, "=cat/packed-1"), "The packed description one");
+                TEST_CHECK_EQUAL(description(env, "=cat/packed-2"), "The changed description");
+                TEST_CHECK(! FSEntry(flat_one).exists());
+                TEST_CHECK(FSEntry(flat_two).exists());
+            }
+        }
+    } test_metadata_packed;
 }
 
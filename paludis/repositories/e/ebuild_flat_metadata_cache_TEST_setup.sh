@@ -1290,3 +1290,32 @@ EAPI=exheres-0
 DEFINED_PHASES=-
 END
 
+
+mkdir -p packed_repo/{eclass,profiles/profile,cat/packed} packed_cache || exit 1
+cd packed_repo || exit 1
+echo "packed-repo" > profiles/repo_name || exit 1
+cat <<END > profiles/categories || exit 1
+cat
+END
+cat <<END > profiles/profile/make.defaults
+ARCH=test
+END
+cat <<END > cat/packed/packed-1.ebuild || exit 1
+DESCRIPTION="The packed description one"
+HOMEPAGE="http://example.com/"
+SRC_URI=""
+LICENSE="GPL-2"
+SLOT="0"
+KEYWORDS="test"
+END
+TZ=UTC touch -t 197001010001 cat/packed/packed-1.ebuild || exit 2
+cat <<END > cat/packed/packed-2.ebuild || exit 1
+DESCRIPTION="The packed description two"
+HOMEPAGE="http://example.com/"
+SRC_URI=""
+LICENSE="GPL-2"
+SLOT="0"
+KEYWORDS="test"
+END
+TZ=UTC touch -t 197001010001 cat/packed/packed-2.ebuild || exit 2
+cd ..
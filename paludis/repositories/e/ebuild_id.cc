@@ -19,6 +19,7 @@
 
 #include <paludis/repositories/e/ebuild_id.hh>
 #include <paludis/repositories/e/ebuild_flat_metadata_cache.hh>
+#include <paludis/repositories/e/ebuild_packed_metadata_cache.hh>
 #include <paludis/repositories/e/e_repository.hh>
 #include <paludis/repositories/e/e_repository_params.hh>
 #include <paludis/repositories/e/eapi_phase.hh>
@@ -186,7 +187,7 @@ EbuildID::need_keys_added() const
         add_metadata_key(_imp->fs_location);
     }
 
-    Context context("When generating metadata for ID '" + canonical_form(idcf_full) + "':");
+    Context context("When generating metadata for ID '", *this, "':");
 
     FSEntry cache_file(_imp->repository->params().cache());
     cache_file /= stringify(name().category());
@@ -199,7 +200,22 @@ EbuildID::need_keys_added() const
     write_cache_file /= stringify(name().package()) + "-" + stringify(version());
 
     bool ok(false);
-    if (_imp->repository->params().cache().basename() != "empty")
+    std::tr1::shared_ptr<const EbuildPackedMetadataCache> packed_metadata_cache(_imp->repository->packed_metadata_cache());
+    if (packed_metadata_cache)
+    {
+        const char * data;
+        std::size_t size;
+        if (packed_metadata_cache->find(stringify(name()) + "-" + stringify(version()), data, size))
+        {
+            FSEntry packed_cache_file(packed_metadata_cache->location());
+            EbuildFlatMetadataCache metadata_cache(_imp->environment, packed_cache_file, _imp->ebuild, _imp->master_mtime,
+                    _imp->eclass_mtimes, true);
+            if (metadata_cache.load_from(shared_from_this(), data, size, true))
+                ok = true;
+        }
+    }
+
+    if ((! ok) && _imp->repository->params().cache().basename() != "empty")
     {
         EbuildFlatMetadataCache metadata_cache(_imp->environment, cache_file, _imp->ebuild, _imp->master_mtime, _imp->eclass_mtimes, false);
         if (metadata_cache.load(shared_from_this(), false))
@@ -464,7 +480,7 @@ EbuildID::need_masks_added() const
 
     _imp->has_masks = true;
 
-    Context context("When generating masks for ID '" + canonical_form(idcf_full) + "':");
+    Context context("When generating masks for ID '", *this, "':");
 
     if (! eapi()->supported())
     {
@@ -1470,3 +1486,28 @@ EbuildID::purge_invalid_cache() const
     }
 }
 
+void
+EbuildID::add_to_packed_metadata_cache(EbuildPackedMetadataCacheWriter & writer) const
+{
+    Context context("When adding ID '", *this, "' to a packed metadata cache:");
+
+    need_keys_added();
+    if (! _imp->eapi->supported())
+        return;
+
+    FSEntry packed_cache_file(writer.location());
+    EbuildFlatMetadataCache metadata_cache(_imp->environment, packed_cache_file, _imp->ebuild, _imp->master_mtime,
+            _imp->eclass_mtimes, true);
+
+    std::string entry;
+    if (metadata_cache.save_to(shared_from_this(), entry))
+        writer.add(stringify(name()) + "-" + stringify(version()), entry);
+}
+
+bool
+EbuildID::keys_added() const
+{
+    Lock l(_imp->mutex);
+    return _imp->has_keys;
+}
+
@@ -33,6 +33,8 @@ namespace paludis
 
     namespace erepository
     {
+        class EbuildPackedMetadataCacheWriter;
+
         class EbuildID :
             public ERepositoryID,
             public std::tr1::enable_shared_from_this<EbuildID>,
@@ -159,6 +161,17 @@ namespace paludis
                 virtual void add_build_options(const std::tr1::shared_ptr<Choices> &) const;
 
                 virtual void purge_invalid_cache() const;
+
+                /**
+                 * Add our metadata to a packed metadata cache, generating it
+                 * if necessary.
+                 */
+                void add_to_packed_metadata_cache(EbuildPackedMetadataCacheWriter &) const;
+
+                /**
+                 * Have our metadata keys already been loaded or generated?
+                 */
+                bool keys_added() const PALUDIS_ATTRIBUTE((warn_unused_result));
         };
     }
 }
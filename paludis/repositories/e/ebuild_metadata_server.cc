@@ -0,0 +1,328 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/repositories/e/ebuild_metadata_server.hh>
+#include <paludis/util/mutex.hh>
+#include <paludis/util/condition_variable.hh>
+#include <paludis/util/thread.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/exception.hh>
+#include <paludis/util/destringify.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/util/private_implementation_pattern-impl.hh>
+#include <tr1/functional>
+#include <tr1/memory>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <set>
+
+using namespace paludis;
+using namespace paludis::erepository;
+
+namespace
+{
+    enum ServerState
+    {
+        ss_idle,
+        ss_pending,
+        ss_running,
+        ss_done,
+        ss_dead
+    };
+
+    std::string shell_quote(const std::string & s)
+    {
+        std::string result("'");
+        for (std::string::const_iterator c(s.begin()), c_end(s.end()) ; c != c_end ; ++c)
+            if ('\'' == *c)
+                result.append("'\\''");
+            else
+                result.append(1, *c);
+        return result + "'";
+    }
+}
+
+namespace paludis
+{
+    template <>
+    struct Implementation<EbuildMetadataServer>
+    {
+        Command command;
+        std::map<std::string, std::string> initial_setenvs;
+        const std::tr1::function<std::string (const std::string &)> initial_pipe_command_handler;
+
+        Mutex mutex;
+        ConditionVariable condition;
+        ServerState state;
+        bool shutdown;
+
+        std::string request;
+        std::tr1::function<std::string (const std::string &)> request_pipe_command_handler;
+
+        std::string result_stdout, result_stderr;
+        int result_exit_status;
+
+        /* only used by the server thread */
+        std::stringstream captured_stdout, captured_stderr;
+
+        std::tr1::shared_ptr<Thread> thread;
+
+        Implementation(const Command & c) :
+            command(c),
+            initial_setenvs(c.begin_setenvs(), c.end_setenvs()),
+            initial_pipe_command_handler(c.pipe_command_handler()),
+            state(ss_idle),
+            shutdown(false),
+            result_exit_status(-1)
+        {
+        }
+    };
+
+    template <>
+    struct Implementation<EbuildMetadataServerPool>
+    {
+        Mutex mutex;
+        std::multimap<std::string, std::tr1::shared_ptr<EbuildMetadataServer> > idle;
+        std::set<std::string> broken;
+    };
+}
+
+EbuildMetadataServer::EbuildMetadataServer(const Command & c) :
+    PrivateImplementationPattern<EbuildMetadataServer>(new Implementation<EbuildMetadataServer>(c))
+{
+    using namespace std::tr1::placeholders;
+
+    _imp->command
+        .with_setenv("PALUDIS_EBUILD_METADATA_SERVER", "yes")
+        .with_pipe_command_handler("PALUDIS_PIPE_COMMAND", std::tr1::bind(&EbuildMetadataServer::_handle_pipe_command, this, _1))
+        .with_captured_stdout_stream(&_imp->captured_stdout)
+        .with_captured_stderr_stream(&_imp->captured_stderr);
+
+    _imp->thread.reset(new Thread(std::tr1::bind(&EbuildMetadataServer::_serve, this)));
+}
+
+EbuildMetadataServer::~EbuildMetadataServer()
+{
+    {
+        Lock lock(_imp->mutex);
+        _imp->shutdown = true;
+        _imp->condition.broadcast();
+    }
+
+    /* joins the thread, which exits once the server sees that we are shutting down */
+    _imp->thread.reset();
+}
+
+void
+EbuildMetadataServer::_serve() throw ()
+{
+    Context context("When running ebuild metadata server:");
+
+    int exit_status(-1);
+    try
+    {
+        exit_status = run_command(_imp->command);
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("e.ebuild.metadata_server.failure", ll_warning, lc_context)
+            << "Caught exception '" << e.message() << "' (" << e.what() << ")";
+    }
+
+    Lock lock(_imp->mutex);
+    if (! _imp->shutdown)
+        Log::get_instance()->message("e.ebuild.metadata_server.exited", ll_debug, lc_context)
+            << "Ebuild metadata server exited unexpectedly with status " << exit_status << ", stderr is '"
+            << _imp->captured_stderr.str() << "'";
+
+    _imp->state = ss_dead;
+    _imp->condition.broadcast();
+}
+
+std::string
+EbuildMetadataServer::_handle_pipe_command(const std::string & s)
+{
+    std::vector<std::string> tokens;
+    std::string t(s);
+    std::string::size_type p(t.find('\2'));
+    while (std::string::npos != p)
+    {
+        tokens.push_back(t.substr(0, p));
+        t.erase(0, p + 1);
+        p = t.find('\2');
+    }
+
+    if ((! tokens.empty()) && tokens[0] == "METADATA_SERVER_NEXT")
+    {
+        Lock lock(_imp->mutex);
+
+        if (! _imp->captured_stderr.str().empty())
+            Log::get_instance()->message("e.ebuild.metadata_server.stray_output", ll_debug, lc_context)
+                << "Ebuild metadata server produced stray stderr '" << _imp->captured_stderr.str() << "'";
+        _imp->captured_stdout.str("");
+        _imp->captured_stderr.str("");
+
+        while ((! _imp->shutdown) && ss_pending != _imp->state)
+            _imp->condition.wait(_imp->mutex);
+
+        /* an empty request tells the server to exit */
+        if (_imp->shutdown)
+            return "O";
+
+        _imp->state = ss_running;
+        return "O" + _imp->request;
+    }
+    else if ((! tokens.empty()) && tokens[0] == "METADATA_SERVER_DONE")
+    {
+        Lock lock(_imp->mutex);
+
+        if (tokens.size() != 2 || ss_running != _imp->state)
+        {
+            Log::get_instance()->message("e.ebuild.metadata_server.bad_done", ll_warning, lc_context)
+                << "Got bad METADATA_SERVER_DONE command";
+            return "Ebad METADATA_SERVER_DONE command";
+        }
+
+        _imp->result_exit_status = destringify<int>(tokens[1]);
+        _imp->result_stdout = _imp->captured_stdout.str();
+        _imp->result_stderr = _imp->captured_stderr.str();
+        _imp->captured_stdout.str("");
+        _imp->captured_stderr.str("");
+        _imp->state = ss_done;
+        _imp->condition.broadcast();
+        return "O";
+    }
+    else
+    {
+        std::tr1::function<std::string (const std::string &)> handler;
+        {
+            Lock lock(_imp->mutex);
+            handler = _imp->request_pipe_command_handler ? _imp->request_pipe_command_handler
+                : _imp->initial_pipe_command_handler;
+        }
+
+        return handler(s);
+    }
+}
+
+bool
+EbuildMetadataServer::run(const Command & cmd, const std::string & ebuild_file, const std::string & commands,
+        std::string & captured_stdout, std::string & captured_stderr, int & exit_status)
+{
+    std::string request;
+    std::set<std::string> seen;
+    for (Command::ConstIterator s(cmd.begin_setenvs()), s_end(cmd.end_setenvs()) ; s != s_end ; ++s)
+    {
+        seen.insert(s->first);
+        std::map<std::string, std::string>::const_iterator i(_imp->initial_setenvs.find(s->first));
+        if (_imp->initial_setenvs.end() == i || i->second != s->second)
+            request.append("export " + s->first + "=" + shell_quote(s->second) + "\n");
+    }
+
+    for (std::map<std::string, std::string>::const_iterator i(_imp->initial_setenvs.begin()),
+            i_end(_imp->initial_setenvs.end()) ; i != i_end ; ++i)
+        if (seen.end() == seen.find(i->first))
+            request.append("unset -v " + i->first + "\n");
+
+    request.append("PALUDIS_METADATA_SERVER_EBUILD=" + shell_quote(ebuild_file) + "\n");
+    request.append("PALUDIS_METADATA_SERVER_COMMANDS=" + shell_quote(commands) + "\n");
+
+    Lock lock(_imp->mutex);
+    if (ss_dead == _imp->state)
+        return false;
+
+    _imp->request = request;
+    _imp->request_pipe_command_handler = cmd.pipe_command_handler();
+    _imp->state = ss_pending;
+    _imp->condition.broadcast();
+
+    while (ss_pending == _imp->state || ss_running == _imp->state)
+        _imp->condition.wait(_imp->mutex);
+
+    _imp->request_pipe_command_handler = std::tr1::function<std::string (const std::string &)>();
+
+    if (ss_done != _imp->state)
+        return false;
+
+    captured_stdout = _imp->result_stdout;
+    captured_stderr = _imp->result_stderr;
+    exit_status = _imp->result_exit_status;
+    _imp->state = ss_idle;
+    return true;
+}
+
+EbuildMetadataServerPool::EbuildMetadataServerPool() :
+    PrivateImplementationPattern<EbuildMetadataServerPool>(new Implementation<EbuildMetadataServerPool>)
+{
+}
+
+EbuildMetadataServerPool::~EbuildMetadataServerPool()
+{
+}
+
+bool
+EbuildMetadataServerPool::run(const std::string & key, const Command & cmd, const std::string & ebuild_file,
+        const std::string & commands, std::string & captured_stdout, std::string & captured_stderr,
+        int & exit_status)
+{
+    std::tr1::shared_ptr<EbuildMetadataServer> server;
+    bool fresh(false);
+    {
+        Lock lock(_imp->mutex);
+        if (_imp->broken.end() != _imp->broken.find(key))
+            return false;
+
+        std::multimap<std::string, std::tr1::shared_ptr<EbuildMetadataServer> >::iterator i(_imp->idle.find(key));
+        if (_imp->idle.end() != i)
+        {
+            server = i->second;
+            _imp->idle.erase(i);
+        }
+    }
+
+    if (! server)
+    {
+        server.reset(new EbuildMetadataServer(cmd));
+        fresh = true;
+    }
+
+    if (server->run(cmd, ebuild_file, commands, captured_stdout, captured_stderr, exit_status))
+    {
+        Lock lock(_imp->mutex);
+        _imp->idle.insert(std::make_pair(key, server));
+        return true;
+    }
+
+    /* if a new server can't even manage one request, something is wrong with
+     * its environment, so don't keep trying */
+    if (fresh)
+    {
+        Lock lock(_imp->mutex);
+        if (_imp->broken.insert(key).second)
+            Log::get_instance()->message("e.ebuild.metadata_server.broken", ll_warning, lc_context)
+                << "Could not use an ebuild metadata server for '" << key << "', falling back to running "
+                << "ebuild.bash once per ebuild";
+    }
+
+    return false;
+}
+
+template class PrivateImplementationPattern<EbuildMetadataServer>;
+template class PrivateImplementationPattern<EbuildMetadataServerPool>;
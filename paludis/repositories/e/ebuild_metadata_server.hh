@@ -0,0 +1,116 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_EBUILD_METADATA_SERVER_HH
+#define PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_EBUILD_METADATA_SERVER_HH 1
+
+#include <paludis/util/private_implementation_pattern.hh>
+#include <paludis/util/instantiation_policy.hh>
+#include <paludis/util/system.hh>
+#include <string>
+
+namespace paludis
+{
+    namespace erepository
+    {
+        /**
+         * A long-running ebuild.bash process that generates metadata for many
+         * ebuilds, saving a fork, exec and module load for each one.
+         *
+         * The process is started using the first command we are asked to run.
+         * Each request is then fed to it over the pipe command channel, and is
+         * run in a subshell, so nothing an ebuild does can affect later
+         * requests. Only environment variables that differ from those of the
+         * first command are passed along, so every request to a particular
+         * server must be for the same EAPI and repository.
+         *
+         * \see EbuildMetadataServerPool
+         * \ingroup grperepository
+         * \nosubgrouping
+         */
+        class EbuildMetadataServer :
+            private PrivateImplementationPattern<EbuildMetadataServer>,
+            private InstantiationPolicy<EbuildMetadataServer, instantiation_method::NonCopyableTag>
+        {
+            private:
+                void _serve() throw ();
+                std::string _handle_pipe_command(const std::string &);
+
+            public:
+                ///\name Basic operations
+                ///\{
+
+                EbuildMetadataServer(const Command &);
+                ~EbuildMetadataServer();
+
+                ///\}
+
+                /**
+                 * Run a metadata command, as if by run_command.
+                 *
+                 * Returns false if the server has gone away, in which case
+                 * the caller should run the command normally instead.
+                 */
+                bool run(const Command &, const std::string & ebuild_file, const std::string & commands,
+                        std::string & captured_stdout, std::string & captured_stderr, int & exit_status)
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+        };
+
+        /**
+         * Holds idle EbuildMetadataServer instances, so that concurrent
+         * metadata generation gets one server per thread.
+         *
+         * \see EbuildMetadataServer
+         * \ingroup grperepository
+         * \nosubgrouping
+         */
+        class EbuildMetadataServerPool :
+            private PrivateImplementationPattern<EbuildMetadataServerPool>,
+            private InstantiationPolicy<EbuildMetadataServerPool, instantiation_method::NonCopyableTag>
+        {
+            public:
+                ///\name Basic operations
+                ///\{
+
+                EbuildMetadataServerPool();
+                ~EbuildMetadataServerPool();
+
+                ///\}
+
+                /**
+                 * Run a metadata command using a server for the given key
+                 * (which must identify the EAPI), starting one if necessary.
+                 *
+                 * Returns false if no server could be used, in which case the
+                 * caller should run the command normally instead.
+                 */
+                bool run(const std::string & key, const Command &, const std::string & ebuild_file,
+                        const std::string & commands, std::string & captured_stdout, std::string & captured_stderr,
+                        int & exit_status)
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+        };
+    }
+
+#ifdef PALUDIS_HAVE_EXTERN_TEMPLATE
+    extern template class PrivateImplementationPattern<erepository::EbuildMetadataServer>;
+    extern template class PrivateImplementationPattern<erepository::EbuildMetadataServerPool>;
+#endif
+}
+
+#endif
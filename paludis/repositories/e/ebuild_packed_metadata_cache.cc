@@ -0,0 +1,330 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/repositories/e/ebuild_packed_metadata_cache.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/exception.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/private_implementation_pattern-impl.hh>
+#include <algorithm>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace paludis;
+using namespace paludis::erepository;
+
+/*
+ * File format:
+ *
+ *     magic
+ *     key and value data for every entry, with no separators
+ *     the offset table, sorted by key, one { key offset, key length,
+ *         value offset, value length } group of uint32_t per entry
+ *     the trailer, { table offset, number of entries, byte order marker }
+ *
+ * Everything is in native byte order. We never rely upon alignment, so all
+ * numbers are memcpy()ed in and out.
+ */
+
+namespace
+{
+    const char magic[] = "paludis-packed-metadata-1\n";
+    const std::size_t magic_size = sizeof(magic) - 1;
+    const uint32_t byte_order_marker = 0x1a2b3c4d;
+    const std::size_t table_entry_size = 4 * sizeof(uint32_t);
+    const std::size_t trailer_size = 3 * sizeof(uint32_t);
+
+    inline uint32_t get_uint32(const char * const p)
+    {
+        uint32_t result;
+        std::memcpy(&result, p, sizeof(result));
+        return result;
+    }
+
+    inline void put_uint32(std::ostream & s, const uint32_t v)
+    {
+        char buf[sizeof(v)];
+        std::memcpy(buf, &v, sizeof(v));
+        s.write(buf, sizeof(v));
+    }
+
+    struct TableEntry
+    {
+        std::string key;
+        uint32_t key_offset;
+        uint32_t value_offset;
+        uint32_t value_size;
+
+        bool operator< (const TableEntry & other) const
+        {
+            return key < other.key;
+        }
+    };
+}
+
+namespace paludis
+{
+    template <>
+    struct Implementation<EbuildPackedMetadataCache>
+    {
+        const FSEntry location;
+        void * map;
+        std::size_t map_size;
+
+        const char * data;
+        const char * table;
+        uint32_t table_offset;
+        uint32_t count;
+
+        Implementation(const FSEntry & l) :
+            location(l),
+            map(MAP_FAILED),
+            map_size(0),
+            data(0),
+            table(0),
+            table_offset(0),
+            count(0)
+        {
+        }
+    };
+
+    template <>
+    struct Implementation<EbuildPackedMetadataCacheWriter>
+    {
+        FSEntry location;
+        FSEntry temp_location;
+        std::tr1::shared_ptr<SafeOFStream> stream;
+        std::vector<TableEntry> table;
+        uint64_t offset;
+
+        Implementation(const FSEntry & l) :
+            location(l),
+            temp_location(l.dirname() / ("-" + l.basename())),
+            offset(0)
+        {
+        }
+    };
+}
+
+EbuildPackedMetadataCache::EbuildPackedMetadataCache(const FSEntry & f) :
+    PrivateImplementationPattern<EbuildPackedMetadataCache>(new Implementation<EbuildPackedMetadataCache>(f))
+{
+    Context context("When loading packed metadata cache '" + stringify(f) + "':");
+
+    int fd(::open(stringify(f).c_str(), O_RDONLY));
+    if (-1 == fd)
+    {
+        Log::get_instance()->message("e.cache.packed.unavailable", ll_debug, lc_context)
+            << "Not using packed metadata cache: " << std::strerror(errno);
+        return;
+    }
+
+    struct stat st;
+    if (0 == ::fstat(fd, &st) && st.st_size > 0)
+    {
+        _imp->map_size = st.st_size;
+        _imp->map = ::mmap(0, _imp->map_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+
+    if (MAP_FAILED == _imp->map)
+    {
+        Log::get_instance()->message("e.cache.packed.unavailable", ll_warning, lc_context)
+            << "Not using packed metadata cache because it could not be mapped";
+        return;
+    }
+
+    const char * const begin(static_cast<const char *>(_imp->map));
+    if (_imp->map_size < magic_size + trailer_size || 0 != std::memcmp(begin, magic, magic_size))
+    {
+        Log::get_instance()->message("e.cache.packed.unsupported", ll_warning, lc_context)
+            << "Not using packed metadata cache because it has an unsupported format";
+        return;
+    }
+
+    const char * const trailer(begin + _imp->map_size - trailer_size);
+    uint32_t table_offset(get_uint32(trailer)), count(get_uint32(trailer + sizeof(uint32_t)));
+    if (byte_order_marker != get_uint32(trailer + 2 * sizeof(uint32_t)) || table_offset < magic_size
+            || uint64_t(table_offset) + uint64_t(count) * table_entry_size + trailer_size != _imp->map_size)
+    {
+        Log::get_instance()->message("e.cache.packed.broken", ll_warning, lc_context)
+            << "Not using packed metadata cache because it is truncated or was written on a different platform";
+        return;
+    }
+
+    _imp->data = begin;
+    _imp->table = begin + table_offset;
+    _imp->table_offset = table_offset;
+    _imp->count = count;
+}
+
+EbuildPackedMetadataCache::~EbuildPackedMetadataCache()
+{
+    if (MAP_FAILED != _imp->map)
+        ::munmap(_imp->map, _imp->map_size);
+}
+
+const FSEntry
+EbuildPackedMetadataCache::location() const
+{
+    return _imp->location;
+}
+
+bool
+EbuildPackedMetadataCache::usable() const
+{
+    return 0 != _imp->data;
+}
+
+bool
+EbuildPackedMetadataCache::find(const std::string & key, const char * & data, std::size_t & size) const
+{
+    if (! _imp->data)
+        return false;
+
+    uint32_t lower(0), upper(_imp->count);
+    while (lower < upper)
+    {
+        uint32_t middle(lower + (upper - lower) / 2);
+        const char * const entry(_imp->table + middle * table_entry_size);
+
+        uint32_t key_offset(get_uint32(entry)), key_size(get_uint32(entry + sizeof(uint32_t)));
+        if (uint64_t(key_offset) + key_size > _imp->table_offset)
+        {
+            Log::get_instance()->message("e.cache.packed.broken", ll_warning, lc_context)
+                << "Packed metadata cache '" << _imp->location << "' has a bad offset table";
+            return false;
+        }
+
+        int c(key.compare(0, std::string::npos, _imp->data + key_offset, key_size));
+        if (c < 0)
+            upper = middle;
+        else if (c > 0)
+            lower = middle + 1;
+        else
+        {
+            uint32_t value_offset(get_uint32(entry + 2 * sizeof(uint32_t))),
+                     value_size(get_uint32(entry + 3 * sizeof(uint32_t)));
+            if (uint64_t(value_offset) + value_size > _imp->table_offset)
+            {
+                Log::get_instance()->message("e.cache.packed.broken", ll_warning, lc_context)
+                    << "Packed metadata cache '" << _imp->location << "' has a bad offset table";
+                return false;
+            }
+
+            data = _imp->data + value_offset;
+            size = value_size;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+EbuildPackedMetadataCacheWriter::EbuildPackedMetadataCacheWriter(const FSEntry & f) :
+    PrivateImplementationPattern<EbuildPackedMetadataCacheWriter>(new Implementation<EbuildPackedMetadataCacheWriter>(f))
+{
+    _imp->stream.reset(new SafeOFStream(_imp->temp_location));
+    _imp->stream->write(magic, magic_size);
+    _imp->offset = magic_size;
+}
+
+EbuildPackedMetadataCacheWriter::~EbuildPackedMetadataCacheWriter()
+{
+    /* we didn't get as far as done(), so throw away the partial file */
+    if (_imp->stream)
+    {
+        try
+        {
+            _imp->stream.reset();
+        }
+        catch (const SafeOFStreamError &)
+        {
+        }
+
+        try
+        {
+            _imp->temp_location.unlink();
+        }
+        catch (const FSError &)
+        {
+        }
+    }
+}
+
+const FSEntry
+EbuildPackedMetadataCacheWriter::location() const
+{
+    return _imp->location;
+}
+
+void
+EbuildPackedMetadataCacheWriter::add(const std::string & key, const std::string & value)
+{
+    /* leave room for the offset table */
+    if (_imp->offset + key.length() + value.length() + (_imp->table.size() + 1) * table_entry_size + trailer_size
+            > uint64_t(uint32_t(-1)))
+        throw InternalError(PALUDIS_HERE, "packed metadata cache '" + stringify(_imp->location) + "' is too large");
+
+    TableEntry entry;
+    entry.key = key;
+    entry.key_offset = _imp->offset;
+    entry.value_offset = _imp->offset + key.length();
+    entry.value_size = value.length();
+    _imp->table.push_back(entry);
+
+    *_imp->stream << key << value;
+    _imp->offset += key.length() + value.length();
+}
+
+void
+EbuildPackedMetadataCacheWriter::done()
+{
+    std::sort(_imp->table.begin(), _imp->table.end());
+
+    for (std::vector<TableEntry>::const_iterator t(_imp->table.begin()), t_end(_imp->table.end()) ;
+            t != t_end ; ++t)
+    {
+        put_uint32(*_imp->stream, t->key_offset);
+        put_uint32(*_imp->stream, t->key.length());
+        put_uint32(*_imp->stream, t->value_offset);
+        put_uint32(*_imp->stream, t->value_size);
+    }
+
+    put_uint32(*_imp->stream, _imp->offset);
+    put_uint32(*_imp->stream, _imp->table.size());
+    put_uint32(*_imp->stream, byte_order_marker);
+
+    /* SafeOFStream reports errors when it is destroyed */
+    std::tr1::shared_ptr<SafeOFStream> stream;
+    stream.swap(_imp->stream);
+    stream.reset();
+    _imp->temp_location.rename(_imp->location);
+}
+
+template class PrivateImplementationPattern<EbuildPackedMetadataCache>;
+template class PrivateImplementationPattern<EbuildPackedMetadataCacheWriter>;
@@ -0,0 +1,130 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_EBUILD_PACKED_METADATA_CACHE_HH
+#define PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_EBUILD_PACKED_METADATA_CACHE_HH 1
+
+#include <paludis/util/private_implementation_pattern.hh>
+#include <paludis/util/instantiation_policy.hh>
+#include <paludis/util/fs_entry.hh>
+#include <string>
+#include <cstddef>
+
+namespace paludis
+{
+    namespace erepository
+    {
+        /**
+         * A read-only view of a packed metadata cache file.
+         *
+         * A packed metadata cache holds flat_hash format cache entries for
+         * every ID in a repository in a single file, along with a sorted
+         * offset table keyed by 'cat/pkg-ver'. The file is mapped into memory
+         * when we are created, so lookups don't need to open or read any
+         * files.
+         *
+         * If the file doesn't exist or is unusable, every lookup fails and
+         * callers should fall back to the per-ID cache files.
+         *
+         * \see EbuildPackedMetadataCacheWriter
+         * \see EbuildFlatMetadataCache
+         * \ingroup grperepository
+         * \nosubgrouping
+         */
+        class EbuildPackedMetadataCache :
+            private PrivateImplementationPattern<EbuildPackedMetadataCache>,
+            private InstantiationPolicy<EbuildPackedMetadataCache, instantiation_method::NonCopyableTag>
+        {
+            public:
+                ///\name Basic operations
+                ///\{
+
+                EbuildPackedMetadataCache(const FSEntry &);
+                ~EbuildPackedMetadataCache();
+
+                ///\}
+
+                /**
+                 * The file we were created from.
+                 */
+                const FSEntry location() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Did we manage to map a valid file?
+                 */
+                bool usable() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Find the entry for a given 'cat/pkg-ver' key.
+                 *
+                 * On success, data and size refer to memory that remains
+                 * valid for as long as we exist.
+                 */
+                bool find(const std::string & key, const char * & data, std::size_t & size) const
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+        };
+
+        /**
+         * Creates a packed metadata cache file.
+         *
+         * Entries are written out as they are added, and the offset table is
+         * written and the file moved into place by done(). If done() is not
+         * called, any existing file is left alone.
+         *
+         * \see EbuildPackedMetadataCache
+         * \ingroup grperepository
+         * \nosubgrouping
+         */
+        class EbuildPackedMetadataCacheWriter :
+            private PrivateImplementationPattern<EbuildPackedMetadataCacheWriter>,
+            private InstantiationPolicy<EbuildPackedMetadataCacheWriter, instantiation_method::NonCopyableTag>
+        {
+            public:
+                ///\name Basic operations
+                ///\{
+
+                EbuildPackedMetadataCacheWriter(const FSEntry &);
+                ~EbuildPackedMetadataCacheWriter();
+
+                ///\}
+
+                /**
+                 * The file we will create.
+                 */
+                const FSEntry location() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Add an entry. Keys must be unique.
+                 */
+                void add(const std::string & key, const std::string & value);
+
+                /**
+                 * Write the offset table, and move the file into place.
+                 */
+                void done();
+        };
+    }
+
+#ifdef PALUDIS_HAVE_EXTERN_TEMPLATE
+    extern template class PrivateImplementationPattern<erepository::EbuildPackedMetadataCache>;
+    extern template class PrivateImplementationPattern<erepository::EbuildPackedMetadataCacheWriter>;
+#endif
+}
+
+#endif
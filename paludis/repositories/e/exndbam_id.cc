@@ -54,13 +54,8 @@ namespace
                 if (_v)
                     return _v;
 
-                using namespace std::tr1::placeholders;
                 _v.reset(new Contents);
-                _db->parse_contents(*_id,
-                        std::tr1::bind(&Contents::add, _v.get(), std::tr1::placeholders::_1),
-                        std::tr1::bind(&Contents::add, _v.get(), std::tr1::placeholders::_1),
-                        std::tr1::bind(&Contents::add, _v.get(), std::tr1::placeholders::_1)
-                        );
+                _db->parse_contents(*_id, *_v);
                 return _v;
             }
 
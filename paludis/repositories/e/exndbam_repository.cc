@@ -37,10 +37,12 @@
 #include <paludis/util/system.hh>
 #include <paludis/util/make_named_values.hh>
 #include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/wrapped_output_iterator.hh>
 #include <paludis/output_manager.hh>
 #include <paludis/distribution.hh>
 #include <paludis/environment.hh>
 #include <paludis/ndbam.hh>
+#include <paludis/owners_index.hh>
 #include <paludis/ndbam_merger.hh>
 #include <paludis/ndbam_unmerger.hh>
 #include <paludis/metadata_key.hh>
@@ -107,6 +109,7 @@ ExndbamRepository::ExndbamRepository(const RepositoryName & n, const ExndbamRepo
                 value_for<n::environment_variable_interface>(this),
                 value_for<n::make_virtuals_interface>(static_cast<RepositoryMakeVirtualsInterface *>(0)),
                 value_for<n::manifest_interface>(static_cast<RepositoryManifestInterface *>(0)),
+                value_for<n::owners_interface>(this),
                 value_for<n::provides_interface>(static_cast<RepositoryProvidesInterface *>(0)),
                 value_for<n::virtuals_interface>(static_cast<RepositoryVirtualsInterface *>(0))
             )),
@@ -618,6 +621,44 @@ ExndbamRepository::perform_uninstall(
 void
 ExndbamRepository::regenerate_cache() const
 {
+    update_owners_index(false);
+}
+
+void
+ExndbamRepository::update_owners_index(const bool create) const
+{
+    const std::tr1::shared_ptr<OwnersIndex> index(_imp->ndbam.owners_index(create));
+    if (! index)
+        return;
+
+    /* installing or uninstalling anything creates or removes a directory
+     * in its package's data directory */
+    const std::string stamp(OwnersIndex::directory_stamp(_imp->params.location() / "data", 1));
+    if (index->is_current(stamp))
+        return;
+
+    const std::tr1::shared_ptr<PackageIDSequence> ids(new PackageIDSequence);
+    const std::tr1::shared_ptr<const CategoryNamePartSet> cats(category_names());
+    for (CategoryNamePartSet::ConstIterator c(cats->begin()), c_end(cats->end()) ;
+            c != c_end ; ++c)
+    {
+        const std::tr1::shared_ptr<const QualifiedPackageNameSet> qpns(package_names(*c));
+        for (QualifiedPackageNameSet::ConstIterator q(qpns->begin()), q_end(qpns->end()) ;
+                q != q_end ; ++q)
+        {
+            const std::tr1::shared_ptr<const PackageIDSequence> q_ids(package_ids(*q));
+            std::copy(q_ids->begin(), q_ids->end(), ids->back_inserter());
+        }
+    }
+
+    index->update(ids, stamp);
+}
+
+std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence>
+ExndbamRepository::owners(const std::string & pattern, const OwnersMatch m) const
+{
+    update_owners_index(true);
+    return _imp->ndbam.owners_index(true)->owners(*this, pattern, m);
 }
 
 void
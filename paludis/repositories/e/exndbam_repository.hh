@@ -54,6 +54,7 @@ namespace paludis
 
     class PALUDIS_VISIBLE ExndbamRepository :
         public erepository::EInstalledRepository,
+        public RepositoryOwnersInterface,
         public std::tr1::enable_shared_from_this<ExndbamRepository>,
         public PrivateImplementationPattern<ExndbamRepository>
     {
@@ -61,6 +62,8 @@ namespace paludis
             PrivateImplementationPattern<ExndbamRepository>::ImpPtr & _imp;
             void _add_metadata_keys() const;
 
+            void update_owners_index(const bool create) const;
+
         protected:
             virtual void need_keys_added() const;
 
@@ -85,6 +88,12 @@ namespace paludis
 
             virtual void merge(const MergeParams &);
 
+            /* RepositoryOwnersInterface */
+
+            virtual std::tr1::shared_ptr<const OwnersSequence> owners(
+                    const std::string &, const OwnersMatch) const
+                PALUDIS_ATTRIBUTE((warn_unused_result));
+
             /* Repository */
 
             virtual std::tr1::shared_ptr<const PackageIDSequence> package_ids(
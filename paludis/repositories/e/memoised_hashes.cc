@@ -28,26 +28,461 @@
 #include <paludis/util/sha1.hh>
 #include <paludis/util/sha256.hh>
 #include <paludis/util/md5.hh>
-#include <paludis/util/timestamp.hh>
+#include <paludis/util/digests.hh>
+#include <paludis/util/options.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/destringify.hh>
+#include <paludis/util/log.hh>
 
+#include <tr1/memory>
 #include <map>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace paludis;
 using namespace paludis::erepository;
 
-namespace paludis
+namespace
 {
-    typedef std::map<std::pair<std::string, int>, std::pair<Timestamp, std::string> > HashesMap;
+    const std::string cache_magic("paludis-hashes-2");
+    const std::string cache_file_name(".paludis-hashes-cache");
+
+    /**
+     * What we remember about a file when we hash it. If any of this
+     * changes, the hash is recalculated. The change time is included because,
+     * unlike the modification time, it can't be set back by hand.
+     */
+    struct FileKey
+    {
+        off_t size;
+        ino_t inode;
+        time_t mtime_seconds;
+        long mtime_nanoseconds;
+        time_t ctime_seconds;
+        long ctime_nanoseconds;
+
+        bool operator== (const FileKey & other) const
+        {
+            return size == other.size && inode == other.inode &&
+                mtime_seconds == other.mtime_seconds && mtime_nanoseconds == other.mtime_nanoseconds &&
+                ctime_seconds == other.ctime_seconds && ctime_nanoseconds == other.ctime_nanoseconds;
+        }
+    };
+
+    FileKey file_key(const FSEntry & f)
+    {
+        struct stat st;
+        if (0 != ::stat(stringify(f).c_str(), &st))
+            throw FSError("Error running stat() on '" + stringify(f) + "': " + ::strerror(errno));
+
+        FileKey result;
+        result.size = st.st_size;
+        result.inode = st.st_ino;
+        result.mtime_seconds = st.st_mtim.tv_sec;
+        result.mtime_nanoseconds = st.st_mtim.tv_nsec;
+        result.ctime_seconds = st.st_ctim.tv_sec;
+        result.ctime_nanoseconds = st.st_ctim.tv_nsec;
+        return result;
+    }
+
+    bool lock_file(const int fd, const short type)
+    {
+        struct flock l;
+        std::memset(&l, 0, sizeof(l));
+        l.l_type = type;
+        l.l_whence = SEEK_SET;
+        l.l_start = 0;
+        l.l_len = 0;
+
+        while (-1 == ::fcntl(fd, F_SETLKW, &l))
+            if (EINTR != errno)
+                return false;
+
+        return true;
+    }
+
+    struct Memo
+    {
+        FileKey key;
+        std::string hexsum;
+    };
+
+    typedef std::map<std::pair<std::string, DigestKind>, Memo> HashesMap;
+
+    std::string make_record(const std::string & name, const DigestKind kind, const Memo & memo)
+    {
+        return stringify(kind) + " " + stringify(memo.key.size) + " " + stringify(memo.key.inode) + " "
+            + stringify(memo.key.mtime_seconds) + " " + stringify(memo.key.mtime_nanoseconds) + " "
+            + stringify(memo.key.ctime_seconds) + " " + stringify(memo.key.ctime_nanoseconds) + " "
+            + memo.hexsum + " " + name + "\n";
+    }
+
+    /**
+     * The on-disk memo for a directory, which is shared between processes.
+     *
+     * Records are only read or appended with the file locked, and later
+     * records replace earlier ones. The file is rewritten when it holds too
+     * many stale records, so anyone who has it open checks that it hasn't
+     * been replaced after taking the lock.
+     *
+     * The file lives alongside the files it describes, so it is only
+     * trusted if it is owned by root or by us and nobody else can write to
+     * it. A record left half written by a writer that died is never read,
+     * and is thrown away by the next writer.
+     */
+    struct CacheFile
+    {
+        FSEntry location;
+        int fd;
+        bool writable;
+        ino_t inode;
+        off_t offset;
+
+        CacheFile(const FSEntry & l) :
+            location(l),
+            fd(-1),
+            writable(false),
+            inode(0),
+            offset(0)
+        {
+            open();
+        }
+
+        ~CacheFile()
+        {
+            if (-1 != fd)
+                ::close(fd);
+        }
+
+        void open()
+        {
+            if (-1 != fd)
+                ::close(fd);
+
+            offset = 0;
+            writable = true;
+            fd = ::open(stringify(location).c_str(), O_RDWR | O_APPEND | O_NOFOLLOW | O_CLOEXEC);
+            if (-1 == fd && ENOENT == errno)
+            {
+                fd = ::open(stringify(location).c_str(), O_RDWR | O_CREAT | O_EXCL | O_APPEND | O_NOFOLLOW | O_CLOEXEC, 0644);
+
+                /* don't let the umask give us something we wouldn't trust */
+                if (-1 != fd)
+                    ::fchmod(fd, 0644);
+            }
+
+            if (-1 == fd)
+            {
+                writable = false;
+                fd = ::open(stringify(location).c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+            }
+
+            if (-1 == fd)
+            {
+                Log::get_instance()->message("e.memoised_hashes.cache.unusable", ll_debug, lc_context)
+                    << "Cannot open hashes cache '" << location << "': " << ::strerror(errno);
+                return;
+            }
+
+            struct stat st;
+            if (0 != ::fstat(fd, &st))
+            {
+                ::close(fd);
+                fd = -1;
+                return;
+            }
+            inode = st.st_ino;
+
+            if (! S_ISREG(st.st_mode) || (0 != st.st_uid && ::geteuid() != st.st_uid)
+                    || 0 != (st.st_mode & (S_IWGRP | S_IWOTH)))
+                give_up("it must be a regular file, owned by root or by us, and writable only by its owner");
+        }
+
+        /**
+         * Has someone else replaced the file since we opened it? Must be
+         * called with a lock held.
+         */
+        bool replaced() const
+        {
+            struct stat st;
+            return 0 != ::stat(stringify(location).c_str(), &st) || st.st_ino != inode;
+        }
+
+        void give_up(const std::string & why)
+        {
+            Log::get_instance()->message("e.memoised_hashes.cache.broken", ll_warning, lc_context)
+                << "Ignoring hashes cache '" << location << "': " << why;
+            ::close(fd);
+            fd = -1;
+        }
 
+        /**
+         * Read any records added since we last looked, returning the number
+         * read. Must be called with a lock held, and if it is a write lock,
+         * a half written record at the end is removed.
+         */
+        unsigned catch_up(HashesMap & hashes, const bool write_locked)
+        {
+            std::string data;
+            char buffer[4096];
+            ssize_t n;
+            while (0 < ((n = ::pread(fd, buffer, sizeof(buffer), offset + data.length()))))
+                data.append(buffer, n);
+
+            std::string::size_type p(0), e;
+            unsigned count(0);
+            while (std::string::npos != ((e = data.find('\n', p))))
+            {
+                std::string line(data.substr(p, e - p));
+                p = e + 1;
+
+                if (0 == offset && 0 == count++)
+                {
+                    if (line != cache_magic)
+                    {
+                        give_up("bad magic");
+                        return 0;
+                    }
+                    continue;
+                }
+
+                std::vector<std::string> tokens;
+                std::string::size_type name_start(0);
+                while (tokens.size() < 8 && std::string::npos != name_start)
+                {
+                    std::string::size_type space(line.find(' ', name_start));
+                    if (std::string::npos == space)
+                        name_start = space;
+                    else
+                    {
+                        tokens.push_back(line.substr(name_start, space - name_start));
+                        name_start = space + 1;
+                    }
+                }
+
+                if (tokens.size() != 8 || name_start >= line.length())
+                {
+                    give_up("bad line '" + line + "'");
+                    return 0;
+                }
+
+                DigestKind kind(last_dk);
+                for (DigestKind k(static_cast<DigestKind>(0)) ; k < last_dk ; k = static_cast<DigestKind>(k + 1))
+                    if (stringify(k) == tokens[0])
+                        kind = k;
+                if (last_dk == kind)
+                    continue;
+
+                Memo memo;
+                try
+                {
+                    memo.key.size = destringify<off_t>(tokens[1]);
+                    memo.key.inode = destringify<ino_t>(tokens[2]);
+                    memo.key.mtime_seconds = destringify<time_t>(tokens[3]);
+                    memo.key.mtime_nanoseconds = destringify<long>(tokens[4]);
+                    memo.key.ctime_seconds = destringify<time_t>(tokens[5]);
+                    memo.key.ctime_nanoseconds = destringify<long>(tokens[6]);
+                }
+                catch (const DestringifyError &)
+                {
+                    give_up("bad line '" + line + "'");
+                    return 0;
+                }
+                memo.hexsum = tokens[7];
+
+                std::pair<std::string, DigestKind> key(stringify(location.dirname() / line.substr(name_start)), kind);
+                HashesMap::iterator i(hashes.find(key));
+                if (i != hashes.end())
+                    i->second = memo;
+                else
+                    hashes.insert(std::make_pair(key, memo));
+            }
+
+            /* anything after the last newline was left by a writer that died
+             * part way through a record, since records are written whole
+             * with the lock held */
+            if (p != data.length() && write_locked && writable)
+                if (0 != ::ftruncate(fd, offset + p))
+                    writable = false;
+
+            offset += p;
+            return count;
+        }
+    };
+}
+
+namespace paludis
+{
     template <>
     struct Implementation<MemoisedHashes>
     {
         mutable Mutex mutex;
         mutable HashesMap hashes;
+        mutable std::map<FSEntry, std::tr1::shared_ptr<CacheFile> > cache_files;
 
         Implementation()
         {
         }
+
+        void compact(CacheFile & cache_file) const
+        {
+            FSEntry tmp(cache_file.location.dirname() / (cache_file_name + "." + stringify(::getpid())));
+            std::string data(cache_magic + "\n");
+
+            std::string dir(stringify(cache_file.location.dirname()));
+            for (HashesMap::const_iterator h(hashes.begin()), h_end(hashes.end()) ;
+                    h != h_end ; ++h)
+            {
+                FSEntry f(h->first.first);
+                if (stringify(f.dirname()) != dir)
+                    continue;
+
+                try
+                {
+                    if (! (file_key(f) == h->second.key))
+                        continue;
+                }
+                catch (const FSError &)
+                {
+                    continue;
+                }
+
+                data.append(make_record(f.basename(), h->first.second, h->second));
+            }
+
+            ::unlink(stringify(tmp).c_str());
+            int fd(::open(stringify(tmp).c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644));
+            if (-1 == fd)
+                return;
+            ::fchmod(fd, 0644);
+
+            bool ok(data.length() == static_cast<std::string::size_type>(::write(fd, data.data(), data.length())));
+            ::close(fd);
+
+            if (ok && 0 == std::rename(stringify(tmp).c_str(), stringify(cache_file.location).c_str()))
+            {
+                Log::get_instance()->message("e.memoised_hashes.cache.compacted", ll_debug, lc_context)
+                    << "Rewrote hashes cache '" << cache_file.location << "'";
+                cache_file.open();
+                if (-1 != cache_file.fd && lock_file(cache_file.fd, F_RDLCK))
+                {
+                    cache_file.catch_up(hashes, false);
+                    lock_file(cache_file.fd, F_UNLCK);
+                }
+            }
+            else
+                ::unlink(stringify(tmp).c_str());
+        }
+
+        HashesMap::size_type entries_in(const FSEntry & dir) const
+        {
+            HashesMap::size_type result(0);
+            std::string d(stringify(dir));
+            for (HashesMap::const_iterator h(hashes.begin()), h_end(hashes.end()) ;
+                    h != h_end ; ++h)
+                if (stringify(FSEntry(h->first.first).dirname()) == d)
+                    ++result;
+            return result;
+        }
+
+        /**
+         * Find the cache file for a file's directory, opening and reading it
+         * if this is the first time we've seen it, or catching up on any
+         * changes other processes have made if not.
+         */
+        CacheFile & cache_file_for(const FSEntry & file) const
+        {
+            FSEntry dir(file.dirname());
+            std::map<FSEntry, std::tr1::shared_ptr<CacheFile> >::iterator c(cache_files.find(dir));
+            bool fresh(c == cache_files.end());
+            if (fresh)
+                c = cache_files.insert(std::make_pair(dir, std::tr1::shared_ptr<CacheFile>(
+                                new CacheFile(dir / cache_file_name)))).first;
+
+            CacheFile & cache_file(*c->second);
+            if (-1 == cache_file.fd)
+                return cache_file;
+
+            const short type(cache_file.writable ? F_WRLCK : F_RDLCK);
+            if (! lock_file(cache_file.fd, type))
+                return cache_file;
+
+            if (cache_file.replaced())
+            {
+                lock_file(cache_file.fd, F_UNLCK);
+                cache_file.open();
+                if (-1 == cache_file.fd || ! lock_file(cache_file.fd, type))
+                    return cache_file;
+            }
+
+            if (0 == cache_file.offset && cache_file.writable)
+            {
+                struct stat st;
+                if (0 == ::fstat(cache_file.fd, &st) && 0 == st.st_size)
+                {
+                    std::string magic(cache_magic + "\n");
+                    if (magic.length() != static_cast<std::string::size_type>(::write(cache_file.fd, magic.data(), magic.length())))
+                        cache_file.writable = false;
+                }
+            }
+
+            unsigned records(cache_file.catch_up(hashes, F_WRLCK == type));
+            if (-1 == cache_file.fd)
+                return cache_file;
+
+            lock_file(cache_file.fd, F_UNLCK);
+
+            if (fresh && cache_file.writable && records > 2 * entries_in(dir) + 64)
+                if (lock_file(cache_file.fd, F_WRLCK))
+                {
+                    if (! cache_file.replaced())
+                        compact(cache_file);
+                    if (-1 != cache_file.fd)
+                        lock_file(cache_file.fd, F_UNLCK);
+                }
+
+            return cache_file;
+        }
+
+        void save(CacheFile & cache_file, const std::string & records) const
+        {
+            if (-1 == cache_file.fd || ! cache_file.writable || records.empty())
+                return;
+
+            if (! lock_file(cache_file.fd, F_WRLCK))
+                return;
+
+            if (cache_file.replaced())
+            {
+                lock_file(cache_file.fd, F_UNLCK);
+                cache_file.open();
+                if (-1 == cache_file.fd || ! cache_file.writable || ! lock_file(cache_file.fd, F_WRLCK))
+                    return;
+            }
+
+            /* pick up anything added since, so we don't append to a half
+             * written record */
+            cache_file.catch_up(hashes, true);
+            if (-1 == cache_file.fd)
+                return;
+            if (! cache_file.writable)
+            {
+                lock_file(cache_file.fd, F_UNLCK);
+                return;
+            }
+
+            if (records.length() != static_cast<std::string::size_type>(::write(cache_file.fd, records.data(), records.length())))
+                Log::get_instance()->message("e.memoised_hashes.cache.write_failed", ll_debug, lc_context)
+                    << "Cannot write to hashes cache '" << cache_file.location << "': " << ::strerror(errno);
+
+            lock_file(cache_file.fd, F_UNLCK);
+        }
     };
 }
 
@@ -68,57 +503,138 @@ namespace
     template <>
     struct HashIDs<RMD160>
     {
-        static const int id;
+        static const DigestKind kind;
     };
-    const int HashIDs<RMD160>::id = 0;
+    const DigestKind HashIDs<RMD160>::kind = dk_rmd160;
 
     template <>
     struct HashIDs<SHA1>
     {
-        static const int id;
+        static const DigestKind kind;
     };
-    const int HashIDs<SHA1>::id = 1;
+    const DigestKind HashIDs<SHA1>::kind = dk_sha1;
 
     template <>
     struct HashIDs<SHA256>
     {
-        static const int id;
+        static const DigestKind kind;
     };
-    const int HashIDs<SHA256>::id = 2;
+    const DigestKind HashIDs<SHA256>::kind = dk_sha256;
 
     template <>
     struct HashIDs<MD5>
     {
-        static const int id;
+        static const DigestKind kind;
     };
-    const int HashIDs<MD5>::id = 3;
+    const DigestKind HashIDs<MD5>::kind = dk_md5;
 }
 
 template <typename H_>
 const std::string
 MemoisedHashes::get(const FSEntry & file, SafeIFStream & stream) const
 {
-    std::pair<std::string, int> key(stringify(file), HashIDs<H_>::id);
-    Timestamp mtime(file.mtim());
+    std::pair<std::string, DigestKind> key(stringify(file), HashIDs<H_>::kind);
+    FileKey current(file_key(file));
 
     Lock l(_imp->mutex);
 
     HashesMap::iterator i(_imp->hashes.find(key));
+    if (i != _imp->hashes.end() && i->second.key == current)
+        return i->second.hexsum;
+
+    CacheFile & cache_file(_imp->cache_file_for(file));
+    i = _imp->hashes.find(key);
 
-    if (i == _imp->hashes.end() || i->second.first != mtime)
+    if (i == _imp->hashes.end() || ! (i->second.key == current))
     {
         H_ hash(stream);
-        std::pair<Timestamp, std::string> value(std::make_pair(mtime, hash.hexsum()));
+        Memo memo;
+        memo.key = current;
+        memo.hexsum = hash.hexsum();
         stream.clear();
         stream.seekg(0, std::ios::beg);
 
+        /* saving can read other people's records, so ours goes in after */
+        _imp->save(cache_file, make_record(file.basename(), key.second, memo));
+
+        i = _imp->hashes.find(key);
         if (i != _imp->hashes.end())
-            i->second = value;
+            i->second = memo;
         else
-            i = _imp->hashes.insert(std::make_pair(key, value)).first;
+            i = _imp->hashes.insert(std::make_pair(key, memo)).first;
+    }
+
+    return i->second.hexsum;
+}
+
+void
+MemoisedHashes::prefetch(const FSEntry & file, const DigestKinds & kinds) const
+{
+    FileKey current(file_key(file));
+
+    Lock l(_imp->mutex);
+
+    DigestKinds wanted;
+    bool looked_at_cache_file(false);
+    CacheFile * cache_file(0);
+    for (DigestKind k(static_cast<DigestKind>(0)) ; k < last_dk ; k = static_cast<DigestKind>(k + 1))
+    {
+        if (! kinds[k])
+            continue;
+
+        std::pair<std::string, DigestKind> key(stringify(file), k);
+        HashesMap::const_iterator i(_imp->hashes.find(key));
+        if (i != _imp->hashes.end() && i->second.key == current)
+            continue;
+
+        if (! looked_at_cache_file)
+        {
+            cache_file = &_imp->cache_file_for(file);
+            looked_at_cache_file = true;
+            i = _imp->hashes.find(key);
+            if (i != _imp->hashes.end() && i->second.key == current)
+                continue;
+        }
+
+        wanted += k;
     }
 
-    return i->second.second;
+    if (wanted.none())
+        return;
+
+    Digests digests(wanted);
+    digests.update(file);
+    digests.finish();
+
+    std::string records;
+    for (DigestKind k(static_cast<DigestKind>(0)) ; k < last_dk ; k = static_cast<DigestKind>(k + 1))
+        if (wanted[k])
+        {
+            Memo memo;
+            memo.key = current;
+            memo.hexsum = digests.hexsum(k);
+            records.append(make_record(file.basename(), k, memo));
+        }
+
+    /* saving can read other people's records, so ours go in after */
+    _imp->save(*cache_file, records);
+
+    for (DigestKind k(static_cast<DigestKind>(0)) ; k < last_dk ; k = static_cast<DigestKind>(k + 1))
+    {
+        if (! wanted[k])
+            continue;
+
+        std::pair<std::string, DigestKind> key(stringify(file), k);
+        Memo memo;
+        memo.key = current;
+        memo.hexsum = digests.hexsum(k);
+
+        HashesMap::iterator i(_imp->hashes.find(key));
+        if (i != _imp->hashes.end())
+            i->second = memo;
+        else
+            _imp->hashes.insert(std::make_pair(key, memo));
+    }
 }
 
 template const std::string MemoisedHashes::get<RMD160>(const FSEntry &, SafeIFStream &) const;
@@ -128,4 +644,3 @@ template const std::string MemoisedHashes::get<MD5>(const FSEntry &, SafeIFStrea
 
 template class PrivateImplementationPattern<MemoisedHashes>;
 template class InstantiationPolicy<MemoisedHashes, instantiation_method::SingletonTag>;
-
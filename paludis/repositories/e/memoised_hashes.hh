@@ -24,11 +24,24 @@
 #include <paludis/util/instantiation_policy.hh>
 #include <paludis/util/fs_entry-fwd.hh>
 #include <paludis/util/safe_ifstream-fwd.hh>
+#include <paludis/util/digests-fwd.hh>
 
 namespace paludis
 {
     namespace erepository
     {
+        /**
+         * Remembers the hashes of distfiles, so that files that have not
+         * changed are only hashed once.
+         *
+         * Hashes are also saved to a cache file in each file's directory,
+         * which is shared with other processes, and which is trusted for as
+         * long as the file's size, inode, modification and change times are
+         * unchanged. A cache file is ignored unless it is owned by root or by
+         * us and is writable only by its owner.
+         *
+         * \ingroup grperepository
+         */
         class PALUDIS_VISIBLE MemoisedHashes :
             public InstantiationPolicy<MemoisedHashes, instantiation_method::SingletonTag>,
             private PrivateImplementationPattern<MemoisedHashes>
@@ -39,6 +52,15 @@ namespace paludis
                 template <typename H_>
                 const std::string get(const FSEntry & file, SafeIFStream & stream) const;
 
+                /**
+                 * Make sure we have up to date hashes of every requested
+                 * kind for a file, calculating any that are missing in a
+                 * single pass over the file.
+                 *
+                 * \since 0.48
+                 */
+                void prefetch(const FSEntry & file, const DigestKinds &) const;
+
             private:
                 MemoisedHashes();
                 ~MemoisedHashes();
@@ -0,0 +1,133 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/repositories/e/memoised_hashes.hh>
+#include <paludis/util/digests.hh>
+#include <paludis/util/options.hh>
+#include <paludis/util/fs_entry.hh>
+#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/md5.hh>
+#include <paludis/util/sha1.hh>
+#include <test/test_runner.hh>
+#include <test/test_framework.hh>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <string>
+#include <algorithm>
+#include <iterator>
+#include <fcntl.h>
+
+using namespace test;
+using namespace paludis;
+using namespace paludis::erepository;
+
+namespace test_cases
+{
+    struct MemoisedHashesTest : TestCase
+    {
+        MemoisedHashesTest() : TestCase("memoised hashes") { }
+
+        bool repeatable() const
+        {
+            return false;
+        }
+
+        void run()
+        {
+            FSEntry dir(FSEntry::cwd() / "memoised_hashes_TEST_dir");
+            FSEntry first(dir / "first"), second(dir / "second"), cache(dir / ".paludis-hashes-cache");
+            MemoisedHashes * hashes(MemoisedHashes::get_instance());
+
+            hashes->prefetch(first, DigestKinds() + dk_md5 + dk_sha1);
+            TEST_CHECK(cache.is_regular_file());
+
+            {
+                SafeIFStream s(first);
+                TEST_CHECK_EQUAL(hashes->get<MD5>(first, s), "900150983cd24fb0d6963f7d28e17f72");
+                TEST_CHECK_EQUAL(hashes->get<SHA1>(first, s), "a9993e364706816aba3e25717850c26c9cd0d89d");
+            }
+
+            std::string contents;
+            {
+                SafeIFStream s(cache);
+                contents = std::string((std::istreambuf_iterator<char>(s)), std::istreambuf_iterator<char>());
+            }
+            TEST_CHECK_EQUAL(std::count(contents.begin(), contents.end(), '\n'), 3);
+
+            /* pretend another process has already hashed second */
+            struct stat st;
+            TEST_CHECK(0 == ::stat(stringify(second).c_str(), &st));
+            {
+                SafeOFStream s(cache, O_WRONLY | O_APPEND);
+                s << "md5 " << st.st_size << " " << st.st_ino << " " << st.st_mtim.tv_sec << " "
+                    << st.st_mtim.tv_nsec << " " << st.st_ctim.tv_sec << " " << st.st_ctim.tv_nsec
+                    << " not-really-a-hash second" << std::endl;
+            }
+
+            {
+                SafeIFStream s(second);
+                TEST_CHECK_EQUAL(hashes->get<MD5>(second, s), "not-really-a-hash");
+            }
+
+            /* and then died half way through writing another record */
+            {
+                SafeOFStream s(cache, O_WRONLY | O_APPEND);
+                s << "md5 " << st.st_size << " " << st.st_ino;
+            }
+
+            /* changing the file invalidates it */
+            {
+                SafeOFStream s(second);
+                s << "ghi";
+            }
+
+            {
+                SafeIFStream s(second);
+                TEST_CHECK_EQUAL(hashes->get<MD5>(second, s), "826bbc5d0522f5f20a1da4b60fa8c871");
+            }
+
+            {
+                SafeIFStream s(cache);
+                contents = std::string((std::istreambuf_iterator<char>(s)), std::istreambuf_iterator<char>());
+            }
+            TEST_CHECK_EQUAL(std::count(contents.begin(), contents.end(), '\n'), 5);
+            TEST_CHECK(std::string::npos != contents.find("826bbc5d0522f5f20a1da4b60fa8c871 second\n"));
+            TEST_CHECK_EQUAL(contents.find("md5 " + stringify(st.st_size) + " " + stringify(st.st_ino) + "md5"), std::string::npos);
+
+            /* a cache that other people can write to isn't trusted */
+            FSEntry third(dir / "untrusted" / "third"), untrusted_cache(dir / "untrusted" / ".paludis-hashes-cache");
+            TEST_CHECK(0 == ::stat(stringify(third).c_str(), &st));
+            {
+                SafeOFStream s(untrusted_cache);
+                s << "paludis-hashes-2" << std::endl;
+                s << "md5 " << st.st_size << " " << st.st_ino << " " << st.st_mtim.tv_sec << " "
+                    << st.st_mtim.tv_nsec << " " << st.st_ctim.tv_sec << " " << st.st_ctim.tv_nsec
+                    << " not-really-a-hash third" << std::endl;
+            }
+            TEST_CHECK(0 == ::chmod(stringify(untrusted_cache).c_str(), 0666));
+
+            {
+                SafeIFStream s(third);
+                TEST_CHECK_EQUAL(hashes->get<MD5>(third, s), "900150983cd24fb0d6963f7d28e17f72");
+            }
+        }
+    } test_memoised_hashes;
+}
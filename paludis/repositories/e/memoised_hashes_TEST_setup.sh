@@ -0,0 +1,10 @@
+#!/usr/bin/env bash
+# vim: set ft=sh sw=4 sts=4 et :
+
+mkdir memoised_hashes_TEST_dir || exit 1
+cd memoised_hashes_TEST_dir || exit 1
+
+echo -n abc > first || exit 1
+echo -n def > second || exit 1
+mkdir untrusted || exit 1
+echo -n abc > untrusted/third || exit 1
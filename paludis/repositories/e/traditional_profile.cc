@@ -75,6 +75,38 @@ namespace
     typedef std::tr1::unordered_map<ChoiceNameWithPrefix, bool, Hash<ChoiceNameWithPrefix> > FlagStatusMap;
     typedef std::list<std::pair<std::tr1::shared_ptr<const PackageDepSpec>, FlagStatusMap> > PackageFlagStatusMapList;
 
+    /* a PackageFlagStatusMapList entry, along with its position in the file */
+    typedef std::vector<std::pair<unsigned, const PackageFlagStatusMapList::value_type *> > PackageFlagStatusEntries;
+
+    /* lets us find the PackageFlagStatusMapList entries that could match a
+     * given package without trying every spec against it */
+    struct PackageFlagStatusIndex
+    {
+        unsigned size;
+        std::tr1::unordered_map<QualifiedPackageName, PackageFlagStatusEntries, Hash<QualifiedPackageName> > by_name;
+        PackageFlagStatusEntries unnamed;
+
+        PackageFlagStatusIndex() :
+            size(0)
+        {
+        }
+    };
+
+    /* the level at which a flag was last set, and what it was set to */
+    typedef std::tr1::unordered_map<ChoiceNameWithPrefix, std::pair<unsigned, bool>, Hash<ChoiceNameWithPrefix> > FlagLevelMap;
+
+    struct PackageFlagLevels
+    {
+        FlagLevelMap use;
+        FlagLevelMap use_mask;
+        FlagLevelMap use_force;
+    };
+
+    typedef std::tr1::unordered_map<
+        std::tr1::shared_ptr<const PackageID>,
+        std::tr1::shared_ptr<const PackageFlagLevels>,
+        Hash<std::tr1::shared_ptr<const PackageID> > > PackageFlagLevelsMap;
+
     struct StackedValues
     {
         std::string origin;
@@ -84,6 +116,9 @@ namespace
         PackageFlagStatusMapList package_use;
         PackageFlagStatusMapList package_use_mask;
         PackageFlagStatusMapList package_use_force;
+        PackageFlagStatusIndex package_use_index;
+        PackageFlagStatusIndex package_use_mask_index;
+        PackageFlagStatusIndex package_use_force_index;
 
         StackedValues(const std::string & o) :
             origin(o)
@@ -112,13 +147,15 @@ namespace paludis
             void load_profile_make_defaults(const FSEntry & dir);
 
             void load_basic_use_file(const FSEntry & file, FlagStatusMap & m);
-            void load_spec_use_file(const EAPI &, const FSEntry & file, PackageFlagStatusMapList & m);
+            void load_spec_use_file(const EAPI &, const FSEntry & file, PackageFlagStatusMapList & m,
+                    PackageFlagStatusIndex & index);
 
             void add_use_expand_to_use();
             void fish_out_use_expand_names();
             void make_vars_from_file_vars();
             void handle_profile_arch_var(const std::string &);
             void load_special_make_defaults_vars(const FSEntry &);
+            void make_flag_levels();
 
             ProfileFile<LineConfigFile> packages_file;
             ProfileFile<LineConfigFile> virtuals_file;
@@ -173,6 +210,13 @@ namespace paludis
             mutable Mutex known_choice_value_names_for_separator_mutex;
             mutable std::tr1::unordered_map<char, KnownMap> known_choice_value_names_for_separator;
             StackedValuesList stacked_values_list;
+            FlagLevelMap use_mask_levels;
+            FlagLevelMap use_force_levels;
+            mutable Mutex package_flag_levels_mutex;
+            mutable PackageFlagLevelsMap package_flag_levels;
+
+            const std::tr1::shared_ptr<const PackageFlagLevels> flag_levels_for(
+                    const std::tr1::shared_ptr<const PackageID> &) const;
 
             ///\}
 
@@ -231,6 +275,7 @@ namespace paludis
                 fish_out_use_expand_names();
                 if (! arch_var_if_special.empty())
                     handle_profile_arch_var(arch_var_if_special);
+                make_flag_levels();
             }
 
             ~Implementation()
@@ -274,9 +319,12 @@ Implementation<TraditionalProfile>::load_profile_directory_recursively(const FSE
 
     load_basic_use_file(dir / "use.mask", stacked_values_list.back().use_mask);
     load_basic_use_file(dir / "use.force", stacked_values_list.back().use_force);
-    load_spec_use_file(*eapi, dir / "package.use", stacked_values_list.back().package_use);
-    load_spec_use_file(*eapi, dir / "package.use.mask", stacked_values_list.back().package_use_mask);
-    load_spec_use_file(*eapi, dir / "package.use.force", stacked_values_list.back().package_use_force);
+    load_spec_use_file(*eapi, dir / "package.use", stacked_values_list.back().package_use,
+            stacked_values_list.back().package_use_index);
+    load_spec_use_file(*eapi, dir / "package.use.mask", stacked_values_list.back().package_use_mask,
+            stacked_values_list.back().package_use_mask_index);
+    load_spec_use_file(*eapi, dir / "package.use.force", stacked_values_list.back().package_use_force,
+            stacked_values_list.back().package_use_force_index);
 
     packages_file.add_file(dir / "packages");
     if ((*DistributionData::get_instance()->distribution_from_string(env->distribution())).support_old_style_virtuals())
@@ -701,7 +749,8 @@ Implementation<TraditionalProfile>::load_basic_use_file(const FSEntry & file, Fl
 }
 
 void
-Implementation<TraditionalProfile>::load_spec_use_file(const EAPI & eapi, const FSEntry & file, PackageFlagStatusMapList & m)
+Implementation<TraditionalProfile>::load_spec_use_file(const EAPI & eapi, const FSEntry & file, PackageFlagStatusMapList & m,
+        PackageFlagStatusIndex & index)
 {
     if (! file.exists())
         return;
@@ -724,6 +773,10 @@ Implementation<TraditionalProfile>::load_spec_use_file(const EAPI & eapi, const
                             eapi.supported()->version_spec_options(),
                             std::tr1::shared_ptr<const PackageID>())));
             PackageFlagStatusMapList::iterator n(m.insert(m.end(), std::make_pair(spec, FlagStatusMap())));
+            if (spec->package_ptr())
+                index.by_name[*spec->package_ptr()].push_back(std::make_pair(index.size++, &*n));
+            else
+                index.unnamed.push_back(std::make_pair(index.size++, &*n));
 
             for (std::list<std::string>::const_iterator t(next(tokens.begin())), t_end(tokens.end()) ;
                     t != t_end ; ++t)
@@ -830,6 +883,93 @@ Implementation<TraditionalProfile>::handle_profile_arch_var(const std::string &
     }
 }
 
+namespace
+{
+    void add_flag_levels(FlagLevelMap & result, const FlagStatusMap & m, const unsigned level)
+    {
+        for (FlagStatusMap::const_iterator f(m.begin()), f_end(m.end()) ;
+                f != f_end ; ++f)
+            result[f->first] = std::make_pair(level, f->second);
+    }
+
+    void add_matching_flag_levels(FlagLevelMap & result, const Environment & env, const PackageID & id,
+            const PackageFlagStatusIndex & index, const unsigned level)
+    {
+        static const PackageFlagStatusEntries no_entries;
+
+        std::tr1::unordered_map<QualifiedPackageName, PackageFlagStatusEntries, Hash<QualifiedPackageName> >::const_iterator
+            n(index.by_name.find(id.name()));
+        const PackageFlagStatusEntries & named(index.by_name.end() == n ? no_entries : n->second);
+
+        /* later lines override earlier ones, so go through both lists in
+         * file order */
+        for (PackageFlagStatusEntries::const_iterator a(named.begin()), a_end(named.end()),
+                b(index.unnamed.begin()), b_end(index.unnamed.end()) ; a != a_end || b != b_end ; )
+        {
+            const PackageFlagStatusMapList::value_type * e;
+            if (b == b_end || (a != a_end && a->first < b->first))
+                e = (a++)->second;
+            else
+                e = (b++)->second;
+
+            if (match_package(env, *e->first, id, MatchPackageOptions()))
+                add_flag_levels(result, e->second, level);
+        }
+    }
+
+    bool last_set(const FlagLevelMap & global, const FlagLevelMap & package,
+            const ChoiceNameWithPrefix & f, bool & result)
+    {
+        /* at any given level, package entries override global ones */
+        FlagLevelMap::const_iterator g(global.find(f)), p(package.find(f));
+        if (package.end() != p && (global.end() == g || p->second.first >= g->second.first))
+            result = p->second.second;
+        else if (global.end() != g)
+            result = g->second.second;
+        else
+            return false;
+
+        return true;
+    }
+}
+
+void
+Implementation<TraditionalProfile>::make_flag_levels()
+{
+    unsigned level(0);
+    for (StackedValuesList::const_iterator i(stacked_values_list.begin()), i_end(stacked_values_list.end()) ;
+            i != i_end ; ++i, ++level)
+    {
+        add_flag_levels(use_mask_levels, i->use_mask, level);
+        add_flag_levels(use_force_levels, i->use_force, level);
+    }
+}
+
+const std::tr1::shared_ptr<const PackageFlagLevels>
+Implementation<TraditionalProfile>::flag_levels_for(const std::tr1::shared_ptr<const PackageID> & id) const
+{
+    {
+        Lock l(package_flag_levels_mutex);
+        PackageFlagLevelsMap::const_iterator i(package_flag_levels.find(id));
+        if (package_flag_levels.end() != i)
+            return i->second;
+    }
+
+    /* don't hold the lock whilst matching, since matching can need choices */
+    std::tr1::shared_ptr<PackageFlagLevels> result(new PackageFlagLevels);
+    unsigned level(0);
+    for (StackedValuesList::const_iterator i(stacked_values_list.begin()), i_end(stacked_values_list.end()) ;
+            i != i_end ; ++i, ++level)
+    {
+        add_matching_flag_levels(result->use, *env, *id, i->package_use_index, level);
+        add_matching_flag_levels(result->use_mask, *env, *id, i->package_use_mask_index, level);
+        add_matching_flag_levels(result->use_force, *env, *id, i->package_use_force_index, level);
+    }
+
+    Lock l(package_flag_levels_mutex);
+    return package_flag_levels.insert(std::make_pair(id, result)).first->second;
+}
+
 TraditionalProfile::TraditionalProfile(
         const Environment * const env, const ERepository * const p, const RepositoryName & name,
         const FSEntrySequence & location,
@@ -863,25 +1003,7 @@ TraditionalProfile::use_masked(
         return true;
 
     bool result(false);
-    for (StackedValuesList::const_iterator i(_imp->stacked_values_list.begin()),
-            i_end(_imp->stacked_values_list.end()) ; i != i_end ; ++i)
-    {
-        FlagStatusMap::const_iterator f(i->use_mask.find(value_prefixed));
-        if (i->use_mask.end() != f)
-            result = f->second;
-
-        for (PackageFlagStatusMapList::const_iterator g(i->package_use_mask.begin()),
-                g_end(i->package_use_mask.end()) ; g != g_end ; ++g)
-        {
-            if (! match_package(*_imp->env, *g->first, *id, MatchPackageOptions()))
-                continue;
-
-            FlagStatusMap::const_iterator h(g->second.find(value_prefixed));
-            if (g->second.end() != h)
-                result = h->second;
-        }
-    }
-
+    last_set(_imp->use_mask_levels, _imp->flag_levels_for(id)->use_mask, value_prefixed, result);
     return result;
 }
 
@@ -899,25 +1021,7 @@ TraditionalProfile::use_forced(
         return true;
 
     bool result(false);
-    for (StackedValuesList::const_iterator i(_imp->stacked_values_list.begin()),
-            i_end(_imp->stacked_values_list.end()) ; i != i_end ; ++i)
-    {
-        FlagStatusMap::const_iterator f(i->use_force.find(value_prefixed));
-        if (i->use_force.end() != f)
-            result = f->second;
-
-        for (PackageFlagStatusMapList::const_iterator g(i->package_use_force.begin()),
-                g_end(i->package_use_force.end()) ; g != g_end ; ++g)
-        {
-            if (! match_package(*_imp->env, *g->first, *id, MatchPackageOptions()))
-                continue;
-
-            FlagStatusMap::const_iterator h(g->second.find(value_prefixed));
-            if (g->second.end() != h)
-                result = h->second;
-        }
-    }
-
+    last_set(_imp->use_force_levels, _imp->flag_levels_for(id)->use_force, value_prefixed, result);
     return result;
 }
 
@@ -929,25 +1033,13 @@ TraditionalProfile::use_state_ignoring_masks(
         const ChoiceNameWithPrefix & value_prefixed
         ) const
 {
-    std::pair<ChoicePrefixName, UnprefixedChoiceName> prefix_value(choice->prefix(), value_unprefixed);
-    Tribool result(_imp->use.end() != _imp->use.find(prefix_value) ? Tribool(true) : Tribool(indeterminate));
+    const std::tr1::shared_ptr<const PackageFlagLevels> levels(_imp->flag_levels_for(id));
+    FlagLevelMap::const_iterator f(levels->use.find(value_prefixed));
+    if (levels->use.end() != f)
+        return f->second.second ? true : false;
 
-    for (StackedValuesList::const_iterator i(_imp->stacked_values_list.begin()),
-            i_end(_imp->stacked_values_list.end()) ; i != i_end ; ++i)
-    {
-        for (PackageFlagStatusMapList::const_iterator g(i->package_use.begin()),
-                g_end(i->package_use.end()) ; g != g_end ; ++g)
-        {
-            if (! match_package(*_imp->env, *g->first, *id, MatchPackageOptions()))
-                continue;
-
-            FlagStatusMap::const_iterator h(g->second.find(value_prefixed));
-            if (g->second.end() != h)
-                result = h->second ? true : false;
-        }
-    }
-
-    return result;
+    std::pair<ChoicePrefixName, UnprefixedChoiceName> prefix_value(choice->prefix(), value_unprefixed);
+    return _imp->use.end() != _imp->use.find(prefix_value) ? Tribool(true) : Tribool(indeterminate);
 }
 
 namespace
@@ -985,8 +1077,9 @@ TraditionalProfile::known_choice_value_names(
     if (_imp->known_choice_value_names_for_separator.end() == it)
         it = _imp->known_choice_value_names_for_separator.insert(std::make_pair(separator, KnownMap())).first;
 
+    const std::string raw_name(choice->raw_name());
     std::string lower_x;
-    std::transform(choice->raw_name().begin(), choice->raw_name().end(), std::back_inserter(lower_x), &::tolower);
+    std::transform(raw_name.begin(), raw_name.end(), std::back_inserter(lower_x), &::tolower);
     KnownMap::const_iterator it2(it->second.find(lower_x));
     if (it->second.end() == it2)
     {
@@ -142,18 +142,14 @@ VDBMerger::record_install_file(const FSEntry & src, const FSEntry & dst_dir, con
             tidy_real(stringify((dst_dir / src.basename()).strip_leading(_imp->realroot)));
     Timestamp timestamp((dst_dir / dst_name).mtim());
 
-    SafeIFStream infile(FSEntry(dst_dir / dst_name));
-    if (! infile)
-        throw MergerError("Cannot read '" + stringify(FSEntry(dst_dir / dst_name)) + "'");
-
-    MD5 md5(infile);
+    std::string md5(installed_file_md5(dst_dir / dst_name));
 
     std::string line(make_arrows(flags) + " [obj] " + tidy_real);
     if (tidy_real != tidy)
         line.append(" (" + FSEntry(tidy).basename() + ")");
     display_override(line);
 
-    *_imp->contents_file << "obj " << tidy_real << " " << md5.hexsum() << " " << timestamp.seconds() << std::endl;
+    *_imp->contents_file << "obj " << tidy_real << " " << md5 << " " << timestamp.seconds() << std::endl;
 }
 
 void
@@ -25,9 +25,12 @@
 #include <paludis/util/make_shared_ptr.hh>
 #include <paludis/util/safe_ifstream.hh>
 #include <paludis/util/set.hh>
+#include <paludis/util/tokeniser.hh>
 #include <paludis/standard_output_manager.hh>
 #include <test/test_framework.hh>
 #include <test/test_runner.hh>
+#include <vector>
+#include <map>
 
 using namespace paludis;
 using namespace test;
@@ -75,7 +78,7 @@ namespace
 
         protected:
 
-            VDBMergerTest(const std::string & what) :
+            VDBMergerTest(const std::string & what, const MergerOptions & o = MergerOptions() + mo_rewrite_symlinks + mo_allow_empty_dirs) :
                 TestCase("merge '" + what + "' test"),
                 root_dir(FSEntry::cwd() / "vdb_merger_TEST_dir" / what / "root"),
                 target(what),
@@ -87,7 +90,7 @@ namespace
                             value_for<n::fix_mtimes_before>(Timestamp(0, 0)),
                             value_for<n::image>(FSEntry::cwd() / "vdb_merger_TEST_dir" / what / "image"),
                             value_for<n::merged_entries>(make_shared_ptr(new FSEntrySet)),
-                            value_for<n::options>(MergerOptions() + mo_rewrite_symlinks + mo_allow_empty_dirs),
+                            value_for<n::options>(o),
                             value_for<n::output_manager>(make_shared_ptr(new StandardOutputManager)),
                             value_for<n::package_id>(std::tr1::shared_ptr<PackageID>()),
                             value_for<n::root>(root_dir)
@@ -251,5 +254,36 @@ namespace test_cases
             TEST_CHECK_THROWS(merger.check(), MergerError);
         }
     } test_vdb_merger_sym_arrow2;
+
+    struct VDBMergerTestNondestructive : VDBMergerTest
+    {
+        VDBMergerTestNondestructive() : VDBMergerTest("nondestructive",
+                MergerOptions() + mo_rewrite_symlinks + mo_allow_empty_dirs + mo_nondestructive) { }
+
+        void run()
+        {
+            TEST_CHECK(merger.check());
+            merger.merge();
+
+            TEST_CHECK((FSEntry::cwd() / "vdb_merger_TEST_dir" / "nondestructive" / "image" / "big").is_regular_file());
+            TEST_CHECK((root_dir / "big").is_regular_file());
+
+            std::map<std::string, std::string> md5s;
+            SafeIFStream contents(FSEntry::cwd() / "vdb_merger_TEST_dir/CONTENTS/nondestructive");
+            std::string line;
+            while (std::getline(contents, line))
+            {
+                std::vector<std::string> tokens;
+                tokenise_whitespace(line, std::back_inserter(tokens));
+                if (tokens.size() == 4 && tokens[0] == "obj")
+                    md5s[tokens[1]] = tokens[2];
+            }
+
+            TEST_CHECK_EQUAL(md5s.size(), 3u);
+            TEST_CHECK_EQUAL(md5s["/empty"], "d41d8cd98f00b204e9800998ecf8427e");
+            TEST_CHECK_EQUAL(md5s["/small"], "d3b07384d113edec49eaa6238ad5ff00");
+            TEST_CHECK_EQUAL(md5s["/big"], "5f677f81f41fabbecdf55818ce258293");
+        }
+    } test_vdb_merger_nondestructive;
 }
 
@@ -84,6 +84,11 @@ mkdir -p sym_arrow2_dir/{image,root} || exit 4
 mkdir sym_arrow2_dir/image/"dir -> ectory" || exit 5
 ln -s bar sym_arrow2_dir/image/"dir -> ectory/sym" || exit 5
 
+mkdir -p nondestructive_dir/{image,root} || exit 4
+touch nondestructive_dir/image/empty || exit 5
+echo foo > nondestructive_dir/image/small || exit 5
+yes abcdefghij | head -c 300000 > nondestructive_dir/image/big || exit 5
+
 
 for d in *_dir; do
     ln -s ${d} ${d%_dir}
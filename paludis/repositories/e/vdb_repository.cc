@@ -54,6 +54,7 @@
 #include <paludis/generator.hh>
 #include <paludis/filtered_generator.hh>
 #include <paludis/filter.hh>
+#include <paludis/owners_index.hh>
 
 #include <paludis/util/make_shared_ptr.hh>
 #include <paludis/util/dir_iterator.hh>
@@ -78,6 +79,7 @@
 #include <paludis/util/safe_ofstream.hh>
 #include <paludis/util/timestamp.hh>
 #include <paludis/util/destringify.hh>
+#include <paludis/util/iterator_funcs.hh>
 
 #include <paludis/util/private_implementation_pattern-impl.hh>
 #include <paludis/util/create_iterator-impl.hh>
@@ -92,6 +94,7 @@
 #include <map>
 #include <iostream>
 #include <cstring>
+#include <fcntl.h>
 #include <cerrno>
 
 using namespace paludis;
@@ -101,6 +104,18 @@ typedef std::tr1::unordered_map<CategoryNamePart, std::tr1::shared_ptr<Qualified
 typedef std::tr1::unordered_map<QualifiedPackageName, std::tr1::shared_ptr<PackageIDSequence>, Hash<QualifiedPackageName> > IDMap;
 typedef std::map<std::pair<QualifiedPackageName, VersionSpec>, std::tr1::shared_ptr<std::list<QualifiedPackageName> > > ProvidesMap;
 
+namespace
+{
+    void write_provides_cache_entry(std::ostream & f, const ProvidesMap::const_iterator & it)
+    {
+        f << "+ " << it->first.first << " " << it->first.second;
+        for (std::list<QualifiedPackageName>::const_iterator it2(it->second->begin()),
+                 it2_end(it->second->end()); it2_end != it2; ++it2)
+            f << " " << *it2;
+        f << std::endl;
+    }
+}
+
 namespace paludis
 {
     template <>
@@ -114,14 +129,23 @@ namespace paludis
         mutable bool has_category_names;
         mutable IDMap ids;
 
+        mutable std::map<CategoryNamePart, Timestamp> category_mtimes;
+
         mutable std::tr1::shared_ptr<RepositoryProvidesInterface::ProvidesSequence> provides;
         mutable std::tr1::shared_ptr<ProvidesMap> provides_map;
         mutable bool tried_provides_cache, used_provides_cache;
+        mutable bool provides_cache_appendable;
+        mutable unsigned provides_cache_records;
         std::tr1::shared_ptr<RepositoryNameCache> names_cache;
+        mutable std::tr1::shared_ptr<OwnersIndex> owners_index;
 
         Implementation(const VDBRepository * const, const VDBRepositoryParams &, std::tr1::shared_ptr<Mutex> = make_shared_ptr(new Mutex));
         ~Implementation();
 
+        FSEntry index_file() const;
+        FSEntry owners_index_file() const;
+        void record_category_mtime(const CategoryNamePart &) const;
+
         std::tr1::shared_ptr<const MetadataValueKey<FSEntry> > location_key;
         std::tr1::shared_ptr<const MetadataValueKey<FSEntry> > root_key;
         std::tr1::shared_ptr<const MetadataValueKey<std::string> > format_key;
@@ -138,6 +162,8 @@ namespace paludis
         has_category_names(false),
         tried_provides_cache(false),
         used_provides_cache(false),
+        provides_cache_appendable(false),
+        provides_cache_records(0),
         names_cache(new RepositoryNameCache(p.names_cache(), r)),
         location_key(new LiteralMetadataValueKey<FSEntry> ("location", "location",
                     mkt_significant, params.location())),
@@ -159,6 +185,30 @@ namespace paludis
     Implementation<VDBRepository>::~Implementation()
     {
     }
+
+    FSEntry
+    Implementation<VDBRepository>::index_file() const
+    {
+        return params.location() / ".cache" / "names_and_versions";
+    }
+
+    FSEntry
+    Implementation<VDBRepository>::owners_index_file() const
+    {
+        return params.location() / ".cache" / "owners";
+    }
+
+    void
+    Implementation<VDBRepository>::record_category_mtime(const CategoryNamePart & c) const
+    {
+        category_mtimes.erase(c);
+
+        /* we can't tell whether the target of a symlink has changed, so such
+         * categories are always rescanned */
+        FSEntry dir(params.location() / stringify(c));
+        if (dir.is_directory())
+            category_mtimes.insert(std::make_pair(c, dir.mtim()));
+    }
 }
 
 VDBRepository::VDBRepository(const VDBRepositoryParams & p) :
@@ -174,6 +224,7 @@ VDBRepository::VDBRepository(const VDBRepositoryParams & p) :
                 value_for<n::environment_variable_interface>(this),
                 value_for<n::make_virtuals_interface>(static_cast<RepositoryMakeVirtualsInterface *>(0)),
                 value_for<n::manifest_interface>(static_cast<RepositoryManifestInterface *>(0)),
+                value_for<n::owners_interface>(this),
                 value_for<n::provides_interface>(this),
                 value_for<n::virtuals_interface>(static_cast<RepositoryVirtualsInterface *>(0))
             )),
@@ -539,6 +590,9 @@ VDBRepository::perform_uninstall(
         }
     }
 
+    _imp->record_category_mtime(id->name().category());
+    write_index();
+
     if (! a.options.is_overwrite())
     {
         std::tr1::shared_ptr<const PackageIDSequence> ids(package_ids(id->name()));
@@ -556,8 +610,8 @@ VDBRepository::perform_uninstall(
 
     if (_imp->used_provides_cache || (! _imp->tried_provides_cache && load_provided_using_cache()))
     {
-        _imp->provides_map->erase(std::make_pair(id->name(), id->version()));
-        write_provides_cache();
+        if (0 != _imp->provides_map->erase(std::make_pair(id->name(), id->version())))
+            update_provides_cache(id->name(), id->version());
         _imp->provides.reset();
     }
 }
@@ -638,10 +692,14 @@ VDBRepository::load_provided_using_cache() const
     std::string version;
     std::getline(provides_cache, version);
 
-    if (version != "paludis-3")
+    /* paludis-3 has one line per entry. paludis-4 is a journal: each line
+     * either adds or replaces an entry ('+') or removes one ('-'), so
+     * merging and unmerging only have to append a line. */
+    bool journal(version == "paludis-4");
+    if ((! journal) && version != "paludis-3")
     {
         Log::get_instance()->message("e.vdb.provides_cache.unsupported", ll_warning, lc_no_context) << "Can't use provides cache at '"
-            << _imp->params.provides_cache() << "' because format '" << version << "' is not 'paludis-3'. Perhaps you need to regenerate "
+            << _imp->params.provides_cache() << "' because format '" << version << "' is not 'paludis-4'. Perhaps you need to regenerate "
             "the cache using 'paludis --regenerate-installed-cache'?";
         return false;
     }
@@ -656,35 +714,68 @@ VDBRepository::load_provided_using_cache() const
         return false;
     }
 
+    const VersionSpecOptions version_spec_options(EAPIData::get_instance()->eapi_from_string(
+                _imp->params.eapi_when_unknown())->supported()->version_spec_options());
+
     _imp->provides_map.reset(new ProvidesMap);
+    _imp->provides_cache_records = 0;
 
     std::string line;
+    std::vector<std::string> tokens;
     while (std::getline(provides_cache, line))
     {
         try
         {
-            std::vector<std::string> tokens;
+            ++_imp->provides_cache_records;
+
+            tokens.clear();
             tokenise_whitespace(line, std::back_inserter(tokens));
-            if (tokens.size() < 3)
+
+            bool remove(journal && (! tokens.empty()) && tokens[0] == "-");
+            if (journal)
+            {
+                if (tokens.empty() || (tokens[0] != "+" && ! remove))
+                {
+                    Log::get_instance()->message("e.vdb.provides_cache.malformed", ll_warning, lc_context)
+                        << "Not using PROVIDES cache line '" << line << "' as it does not start with '+' or '-'";
+                    continue;
+                }
+                tokens.erase(tokens.begin());
+            }
+
+            if (tokens.size() < (remove ? 2 : 3))
             {
                 Log::get_instance()->message("e.vdb.provides_cache.malformed", ll_warning, lc_context)
-                    << "Not using PROVIDES cache line '" << line << "' as it contains fewer than three tokens";
+                    << "Not using PROVIDES cache line '" << line << "' as it contains too few tokens";
                 continue;
             }
 
             QualifiedPackageName q(tokens.at(0));
-            VersionSpec v(tokens.at(1), EAPIData::get_instance()->eapi_from_string(
-                        _imp->params.eapi_when_unknown())->supported()->version_spec_options());
+            VersionSpec v(tokens.at(1), version_spec_options);
+
+            if (remove)
+            {
+                _imp->provides_map->erase(std::make_pair(q, v));
+                continue;
+            }
 
             std::tr1::shared_ptr<std::list<QualifiedPackageName> > qpns(new std::list<QualifiedPackageName>);
             std::copy(tokens.begin() + 2, tokens.end(), create_inserter<QualifiedPackageName>(
                         std::back_inserter(*qpns)));
 
-            if (_imp->provides_map->end() != _imp->provides_map->find(std::make_pair(q, v)))
+            ProvidesMap::iterator it(_imp->provides_map->find(std::make_pair(q, v)));
+            if (_imp->provides_map->end() == it)
+                _imp->provides_map->insert(std::make_pair(std::make_pair(q, v), qpns));
+            else if (journal)
+            {
+                /* a later entry for an equal version replaces the key too,
+                 * since 1.1 and 1.1-r0 are different packages on disk */
+                _imp->provides_map->erase(it);
+                _imp->provides_map->insert(std::make_pair(std::make_pair(q, v), qpns));
+            }
+            else
                 Log::get_instance()->message("e.vdb.provides_cache.duplicate", ll_warning, lc_context)
                     << "Not using PROVIDES cache line '" << line << "' as it names a package that has already been specified";
-            else
-                _imp->provides_map->insert(std::make_pair(std::make_pair(q, v), qpns));
         }
         catch (const InternalError &)
         {
@@ -698,6 +789,7 @@ VDBRepository::load_provided_using_cache() const
     }
 
     _imp->used_provides_cache = true;
+    _imp->provides_cache_appendable = journal;
     return true;
 }
 
@@ -800,25 +892,57 @@ VDBRepository::write_provides_cache() const
     {
         SafeOFStream f(_imp->params.provides_cache());
 
-        f << "paludis-3" << std::endl;
+        f << "paludis-4" << std::endl;
         f << name() << std::endl;
 
         for (ProvidesMap::const_iterator it(_imp->provides_map->begin()),
                  it_end(_imp->provides_map->end()); it_end != it; ++it)
-        {
-            f << it->first.first << " " << it->first.second;
-            for (std::list<QualifiedPackageName>::const_iterator it2(it->second->begin()),
-                     it2_end(it->second->end()); it2_end != it2; ++it2)
-                f << " " << *it2;
-            f << std::endl;
-        }
+            write_provides_cache_entry(f, it);
+    }
+    catch (const SafeOFStreamError & e)
+    {
+        Log::get_instance()->message("e.vdb.provides.write_failed", ll_warning, lc_context) << "Cannot write to '" <<
+                _imp->params.provides_cache() << "': '" << e.message() << "' (" << e.what() << ")";
+        _imp->provides_cache_appendable = false;
+        return;
+    }
+
+    _imp->provides_cache_appendable = true;
+    _imp->provides_cache_records = _imp->provides_map->size();
+}
+
+void
+VDBRepository::update_provides_cache(const QualifiedPackageName & q, const VersionSpec & v) const
+{
+    /* rewrite rather than append if the file isn't a journal we can trust,
+     * or if it's mostly made up of superseded lines */
+    if ((! _imp->provides_cache_appendable) || _imp->provides_cache_records > 2 * _imp->provides_map->size() + 16)
+    {
+        write_provides_cache();
+        return;
+    }
+
+    Context context("When updating provides cache at '" + stringify(_imp->params.provides_cache()) + "':");
+
+    try
+    {
+        SafeOFStream f(_imp->params.provides_cache(), O_WRONLY | O_APPEND | O_CLOEXEC);
+
+        ProvidesMap::const_iterator it(_imp->provides_map->find(std::make_pair(q, v)));
+        if (_imp->provides_map->end() == it)
+            f << "- " << q << " " << v << std::endl;
+        else
+            write_provides_cache_entry(f, it);
     }
     catch (const SafeOFStreamError & e)
     {
         Log::get_instance()->message("e.vdb.provides.write_failed", ll_warning, lc_context) << "Cannot write to '" <<
                 _imp->params.provides_cache() << "': '" << e.message() << "' (" << e.what() << ")";
+        _imp->provides_cache_appendable = false;
         return;
     }
+
+    ++_imp->provides_cache_records;
 }
 
 void
@@ -826,8 +950,56 @@ VDBRepository::regenerate_cache() const
 {
     Lock l(*_imp->big_nasty_mutex);
 
+    write_index();
     regenerate_provides_cache();
     _imp->names_cache->regenerate_cache();
+    update_owners_index(false);
+}
+
+void
+VDBRepository::update_owners_index(const bool create) const
+{
+    Lock l(*_imp->big_nasty_mutex);
+
+    /* building the index from scratch means loading every package's
+     * contents, so only do that when someone actually asks for owners */
+    if ((! _imp->owners_index) && (! create) && (! _imp->owners_index_file().exists()))
+        return;
+
+    if (! _imp->owners_index)
+        _imp->owners_index.reset(new OwnersIndex(_imp->owners_index_file(), "CONTENTS"));
+
+    /* installing, uninstalling or replacing anything creates, removes or
+     * renames a directory in its category directory */
+    const std::string stamp(OwnersIndex::directory_stamp(_imp->params.location(), 1));
+    if (_imp->owners_index->is_current(stamp))
+        return;
+
+    need_category_names();
+    const std::tr1::shared_ptr<PackageIDSequence> ids(new PackageIDSequence);
+    for (CategoryMap::const_iterator c(_imp->categories.begin()), c_end(_imp->categories.end()) ;
+            c != c_end ; ++c)
+    {
+        need_package_ids(c->first);
+        for (QualifiedPackageNameSet::ConstIterator q(c->second->begin()), q_end(c->second->end()) ;
+                q != q_end ; ++q)
+        {
+            IDMap::const_iterator i(_imp->ids.find(*q));
+            if (_imp->ids.end() != i)
+                std::copy(i->second->begin(), i->second->end(), ids->back_inserter());
+        }
+    }
+
+    _imp->owners_index->update(ids, stamp);
+}
+
+std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence>
+VDBRepository::owners(const std::string & pattern, const OwnersMatch m) const
+{
+    Lock l(*_imp->big_nasty_mutex);
+
+    update_owners_index(true);
+    return _imp->owners_index->owners(*this, pattern, m);
 }
 
 void
@@ -1042,12 +1214,24 @@ VDBRepository::merge(const MergeParams & m)
             ));
     post_merge_command();
 
+    /* we might have just created a new category, which we need to know
+     * about when writing the index */
+    if (_imp->has_category_names && _imp->categories.end() == _imp->categories.find(m.package_id()->name().category()))
+        _imp->categories.insert(std::make_pair(m.package_id()->name().category(), std::tr1::shared_ptr<QualifiedPackageNameSet>()));
+
+    _imp->record_category_mtime(m.package_id()->name().category());
+    write_index();
+
     _imp->names_cache->add(m.package_id()->name());
 
     if (_imp->used_provides_cache || (! _imp->tried_provides_cache && load_provided_using_cache()))
     {
+        bool had_entry(_imp->provides_map->end() != _imp->provides_map->find(
+                    std::make_pair(m.package_id()->name(), m.package_id()->version())));
         provides_from_package_id(*m.package_id());
-        write_provides_cache();
+        if (had_entry || _imp->provides_map->end() != _imp->provides_map->find(
+                    std::make_pair(m.package_id()->name(), m.package_id()->version())))
+            update_provides_cache(m.package_id()->name(), m.package_id()->version());
         _imp->provides.reset();
     }
 }
@@ -1060,6 +1244,12 @@ VDBRepository::need_category_names() const
     if (_imp->has_category_names)
         return;
 
+    if (load_index())
+    {
+        _imp->has_category_names = true;
+        return;
+    }
+
     Context context("When loading category names from '" + stringify(_imp->params.location()) + "':");
 
     for (DirIterator d(_imp->params.location(), DirIteratorOptions() + dio_inode_sort), d_end ; d != d_end ; ++d)
@@ -1095,6 +1285,10 @@ VDBRepository::need_package_ids(const CategoryNamePart & c) const
 
     std::tr1::shared_ptr<QualifiedPackageNameSet> q(new QualifiedPackageNameSet);
 
+    /* record the mtime before scanning, so that anything which changes
+     * whilst we're working makes the index look stale rather than wrong */
+    _imp->record_category_mtime(c);
+
     for (DirIterator d(_imp->params.location() / stringify(c), DirIteratorOptions() + dio_inode_sort), d_end ; d != d_end ; ++d)
         try
         {
@@ -1126,6 +1320,191 @@ VDBRepository::need_package_ids(const CategoryNamePart & c) const
     _imp->categories[c] = q;
 }
 
+bool
+VDBRepository::load_index() const
+{
+    Lock l(*_imp->big_nasty_mutex);
+
+    FSEntry index_file(_imp->index_file());
+    if (! index_file.is_regular_file())
+        return false;
+
+    Context context("When loading VDB index from '" + stringify(index_file) + "':");
+
+    std::vector<std::string> lines;
+    try
+    {
+        SafeIFStream f(index_file);
+        std::string data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        tokenise<delim_kind::AnyOfTag, delim_mode::DelimiterTag>(data, "\n", "", std::back_inserter(lines));
+    }
+    catch (const SafeIFStreamError & e)
+    {
+        Log::get_instance()->message("e.vdb.index.read_failed", ll_warning, lc_context) << "Cannot read '" <<
+                index_file << "': '" << e.message() << "' (" << e.what() << ")";
+        return false;
+    }
+
+    if (lines.size() < 3 || lines.at(0) != "paludis-vdb-index-1")
+    {
+        Log::get_instance()->message("e.vdb.index.unsupported", ll_debug, lc_context)
+            << "Not using index because it has an unsupported format";
+        return false;
+    }
+
+    if (lines.at(1) != stringify(name()))
+    {
+        Log::get_instance()->message("e.vdb.index.unusable", ll_warning, lc_context)
+            << "Not using index because it was generated for repository '" << lines.at(1) << "'";
+        return false;
+    }
+
+    CategoryMap categories;
+    IDMap ids;
+    std::map<CategoryNamePart, Timestamp> category_mtimes;
+
+    try
+    {
+        std::vector<std::string> tokens;
+        tokenise_whitespace(lines.at(2), std::back_inserter(tokens));
+        if (2 != tokens.size() || FSEntry(_imp->params.location()).mtim() !=
+                Timestamp(destringify<time_t>(tokens.at(0)), destringify<long>(tokens.at(1))))
+        {
+            Log::get_instance()->message("e.vdb.index.stale", ll_debug, lc_context)
+                << "Not using index because the list of categories has changed";
+            return false;
+        }
+
+        std::tr1::shared_ptr<CategoryNamePart> category;
+        std::tr1::shared_ptr<QualifiedPackageNameSet> names;
+        for (std::vector<std::string>::const_iterator line(next(lines.begin(), 3)), line_end(lines.end()) ;
+                line != line_end ; ++line)
+        {
+            tokens.clear();
+            tokenise_whitespace(*line, std::back_inserter(tokens));
+
+            if (4 == tokens.size() && "c" == tokens.at(0))
+            {
+                category.reset(new CategoryNamePart(tokens.at(1)));
+                names.reset();
+
+                FSEntry dir(_imp->params.location() / tokens.at(1));
+                Timestamp mtime(destringify<time_t>(tokens.at(2)), destringify<long>(tokens.at(3)));
+                if (dir.is_directory() && dir.mtim() == mtime)
+                {
+                    names.reset(new QualifiedPackageNameSet);
+                    category_mtimes.insert(std::make_pair(*category, mtime));
+                }
+                else
+                    Log::get_instance()->message("e.vdb.index.stale_category", ll_debug, lc_context)
+                        << "Not using index for category '" << *category << "' because it has changed";
+
+                categories.insert(std::make_pair(*category, names));
+            }
+            else if (3 == tokens.size() && "p" == tokens.at(0) && category)
+            {
+                if (! names)
+                    continue;
+
+                QualifiedPackageName q(*category, PackageNamePart(tokens.at(1)));
+                names->insert(q);
+
+                IDMap::iterator i(ids.find(q));
+                if (ids.end() == i)
+                    i = ids.insert(std::make_pair(q, make_shared_ptr(new PackageIDSequence))).first;
+                i->second->push_back(make_id(q, VersionSpec(tokens.at(2), user_version_spec_options()),
+                            _imp->params.location() / stringify(q.category()) / (tokens.at(1) + "-" + tokens.at(2))));
+            }
+            else
+                throw VDBRepositoryKeyReadError("Malformed index line '" + *line + "'");
+        }
+    }
+    catch (const InternalError &)
+    {
+        throw;
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("e.vdb.index.malformed", ll_warning, lc_context)
+            << "Not using index due to exception '" << e.message() << "' (" << e.what() << ")";
+        return false;
+    }
+
+    _imp->categories.swap(categories);
+    _imp->ids.swap(ids);
+    _imp->category_mtimes.swap(category_mtimes);
+    return true;
+}
+
+void
+VDBRepository::write_index() const
+{
+    Lock l(*_imp->big_nasty_mutex);
+
+    FSEntry index_file(_imp->index_file());
+
+    Context context("When writing VDB index to '" + stringify(index_file) + "':");
+
+    try
+    {
+        /* creating the cache directory changes the mtime of the location, so
+         * do that before we look at it */
+        index_file.dirname().mkdir();
+
+        Timestamp location_mtime(FSEntry(_imp->params.location()).mtim());
+
+        need_category_names();
+        for (CategoryMap::const_iterator c(_imp->categories.begin()), c_end(_imp->categories.end()) ;
+                c != c_end ; ++c)
+            need_package_ids(c->first);
+
+        FSEntry new_index_file(index_file.dirname() / ("-" + index_file.basename()));
+        {
+            SafeOFStream f(new_index_file);
+
+            f << "paludis-vdb-index-1" << std::endl;
+            f << name() << std::endl;
+            f << location_mtime.seconds() << " " << location_mtime.nanoseconds() << std::endl;
+
+            for (CategoryMap::const_iterator c(_imp->categories.begin()), c_end(_imp->categories.end()) ;
+                    c != c_end ; ++c)
+            {
+                std::map<CategoryNamePart, Timestamp>::const_iterator m(_imp->category_mtimes.find(c->first));
+                if (_imp->category_mtimes.end() == m)
+                {
+                    f << "c " << c->first << " 0 0" << std::endl;
+                    continue;
+                }
+
+                f << "c " << c->first << " " << m->second.seconds() << " " << m->second.nanoseconds() << std::endl;
+                for (QualifiedPackageNameSet::ConstIterator q(c->second->begin()), q_end(c->second->end()) ;
+                        q != q_end ; ++q)
+                {
+                    IDMap::const_iterator i(_imp->ids.find(*q));
+                    if (_imp->ids.end() == i)
+                        continue;
+
+                    for (PackageIDSequence::ConstIterator v(i->second->begin()), v_end(i->second->end()) ;
+                            v != v_end ; ++v)
+                        f << "p " << q->package() << " " << (*v)->version() << std::endl;
+                }
+            }
+        }
+
+        new_index_file.rename(index_file);
+    }
+    catch (const SafeOFStreamError & e)
+    {
+        Log::get_instance()->message("e.vdb.index.write_failed", ll_warning, lc_context) << "Cannot write to '" <<
+                index_file << "': '" << e.message() << "' (" << e.what() << ")";
+    }
+    catch (const FSError & e)
+    {
+        Log::get_instance()->message("e.vdb.index.write_failed", ll_warning, lc_context) << "Cannot write to '" <<
+                index_file << "': '" << e.message() << "' (" << e.what() << ")";
+    }
+}
+
 const std::tr1::shared_ptr<const ERepositoryID>
 VDBRepository::make_id(const QualifiedPackageName & q, const VersionSpec & v, const FSEntry & f) const
 {
@@ -1552,6 +1931,7 @@ VDBRepository::perform_updates()
         if ((! moves.empty()) || (! slot_moves.empty()))
         {
             invalidate();
+            write_index();
 
             if (_imp->params.provides_cache() != FSEntry("/var/empty"))
                 if (_imp->params.provides_cache().is_regular_file_or_symlink_to_regular_file())
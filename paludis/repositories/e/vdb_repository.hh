@@ -76,6 +76,7 @@ namespace paludis
     class PALUDIS_VISIBLE VDBRepository :
         public erepository::EInstalledRepository,
         public RepositoryProvidesInterface,
+        public RepositoryOwnersInterface,
         public std::tr1::enable_shared_from_this<VDBRepository>,
         public PrivateImplementationPattern<VDBRepository>
     {
@@ -88,11 +89,17 @@ namespace paludis
             void load_provided_the_slow_way() const;
 
             void write_provides_cache() const;
+            void update_provides_cache(const QualifiedPackageName &, const VersionSpec &) const;
             void regenerate_provides_cache() const;
 
+            void update_owners_index(const bool create) const;
+
             void need_category_names() const;
             void need_package_ids(const CategoryNamePart &) const;
 
+            bool load_index() const;
+            void write_index() const;
+
             const std::tr1::shared_ptr<const erepository::ERepositoryID> package_id_if_exists(const QualifiedPackageName &,
                     const VersionSpec &) const
                 PALUDIS_ATTRIBUTE((warn_unused_result));
@@ -130,6 +137,12 @@ namespace paludis
             virtual std::tr1::shared_ptr<const ProvidesSequence> provided_packages() const
                 PALUDIS_ATTRIBUTE((warn_unused_result));
 
+            /* RepositoryOwnersInterface */
+
+            virtual std::tr1::shared_ptr<const OwnersSequence> owners(
+                    const std::string &, const OwnersMatch) const
+                PALUDIS_ATTRIBUTE((warn_unused_result));
+
             /* RepositoryDestinationInterface */
 
             virtual void merge(const MergeParams &);
@@ -29,6 +29,7 @@
 #include <paludis/util/make_named_values.hh>
 #include <paludis/standard_output_manager.hh>
 #include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/safe_ofstream.hh>
 #include <paludis/generator.hh>
 #include <paludis/filter.hh>
 #include <paludis/filtered_generator.hh>
@@ -132,6 +133,61 @@ namespace test_cases
         }
     } test_vdb_repository_has_category_named;
 
+    struct VDBRepositoryIndexTest : TestCase
+    {
+        VDBRepositoryIndexTest() : TestCase("index") { }
+
+        bool repeatable() const
+        {
+            return false;
+        }
+
+        std::string ids_for(const Environment & env, const std::string & q)
+        {
+            std::tr1::shared_ptr<const PackageIDSequence> ids(env[selection::AllVersionsSorted(
+                        generator::Package(QualifiedPackageName(q)) & generator::InRepository(RepositoryName("installed")))]);
+            return join(indirect_iterator(ids->begin()), indirect_iterator(ids->end()), " ");
+        }
+
+        void run()
+        {
+            TestEnvironment env;
+            env.set_paludis_command("/bin/false");
+            std::tr1::shared_ptr<Map<std::string, std::string> > keys(
+                    new Map<std::string, std::string>);
+            keys->insert("format", "vdb");
+            keys->insert("names_cache", "/var/empty");
+            keys->insert("provides_cache", "/var/empty");
+            keys->insert("location", stringify(FSEntry::cwd() / "vdb_repository_TEST_dir" / "indextest"));
+            keys->insert("builddir", stringify(FSEntry::cwd() / "vdb_repository_TEST_dir" / "build"));
+            std::tr1::shared_ptr<Repository> repo(VDBRepository::VDBRepository::repository_factory_create(&env,
+                        std::tr1::bind(from_keys, keys, std::tr1::placeholders::_1)));
+            env.package_database()->add_repository(0, repo);
+
+            FSEntry index(FSEntry::cwd() / "vdb_repository_TEST_dir" / "indextest" / ".cache" / "names_and_versions");
+            TEST_CHECK(! index.exists());
+
+            repo->regenerate_cache();
+            TEST_CHECK(FSEntry(stringify(index)).is_regular_file());
+
+            repo->invalidate();
+            TEST_CHECK_EQUAL(ids_for(env, "cat-one/pkg-both"), "cat-one/pkg-both-1::installed");
+            TEST_CHECK_EQUAL(ids_for(env, "cat-two/pkg-both"), "cat-two/pkg-both-2::installed");
+            TEST_CHECK(! repo->has_category_named(CategoryNamePart("cat-three")));
+
+            FSEntry(FSEntry::cwd() / "vdb_repository_TEST_dir" / "indextest" / "cat-one" / "pkg-both-3").mkdir();
+            repo->invalidate();
+            TEST_CHECK_EQUAL(ids_for(env, "cat-one/pkg-both"), "cat-one/pkg-both-1::installed cat-one/pkg-both-3::installed");
+            TEST_CHECK_EQUAL(ids_for(env, "cat-two/pkg-both"), "cat-two/pkg-both-2::installed");
+
+            FSEntry(FSEntry::cwd() / "vdb_repository_TEST_dir" / "indextest" / "cat-three").mkdir();
+            FSEntry(FSEntry::cwd() / "vdb_repository_TEST_dir" / "indextest" / "cat-three" / "pkg-three-1").mkdir();
+            repo->invalidate();
+            TEST_CHECK(repo->has_category_named(CategoryNamePart("cat-three")));
+            TEST_CHECK_EQUAL(ids_for(env, "cat-three/pkg-three"), "cat-three/pkg-three-1::installed");
+        }
+    } test_vdb_repository_index;
+
     struct VDBRepositoryQueryUseTest : TestCase
     {
         VDBRepositoryQueryUseTest() : TestCase("query USE") { }
@@ -258,6 +314,125 @@ namespace test_cases
         }
     } vdb_repository_contents_test;
 
+    struct VDBRepositoryOwnersTest : TestCase
+    {
+        VDBRepositoryOwnersTest() : TestCase("owners") { }
+
+        void run()
+        {
+            TestEnvironment env;
+            env.set_paludis_command("/bin/false");
+            std::tr1::shared_ptr<Map<std::string, std::string> > keys(new Map<std::string, std::string>);
+            keys->insert("format", "vdb");
+            keys->insert("names_cache", "/var/empty");
+            keys->insert("provides_cache", "/var/empty");
+            keys->insert("location", stringify(FSEntry::cwd() / "vdb_repository_TEST_dir" / "repo1"));
+            keys->insert("builddir", stringify(FSEntry::cwd() / "vdb_repository_TEST_dir" / "build"));
+            keys->insert("world", stringify(FSEntry::cwd() / "vdb_repository_TEST_dir" / "world-no-match-no-eol"));
+            std::tr1::shared_ptr<Repository> repo(VDBRepository::VDBRepository::repository_factory_create(&env,
+                        std::tr1::bind(from_keys, keys, std::tr1::placeholders::_1)));
+            env.package_database()->add_repository(1, repo);
+
+            TEST_CHECK(repo->owners_interface());
+
+            std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence> full(
+                    repo->owners_interface()->owners("/directory/file", om_full));
+            TEST_CHECK_EQUAL(std::distance(full->begin(), full->end()), 1);
+            TEST_CHECK_STRINGIFY_EQUAL(full->begin()->package_id()->name(), "cat-one/pkg-one");
+            TEST_CHECK_STRINGIFY_EQUAL(full->begin()->package_id()->version(), "1");
+            TEST_CHECK_STRINGIFY_EQUAL(full->begin()->path(), "/directory/file");
+            TEST_CHECK((FSEntry::cwd() / "vdb_repository_TEST_dir" / "repo1" / ".cache" / "owners").exists());
+
+            std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence> basename(
+                    repo->owners_interface()->owners("file", om_basename));
+            TEST_CHECK_EQUAL(std::distance(basename->begin(), basename->end()), 1);
+
+            std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence> partial(
+                    repo->owners_interface()->owners("fifo", om_partial));
+            TEST_CHECK_EQUAL(std::distance(partial->begin(), partial->end()), 3);
+
+            std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence> directory(
+                    repo->owners_interface()->owners("/directory", om_partial));
+            TEST_CHECK_EQUAL(std::distance(directory->begin(), directory->end()), 6);
+
+            std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence> middle(
+                    repo->owners_interface()->owners("ctory/fi", om_partial));
+            TEST_CHECK_EQUAL(std::distance(middle->begin(), middle->end()), 1);
+            TEST_CHECK_STRINGIFY_EQUAL(middle->begin()->path(), "/directory/file");
+
+            std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence> symlinks(
+                    repo->owners_interface()->owners("symlink", om_basename));
+            TEST_CHECK_EQUAL(std::distance(symlinks->begin(), symlinks->end()), 2);
+
+            std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence> none(
+                    repo->owners_interface()->owners("director", om_basename));
+            TEST_CHECK_EQUAL(std::distance(none->begin(), none->end()), 0);
+        }
+    } vdb_repository_owners_test;
+
+    struct VDBRepositoryOwnersUpdateTest : TestCase
+    {
+        VDBRepositoryOwnersUpdateTest() : TestCase("owners update") { }
+
+        std::tr1::shared_ptr<Repository> make_repo(TestEnvironment & env)
+        {
+            std::tr1::shared_ptr<Map<std::string, std::string> > keys(new Map<std::string, std::string>);
+            keys->insert("format", "vdb");
+            keys->insert("names_cache", "/var/empty");
+            keys->insert("provides_cache", "/var/empty");
+            keys->insert("location", stringify(FSEntry::cwd() / "vdb_repository_TEST_dir" / "owners"));
+            keys->insert("builddir", stringify(FSEntry::cwd() / "vdb_repository_TEST_dir" / "build"));
+            std::tr1::shared_ptr<Repository> repo(VDBRepository::VDBRepository::repository_factory_create(&env,
+                        std::tr1::bind(from_keys, keys, std::tr1::placeholders::_1)));
+            env.package_database()->add_repository(1, repo);
+            return repo;
+        }
+
+        void run()
+        {
+            {
+                TestEnvironment env;
+                std::tr1::shared_ptr<Repository> repo(make_repo(env));
+
+                std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence> old_file(
+                        repo->owners_interface()->owners("/old/file", om_full));
+                TEST_CHECK_EQUAL(std::distance(old_file->begin(), old_file->end()), 1);
+
+                std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence> new_file(
+                        repo->owners_interface()->owners("/new/file", om_full));
+                TEST_CHECK_EQUAL(std::distance(new_file->begin(), new_file->end()), 0);
+            }
+
+            FSEntry new_dir(FSEntry::cwd() / "vdb_repository_TEST_dir" / "owners" / "cat" / "new-1");
+            new_dir.mkdir();
+            {
+                SafeOFStream slot(new_dir / "SLOT"), eapi(new_dir / "EAPI"), contents(new_dir / "CONTENTS");
+                slot << "0" << std::endl;
+                eapi << "0" << std::endl;
+                contents << "dir /new" << std::endl << "obj /new/file 4 2" << std::endl;
+            }
+
+            {
+                TestEnvironment env;
+                std::tr1::shared_ptr<Repository> repo(make_repo(env));
+
+                std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence> new_file(
+                        repo->owners_interface()->owners("/new/file", om_full));
+                TEST_CHECK_EQUAL(std::distance(new_file->begin(), new_file->end()), 1);
+                TEST_CHECK_STRINGIFY_EQUAL(*new_file->begin()->package_id(), "cat/new-1:0::installed");
+
+                std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence> files(
+                        repo->owners_interface()->owners("file", om_basename));
+                TEST_CHECK_EQUAL(std::distance(files->begin(), files->end()), 2);
+            }
+        }
+
+        bool repeatable() const
+        {
+            return false;
+        }
+    } vdb_repository_owners_update_test;
+
     struct VDBRepositoryDependenciesRewriterTest : TestCase
     {
         VDBRepositoryDependenciesRewriterTest() : TestCase("dependencies_rewriter") { }
@@ -892,7 +1067,7 @@ namespace test_cases
             }
 
             vdb_repo->regenerate_cache();
-            TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-3\ninstalled\ncat1/pkg1 1 virtual/foo\ncat1/pkg1 2 virtual/foo\ncat1/pkg2 1 virtual/foo virtual/bar\ncat1/pkg2 2 virtual/bar\n");
+            TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-4\ninstalled\n+ cat1/pkg1 1 virtual/foo\n+ cat1/pkg1 2 virtual/foo\n+ cat1/pkg2 1 virtual/foo virtual/bar\n+ cat1/pkg2 2 virtual/bar\n");
             vdb_repo->invalidate();
 
             {
@@ -1027,7 +1202,7 @@ namespace test_cases
                 install(env, vdb_repo, "=cat1/pkg1-1::providesincrtest_src1", "");
                 vdb_repo->invalidate();
 
-                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-3\ninstalled\ncat1/pkg1 1 virtual/foo\n");
+                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-4\ninstalled\n+ cat1/pkg1 1 virtual/foo\n");
             }
 
             {
@@ -1035,7 +1210,7 @@ namespace test_cases
                 install(env, vdb_repo, "=cat1/pkg1-1::providesincrtest_src1", "");
                 vdb_repo->invalidate();
 
-                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-3\ninstalled\ncat1/pkg1 1 virtual/foo\n");
+                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-4\ninstalled\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/foo\n");
             }
 
             {
@@ -1043,7 +1218,7 @@ namespace test_cases
                 install(env, vdb_repo, "=cat1/pkg1-1.1::providesincrtest_src1", "=cat1/pkg1-1::installed");
                 vdb_repo->invalidate();
 
-                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-3\ninstalled\ncat1/pkg1 1.1 virtual/foo\n");
+                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-4\ninstalled\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/foo\n+ cat1/pkg1 1.1 virtual/foo\n- cat1/pkg1 1\n");
             }
 
             {
@@ -1051,7 +1226,7 @@ namespace test_cases
                 install(env, vdb_repo, "=cat1/pkg1-1.1::providesincrtest_src2", "");
                 vdb_repo->invalidate();
 
-                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-3\ninstalled\ncat1/pkg1 1.1-r0 virtual/foo\n");
+                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-4\ninstalled\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/foo\n+ cat1/pkg1 1.1 virtual/foo\n- cat1/pkg1 1\n- cat1/pkg1 1.1\n+ cat1/pkg1 1.1-r0 virtual/foo\n");
             }
 
             {
@@ -1059,7 +1234,7 @@ namespace test_cases
                 install(env, vdb_repo, "=cat1/pkg1-1::providesincrtest_src1", "=cat1/pkg1-1.1::installed");
                 vdb_repo->invalidate();
 
-                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-3\ninstalled\ncat1/pkg1 1 virtual/foo\n");
+                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-4\ninstalled\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/foo\n+ cat1/pkg1 1.1 virtual/foo\n- cat1/pkg1 1\n- cat1/pkg1 1.1\n+ cat1/pkg1 1.1-r0 virtual/foo\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1.1-r0\n");
             }
 
             {
@@ -1067,7 +1242,7 @@ namespace test_cases
                 install(env, vdb_repo, "=cat1/pkg1-1::providesincrtest_src2", "");
                 vdb_repo->invalidate();
 
-                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-3\ninstalled\ncat1/pkg1 1 virtual/bar\n");
+                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-4\ninstalled\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/foo\n+ cat1/pkg1 1.1 virtual/foo\n- cat1/pkg1 1\n- cat1/pkg1 1.1\n+ cat1/pkg1 1.1-r0 virtual/foo\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1.1-r0\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/bar\n");
             }
 
             {
@@ -1075,7 +1250,16 @@ namespace test_cases
                 install(env, vdb_repo, "=cat1/pkg1-2::providesincrtest_src1", "");
                 vdb_repo->invalidate();
 
-                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-3\ninstalled\ncat1/pkg1 1 virtual/bar\ncat1/pkg1 2 virtual/foo\n");
+                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-4\ninstalled\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/foo\n+ cat1/pkg1 1.1 virtual/foo\n- cat1/pkg1 1\n- cat1/pkg1 1.1\n+ cat1/pkg1 1.1-r0 virtual/foo\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1.1-r0\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/bar\n+ cat1/pkg1 2 virtual/foo\n");
+
+                std::tr1::shared_ptr<const RepositoryProvidesInterface::ProvidesSequence> seq(vdb_repo->provides_interface()->provided_packages());
+                TEST_CHECK_EQUAL(std::distance(seq->begin(), seq->end()), 2);
+                RepositoryProvidesInterface::ProvidesSequence::ConstIterator it(seq->begin());
+                TEST_CHECK_STRINGIFY_EQUAL(it->virtual_name(), "virtual/bar");
+                TEST_CHECK_STRINGIFY_EQUAL((*it++).provided_by()->version(), "1");
+                TEST_CHECK_STRINGIFY_EQUAL(it->virtual_name(), "virtual/foo");
+                TEST_CHECK_STRINGIFY_EQUAL((*it++).provided_by()->version(), "2");
+                vdb_repo->invalidate();
             }
 
             {
@@ -1086,7 +1270,7 @@ namespace test_cases
                 inst_id->perform_action(uninstall_action);
                 vdb_repo->invalidate();
 
-                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-3\ninstalled\ncat1/pkg1 1 virtual/bar\n");
+                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-4\ninstalled\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/foo\n+ cat1/pkg1 1.1 virtual/foo\n- cat1/pkg1 1\n- cat1/pkg1 1.1\n+ cat1/pkg1 1.1-r0 virtual/foo\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1.1-r0\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/bar\n+ cat1/pkg1 2 virtual/foo\n- cat1/pkg1 2\n");
             }
 
             {
@@ -1094,7 +1278,7 @@ namespace test_cases
                 install(env, vdb_repo, "=cat1/pkg2-1::providesincrtest_src1", "");
                 vdb_repo->invalidate();
 
-                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-3\ninstalled\ncat1/pkg1 1 virtual/bar\ncat1/pkg2 1 virtual/foo\n");
+                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-4\ninstalled\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/foo\n+ cat1/pkg1 1.1 virtual/foo\n- cat1/pkg1 1\n- cat1/pkg1 1.1\n+ cat1/pkg1 1.1-r0 virtual/foo\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1.1-r0\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/bar\n+ cat1/pkg1 2 virtual/foo\n- cat1/pkg1 2\n+ cat1/pkg2 1 virtual/foo\n");
             }
 
             {
@@ -1105,7 +1289,7 @@ namespace test_cases
                 inst_id->perform_action(uninstall_action);
                 vdb_repo->invalidate();
 
-                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-3\ninstalled\ncat1/pkg1 1 virtual/bar\n");
+                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-4\ninstalled\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/foo\n+ cat1/pkg1 1.1 virtual/foo\n- cat1/pkg1 1\n- cat1/pkg1 1.1\n+ cat1/pkg1 1.1-r0 virtual/foo\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1.1-r0\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/bar\n+ cat1/pkg1 2 virtual/foo\n- cat1/pkg1 2\n+ cat1/pkg2 1 virtual/foo\n- cat1/pkg2 1\n");
             }
 
             {
@@ -1116,7 +1300,7 @@ namespace test_cases
                 inst_id->perform_action(uninstall_action);
                 vdb_repo->invalidate();
 
-                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-3\ninstalled\n");
+                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-4\ninstalled\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/foo\n+ cat1/pkg1 1.1 virtual/foo\n- cat1/pkg1 1\n- cat1/pkg1 1.1\n+ cat1/pkg1 1.1-r0 virtual/foo\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1.1-r0\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/bar\n+ cat1/pkg1 2 virtual/foo\n- cat1/pkg1 2\n+ cat1/pkg2 1 virtual/foo\n- cat1/pkg2 1\n- cat1/pkg1 1\n");
             }
 
             {
@@ -1124,7 +1308,7 @@ namespace test_cases
                 install(env, vdb_repo, "=cat2/pkg1-1::providesincrtest_src1", "");
                 vdb_repo->invalidate();
 
-                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-3\ninstalled\ncat2/pkg1 1 virtual/moo\n");
+                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-4\ninstalled\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/foo\n+ cat1/pkg1 1.1 virtual/foo\n- cat1/pkg1 1\n- cat1/pkg1 1.1\n+ cat1/pkg1 1.1-r0 virtual/foo\n+ cat1/pkg1 1 virtual/foo\n- cat1/pkg1 1.1-r0\n- cat1/pkg1 1\n+ cat1/pkg1 1 virtual/bar\n+ cat1/pkg1 2 virtual/foo\n- cat1/pkg1 2\n+ cat1/pkg2 1 virtual/foo\n- cat1/pkg2 1\n- cat1/pkg1 1\n+ cat2/pkg1 1 virtual/moo\n");
             }
 
             {
@@ -1132,7 +1316,7 @@ namespace test_cases
                 install(env, vdb_repo, "=cat2/pkg1-2::providesincrtest_src1", "=cat2/pkg1-1::installed");
                 vdb_repo->invalidate();
 
-                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-3\ninstalled\ncat2/pkg1 2 virtual/moo\n");
+                TEST_CHECK_EQUAL(read_file(provides_cache), "paludis-4\ninstalled\n+ cat2/pkg1 2 virtual/moo\n");
             }
         }
 
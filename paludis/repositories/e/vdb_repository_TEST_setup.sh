@@ -9,6 +9,8 @@ mkdir -p build
 mkdir -p root/etc
 
 mkdir -p repo1/cat-{one/{pkg-one-1,pkg-both-1},two/{pkg-two-2,pkg-both-2}} || exit 1
+mkdir -p indextest/cat-{one/{pkg-one-1,pkg-both-1},two/{pkg-two-2,pkg-both-2}} || exit 1
+mkdir -p owners/cat/old-1 || exit 1
 
 for i in SLOT EAPI; do
     echo "0" >repo1/cat-one/pkg-one-1/${i}
@@ -60,6 +62,13 @@ sym -> bar 2
 sym foo -> 2
 END
 
+echo "0" >owners/cat/old-1/SLOT
+echo "0" >owners/cat/old-1/EAPI
+cat <<END >owners/cat/old-1/CONTENTS
+dir /old
+obj /old/file 4 2
+END
+
 touch "world-empty"
 cat <<END > world-no-match
 cat-one/foo
@@ -64,6 +64,7 @@ FakeInstalledRepository::FakeInstalledRepository(const FakeInstalledRepositoryPa
                 value_for<n::environment_variable_interface>(static_cast<RepositoryEnvironmentVariableInterface *>(0)),
                 value_for<n::make_virtuals_interface>(static_cast<RepositoryMakeVirtualsInterface *>(0)),
                 value_for<n::manifest_interface>(static_cast<RepositoryManifestInterface *>(0)),
+                value_for<n::owners_interface>(static_cast<RepositoryOwnersInterface *>(0)),
                 value_for<n::provides_interface>(this),
                 value_for<n::virtuals_interface>(static_cast<RepositoryVirtualsInterface *>(0))
                 )),
@@ -21,8 +21,10 @@
 #define PALUDIS_GUARD_PALUDIS_REPOSITORY_FWD_HH 1
 
 #include <paludis/util/set-fwd.hh>
+#include <paludis/util/attributes.hh>
 #include <paludis/repository-fwd.hh>
 #include <tr1/memory>
+#include <iosfwd>
 
 /** \file
  * Forward declarations for paludis/repository.hh .
@@ -45,6 +47,7 @@ namespace paludis
     class RepositoryMakeVirtualsInterface;
     class RepositoryDestinationInterface;
     class RepositoryManifestInterface;
+    class RepositoryOwnersInterface;
 
     /**
      * A set of destinations, used to decide whether a PackageID can be
@@ -55,6 +58,8 @@ namespace paludis
     typedef Set<std::tr1::shared_ptr<Repository> > DestinationsSet;
 
     struct MergeParams;
+
+#include <paludis/repository-se.hh>
 }
 
 #endif
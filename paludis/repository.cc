@@ -40,9 +40,13 @@
 #include <utility>
 #include <algorithm>
 #include <ctype.h>
+#include <istream>
+#include <ostream>
 
 using namespace paludis;
 
+#include <paludis/repository-se.cc>
+
 template class Set<std::tr1::shared_ptr<Repository> >;
 template class WrappedForwardIterator<Set<std::tr1::shared_ptr<Repository> >::ConstIteratorTag, const std::tr1::shared_ptr<Repository> >;
 template class WrappedOutputIterator<Set<std::tr1::shared_ptr<Repository> >::InserterTag, std::tr1::shared_ptr<Repository> >;
@@ -55,6 +59,10 @@ template class Sequence<RepositoryProvidesEntry>;
 template class WrappedForwardIterator<Sequence<RepositoryProvidesEntry>::ConstIteratorTag, const RepositoryProvidesEntry>;
 template class WrappedOutputIterator<Sequence<RepositoryProvidesEntry>::InserterTag, RepositoryProvidesEntry>;
 
+template class Sequence<RepositoryOwnersEntry>;
+template class WrappedForwardIterator<Sequence<RepositoryOwnersEntry>::ConstIteratorTag, const RepositoryOwnersEntry>;
+template class WrappedOutputIterator<Sequence<RepositoryOwnersEntry>::InserterTag, RepositoryOwnersEntry>;
+
 NoSuchSetError::NoSuchSetError(const std::string & our_name) throw () :
     Exception("Could not find '" + our_name + "'"),
     _name(our_name)
@@ -204,6 +212,10 @@ RepositoryManifestInterface::~RepositoryManifestInterface()
 {
 }
 
+RepositoryOwnersInterface::~RepositoryOwnersInterface()
+{
+}
+
 bool
 Repository::can_be_favourite_repository() const
 {
@@ -221,3 +233,8 @@ Repository::can_drop_in_memory_cache() const
 {
 }
 
+void
+Repository::prefetch_metadata(const std::tr1::shared_ptr<const PackageIDSequence> &) const
+{
+}
+
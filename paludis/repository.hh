@@ -67,6 +67,7 @@ namespace paludis
         struct merged_entries;
         struct options;
         struct output_manager;
+        struct owners_interface;
         struct package_id;
         struct path;
         struct perform_uninstall;
@@ -93,6 +94,12 @@ namespace paludis
         NamedValue<n::environment_variable_interface, RepositoryEnvironmentVariableInterface *> environment_variable_interface;
         NamedValue<n::make_virtuals_interface, RepositoryMakeVirtualsInterface *> make_virtuals_interface;
         NamedValue<n::manifest_interface, RepositoryManifestInterface *> manifest_interface;
+
+        /**
+         * \since 0.48
+         */
+        NamedValue<n::owners_interface, RepositoryOwnersInterface *> owners_interface;
+
         NamedValue<n::provides_interface, RepositoryProvidesInterface *> provides_interface;
         NamedValue<n::virtuals_interface, RepositoryVirtualsInterface *> virtuals_interface;
     };
@@ -125,6 +132,20 @@ namespace paludis
         NamedValue<n::virtual_name, QualifiedPackageName> virtual_name;
     };
 
+    /**
+     * An owners entry in a Repository implementing RepositoryOwnersInterface.
+     *
+     * \see Repository
+     * \see RepositoryOwnersInterface
+     * \ingroup g_repository
+     * \since 0.48
+     */
+    struct RepositoryOwnersEntry
+    {
+        NamedValue<n::package_id, std::tr1::shared_ptr<const PackageID> > package_id;
+        NamedValue<n::path, FSEntry> path;
+    };
+
     /**
      * Parameters for RepositoryDestinationInterface::merge.
      *
@@ -433,6 +454,18 @@ namespace paludis
              */
             virtual void can_drop_in_memory_cache() const;
 
+            /**
+             * Load or generate metadata for the given IDs, all of which must
+             * be ours, before it is needed.
+             *
+             * Repositories where metadata can be expensive to obtain may use
+             * this to do the work for several IDs at once. The default does
+             * nothing, and metadata is loaded on demand as usual.
+             *
+             * \since 0.48
+             */
+            virtual void prefetch_metadata(const std::tr1::shared_ptr<const PackageIDSequence> &) const;
+
             ///\}
 
             ///\name Set methods
@@ -552,6 +585,39 @@ namespace paludis
             virtual ~RepositoryProvidesInterface();
     };
 
+    /**
+     * Interface for repositories that can find which of their packages own
+     * a particular file without loading the contents of every package.
+     *
+     * \see Repository
+     * \ingroup g_repository
+     * \nosubgrouping
+     * \since 0.48
+     */
+    class PALUDIS_VISIBLE RepositoryOwnersInterface
+    {
+        public:
+            ///\name Owners functionality
+            ///\{
+
+            /**
+             * A collection of owned paths.
+             */
+            typedef Sequence<RepositoryOwnersEntry> OwnersSequence;
+
+            /**
+             * Fetch every path matching a pattern, along with the ID that
+             * owns it.
+             */
+            virtual std::tr1::shared_ptr<const OwnersSequence> owners(
+                    const std::string & pattern, const OwnersMatch) const
+                PALUDIS_ATTRIBUTE((warn_unused_result)) = 0;
+
+            ///\}
+
+            virtual ~RepositoryOwnersInterface();
+    };
+
     /**
      * Interface for repositories that can be used as an install destination.
      *
@@ -39,6 +39,7 @@
 #include <paludis/util/wrapped_output_iterator.hh>
 #include <paludis/util/enum_iterator.hh>
 #include <paludis/util/indirect_iterator-impl.hh>
+#include <paludis/util/save.hh>
 #include <paludis/environment.hh>
 #include <paludis/notifier_callback.hh>
 #include <paludis/repository.hh>
@@ -58,6 +59,8 @@
 #include <paludis/util/private_implementation_pattern-impl.hh>
 
 #include <algorithm>
+#include <iterator>
+#include <list>
 #include <map>
 #include <set>
 
@@ -65,6 +68,7 @@ using namespace paludis;
 using namespace paludis::resolver;
 
 typedef std::map<Resolvent, std::tr1::shared_ptr<Resolution> > ResolutionsByResolventMap;
+typedef std::map<Resolvent, std::tr1::shared_ptr<ConstraintSequence> > PresetsMap;
 
 namespace paludis
 {
@@ -78,21 +82,43 @@ namespace paludis
         ResolutionsByResolventMap resolutions_by_resolvent;
 
         const std::tr1::shared_ptr<ResolverLists> lists;
+        const std::tr1::shared_ptr<SanitisedDependenciesCache> sanitised_dependencies_cache;
+
+        PresetsMap presets;
+        std::set<QualifiedPackageName> prefetched, not_yet_prefetched;
+        const Resolvent * adding_dependencies_for;
+        bool found_dependents;
+        int restarts_avoided;
 
         Implementation(const Environment * const e, const ResolverFunctions & f,
-                const std::tr1::shared_ptr<ResolverLists> & l) :
+                const std::tr1::shared_ptr<ResolverLists> & l,
+                const std::tr1::shared_ptr<SanitisedDependenciesCache> & c) :
             env(e),
             fns(f),
             rewriter(env),
-            lists(l)
+            lists(l),
+            sanitised_dependencies_cache(c),
+            adding_dependencies_for(0),
+            found_dependents(false),
+            restarts_avoided(0)
         {
+            /* a restart gives us different initial constraints */
+            sanitised_dependencies_cache->decider_state_changed();
         }
     };
 }
 
 Decider::Decider(const Environment * const e, const ResolverFunctions & f,
         const std::tr1::shared_ptr<ResolverLists> & l) :
-    PrivateImplementationPattern<Decider>(new Implementation<Decider>(e, f, l))
+    PrivateImplementationPattern<Decider>(new Implementation<Decider>(e, f, l,
+                make_shared_ptr(new SanitisedDependenciesCache)))
+{
+}
+
+Decider::Decider(const Environment * const e, const ResolverFunctions & f,
+        const std::tr1::shared_ptr<ResolverLists> & l,
+        const std::tr1::shared_ptr<SanitisedDependenciesCache> & c) :
+    PrivateImplementationPattern<Decider>(new Implementation<Decider>(e, f, l, c))
 {
 }
 
@@ -132,13 +158,49 @@ Decider::_resolve_decide_with_dependencies()
             _imp->env->trigger_notifier_callback(NotifierCallbackResolverStepEvent());
 
             changed = true;
-            _decide(i->first, i->second);
+            const Resolvent resolvent(i->first);
+            const std::tr1::shared_ptr<Resolution> resolution(i->second);
 
-            _add_dependencies_if_necessary(i->first, i->second);
+            /* deciding needs metadata for every version, so get it in bulk
+             * for every package we've been asked about, not just this one */
+            if (_imp->prefetched.end() == _imp->prefetched.find(resolvent.package()))
+                _prefetch_metadata_for_new_packages();
+
+            _decide(resolvent, resolution);
+
+            const int undone_before(_imp->restarts_avoided);
+            _add_dependencies_if_necessary(resolvent, resolution);
+
+            /* adding dependencies made us undo some decisions, and perhaps
+             * throw away resolutions entirely, including the one i refers
+             * to, so start again */
+            if (undone_before != _imp->restarts_avoided)
+                break;
         }
     }
 }
 
+void
+Decider::_prefetch_metadata_for_new_packages()
+{
+    Context context("When prefetching metadata for new packages:");
+
+    const std::tr1::shared_ptr<PackageIDSequence> ids(new PackageIDSequence);
+    for (std::set<QualifiedPackageName>::const_iterator p(_imp->not_yet_prefetched.begin()),
+            p_end(_imp->not_yet_prefetched.end()) ;
+            p != p_end ; ++p)
+    {
+        const std::tr1::shared_ptr<const PackageIDSequence> package_ids((*_imp->env)[selection::AllVersionsUnsorted(
+                    generator::Package(*p))]);
+        std::copy(package_ids->begin(), package_ids->end(), ids->back_inserter());
+    }
+
+    _imp->prefetched.insert(_imp->not_yet_prefetched.begin(), _imp->not_yet_prefetched.end());
+    _imp->not_yet_prefetched.clear();
+
+    _imp->env->package_database()->prefetch_metadata(ids);
+}
+
 bool
 Decider::_resolve_dependents()
 {
@@ -181,6 +243,10 @@ Decider::_resolve_dependents()
             for (ConstraintSequence::ConstIterator c(constraints->begin()), c_end(constraints->end()) ;
                     c != c_end ; ++c)
                 _apply_resolution_constraint(resolvent, resolution, *c);
+
+            /* dependent constraints are worked out from every decision we've
+             * made, so we can't undo decisions locally any more */
+            _imp->found_dependents = true;
         }
         else
         {
@@ -574,6 +640,10 @@ Decider::_resolution_for_resolvent(const Resolvent & r, const bool create)
             std::tr1::shared_ptr<Resolution> resolution(_create_resolution_for_resolvent(r));
             i = _imp->resolutions_by_resolvent.insert(std::make_pair(r, resolution)).first;
             _imp->lists->all_resolutions()->append(resolution);
+            _imp->sanitised_dependencies_cache->decider_state_changed();
+
+            if (_imp->prefetched.end() == _imp->prefetched.find(r.package()))
+                _imp->not_yet_prefetched.insert(r.package());
         }
         else
             throw InternalError(PALUDIS_HERE, "resolver bug: expected resolution for "
@@ -675,7 +745,8 @@ Decider::_apply_resolution_constraint(
 {
     if (resolution->decision())
         if (! _verify_new_constraint(resolvent, resolution, constraint))
-            _made_wrong_decision(resolvent, resolution, constraint);
+            if (! _made_wrong_decision(resolvent, resolution, constraint))
+                return;
 
     resolution->constraints()->add(constraint);
 }
@@ -829,41 +900,96 @@ namespace
 {
     struct WrongDecisionVisitor
     {
-        std::tr1::function<void ()> restart;
+        bool visit(const NothingNoChangeDecision &) const
+        {
+            /* going from nothing to something is fine */
+            return false;
+        }
 
-        WrongDecisionVisitor(const std::tr1::function<void ()> & r) :
-            restart(r)
+        bool visit(const RemoveDecision &) const
         {
+            return true;
         }
 
-        void visit(const NothingNoChangeDecision &) const
+        bool visit(const UnableToMakeDecision &) const
         {
-            /* going from nothing to something is fine */
+            return true;
         }
 
-        void visit(const RemoveDecision &) const
+        bool visit(const ChangesToMakeDecision &) const
         {
-            restart();
+            return true;
         }
 
-        void visit(const UnableToMakeDecision &) const
+        bool visit(const ExistingNoChangeDecision &) const
         {
-            restart();
+            return true;
         }
+    };
 
-        void visit(const ChangesToMakeDecision &) const
+    struct FromResolventVisitor
+    {
+        const std::tr1::shared_ptr<const Resolvent> visit(const DependencyReason & r) const
         {
-            restart();
+            return make_shared_ptr(new Resolvent(r.from_resolvent()));
         }
 
-        void visit(const ExistingNoChangeDecision &) const
+        const std::tr1::shared_ptr<const Resolvent> visit(const TargetReason &) const
         {
-            restart();
+            return make_null_shared_ptr();
+        }
+
+        const std::tr1::shared_ptr<const Resolvent> visit(const DependentReason &) const
+        {
+            return make_null_shared_ptr();
+        }
+
+        const std::tr1::shared_ptr<const Resolvent> visit(const PresetReason &) const
+        {
+            return make_null_shared_ptr();
+        }
+
+        const std::tr1::shared_ptr<const Resolvent> visit(const SetReason &) const
+        {
+            return make_null_shared_ptr();
+        }
+    };
+
+    const std::tr1::shared_ptr<const Resolvent> from_resolvent(const std::tr1::shared_ptr<const Constraint> & c)
+    {
+        return c->reason()->accept_returning<std::tr1::shared_ptr<const Resolvent> >(FromResolventVisitor());
+    }
+
+    struct IsPresetVisitor
+    {
+        bool visit(const PresetReason &) const
+        {
+            return true;
+        }
+
+        bool visit(const TargetReason &) const
+        {
+            return false;
+        }
+
+        bool visit(const DependencyReason &) const
+        {
+            return false;
+        }
+
+        bool visit(const DependentReason &) const
+        {
+            return false;
+        }
+
+        bool visit(const SetReason &) const
+        {
+            return false;
         }
     };
 }
 
-void
+bool
 Decider::_made_wrong_decision(const Resolvent & resolvent,
         const std::tr1::shared_ptr<Resolution> & resolution,
         const std::tr1::shared_ptr<const Constraint> & constraint)
@@ -875,12 +1001,126 @@ Decider::_made_wrong_decision(const Resolvent & resolvent,
     const std::tr1::shared_ptr<Decision> decision(_try_to_find_decision_for(resolvent, adapted_resolution));
     if (decision)
     {
-        resolution->decision()->accept(WrongDecisionVisitor(std::tr1::bind(
-                        &Decider::_suggest_restart_with, this, resolvent, resolution, constraint, decision)));
-        resolution->decision() = decision;
+        if (resolution->decision()->accept_returning<bool>(WrongDecisionVisitor()))
+        {
+            /* rather than starting again from scratch, try to throw away only
+             * the old decision and whatever came from it */
+            if (! _undo_decision_for(resolvent, decision, constraint))
+                _suggest_restart_with(resolvent, resolution, constraint, decision);
+            ++_imp->restarts_avoided;
+
+            /* we might have undone whatever gave us the constraint, too */
+            const std::tr1::shared_ptr<const Resolvent> from(from_resolvent(constraint));
+            if (from)
+            {
+                ResolutionsByResolventMap::const_iterator i(_imp->resolutions_by_resolvent.find(*from));
+                if (_imp->resolutions_by_resolvent.end() == i || ! i->second->decision())
+                    return false;
+            }
+        }
+        else
+            resolution->decision() = decision;
     }
     else
         resolution->decision() = _cannot_decide_for(resolvent, adapted_resolution);
+
+    return true;
+}
+
+bool
+Decider::_undo_decision_for(const Resolvent & resolvent,
+        const std::tr1::shared_ptr<const Decision> & decision,
+        const std::tr1::shared_ptr<const Constraint> & constraint)
+{
+    /* we can only do this whilst adding dependencies, since otherwise we
+     * don't know who else is holding on to the resolutions we'd change, and
+     * _resolve_decide_with_dependencies knows to look out for it */
+    if (_imp->found_dependents || ! _imp->adding_dependencies_for)
+        return false;
+
+    Context context("When undoing the decision for '" + stringify(resolvent) + "':");
+
+    typedef std::map<Resolvent, std::set<Resolvent> > ConstrainedBy;
+    ConstrainedBy constrained_by;
+    for (ResolutionsByResolventMap::const_iterator i(_imp->resolutions_by_resolvent.begin()),
+            i_end(_imp->resolutions_by_resolvent.end()) ;
+            i != i_end ; ++i)
+        for (Constraints::ConstIterator c(i->second->constraints()->begin()),
+                c_end(i->second->constraints()->end()) ;
+                c != c_end ; ++c)
+        {
+            const std::tr1::shared_ptr<const Resolvent> from(from_resolvent(*c));
+            if (from)
+                constrained_by[*from].insert(i->first);
+        }
+
+    /* everything whose constraints came, directly or indirectly, from the
+     * decision we're undoing has to be decided again */
+    std::set<Resolvent> undoing;
+    std::list<Resolvent> todo(1, resolvent);
+    while (! todo.empty())
+    {
+        Resolvent r(todo.front());
+        todo.pop_front();
+
+        if (! undoing.insert(r).second)
+            continue;
+
+        ConstrainedBy::const_iterator c(constrained_by.find(r));
+        if (c != constrained_by.end())
+            std::copy(c->second.begin(), c->second.end(), std::back_inserter(todo));
+    }
+
+    /* remember the constraint that caught us out, just as a restart would,
+     * since whatever gave it to us might be being undone too */
+    const std::tr1::shared_ptr<const Constraint> preset(_make_constraint_for_preloading(resolvent, decision, constraint));
+    _imp->presets.insert(std::make_pair(resolvent, make_shared_ptr(new ConstraintSequence))).first->second->push_back(preset);
+    _imp->sanitised_dependencies_cache->decider_state_changed();
+
+    const std::tr1::shared_ptr<const Resolvent> constraint_from(from_resolvent(constraint));
+    bool constraint_undone(constraint_from && undoing.end() != undoing.find(*constraint_from));
+
+    for (std::set<Resolvent>::const_iterator u(undoing.begin()), u_end(undoing.end()) ;
+            u != u_end ; ++u)
+    {
+        ResolutionsByResolventMap::iterator i(_imp->resolutions_by_resolvent.find(*u));
+        const std::tr1::shared_ptr<Constraints> constraints(new Constraints);
+        bool wanted(false);
+        for (Constraints::ConstIterator c(i->second->constraints()->begin()),
+                c_end(i->second->constraints()->end()) ;
+                c != c_end ; ++c)
+        {
+            const std::tr1::shared_ptr<const Resolvent> from(from_resolvent(*c));
+            if (from && undoing.end() != undoing.find(*from))
+                continue;
+
+            constraints->add(*c);
+            wanted = wanted || ! (*c)->reason()->accept_returning<bool>(IsPresetVisitor());
+        }
+
+        if (*u == resolvent)
+        {
+            constraints->add(preset);
+            wanted = wanted || ! constraint_undone;
+        }
+
+        /* presets on their own don't make us want something, so if nothing
+         * else wants this any more, it goes away entirely, as if it had never
+         * been asked for */
+        if (! wanted)
+        {
+            /* anyone still holding on to it must see it as undecided */
+            i->second->decision().reset();
+            _imp->lists->all_resolutions()->remove(i->second);
+            _imp->resolutions_by_resolvent.erase(i);
+            continue;
+        }
+
+        i->second->constraints() = constraints;
+        i->second->decision().reset();
+    }
+
+    return true;
 }
 
 void
@@ -996,8 +1236,10 @@ Decider::_add_dependencies_if_necessary(
     Context context("When adding dependencies for '" + stringify(our_resolvent) + "' with '"
             + stringify(*package_id) + "':");
 
-    const std::tr1::shared_ptr<SanitisedDependencies> deps(new SanitisedDependencies);
-    deps->populate(*this, our_resolvent, package_id);
+    const std::tr1::shared_ptr<const SanitisedDependencies> deps(
+            _imp->sanitised_dependencies_cache->sanitised_dependencies_for(*this, our_resolvent, package_id));
+
+    Save<const Resolvent *> save_adding_dependencies_for(&_imp->adding_dependencies_for, &our_resolvent);
 
     for (SanitisedDependencies::ConstIterator s(deps->begin()), s_end(deps->end()) ;
             s != s_end ; ++s)
@@ -1046,7 +1288,13 @@ Decider::_add_dependencies_if_necessary(
 
             for (ConstraintSequence::ConstIterator c(constraints->begin()), c_end(constraints->end()) ;
                     c != c_end ; ++c)
+            {
                 _apply_resolution_constraint(*r, dep_resolution, *c);
+
+                /* we've been undone, so our dependencies don't matter any more */
+                if (! our_resolution->decision())
+                    return;
+            }
         }
     }
 }
@@ -1061,7 +1309,21 @@ Decider::_interest_in_spec(const Resolvent & resolvent,
 const std::tr1::shared_ptr<Constraints>
 Decider::_initial_constraints_for(const Resolvent & r) const
 {
-    return _imp->fns.get_initial_constraints_for_fn()(r);
+    const std::tr1::shared_ptr<Constraints> result(_imp->fns.get_initial_constraints_for_fn()(r));
+
+    PresetsMap::const_iterator p(_imp->presets.find(r));
+    if (_imp->presets.end() == p)
+        return result;
+
+    /* don't add our presets to someone else's constraints */
+    const std::tr1::shared_ptr<Constraints> with_presets(new Constraints);
+    for (Constraints::ConstIterator c(result->begin()), c_end(result->end()) ;
+            c != c_end ; ++c)
+        with_presets->add(*c);
+    for (ConstraintSequence::ConstIterator c(p->second->begin()), c_end(p->second->end()) ;
+            c != c_end ; ++c)
+        with_presets->add(*c);
+    return with_presets;
 }
 
 namespace
@@ -1767,6 +2029,12 @@ Decider::add_target_with_reason(const PackageOrBlockDepSpec & spec, const std::t
     }
 }
 
+int
+Decider::restarts_avoided() const
+{
+    return _imp->restarts_avoided;
+}
+
 void
 Decider::resolve()
 {
@@ -104,10 +104,14 @@ namespace paludis
                         const std::tr1::shared_ptr<const Resolution> &,
                         const std::tr1::shared_ptr<const Constraint> &);
 
-                void _made_wrong_decision(const Resolvent &,
+                bool _made_wrong_decision(const Resolvent &,
                         const std::tr1::shared_ptr<Resolution> & resolution,
                         const std::tr1::shared_ptr<const Constraint> & constraint);
 
+                bool _undo_decision_for(const Resolvent &,
+                        const std::tr1::shared_ptr<const Decision> &,
+                        const std::tr1::shared_ptr<const Constraint> &) PALUDIS_ATTRIBUTE((warn_unused_result));
+
                 void _suggest_restart_with(const Resolvent &,
                         const std::tr1::shared_ptr<const Resolution> & resolution,
                         const std::tr1::shared_ptr<const Constraint> & constraint,
@@ -130,6 +134,7 @@ namespace paludis
                         const ChangesToMakeDecision &) const;
 
                 void _resolve_decide_with_dependencies();
+                void _prefetch_metadata_for_new_packages();
                 bool _resolve_dependents() PALUDIS_ATTRIBUTE((warn_unused_result));
                 void _resolve_destinations();
 
@@ -220,6 +225,11 @@ namespace paludis
                 Decider(const Environment * const,
                         const ResolverFunctions &,
                         const std::tr1::shared_ptr<ResolverLists> &);
+
+                Decider(const Environment * const,
+                        const ResolverFunctions &,
+                        const std::tr1::shared_ptr<ResolverLists> &,
+                        const std::tr1::shared_ptr<SanitisedDependenciesCache> &);
                 ~Decider();
 
                 void resolve();
@@ -232,6 +242,8 @@ namespace paludis
                         const std::tr1::shared_ptr<const Resolvent> & maybe_from) const;
 
                 const std::tr1::shared_ptr<Resolution> resolution_for_resolvent(const Resolvent &) const;
+
+                int restarts_avoided() const PALUDIS_ATTRIBUTE((warn_unused_result));
         };
     }
 }
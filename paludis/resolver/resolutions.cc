@@ -25,6 +25,7 @@
 #include <paludis/util/stringify.hh>
 #include <paludis/util/make_named_values.hh>
 #include <paludis/serialise-impl.hh>
+#include <list>
 
 using namespace paludis;
 using namespace paludis::resolver;
@@ -34,13 +35,13 @@ namespace paludis
     template <>
     struct Implementation<Resolutions>
     {
-        Sequence<std::tr1::shared_ptr<Resolution> > resolutions;
+        std::list<std::tr1::shared_ptr<Resolution> > resolutions;
     };
 
     template <>
     struct WrappedForwardIteratorTraits<Resolutions::ConstIteratorTag>
     {
-        typedef Sequence<std::tr1::shared_ptr<Resolution> >::ConstIterator UnderlyingIterator;
+        typedef std::list<std::tr1::shared_ptr<Resolution> >::const_iterator UnderlyingIterator;
     };
 }
 
@@ -59,6 +60,18 @@ Resolutions::append(const std::tr1::shared_ptr<Resolution> & r)
     _imp->resolutions.push_back(r);
 }
 
+void
+Resolutions::remove(const std::tr1::shared_ptr<const Resolution> & r)
+{
+    for (std::list<std::tr1::shared_ptr<Resolution> >::iterator i(_imp->resolutions.begin()),
+            i_end(_imp->resolutions.end()) ;
+            i != i_end ; )
+        if (*i == r)
+            _imp->resolutions.erase(i++);
+        else
+            ++i;
+}
+
 Resolutions::ConstIterator
 Resolutions::begin() const
 {
@@ -49,6 +49,12 @@ namespace paludis
 
                 void append(const std::tr1::shared_ptr<Resolution> &);
 
+                /**
+                 * Used by the Decider when it throws away a resolution that is
+                 * no longer wanted. Everything else stays in order.
+                 */
+                void remove(const std::tr1::shared_ptr<const Resolution> &);
+
                 struct ConstIteratorTag;
                 typedef WrappedForwardIterator<ConstIteratorTag,
                         const std::tr1::shared_ptr<Resolution> > ConstIterator;
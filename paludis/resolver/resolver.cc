@@ -59,7 +59,8 @@ namespace paludis
         const std::tr1::shared_ptr<Decider> decider;
         const std::tr1::shared_ptr<Orderer> orderer;
 
-        Implementation(const Environment * const e, const ResolverFunctions & f) :
+        Implementation(const Environment * const e, const ResolverFunctions & f,
+                const std::tr1::shared_ptr<SanitisedDependenciesCache> & c) :
             env(e),
             fns(f),
             lists(new ResolverLists(make_named_values<ResolverLists>(
@@ -71,7 +72,7 @@ namespace paludis
                             value_for<n::untaken_error_job_ids>(make_shared_ptr(new JobIDSequence)),
                             value_for<n::untaken_job_ids>(make_shared_ptr(new JobIDSequence))
                             ))),
-            decider(new Decider(e, f, lists)),
+            decider(new Decider(e, f, lists, c)),
             orderer(new Orderer(e, f, decider, lists))
         {
         }
@@ -79,7 +80,14 @@ namespace paludis
 }
 
 Resolver::Resolver(const Environment * const e, const ResolverFunctions & f) :
-    PrivateImplementationPattern<Resolver>(new Implementation<Resolver>(e, f))
+    PrivateImplementationPattern<Resolver>(new Implementation<Resolver>(e, f,
+                make_shared_ptr(new SanitisedDependenciesCache)))
+{
+}
+
+Resolver::Resolver(const Environment * const e, const ResolverFunctions & f,
+        const std::tr1::shared_ptr<SanitisedDependenciesCache> & c) :
+    PrivateImplementationPattern<Resolver>(new Implementation<Resolver>(e, f, c))
 {
 }
 
@@ -169,3 +177,9 @@ Resolver::lists() const
     return _imp->lists;
 }
 
+int
+Resolver::restarts_avoided() const
+{
+    return _imp->decider->restarts_avoided();
+}
+
@@ -50,6 +50,15 @@ namespace paludis
                 Resolver(
                         const Environment * const,
                         const ResolverFunctions &);
+
+                /**
+                 * Use a SanitisedDependenciesCache that can be shared with
+                 * the resolvers made after a restart.
+                 */
+                Resolver(
+                        const Environment * const,
+                        const ResolverFunctions &,
+                        const std::tr1::shared_ptr<SanitisedDependenciesCache> &);
                 ~Resolver();
 
                 void add_target(const PackageOrBlockDepSpec &);
@@ -58,6 +67,12 @@ namespace paludis
                 void resolve();
 
                 const std::tr1::shared_ptr<const ResolverLists> lists() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * How many times a wrong decision was fixed up in place,
+                 * rather than by throwing SuggestRestart.
+                 */
+                int restarts_avoided() const PALUDIS_ATTRIBUTE((warn_unused_result));
         };
     }
 }
@@ -201,5 +201,38 @@ namespace test_cases
             TEST_CHECK_THROWS(get_resolutions("mutual-build-deps/target"), Exception);
         }
     } test_mutual_build_deps;
+
+    struct TestUndoCycle : ResolverCyclesTestCase
+    {
+        TestUndoCycle() : ResolverCyclesTestCase("undo-cycle") { }
+
+        void run()
+        {
+            std::tr1::shared_ptr<const ResolverLists> resolutions(get_resolutions("undo-cycle/target"));
+
+            {
+                TestMessageSuffix s("taken errors");
+                check_resolution_list(resolutions->jobs(), resolutions->taken_error_job_ids(), ResolutionListChecks()
+                        .finished()
+                        );
+            }
+
+            {
+                TestMessageSuffix s("untaken errors");
+                check_resolution_list(resolutions->jobs(), resolutions->untaken_error_job_ids(), ResolutionListChecks()
+                        .finished()
+                        );
+            }
+
+            {
+                TestMessageSuffix s("ordered");
+                check_resolution_list(resolutions->jobs(), resolutions->taken_job_ids(), ResolutionListChecks()
+                        .qpn(QualifiedPackageName("undo-cycle/dep"))
+                        .qpn(QualifiedPackageName("undo-cycle/target"))
+                        .finished()
+                        );
+            }
+        }
+    } test_undo_cycle;
 }
 
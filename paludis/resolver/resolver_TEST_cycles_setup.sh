@@ -130,5 +130,38 @@ SLOT="0"
 DEPENDENCIES="build: mutual-build-deps/dep-b"
 END
 
+# undo-cycle
+echo 'undo-cycle' >> metadata/categories.conf
+
+mkdir -p 'packages/undo-cycle/target'
+cat <<END > packages/undo-cycle/target/target-1.exheres-0
+SUMMARY="target"
+PLATFORMS="test"
+SLOT="0"
+DEPENDENCIES="undo-cycle/dep"
+END
+
+mkdir -p 'packages/undo-cycle/dep'
+cat <<END > packages/undo-cycle/dep/dep-1.exheres-0
+SUMMARY="target"
+PLATFORMS="test"
+SLOT="0"
+END
+
+cat <<END > packages/undo-cycle/dep/dep-2.exheres-0
+SUMMARY="target"
+PLATFORMS="test"
+SLOT="0"
+DEPENDENCIES="undo-cycle/back"
+END
+
+mkdir -p 'packages/undo-cycle/back'
+cat <<END > packages/undo-cycle/back/back-1.exheres-0
+SUMMARY="target"
+PLATFORMS="test"
+SLOT="0"
+DEPENDENCIES="undo-cycle/dep[<2]"
+END
+
 cd ..
 
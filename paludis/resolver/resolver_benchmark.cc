@@ -0,0 +1,539 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Times the decide, order and serialisation phases of the resolver over large
+ * generated fake repositories. Built but not run by 'make check'; use
+ * 'make benchmark', which sets up the same environment as the tests:
+ *
+ *     make benchmark BENCHMARK_OPTIONS="[--size N] [scenario ...]"
+ *
+ * For each phase we report wall time, the number and total size of
+ * allocations made, and the process's peak resident set size afterwards.
+ * Graphs are generated from a fixed seed, so numbers are comparable between
+ * builds.
+ */
+
+#include <paludis/resolver/resolver_test.hh>
+#include <paludis/resolver/resolver_functions.hh>
+#include <paludis/resolver/resolver_lists.hh>
+#include <paludis/resolver/resolutions.hh>
+#include <paludis/resolver/resolvent.hh>
+#include <paludis/resolver/constraint.hh>
+#include <paludis/resolver/reason.hh>
+#include <paludis/resolver/decider.hh>
+#include <paludis/resolver/orderer.hh>
+#include <paludis/resolver/jobs.hh>
+#include <paludis/resolver/job_id.hh>
+#include <paludis/resolver/suggest_restart.hh>
+#include <paludis/resolver/sanitised_dependencies.hh>
+#include <paludis/repositories/fake/fake_repository.hh>
+#include <paludis/repositories/fake/fake_installed_repository.hh>
+#include <paludis/repositories/fake/fake_package_id.hh>
+#include <paludis/environments/test/test_environment.hh>
+#include <paludis/util/make_named_values.hh>
+#include <paludis/util/make_shared_ptr.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/destringify.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/map.hh>
+#include <paludis/util/set.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/util/benchmark_extras.hh>
+#include <paludis/package_database.hh>
+#include <paludis/user_dep_spec.hh>
+#include <paludis/serialise.hh>
+#include <paludis/selection.hh>
+#include <paludis/generator.hh>
+#include <paludis/filtered_generator.hh>
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <inttypes.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+using namespace paludis;
+using namespace paludis::resolver;
+using namespace paludis::resolver::resolver_test;
+using namespace paludis::benchmark_extras;
+
+namespace
+{
+    struct Sample
+    {
+        double seconds;
+        unsigned long allocations;
+        unsigned long long allocated_bytes;
+    };
+
+    Sample sample()
+    {
+        timeval t;
+        gettimeofday(&t, 0);
+
+        Sample result;
+        result.seconds = t.tv_sec + t.tv_usec / 1000000.0;
+        result.allocations = allocations();
+        result.allocated_bytes = allocated_bytes();
+        return result;
+    }
+
+    long peak_rss_kb()
+    {
+        rusage u;
+        if (0 != getrusage(RUSAGE_SELF, &u))
+            return 0;
+        return u.ru_maxrss;
+    }
+
+    void report_header()
+    {
+        std::cout << std::left
+            << std::setw(10) << "scenario" << " "
+            << std::setw(12) << "phase" << " "
+            << std::right
+            << std::setw(10) << "seconds" << " "
+            << std::setw(12) << "allocations" << " "
+            << std::setw(12) << "alloc-kb" << " "
+            << std::setw(12) << "peak-rss-kb" << " "
+            << "notes" << std::endl;
+    }
+
+    void report(const std::string & scenario, const std::string & phase,
+            const Sample & before, const Sample & after, const std::string & notes)
+    {
+        std::cout << std::left
+            << std::setw(10) << scenario << " "
+            << std::setw(12) << phase << " "
+            << std::right << std::fixed << std::setprecision(3)
+            << std::setw(10) << (after.seconds - before.seconds) << " "
+            << std::setw(12) << (after.allocations - before.allocations) << " "
+            << std::setw(12) << ((after.allocated_bytes - before.allocated_bytes) / 1024) << " "
+            << std::setw(12) << peak_rss_kb() << " "
+            << notes << std::endl;
+    }
+
+    /* a small fixed-seed generator, so graphs don't depend upon libc */
+    struct Random
+    {
+        uint32_t state;
+
+        Random() :
+            state(20100301)
+        {
+        }
+
+        unsigned operator() (const unsigned n)
+        {
+            state = state * 1103515245u + 12345u;
+            return (state >> 8) % n;
+        }
+    };
+
+    /*
+     * Every scenario fills in a repository and an installed repository for
+     * its own category, and makes a single target package depending upon
+     * whatever it wants resolved.
+     */
+    struct Graph
+    {
+        const std::string category;
+        const std::tr1::shared_ptr<FakeRepository> repo;
+        const std::tr1::shared_ptr<FakeInstalledRepository> installed;
+        Random random;
+
+        Graph(const std::string & c, const std::tr1::shared_ptr<FakeRepository> & r,
+                const std::tr1::shared_ptr<FakeInstalledRepository> & i) :
+            category(c),
+            repo(r),
+            installed(i)
+        {
+        }
+
+        std::string name(const unsigned n) const
+        {
+            return "p" + stringify(n);
+        }
+
+        std::string spec(const unsigned n) const
+        {
+            return category + "/" + name(n);
+        }
+
+        /* a package in layer, when each layer has width packages */
+        unsigned pick(const unsigned layer, const unsigned width)
+        {
+            return layer * width + random(width);
+        }
+
+        const std::tr1::shared_ptr<FakePackageID> add(const unsigned n, const std::string & v)
+        {
+            return repo->add_version(category, name(n), v);
+        }
+
+        const std::tr1::shared_ptr<FakePackageID> install(const unsigned n, const std::string & v)
+        {
+            return installed->add_version(category, name(n), v);
+        }
+
+        void target(const std::string & deps)
+        {
+            repo->add_version(category, "target", "1")->build_dependencies_key()->set_from_string(deps);
+        }
+    };
+
+    /* deep layers, each package depending upon a few from the next layer down */
+    void populate_deep(Graph & g, const unsigned size)
+    {
+        const unsigned width(10), layers(std::max(2u, size / width));
+
+        for (unsigned l(0) ; l < layers ; ++l)
+            for (unsigned i(l * width), i_end((l + 1) * width) ; i != i_end ; ++i)
+            {
+                const std::tr1::shared_ptr<FakePackageID> id(g.add(i, "1"));
+                if (l + 1 == layers)
+                    continue;
+
+                id->build_dependencies_key()->set_from_string(g.spec(g.pick(l + 1, width)) + " " + g.spec(g.pick(l + 1, width)));
+                id->run_dependencies_key()->set_from_string(g.spec(g.pick(l + 1 + g.random(layers - l - 1), width)));
+            }
+
+        std::string deps;
+        for (unsigned i(0) ; i < width ; ++i)
+            deps.append(" " + g.spec(i));
+        g.target(deps);
+    }
+
+    /* three slots of everything, with slot dependencies, and slot 1 installed */
+    void populate_slots(Graph & g, const unsigned size)
+    {
+        const unsigned width(20), layers(std::max(2u, size / width / 3));
+
+        for (unsigned l(0) ; l < layers ; ++l)
+            for (unsigned i(l * width), i_end((l + 1) * width) ; i != i_end ; ++i)
+            {
+                g.install(i, "1")->set_slot(SlotName("1"));
+
+                for (unsigned s(1) ; s <= 3 ; ++s)
+                {
+                    const std::tr1::shared_ptr<FakePackageID> id(g.add(i, stringify(s)));
+                    id->set_slot(SlotName(stringify(s)));
+                    if (l + 1 == layers)
+                        continue;
+
+                    id->build_dependencies_key()->set_from_string(
+                            g.spec(g.pick(l + 1, width)) + ":" + stringify(1 + g.random(3)) + " " +
+                            g.spec(g.pick(l + 1, width)) + ":" + stringify(s));
+                }
+            }
+
+        std::string deps;
+        for (unsigned i(0) ; i < width ; ++i)
+            deps.append(" " + g.spec(i) + ":" + stringify(1 + (i % 3)));
+        g.target(deps);
+    }
+
+    /* any-of groups over the next layer, with some alternatives installed */
+    void populate_any(Graph & g, const unsigned size)
+    {
+        const unsigned width(20), layers(std::max(2u, size / width));
+
+        for (unsigned l(0) ; l < layers ; ++l)
+            for (unsigned i(l * width), i_end((l + 1) * width) ; i != i_end ; ++i)
+            {
+                const std::tr1::shared_ptr<FakePackageID> id(g.add(i, "1"));
+                if (0 == g.random(4))
+                    g.install(i, "1");
+                if (l + 1 == layers)
+                    continue;
+
+                std::string deps;
+                for (unsigned a(0) ; a < 2 ; ++a)
+                {
+                    deps.append(" || (");
+                    for (unsigned c(0) ; c < 3 ; ++c)
+                        deps.append(" " + g.spec(g.pick(l + 1, width)));
+                    deps.append(" )");
+                }
+                deps.append(" " + g.spec(g.pick(l + 1, width)));
+                id->build_dependencies_key()->set_from_string(deps);
+            }
+
+        std::string deps;
+        for (unsigned i(0) ; i < width ; ++i)
+            deps.append(" " + g.spec(i));
+        g.target(deps);
+    }
+
+    /* everything installed at an old version, with new versions blocking old ones */
+    void populate_blockers(Graph & g, const unsigned size)
+    {
+        const unsigned width(20), layers(std::max(2u, size / width));
+
+        for (unsigned l(0) ; l < layers ; ++l)
+            for (unsigned i(l * width), i_end((l + 1) * width) ; i != i_end ; ++i)
+            {
+                g.install(i, "1");
+                const std::tr1::shared_ptr<FakePackageID> id(g.add(i, "2"));
+                if (l + 1 == layers)
+                    continue;
+
+                const unsigned b(g.pick(l + 1, width));
+                id->build_dependencies_key()->set_from_string(
+                        ">=" + g.spec(g.pick(l + 1, width)) + "-2 "
+                        ">=" + g.spec(b) + "-2 !<" + g.spec(b) + "-2");
+                id->run_dependencies_key()->set_from_string(
+                        "!<" + g.spec(g.pick(l + 1, width)) + "-2");
+            }
+
+        std::string deps;
+        for (unsigned i(0) ; i < width ; ++i)
+            deps.append(" >=" + g.spec(i) + "-2");
+        g.target(deps);
+    }
+
+    /* layers of rings, with run dependencies around each ring */
+    void populate_cycles(Graph & g, const unsigned size)
+    {
+        const unsigned width(20), ring(5), layers(std::max(2u, size / width));
+
+        for (unsigned l(0) ; l < layers ; ++l)
+            for (unsigned i(l * width), i_end((l + 1) * width) ; i != i_end ; ++i)
+            {
+                const std::tr1::shared_ptr<FakePackageID> id(g.add(i, "1"));
+                const unsigned next(i - (i % ring) + ((i + 1) % ring));
+                id->run_dependencies_key()->set_from_string(g.spec(next));
+                if (l + 1 == layers)
+                    continue;
+
+                id->build_dependencies_key()->set_from_string(g.spec(g.pick(l + 1, width)));
+            }
+
+        std::string deps;
+        for (unsigned i(0) ; i < width ; ++i)
+            deps.append(" " + g.spec(i));
+        g.target(deps);
+    }
+
+    /* late dependencies wanting older versions of things already decided,
+     * so the resolver has to restart */
+    void populate_restarts(Graph & g, const unsigned size)
+    {
+        const unsigned width(20), layers(std::max(2u, size / width / 2));
+
+        for (unsigned l(0) ; l < layers ; ++l)
+            for (unsigned i(l * width), i_end((l + 1) * width) ; i != i_end ; ++i)
+            {
+                g.add(i, "1");
+                const std::tr1::shared_ptr<FakePackageID> id(g.add(i, "2"));
+                if (l + 1 == layers)
+                {
+                    if (0 == i % 4)
+                        id->run_dependencies_key()->set_from_string("<" + g.spec(g.pick(g.random(l), width)) + "-2");
+                    continue;
+                }
+
+                id->build_dependencies_key()->set_from_string(g.spec(g.pick(l + 1, width)) + " " + g.spec(g.pick(l + 1, width)));
+            }
+
+        std::string deps;
+        for (unsigned i(0) ; i < width ; ++i)
+            deps.append(" " + g.spec(i));
+        g.target(deps);
+    }
+
+    struct Scenario
+    {
+        const char * const name;
+        void (* const populate)(Graph &, const unsigned);
+    };
+
+    const Scenario scenarios[] = {
+        { "deep",     &populate_deep },
+        { "slots",    &populate_slots },
+        { "any",      &populate_any },
+        { "blockers", &populate_blockers },
+        { "cycles",   &populate_cycles },
+        { "restarts", &populate_restarts }
+    };
+
+    const std::tr1::shared_ptr<ResolverLists> make_lists()
+    {
+        return make_shared_ptr(new ResolverLists(make_named_values<ResolverLists>(
+                        value_for<n::all_resolutions>(make_shared_ptr(new Resolutions)),
+                        value_for<n::job_ids_needing_confirmation>(make_shared_ptr(new JobIDSequence)),
+                        value_for<n::jobs>(make_shared_ptr(new Jobs)),
+                        value_for<n::taken_error_job_ids>(make_shared_ptr(new JobIDSequence)),
+                        value_for<n::taken_job_ids>(make_shared_ptr(new JobIDSequence)),
+                        value_for<n::untaken_error_job_ids>(make_shared_ptr(new JobIDSequence)),
+                        value_for<n::untaken_job_ids>(make_shared_ptr(new JobIDSequence))
+                        )));
+    }
+
+    ResolverFunctions make_functions(TestEnvironment & env, InitialConstraints & initial_constraints)
+    {
+        const std::tr1::shared_ptr<QualifiedPackageNameSet> names(new QualifiedPackageNameSet);
+        return make_named_values<ResolverFunctions>(
+                value_for<n::allowed_to_break_fn>(std::tr1::bind(&allowed_to_break_fn,
+                        names, std::tr1::placeholders::_1)),
+                value_for<n::allowed_to_remove_fn>(std::tr1::bind(&allowed_to_remove_fn,
+                        names, std::tr1::placeholders::_1)),
+                value_for<n::confirm_fn>(&confirm_fn),
+                value_for<n::find_repository_for_fn>(std::tr1::bind(&find_repository_for_fn,
+                        &env, std::tr1::placeholders::_1, std::tr1::placeholders::_2,
+                        std::tr1::placeholders::_3)),
+                value_for<n::get_constraints_for_dependent_fn>(&get_constraints_for_dependent_fn),
+                value_for<n::get_destination_types_for_fn>(&get_destination_types_for_fn),
+                value_for<n::get_initial_constraints_for_fn>(
+                    std::tr1::bind(&initial_constraints_for_fn, std::tr1::ref(initial_constraints),
+                        std::tr1::placeholders::_1)),
+                value_for<n::get_resolvents_for_fn>(&get_resolvents_for_fn),
+                value_for<n::get_use_existing_fn>(&get_use_existing_fn),
+                value_for<n::interest_in_spec_fn>(&interest_in_spec_fn),
+                value_for<n::make_destination_filtered_generator_fn>(&make_destination_filtered_generator_fn),
+                value_for<n::prefer_or_avoid_fn>(std::tr1::bind(&prefer_or_avoid_fn,
+                        make_shared_ptr(new Map<QualifiedPackageName, bool>), std::tr1::placeholders::_1)),
+                value_for<n::remove_if_dependent_fn>(std::tr1::bind(&remove_if_dependent_fn,
+                        names, std::tr1::placeholders::_1))
+                );
+    }
+
+    void run(const Scenario & scenario, const unsigned size)
+    {
+        TestEnvironment env;
+
+        Sample before(sample());
+
+        const std::tr1::shared_ptr<FakeRepository> repo(new FakeRepository(make_named_values<FakeRepositoryParams>(
+                        value_for<n::environment>(&env),
+                        value_for<n::name>(RepositoryName("repo")))));
+        env.package_database()->add_repository(1, repo);
+
+        const std::tr1::shared_ptr<FakeInstalledRepository> installed(new FakeInstalledRepository(
+                    make_named_values<FakeInstalledRepositoryParams>(
+                        value_for<n::environment>(&env),
+                        value_for<n::name>(RepositoryName("installed")),
+                        value_for<n::suitable_destination>(true),
+                        value_for<n::supports_uninstall>(true)
+                        )));
+        env.package_database()->add_repository(2, installed);
+
+        Graph graph(scenario.name, repo, installed);
+        scenario.populate(graph, size);
+
+        const std::tr1::shared_ptr<const PackageIDSequence> ids(env[selection::AllVersionsUnsorted(generator::All())]);
+        report(scenario.name, "generate", before, sample(), stringify(std::distance(ids->begin(), ids->end())) + " ids");
+
+        const PackageDepSpec target(parse_user_package_dep_spec(graph.category + "/target", &env, UserPackageDepSpecOptions()));
+
+        before = sample();
+        InitialConstraints initial_constraints;
+        const ResolverFunctions functions(make_functions(env, initial_constraints));
+        const std::tr1::shared_ptr<SanitisedDependenciesCache> sanitised_dependencies_cache(new SanitisedDependenciesCache);
+        std::tr1::shared_ptr<ResolverLists> lists;
+        std::tr1::shared_ptr<Decider> decider;
+        unsigned restarts(0);
+        while (true)
+        {
+            try
+            {
+                lists = make_lists();
+                decider.reset(new Decider(&env, functions, lists, sanitised_dependencies_cache));
+                decider->add_target_with_reason(target, make_shared_ptr(new TargetReason));
+                decider->resolve();
+                break;
+            }
+            catch (const SuggestRestart & e)
+            {
+                ++restarts;
+                initial_constraints.insert(std::make_pair(e.resolvent(), make_shared_ptr(new Constraints))).first->second->add(
+                        e.suggested_preset());
+            }
+        }
+        report(scenario.name, "decide", before, sample(),
+                stringify(std::distance(lists->all_resolutions()->begin(), lists->all_resolutions()->end()))
+                + " resolutions, " + stringify(restarts) + " restarts, "
+                + stringify(decider->restarts_avoided()) + " avoided, "
+                + stringify(sanitised_dependencies_cache->hits()) + " cache hits");
+
+        before = sample();
+        Orderer orderer(&env, functions, decider, lists);
+        orderer.resolve();
+        report(scenario.name, "order", before, sample(),
+                stringify(std::distance(lists->taken_job_ids()->begin(), lists->taken_job_ids()->end())) + " taken, "
+                + stringify(std::distance(lists->taken_error_job_ids()->begin(), lists->taken_error_job_ids()->end()))
+                + " errors");
+
+        before = sample();
+        std::stringstream str;
+        Serialiser ser(str);
+        lists->serialise(ser);
+        report(scenario.name, "serialise", before, sample(), stringify(str.str().length() / 1024) + " kb");
+
+        before = sample();
+        Deserialiser deser(&env, str);
+        Deserialisation desern("ResolverLists", deser);
+        const ResolverLists copy(ResolverLists::deserialise(desern));
+        report(scenario.name, "deserialise", before, sample(), "");
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    unsigned size(2000);
+    std::vector<std::string> wanted;
+
+    for (int a(1) ; a < argc ; ++a)
+    {
+        const std::string arg(argv[a]);
+        if (arg == "--size" && a + 1 < argc)
+            size = destringify<unsigned>(argv[++a]);
+        else if (! arg.empty() && arg[0] == '-')
+        {
+            std::cerr << "Usage: " << argv[0] << " [--size N] [scenario ...]" << std::endl;
+            return EXIT_FAILURE;
+        }
+        else
+            wanted.push_back(arg);
+    }
+
+    try
+    {
+        report_header();
+
+        for (const Scenario * s(scenarios), * s_end(scenarios + sizeof(scenarios) / sizeof(scenarios[0])) ;
+                s != s_end ; ++s)
+            if (wanted.empty() || wanted.end() != std::find(wanted.begin(), wanted.end(), s->name))
+                run(*s, size);
+    }
+    catch (const Exception & e)
+    {
+        std::cerr << "Caught exception " << e.message() << " (" << e.what() << ")" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
@@ -32,6 +32,7 @@
 #include <paludis/resolver/jobs.hh>
 #include <paludis/resolver/job_id.hh>
 #include <paludis/resolver/reason.hh>
+#include <paludis/resolver/sanitised_dependencies.hh>
 #include <paludis/util/map.hh>
 #include <paludis/util/make_shared_ptr.hh>
 #include <paludis/util/sequence.hh>
@@ -401,12 +402,13 @@ const std::tr1::shared_ptr<const ResolverLists>
 ResolverTestCase::get_resolutions(const PackageOrBlockDepSpec & target)
 {
     InitialConstraints initial_constraints;
+    const std::tr1::shared_ptr<SanitisedDependenciesCache> sanitised_dependencies_cache(new SanitisedDependenciesCache);
 
     while (true)
     {
         try
         {
-            Resolver resolver(&env, get_resolver_functions(initial_constraints));
+            Resolver resolver(&env, get_resolver_functions(initial_constraints), sanitised_dependencies_cache);
             resolver.add_target(target);
             resolver.resolve();
             return resolver.lists();
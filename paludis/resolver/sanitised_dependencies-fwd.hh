@@ -28,6 +28,7 @@ namespace paludis
     namespace resolver
     {
         struct SanitisedDependencies;
+        struct SanitisedDependenciesCache;
         struct SanitisedDependency;
 
         struct PackageOrBlockDepSpec;
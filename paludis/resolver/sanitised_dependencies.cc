@@ -44,18 +44,31 @@
 #include <paludis/serialise-impl.hh>
 #include <set>
 #include <list>
+#include <map>
 
 using namespace paludis;
 using namespace paludis::resolver;
 
 namespace
 {
+    typedef std::pair<AnyChildScore, OperatorScore> AnyScore;
+    typedef std::tr1::function<AnyScore (const SanitisedDependency &)> FindAnyScoreFunction;
+
     template <typename T_>
     void list_push_back(std::list<T_> * const l, const T_ & t)
     {
         l->push_back(t);
     }
 
+    /* any-of choices are the only thing that depends upon the decider's
+     * state, so remember whether we had to make any */
+    AnyScore note_any_score(const Decider * const decider, const Resolvent & our_resolvent,
+            bool * const made_any_of_choices, const SanitisedDependency & dep)
+    {
+        *made_any_of_choices = true;
+        return decider->find_any_score(our_resolvent, dep);
+    }
+
     struct MakeAnyOfStringVisitor
     {
         std::string result;
@@ -110,6 +123,7 @@ namespace
         const Decider & decider;
         const Resolvent our_resolvent;
         const std::tr1::function<SanitisedDependency (const PackageOrBlockDepSpec &)> parent_make_sanitised;
+        const FindAnyScoreFunction find_any_score;
 
         bool super_complicated, nested;
 
@@ -119,10 +133,12 @@ namespace
         bool seen_any;
 
         AnyDepSpecChildHandler(const Decider & r, const Resolvent & q,
-                const std::tr1::function<SanitisedDependency (const PackageOrBlockDepSpec &)> & f) :
+                const std::tr1::function<SanitisedDependency (const PackageOrBlockDepSpec &)> & f,
+                const FindAnyScoreFunction & s) :
             decider(r),
             our_resolvent(q),
             parent_make_sanitised(f),
+            find_any_score(s),
             super_complicated(false),
             nested(false),
             active_sublist(0),
@@ -210,7 +226,7 @@ namespace
 
         void visit(const DependencySpecTree::NodeType<AnyDepSpec>::Type & node)
         {
-            AnyDepSpecChildHandler h(decider, our_resolvent, parent_make_sanitised);
+            AnyDepSpecChildHandler h(decider, our_resolvent, parent_make_sanitised, find_any_score);
             std::for_each(indirect_iterator(node.begin()), indirect_iterator(node.end()), accept_visitor(h));
             std::list<SanitisedDependency> l;
             h.commit(
@@ -271,7 +287,7 @@ namespace
                             h != h_end ; ++h)
                     {
                         std::pair<AnyChildScore, OperatorScore> score(
-                                decider.find_any_score(our_resolvent, make_sanitised(PackageOrBlockDepSpec(*h))));
+                                find_any_score(make_sanitised(PackageOrBlockDepSpec(*h))));
                         if (score < worst_score)
                             worst_score = score;
                     }
@@ -297,6 +313,7 @@ namespace
         const Decider & decider;
         const Resolvent our_resolvent;
         SanitisedDependencies & sanitised_dependencies;
+        bool & made_any_of_choices;
         const std::string raw_name;
         const std::string human_name;
         std::string original_specs_as_string;
@@ -306,6 +323,7 @@ namespace
                 const Decider & r,
                 const Resolvent & q,
                 SanitisedDependencies & s,
+                bool & c,
                 const std::tr1::shared_ptr<const DependenciesLabelSequence> & l,
                 const std::string & rn,
                 const std::string & hn,
@@ -313,6 +331,7 @@ namespace
             decider(r),
             our_resolvent(q),
             sanitised_dependencies(s),
+            made_any_of_choices(c),
             raw_name(rn),
             human_name(hn),
             original_specs_as_string(a)
@@ -386,7 +405,8 @@ namespace
                 original_specs_as_string = "|| (" + v.result + " )";
             }
 
-            AnyDepSpecChildHandler h(decider, our_resolvent, std::tr1::bind(&Finder::make_sanitised, this, std::tr1::placeholders::_1));
+            AnyDepSpecChildHandler h(decider, our_resolvent, std::tr1::bind(&Finder::make_sanitised, this, std::tr1::placeholders::_1),
+                    std::tr1::bind(&note_any_score, &decider, our_resolvent, &made_any_of_choices, std::tr1::placeholders::_1));
             std::for_each(indirect_iterator(node.begin()), indirect_iterator(node.end()), accept_visitor(h));
             h.commit(
                     std::tr1::bind(&Finder::make_sanitised, this, std::tr1::placeholders::_1),
@@ -414,6 +434,12 @@ namespace paludis
     struct Implementation<SanitisedDependencies>
     {
         std::list<SanitisedDependency> sanitised_dependencies;
+        bool made_any_of_choices;
+
+        Implementation() :
+            made_any_of_choices(false)
+        {
+        }
     };
 
     template <>
@@ -442,7 +468,7 @@ SanitisedDependencies::_populate_one(
 {
     Context context("When finding dependencies for '" + stringify(*id) + "' from key '" + ((*id).*pmf)()->raw_name() + "':");
 
-    Finder f(decider, resolvent, *this, ((*id).*pmf)()->initial_labels(), ((*id).*pmf)()->raw_name(),
+    Finder f(decider, resolvent, *this, _imp->made_any_of_choices, ((*id).*pmf)()->initial_labels(), ((*id).*pmf)()->raw_name(),
             ((*id).*pmf)()->human_name(), "");
     ((*id).*pmf)()->value()->root()->accept(f);
 }
@@ -476,6 +502,12 @@ SanitisedDependencies::add(const SanitisedDependency & dep)
     _imp->sanitised_dependencies.push_back(dep);
 }
 
+bool
+SanitisedDependencies::made_any_of_choices() const
+{
+    return _imp->made_any_of_choices;
+}
+
 SanitisedDependencies::ConstIterator
 SanitisedDependencies::begin() const
 {
@@ -488,6 +520,97 @@ SanitisedDependencies::end() const
     return ConstIterator(_imp->sanitised_dependencies.end());
 }
 
+namespace paludis
+{
+    template <>
+    struct Implementation<SanitisedDependenciesCache>
+    {
+        struct Entry
+        {
+            std::tr1::shared_ptr<const SanitisedDependencies> sanitised_dependencies;
+            unsigned long generation;
+        };
+
+        typedef std::map<std::tr1::shared_ptr<const PackageID>, Entry, PackageIDSetComparator> ByID;
+        typedef std::map<Resolvent, ByID> ByResolvent;
+
+        ByResolvent entries;
+        unsigned long generation;
+        unsigned hits, misses, stale;
+
+        Implementation() :
+            generation(0),
+            hits(0),
+            misses(0),
+            stale(0)
+        {
+        }
+    };
+}
+
+SanitisedDependenciesCache::SanitisedDependenciesCache() :
+    PrivateImplementationPattern<SanitisedDependenciesCache>(new Implementation<SanitisedDependenciesCache>)
+{
+}
+
+SanitisedDependenciesCache::~SanitisedDependenciesCache()
+{
+}
+
+const std::tr1::shared_ptr<const SanitisedDependencies>
+SanitisedDependenciesCache::sanitised_dependencies_for(
+        const Decider & decider,
+        const Resolvent & resolvent,
+        const std::tr1::shared_ptr<const PackageID> & id)
+{
+    Implementation<SanitisedDependenciesCache>::Entry & entry(_imp->entries[resolvent][id]);
+
+    if (entry.sanitised_dependencies)
+    {
+        /* populating is deterministic apart from any-of choices, so only
+         * those have to be worked out again when the decider changes */
+        if (entry.generation == _imp->generation || ! entry.sanitised_dependencies->made_any_of_choices())
+        {
+            ++_imp->hits;
+            return entry.sanitised_dependencies;
+        }
+
+        ++_imp->stale;
+    }
+    else
+        ++_imp->misses;
+
+    const std::tr1::shared_ptr<SanitisedDependencies> deps(new SanitisedDependencies);
+    deps->populate(decider, resolvent, id);
+    entry.sanitised_dependencies = deps;
+    entry.generation = _imp->generation;
+    return entry.sanitised_dependencies;
+}
+
+void
+SanitisedDependenciesCache::decider_state_changed()
+{
+    ++_imp->generation;
+}
+
+unsigned
+SanitisedDependenciesCache::hits() const
+{
+    return _imp->hits;
+}
+
+unsigned
+SanitisedDependenciesCache::misses() const
+{
+    return _imp->misses;
+}
+
+unsigned
+SanitisedDependenciesCache::stale() const
+{
+    return _imp->stale;
+}
+
 std::ostream &
 paludis::resolver::operator<< (std::ostream & s, const PackageOrBlockDepSpec & d)
 {
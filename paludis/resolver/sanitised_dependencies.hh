@@ -24,6 +24,7 @@
 #include <paludis/resolver/decider-fwd.hh>
 #include <paludis/resolver/resolvent-fwd.hh>
 #include <paludis/util/named_value.hh>
+#include <paludis/util/private_implementation_pattern.hh>
 #include <paludis/dep_label-fwd.hh>
 #include <paludis/dep_spec.hh>
 #include <paludis/spec_tree-fwd.hh>
@@ -99,12 +100,52 @@ namespace paludis
 
                 void add(const SanitisedDependency & d);
 
+                /**
+                 * Did populating have to ask the decider to choose between
+                 * the children of an any-of? If not, the result doesn't
+                 * depend upon the decider's state.
+                 */
+                bool made_any_of_choices() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
                 struct ConstIteratorTag;
                 typedef WrappedForwardIterator<ConstIteratorTag, const SanitisedDependency> ConstIterator;
 
                 ConstIterator begin() const;
                 ConstIterator end() const;
         };
+
+        /**
+         * Remembers populated SanitisedDependencies, so that they need not be
+         * worked out again for every resolver after a restart.
+         */
+        class PALUDIS_VISIBLE SanitisedDependenciesCache :
+            private PrivateImplementationPattern<SanitisedDependenciesCache>
+        {
+            public:
+                SanitisedDependenciesCache();
+                ~SanitisedDependenciesCache();
+
+                const std::tr1::shared_ptr<const SanitisedDependencies> sanitised_dependencies_for(
+                        const Decider &,
+                        const Resolvent &,
+                        const std::tr1::shared_ptr<const PackageID> &) PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Something that Decider::find_any_score looks at has changed,
+                 * so any entry that made any-of choices must be populated
+                 * again.
+                 */
+                void decider_state_changed();
+
+                ///\name Statistics, for profiling
+                ///\{
+
+                unsigned hits() const PALUDIS_ATTRIBUTE((warn_unused_result));
+                unsigned misses() const PALUDIS_ATTRIBUTE((warn_unused_result));
+                unsigned stale() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                ///\}
+        };
     }
 }
 
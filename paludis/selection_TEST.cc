@@ -26,13 +26,16 @@
 #include <paludis/repositories/fake/fake_package_id.hh>
 #include <paludis/user_dep_spec.hh>
 #include <paludis/package_database.hh>
+#include <paludis/selection_cache.hh>
 #include <paludis/util/sequence.hh>
 #include <paludis/util/wrapped_forward_iterator.hh>
 #include <paludis/util/indirect_iterator-impl.hh>
 #include <paludis/util/make_named_values.hh>
+#include <paludis/util/stringify.hh>
 #include <test/test_runner.hh>
 #include <test/test_framework.hh>
 #include <test/test_concepts.hh>
+#include <cstdlib>
 
 using namespace paludis;
 using namespace test;
@@ -109,6 +112,85 @@ namespace test_cases
         }
     } basic_selections_test;
 
+    struct CachedSelectionsTest : TestCase
+    {
+        CachedSelectionsTest() : TestCase("cached selections") { }
+
+        void run()
+        {
+            TestEnvironment env;
+
+            std::tr1::shared_ptr<FakeRepository> r1(new FakeRepository(make_named_values<FakeRepositoryParams>(
+                            value_for<n::environment>(&env),
+                            value_for<n::name>(RepositoryName("repo1")))));
+            r1->add_version("cat", "pkg", "1");
+            r1->add_version("cat", "pkg", "2");
+            r1->add_version("cat", "other", "1");
+            env.package_database()->add_repository(10, r1);
+
+            ScopedSelectionCache cache(&env);
+            PackageDepSpec d(parse_user_package_dep_spec("cat/pkg", &env, UserPackageDepSpecOptions()));
+            PackageDepSpec o(parse_user_package_dep_spec("cat/other", &env, UserPackageDepSpecOptions()));
+
+            const std::tr1::shared_ptr<const PackageIDSequence> q1(env[selection::AllVersionsSorted(generator::Matches(d, MatchPackageOptions()))]);
+            TEST_CHECK_EQUAL(join(indirect_iterator(q1->begin()), indirect_iterator(q1->end()), " "),
+                    "cat/pkg-1:0::repo1 cat/pkg-2:0::repo1");
+
+            const std::tr1::shared_ptr<const PackageIDSequence> q2(env[selection::AllVersionsSorted(generator::Matches(d, MatchPackageOptions()))]);
+            TEST_CHECK(q1 == q2);
+
+            const std::tr1::shared_ptr<const PackageIDSequence> q3(env[selection::AllVersionsSorted(generator::Matches(o, MatchPackageOptions()))]);
+            TEST_CHECK(q1 != q3);
+            TEST_CHECK_EQUAL(join(indirect_iterator(q3->begin()), indirect_iterator(q3->end()), " "),
+                    "cat/other-1:0::repo1");
+            TEST_CHECK_EQUAL(join(indirect_iterator(q1->begin()), indirect_iterator(q1->end()), " "),
+                    "cat/pkg-1:0::repo1 cat/pkg-2:0::repo1");
+        }
+    } cached_selections_test;
+
+    struct ParallelSelectionsTest : TestCase
+    {
+        ParallelSelectionsTest() : TestCase("parallel selections") { }
+
+        std::string join_ids(const std::tr1::shared_ptr<const PackageIDSequence> & ids)
+        {
+            return join(indirect_iterator(ids->begin()), indirect_iterator(ids->end()), " ");
+        }
+
+        std::string get(const Environment & env, const std::string & threads)
+        {
+            setenv("PALUDIS_GENERATOR_THREADS", threads.c_str(), 1);
+            PackageDepSpec d(parse_user_package_dep_spec("cat/pkg", &env, UserPackageDepSpecOptions()));
+            std::string result(
+                    join_ids(env[selection::AllVersionsSorted(generator::All())]) + "; " +
+                    join_ids(env[selection::AllVersionsSorted(generator::Category(CategoryNamePart("cat")))]) + "; " +
+                    join_ids(env[selection::AllVersionsSorted(generator::Matches(d, MatchPackageOptions()))]));
+            unsetenv("PALUDIS_GENERATOR_THREADS");
+            return result;
+        }
+
+        void run()
+        {
+            TestEnvironment env;
+
+            for (int i(1) ; i <= 5 ; ++i)
+            {
+                std::tr1::shared_ptr<FakeRepository> r(new FakeRepository(make_named_values<FakeRepositoryParams>(
+                                value_for<n::environment>(&env),
+                                value_for<n::name>(RepositoryName("repo" + stringify(i))))));
+                r->add_version("cat", "pkg", stringify(i));
+                r->add_version("cat", "other" + stringify(i), "1");
+                r->add_version("cat" + stringify(i), "pkg", "1");
+                env.package_database()->add_repository(i, r);
+            }
+
+            std::string sequential(get(env, "1"));
+            TEST_CHECK_EQUAL(get(env, "4"), sequential);
+            TEST_CHECK_EQUAL(get(env, "16"), sequential);
+            TEST_CHECK_EQUAL(get(env, "bad"), sequential);
+        }
+    } parallel_selections_test;
+
     struct SelectionsTest : TestCase
     {
         SelectionsTest() : TestCase("selections") { }
@@ -22,23 +22,34 @@
 #include <paludis/util/mutex.hh>
 #include <paludis/util/sequence.hh>
 #include <paludis/util/wrapped_forward_iterator.hh>
-#include <paludis/util/wrapped_output_iterator.hh>
+#include <paludis/util/hashes.hh>
 #include <paludis/environment.hh>
 #include <paludis/selection.hh>
 #include <tr1/unordered_map>
-#include <algorithm>
 
 using namespace paludis;
 
-typedef std::tr1::unordered_map<std::string, std::tr1::shared_ptr<const PackageIDSequence> > Cache;
+namespace
+{
+    typedef std::tr1::unordered_map<std::string, std::tr1::shared_ptr<const PackageIDSequence>, Hash<std::string> > Cache;
+
+    /* lookups for different selections mostly go to different shards, so
+     * they don't have to wait for each other */
+    const unsigned number_of_shards(16);
+
+    struct Shard
+    {
+        Mutex mutex;
+        Cache cache;
+    };
+}
 
 namespace paludis
 {
     template <>
     struct Implementation<SelectionCache>
     {
-        mutable Mutex mutex;
-        mutable Cache cache;
+        mutable Shard shards[number_of_shards];
     };
 
     template <>
@@ -64,23 +75,31 @@ SelectionCache::~SelectionCache()
 {
 }
 
-const std::tr1::shared_ptr<PackageIDSequence>
+const std::tr1::shared_ptr<const PackageIDSequence>
 SelectionCache::perform_select(const Environment * const env, const Selection & s) const
 {
     std::string ss(s.as_string());
-    Cache::const_iterator i(_imp->cache.end());
+    Shard & shard(_imp->shards[Hash<std::string>()(ss) % number_of_shards]);
+
+    std::tr1::shared_ptr<const PackageIDSequence> cached;
+    {
+        Lock lock(shard.mutex);
+        Cache::const_iterator i(shard.cache.find(ss));
+        if (shard.cache.end() != i)
+            cached = i->second;
+    }
 
+    if (! cached)
     {
-        Lock lock(_imp->mutex);
-        i = _imp->cache.find(ss);
+        /* don't hold the lock whilst we work, so that other lookups can carry
+         * on. if someone else beats us to it, use theirs. */
+        std::tr1::shared_ptr<const PackageIDSequence> result(s.perform_select(env));
 
-        if (_imp->cache.end() == i)
-            i = _imp->cache.insert(std::make_pair(ss, s.perform_select(env))).first;
+        Lock lock(shard.mutex);
+        cached = shard.cache.insert(std::make_pair(ss, result)).first->second;
     }
 
-    std::tr1::shared_ptr<PackageIDSequence> result(new PackageIDSequence);
-    std::copy(i->second->begin(), i->second->end(), result->back_inserter());
-    return result;
+    return cached;
 }
 
 ScopedSelectionCache::ScopedSelectionCache(Environment * const e) :
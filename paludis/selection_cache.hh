@@ -36,7 +36,7 @@ namespace paludis
             SelectionCache();
             ~SelectionCache();
 
-            const std::tr1::shared_ptr<PackageIDSequence> perform_select(
+            const std::tr1::shared_ptr<const PackageIDSequence> perform_select(
                     const Environment * const,
                     const Selection &) const PALUDIS_ATTRIBUTE((warn_unused_result));
     };
@@ -300,7 +300,7 @@ paludis::parse_user_package_dep_spec(const std::string & ss, const Environment *
 {
     using namespace std::tr1::placeholders;
 
-    Context context("When parsing user package dep spec '" + ss + "':");
+    Context context("When parsing user package dep spec '", ss, "':");
 
     bool had_bracket_version_requirements(false);
     PartiallyMadePackageDepSpecOptions o;
@@ -76,6 +76,7 @@ DEFS=\
 EXTRA_DIST = util.hh.m4 Makefile.am.m4 files.m4 srlist srcleanlist selist secleanlist \
 	testscriptlist \
 	test_extras.cc \
+	benchmark_extras.cc benchmark_extras.hh \
 	echo_functions.bash.in
 SUBDIRS = .
 
@@ -85,13 +86,24 @@ libpaludisutil_@PALUDIS_PC_SLOT@_la_LIBADD = $(PTHREAD_LIBS) $(RT_LIBS)
 
 TESTS = testlist
 
-check_PROGRAMS = $(TESTS) system_TEST_become_child
+check_PROGRAMS = $(TESTS) system_TEST_become_child log_benchmark
 check_SCRIPTS = testscriptlist
 
 system_TEST_become_child_SOURCES = system_TEST_become_child.cc
 system_TEST_become_child_LDADD = \
 	libpaludisutil_@PALUDIS_PC_SLOT@.la
 
+log_benchmark_SOURCES = log_benchmark.cc
+log_benchmark_LDADD = \
+	benchmark_extras.o \
+	libpaludisutil_@PALUDIS_PC_SLOT@.la
+log_benchmark_CXXFLAGS = -I$(top_srcdir) $(AM_CXXFLAGS) @PALUDIS_CXXFLAGS_NO_DEBUGGING@
+
+benchmark : log_benchmark
+	./log_benchmark $(BENCHMARK_OPTIONS)
+
+.PHONY : benchmark
+
 lib_LTLIBRARIES = libpaludisutil_@PALUDIS_PC_SLOT@.la
 
 paludis_util_includedir = $(includedir)/paludis-$(PALUDIS_PC_SLOT)/paludis/util/
@@ -0,0 +1,73 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/util/benchmark_extras.hh>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    /* some things, like the log, allocate from their own threads */
+    unsigned long allocations_count(0);
+    unsigned long long allocated_bytes_count(0);
+
+    void * counted_allocate(std::size_t s)
+    {
+        __sync_fetch_and_add(&allocations_count, 1);
+        __sync_fetch_and_add(&allocated_bytes_count, s);
+
+        void * result(std::malloc(0 == s ? 1 : s));
+        if (! result)
+            throw std::bad_alloc();
+        return result;
+    }
+}
+
+void * operator new (std::size_t s) throw (std::bad_alloc)
+{
+    return counted_allocate(s);
+}
+
+void * operator new[] (std::size_t s) throw (std::bad_alloc)
+{
+    return counted_allocate(s);
+}
+
+void operator delete (void * p) throw ()
+{
+    std::free(p);
+}
+
+void operator delete[] (void * p) throw ()
+{
+    std::free(p);
+}
+
+unsigned long
+paludis::benchmark_extras::allocations()
+{
+    return __sync_fetch_and_add(&allocations_count, 0);
+}
+
+unsigned long long
+paludis::benchmark_extras::allocated_bytes()
+{
+    return __sync_fetch_and_add(&allocated_bytes_count, 0);
+}
@@ -0,0 +1,48 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef PALUDIS_GUARD_PALUDIS_UTIL_BENCHMARK_EXTRAS_HH
+#define PALUDIS_GUARD_PALUDIS_UTIL_BENCHMARK_EXTRAS_HH 1
+
+/** \file
+ * Allocation counting for benchmarks.
+ *
+ * Linking against benchmark_extras.o replaces the global operator new and
+ * operator delete with versions that count what is allocated. It is for
+ * benchmark programs only, and is never part of a library or test.
+ */
+
+namespace paludis
+{
+    namespace benchmark_extras
+    {
+        /**
+         * How many allocations have been made so far, from any thread.
+         */
+        unsigned long allocations();
+
+        /**
+         * How many bytes have been allocated so far, from any thread.
+         */
+        unsigned long long allocated_bytes();
+    }
+}
+
+#endif
@@ -0,0 +1,153 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_UTIL_DIGEST_BLOCKS_HH
+#define PALUDIS_GUARD_PALUDIS_UTIL_DIGEST_BLOCKS_HH 1
+
+#include <algorithm>
+#include <istream>
+#include <cstring>
+#include <cstddef>
+#include <inttypes.h>
+
+#ifdef HAVE_X86_SHA_EXTENSIONS
+#  include <cpuid.h>
+#endif
+
+/*
+ * Block buffering and padding shared by the MD5, SHA-1, SHA-256 and RMD160
+ * implementations, all of which work on 64 byte blocks and pad in the same
+ * way. Not installed.
+ */
+
+namespace paludis
+{
+    namespace digest_blocks
+    {
+        /**
+         * Feed data to a digest, calling process for as many whole blocks at
+         * a time as possible and buffering any partial block.
+         */
+        template <typename T_>
+        void update(T_ & t, void (T_::* const process)(const uint8_t * const, std::size_t),
+                uint8_t * const buffer, unsigned & buffer_used, uint64_t & size,
+                const uint8_t * data, std::size_t length)
+        {
+            size += length;
+
+            if (0 != buffer_used)
+            {
+                std::size_t n(std::min<std::size_t>(64 - buffer_used, length));
+                std::memcpy(buffer + buffer_used, data, n);
+                buffer_used += n;
+                data += n;
+                length -= n;
+
+                if (64 != buffer_used)
+                    return;
+
+                (t.*process)(buffer, 1);
+                buffer_used = 0;
+            }
+
+            if (length >= 64)
+            {
+                (t.*process)(data, length / 64);
+                data += length - (length % 64);
+                length %= 64;
+            }
+
+            if (0 != length)
+            {
+                std::memcpy(buffer, data, length);
+                buffer_used = length;
+            }
+        }
+
+        /**
+         * Pad the final block and append the message length in bits, in
+         * either big endian or little endian order.
+         */
+        template <typename T_>
+        void finish(T_ & t, void (T_::* const process)(const uint8_t * const, std::size_t),
+                uint8_t * const buffer, unsigned & buffer_used, const uint64_t size,
+                const bool big_endian_length)
+        {
+            buffer[buffer_used++] = 0x80;
+
+            if (buffer_used > 56)
+            {
+                std::fill(buffer + buffer_used, buffer + 64, 0);
+                (t.*process)(buffer, 1);
+                buffer_used = 0;
+            }
+
+            std::fill(buffer + buffer_used, buffer + 56, 0);
+
+            const uint64_t bits(size * 8);
+            for (int i(0) ; i < 8 ; ++i)
+                buffer[56 + i] = static_cast<uint8_t>(bits >> ((big_endian_length ? 7 - i : i) * 8));
+
+            (t.*process)(buffer, 1);
+            buffer_used = 0;
+        }
+
+        /**
+         * Feed everything in a stream to a digest.
+         */
+        template <typename T_>
+        void update_from_stream(T_ & t, std::istream & stream)
+        {
+            std::streambuf * const buf(stream.rdbuf());
+            char data[65536];
+
+            std::streamsize n;
+            while (0 < ((n = buf->sgetn(data, sizeof(data)))))
+                t.update(data, n);
+
+            stream.setstate(std::ios::eofbit);
+        }
+
+        /**
+         * Can we use the x86 SHA extensions (along with the SSSE3 and SSE4.1
+         * instructions our kernels use)? If we weren't built with support
+         * for them, we can't.
+         */
+        inline bool have_x86_sha_extensions()
+        {
+#ifdef HAVE_X86_SHA_EXTENSIONS
+            unsigned a, b, c, d;
+
+            if (__get_cpuid_max(0, 0) < 7)
+                return false;
+
+            __cpuid(1, a, b, c, d);
+            if (! ((c & bit_SSSE3) && (c & bit_SSE4_1)))
+                return false;
+
+            __cpuid_count(7, 0, a, b, c, d);
+            return b & (1U << 29);
+#else
+            return false;
+#endif
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,181 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/util/digests.hh>
+#include <paludis/util/digest_blocks.hh>
+#include <paludis/util/md5.hh>
+#include <paludis/util/rmd160.hh>
+#include <paludis/util/sha1.hh>
+#include <paludis/util/sha256.hh>
+#include <paludis/util/fs_entry.hh>
+#include <paludis/util/fd_holder.hh>
+#include <paludis/util/exception.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/private_implementation_pattern-impl.hh>
+#include <tr1/memory>
+#include <istream>
+#include <cstring>
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace paludis;
+
+#include <paludis/util/digests-se.cc>
+
+namespace paludis
+{
+    template <>
+    struct Implementation<Digests>
+    {
+        std::tr1::shared_ptr<MD5> md5;
+        std::tr1::shared_ptr<RMD160> rmd160;
+        std::tr1::shared_ptr<SHA1> sha1;
+        std::tr1::shared_ptr<SHA256> sha256;
+    };
+}
+
+Digests::Digests(const DigestKinds & kinds) :
+    PrivateImplementationPattern<Digests>(new Implementation<Digests>)
+{
+    if (kinds[dk_md5])
+        _imp->md5.reset(new MD5);
+    if (kinds[dk_rmd160])
+        _imp->rmd160.reset(new RMD160);
+    if (kinds[dk_sha1])
+        _imp->sha1.reset(new SHA1);
+    if (kinds[dk_sha256])
+        _imp->sha256.reset(new SHA256);
+}
+
+Digests::~Digests()
+{
+}
+
+void
+Digests::update(const void * const data, const std::size_t length)
+{
+    if (_imp->md5)
+        _imp->md5->update(data, length);
+    if (_imp->rmd160)
+        _imp->rmd160->update(data, length);
+    if (_imp->sha1)
+        _imp->sha1->update(data, length);
+    if (_imp->sha256)
+        _imp->sha256->update(data, length);
+}
+
+void
+Digests::update(std::istream & stream)
+{
+    digest_blocks::update_from_stream(*this, stream);
+}
+
+void
+Digests::update(const FSEntry & f)
+{
+    FDHolder fd(::open(stringify(f).c_str(), O_RDONLY), false);
+    if (-1 == fd)
+        throw FSError("Cannot open '" + stringify(f) + "' for reading: " + ::strerror(errno));
+
+    struct stat st;
+    if (0 != ::fstat(fd, &st))
+        throw FSError("Cannot fstat '" + stringify(f) + "': " + ::strerror(errno));
+
+    /* mmap saves copying everything through a buffer, but it only makes
+     * sense for non-empty regular files that fit in our address space. If
+     * it fails for any reason, just read the file instead. */
+    if (S_ISREG(st.st_mode) && 0 < st.st_size &&
+            static_cast<uint64_t>(st.st_size) == static_cast<std::size_t>(st.st_size))
+    {
+        void * map(::mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0));
+        if (MAP_FAILED != map)
+        {
+            ::madvise(map, st.st_size, MADV_SEQUENTIAL);
+            update(map, st.st_size);
+            ::munmap(map, st.st_size);
+            return;
+        }
+    }
+
+    char buffer[65536];
+    while (true)
+    {
+        ssize_t n(::read(fd, buffer, sizeof(buffer)));
+        if (0 == n)
+            break;
+        else if (-1 == n)
+        {
+            if (EINTR == errno)
+                continue;
+            throw FSError("Cannot read '" + stringify(f) + "': " + ::strerror(errno));
+        }
+        update(buffer, n);
+    }
+}
+
+void
+Digests::finish()
+{
+    if (_imp->md5)
+        _imp->md5->finish();
+    if (_imp->rmd160)
+        _imp->rmd160->finish();
+    if (_imp->sha1)
+        _imp->sha1->finish();
+    if (_imp->sha256)
+        _imp->sha256->finish();
+}
+
+std::string
+Digests::hexsum(const DigestKind k) const
+{
+    switch (k)
+    {
+        case dk_md5:
+            if (_imp->md5)
+                return _imp->md5->hexsum();
+            break;
+
+        case dk_rmd160:
+            if (_imp->rmd160)
+                return _imp->rmd160->hexsum();
+            break;
+
+        case dk_sha1:
+            if (_imp->sha1)
+                return _imp->sha1->hexsum();
+            break;
+
+        case dk_sha256:
+            if (_imp->sha256)
+                return _imp->sha256->hexsum();
+            break;
+
+        case last_dk:
+            break;
+    }
+
+    throw InternalError(PALUDIS_HERE, "Digest '" + stringify(k) + "' was not requested");
+}
+
+template class PrivateImplementationPattern<Digests>;
@@ -0,0 +1,100 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_UTIL_DIGESTS_HH
+#define PALUDIS_GUARD_PALUDIS_UTIL_DIGESTS_HH 1
+
+#include <paludis/util/digests-fwd.hh>
+#include <paludis/util/private_implementation_pattern.hh>
+#include <paludis/util/fs_entry-fwd.hh>
+#include <paludis/util/options.hh>
+#include <string>
+#include <cstddef>
+
+/** \file
+ * Declarations for the Digests class.
+ *
+ * \ingroup g_digests
+ *
+ * \section Examples
+ *
+ * - None at this time.
+ */
+
+namespace paludis
+{
+    /**
+     * Calculates several kinds of digest in a single pass over some data.
+     *
+     * Each buffer passed to update() is handed to every requested digest in
+     * turn, so a large file only has to be read once however many kinds of
+     * digest are wanted.
+     *
+     * \ingroup g_digests
+     * \since 0.48
+     */
+    class PALUDIS_VISIBLE Digests :
+        private PrivateImplementationPattern<Digests>
+    {
+        public:
+            ///\name Basic operations
+            ///\{
+
+            Digests(const DigestKinds &);
+            ~Digests();
+
+            ///\}
+
+            /**
+             * Add more data to every digest.
+             */
+            void update(const void * const data, const std::size_t length);
+
+            /**
+             * Add everything in a stream to every digest.
+             */
+            void update(std::istream &);
+
+            /**
+             * Add the contents of a file to every digest, mapping the file
+             * into memory where possible.
+             *
+             * \throw FSError if the file cannot be read.
+             */
+            void update(const FSEntry &);
+
+            /**
+             * Finish every digest, after which hexsum() may be called and
+             * update() may not.
+             */
+            void finish();
+
+            /**
+             * The checksum for a particular kind of digest, as a string of
+             * hex characters. The kind must have been requested.
+             */
+            std::string hexsum(const DigestKind) const PALUDIS_ATTRIBUTE((warn_unused_result));
+    };
+
+#ifdef PALUDIS_HAVE_EXTERN_TEMPLATE
+    extern template class PrivateImplementationPattern<Digests>;
+#endif
+}
+
+#endif
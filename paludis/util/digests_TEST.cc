@@ -0,0 +1,112 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/util/digests.hh>
+#include <paludis/util/fs_entry.hh>
+#include <paludis/util/exception.hh>
+#include <test/test_framework.hh>
+#include <test/test_runner.hh>
+#include <sstream>
+#include <algorithm>
+
+using namespace paludis;
+using namespace test;
+
+namespace
+{
+    const DigestKinds all_kinds(DigestKinds() + dk_md5 + dk_rmd160 + dk_sha1 + dk_sha256);
+}
+
+namespace test_cases
+{
+    struct DigestsAbcTest : TestCase
+    {
+        DigestsAbcTest() : TestCase("abc") { }
+
+        void run()
+        {
+            Digests d(all_kinds);
+            d.update("abc", 3);
+            d.finish();
+
+            TEST_CHECK_EQUAL(d.hexsum(dk_md5), "900150983cd24fb0d6963f7d28e17f72");
+            TEST_CHECK_EQUAL(d.hexsum(dk_rmd160), "8eb208f7e05d987a9b044a8e98c6b087f15a0bfc");
+            TEST_CHECK_EQUAL(d.hexsum(dk_sha1), "a9993e364706816aba3e25717850c26c9cd0d89d");
+            TEST_CHECK_EQUAL(d.hexsum(dk_sha256), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        }
+    } test_digests_abc;
+
+    struct DigestsChunksTest : TestCase
+    {
+        DigestsChunksTest() : TestCase("chunks") { }
+
+        void run()
+        {
+            std::string data;
+            for (int i(0) ; i < 5000 ; ++i)
+                data.append(1, static_cast<char>((i * 7) % 251));
+
+            Digests whole(all_kinds);
+            whole.update(data.data(), data.length());
+            whole.finish();
+
+            for (std::string::size_type chunk(1) ; chunk < 200 ; chunk += 13)
+            {
+                Digests pieces(all_kinds);
+                for (std::string::size_type p(0) ; p < data.length() ; p += chunk)
+                    pieces.update(data.data() + p, std::min(chunk, data.length() - p));
+                pieces.finish();
+
+                TEST_CHECK_EQUAL(pieces.hexsum(dk_md5), whole.hexsum(dk_md5));
+                TEST_CHECK_EQUAL(pieces.hexsum(dk_rmd160), whole.hexsum(dk_rmd160));
+                TEST_CHECK_EQUAL(pieces.hexsum(dk_sha1), whole.hexsum(dk_sha1));
+                TEST_CHECK_EQUAL(pieces.hexsum(dk_sha256), whole.hexsum(dk_sha256));
+            }
+
+            std::stringstream s(data);
+            Digests stream(all_kinds);
+            stream.update(s);
+            stream.finish();
+            TEST_CHECK_EQUAL(stream.hexsum(dk_sha256), whole.hexsum(dk_sha256));
+        }
+    } test_digests_chunks;
+
+    struct DigestsFileTest : TestCase
+    {
+        DigestsFileTest() : TestCase("file") { }
+
+        void run()
+        {
+            Digests abc(DigestKinds() + dk_sha1 + dk_md5);
+            abc.update(FSEntry("digests_TEST_dir/abc"));
+            abc.finish();
+            TEST_CHECK_EQUAL(abc.hexsum(dk_md5), "900150983cd24fb0d6963f7d28e17f72");
+            TEST_CHECK_EQUAL(abc.hexsum(dk_sha1), "a9993e364706816aba3e25717850c26c9cd0d89d");
+            TEST_CHECK_THROWS(std::string x(abc.hexsum(dk_sha256)), InternalError);
+
+            Digests empty(DigestKinds() + dk_sha256);
+            empty.update(FSEntry("digests_TEST_dir/empty"));
+            empty.finish();
+            TEST_CHECK_EQUAL(empty.hexsum(dk_sha256), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+
+            Digests missing(DigestKinds() + dk_sha256);
+            TEST_CHECK_THROWS(missing.update(FSEntry("digests_TEST_dir/missing")), FSError);
+        }
+    } test_digests_file;
+}
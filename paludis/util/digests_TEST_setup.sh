@@ -0,0 +1,7 @@
+#!/usr/bin/env bash
+# vim: set ft=sh sw=4 sts=4 et :
+
+mkdir digests_TEST_dir || exit 2
+cd digests_TEST_dir || exit 3
+echo -n abc > abc || exit 4
+touch empty || exit 5
@@ -35,35 +35,60 @@ using namespace paludis;
 
 namespace
 {
-    PALUDIS_TLS std::list<std::string> * context = 0;
+    /* Contexts live on the stack, and each one remembers the one before it,
+     * so we never need to allocate anything to keep track of them */
+    PALUDIS_TLS const Context * current_context = 0;
 }
 
-Context::Context(const std::string & s)
+Context::Context(const std::string & s) :
+    _text(s)
 {
-    if (! context)
-        context = new std::list<std::string>;
-    context->push_back(s);
+    _parts[0] = 0;
+    _push();
 }
 
 Context::~Context()
 {
-    if (! context)
+    if (current_context != this)
         throw InternalError(PALUDIS_HERE, "no context");
-    context->pop_back();
-    if (context->empty())
+    current_context = _previous;
+}
+
+void
+Context::_push()
+{
+    _previous = current_context;
+    current_context = this;
+}
+
+void
+Context::_append_to(std::string & s) const
+{
+    if (! _parts[0])
     {
-        delete context;
-        context = 0;
+        s.append(_text);
+        return;
+    }
+
+    s.append(_parts[0]);
+    for (int n(0) ; n < 2 && _parts[n + 1] ; ++n)
+    {
+        _formatters[n](s, _values[n]);
+        s.append(_parts[n + 1]);
     }
 }
 
 std::string
 Context::backtrace(const std::string & delim)
 {
-    if (! context)
+    std::list<std::string> texts;
+    for (const Context * c(current_context) ; c ; c = c->_previous)
+        c->_append_to(*texts.insert(texts.begin(), std::string()));
+
+    if (texts.empty())
         return "";
 
-    return join(context->begin(), context->end(), delim) + delim;
+    return join(texts.begin(), texts.end(), delim) + delim;
 }
 
 namespace paludis
@@ -74,8 +99,6 @@ namespace paludis
 
         ContextData()
         {
-            if (context)
-                local_context.assign(context->begin(), context->end());
         }
 
         ContextData(const ContextData & other) :
@@ -89,6 +112,8 @@ Exception::Exception(const std::string & m) throw () :
     _message(m),
     _context_data(new ContextData)
 {
+    for (const Context * c(current_context) ; c ; c = c->_previous)
+        c->_append_to(*_context_data->local_context.insert(_context_data->local_context.begin(), std::string()));
 }
 
 Exception::Exception(const Exception & other) :
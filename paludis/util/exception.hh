@@ -21,8 +21,10 @@
 #define PALUDIS_GUARD_PALUDIS_EXCEPTION_HH 1
 
 #include <paludis/util/attributes.hh>
+#include <paludis/util/stringify.hh>
 #include <string>
 #include <exception>
+#include <cstddef>
 
 /** \file
  * Declaration for the Exception base class, the InternalError exception
@@ -40,21 +42,96 @@ namespace paludis
     /**
      * Backtrace context class.
      *
+     * A Context only turns into text if a backtrace is needed, which is rare.
+     * Where a Context is created often, prefer the forms taking string
+     * literals and values to be stringified, such as
+     * <code>Context context("When loading '", f, "':")</code>, over building
+     * the string up front. Values are held by reference, so they must
+     * outlive the Context.
+     *
      * \ingroup g_exceptions
      * \nosubgrouping
      */
     class PALUDIS_VISIBLE Context
     {
+        friend class Exception;
+
         private:
+            typedef void (* Formatter)(std::string &, const void * const);
+
+            const Context * _previous;
+            std::string _text;
+            const char * _parts[3];
+            const void * _values[2];
+            Formatter _formatters[2];
+
             Context(const Context &);
             const Context & operator= (const Context &);
 
+            template <typename T_>
+            static void _format(std::string & s, const void * const t)
+            {
+                s.append(stringify(*static_cast<const T_ *>(t)));
+            }
+
+            void _push();
+            void _append_to(std::string &) const;
+
         public:
             ///\name Basic operations
             ///\{
 
             Context(const std::string &);
 
+            /**
+             * Constructor, from a string literal.
+             *
+             * \since 0.48
+             */
+            template <std::size_t a_>
+            Context(const char (& a)[a_])
+            {
+                _parts[0] = a;
+                _parts[1] = 0;
+                _push();
+            }
+
+            /**
+             * Constructor, from a string literal, a value to be stringified
+             * if necessary, and another string literal.
+             *
+             * \since 0.48
+             */
+            template <std::size_t a_, typename T_, std::size_t b_>
+            Context(const char (& a)[a_], T_ & t, const char (& b)[b_])
+            {
+                _parts[0] = a;
+                _values[0] = &t;
+                _formatters[0] = &_format<T_>;
+                _parts[1] = b;
+                _parts[2] = 0;
+                _push();
+            }
+
+            /**
+             * Constructor, from string literals and two values to be
+             * stringified if necessary.
+             *
+             * \since 0.48
+             */
+            template <std::size_t a_, typename T_, std::size_t b_, typename U_, std::size_t c_>
+            Context(const char (& a)[a_], T_ & t, const char (& b)[b_], U_ & u, const char (& c)[c_])
+            {
+                _parts[0] = a;
+                _values[0] = &t;
+                _formatters[0] = &_format<T_>;
+                _parts[1] = b;
+                _values[1] = &u;
+                _formatters[1] = &_format<U_>;
+                _parts[2] = c;
+                _push();
+            }
+
             ~Context();
 
             ///\}
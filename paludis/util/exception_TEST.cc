@@ -0,0 +1,91 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/util/exception.hh>
+#include <string>
+#include <test/test_framework.hh>
+#include <test/test_runner.hh>
+
+using namespace test;
+using namespace paludis;
+
+namespace test_cases
+{
+    struct ContextBacktraceTest : TestCase
+    {
+        ContextBacktraceTest() : TestCase("context backtrace") { }
+
+        void run()
+        {
+            TEST_CHECK_EQUAL(Context::backtrace("|"), "");
+
+            Context c1("one");
+            const std::string two("two");
+            Context c2("When doing '" + two + "':");
+            int n(3);
+            Context c3("At ", n, ":");
+            const std::string four("four");
+            Context c4("From '", four, "' to '", n, "':");
+
+            TEST_CHECK_EQUAL(Context::backtrace("|"), "one|When doing 'two':|At 3:|From 'four' to '3':|");
+
+            n = 5;
+            TEST_CHECK_EQUAL(Context::backtrace("|"), "one|When doing 'two':|At 5:|From 'four' to '5':|");
+        }
+    } test_context_backtrace;
+
+    struct ContextUnwindTest : TestCase
+    {
+        ContextUnwindTest() : TestCase("context unwind") { }
+
+        void run()
+        {
+            Context c1("outer");
+            {
+                const std::string s("inner");
+                Context c2("In ", s, ":");
+                TEST_CHECK_EQUAL(Context::backtrace("|"), "outer|In inner:|");
+            }
+            TEST_CHECK_EQUAL(Context::backtrace("|"), "outer|");
+        }
+    } test_context_unwind;
+
+    struct ExceptionContextTest : TestCase
+    {
+        ExceptionContextTest() : TestCase("exception context") { }
+
+        void run()
+        {
+            try
+            {
+                const std::string s("thing");
+                Context c1("When doing '", s, "':");
+                throw InternalError(PALUDIS_HERE, "oops");
+            }
+            catch (const Exception & e)
+            {
+                TEST_CHECK(! e.empty());
+                TEST_CHECK_EQUAL(e.backtrace("|"), "When doing 'thing':|");
+            }
+
+            TEST_CHECK_EQUAL(Context::backtrace("|"), "");
+        }
+    } test_exception_context;
+}
+
@@ -21,14 +21,18 @@
 #include <paludis/util/private_implementation_pattern-impl.hh>
 #include <paludis/util/mutex.hh>
 #include <paludis/util/condition_variable.hh>
-#include <paludis/util/thread.hh>
-#include <paludis/util/make_shared_ptr.hh>
+#include <paludis/util/thread_pool.hh>
+#include <paludis/util/timestamp.hh>
+#include <tr1/functional>
 #include <map>
 #include <list>
+#include <deque>
 
 using namespace paludis;
 
-typedef std::multimap<std::string, std::tr1::shared_ptr<Executive> > Queues;
+typedef std::map<std::string, std::list<std::tr1::shared_ptr<Executive> > > Queues;
+typedef std::map<std::string, std::tr1::shared_ptr<Executive> > Running;
+typedef std::deque<std::tr1::shared_ptr<Executive> > ReadyToRun;
 typedef std::list<std::tr1::shared_ptr<Executive> > ReadyForPost;
 
 Executive::~Executive()
@@ -40,26 +44,69 @@ namespace paludis
     template <>
     struct Implementation<Executor>
     {
+        const unsigned max_active;
+
         int pending;
         int active;
         int done;
 
         Queues queues;
+        ReadyToRun ready_to_run;
         ReadyForPost ready_for_post;
+        bool finished;
+
         Mutex mutex;
         ConditionVariable condition;
+        ConditionVariable work_condition;
 
-        Implementation() :
+        Implementation(const unsigned m) :
+            max_active(m),
             pending(0),
             active(0),
-            done(0)
+            done(0),
+            finished(false)
         {
         }
     };
 }
 
+namespace
+{
+    /* the first runnable executive from the first queue after last that
+     * isn't already running something, wrapping round */
+    bool find_next(Queues & queues, const Running & running, const std::string & last,
+            Queues::iterator & queue, std::list<std::tr1::shared_ptr<Executive> >::iterator & executive)
+    {
+        Queues::iterator start(queues.upper_bound(last));
+        for (Queues::size_type n(0), n_end(queues.size()) ; n < n_end ; ++n, ++start)
+        {
+            if (queues.end() == start)
+                start = queues.begin();
+
+            if (running.end() != running.find(start->first))
+                continue;
+
+            for (std::list<std::tr1::shared_ptr<Executive> >::iterator x(start->second.begin()), x_end(start->second.end()) ;
+                    x != x_end ; ++x)
+                if ((*x)->can_run())
+                {
+                    queue = start;
+                    executive = x;
+                    return true;
+                }
+        }
+
+        return false;
+    }
+}
+
 Executor::Executor() :
-    PrivateImplementationPattern<Executor>(new Implementation<Executor>)
+    PrivateImplementationPattern<Executor>(new Implementation<Executor>(0))
+{
+}
+
+Executor::Executor(const unsigned m) :
+    PrivateImplementationPattern<Executor>(new Implementation<Executor>(m))
 {
 }
 
@@ -68,15 +115,30 @@ Executor::~Executor()
 }
 
 void
-Executor::_one(const std::tr1::shared_ptr<Executive> executive)
+Executor::_work() throw ()
 {
-    executive->execute_threaded();
+    while (true)
+    {
+        std::tr1::shared_ptr<Executive> executive;
+        {
+            Lock lock(_imp->mutex);
+            while (_imp->ready_to_run.empty() && ! _imp->finished)
+                _imp->work_condition.wait(_imp->mutex);
 
-    Lock lock(_imp->mutex);
-    _imp->ready_for_post.push_back(executive);
-    _imp->condition.signal();
-}
+            if (_imp->ready_to_run.empty())
+                return;
 
+            executive = _imp->ready_to_run.front();
+            _imp->ready_to_run.pop_front();
+        }
+
+        executive->execute_threaded();
+
+        Lock lock(_imp->mutex);
+        _imp->ready_for_post.push_back(executive);
+        _imp->condition.signal();
+    }
+}
 
 int
 Executor::pending() const
@@ -100,58 +162,88 @@ void
 Executor::add(const std::tr1::shared_ptr<Executive> & x)
 {
     ++_imp->pending;
-    _imp->queues.insert(std::make_pair(x->queue_name(), x));
+    _imp->queues[x->queue_name()].push_back(x);
 }
 
 void
 Executor::execute()
 {
-    typedef std::map<std::string, std::pair<std::tr1::shared_ptr<Thread>, std::tr1::shared_ptr<Executive> > > Running;
-    Running running;
+    /* must outlive the lock, so that our threads can finish */
+    ThreadPool pool;
 
     Lock lock(_imp->mutex);
-    while (true)
+    _imp->finished = false;
+
+    try
     {
-        bool any(false);
-        for (Queues::iterator q(_imp->queues.begin()), q_end(_imp->queues.end()) ;
-                q != q_end ; )
+        Running running;
+        std::string last_queue;
+        time_t next_flush(Timestamp::now().seconds() + 1);
+
+        while (true)
         {
-            if ((running.end() != running.find(q->first)) || ! q->second->can_run())
+            Queues::iterator q;
+            std::list<std::tr1::shared_ptr<Executive> >::iterator x;
+            while ((0 == _imp->max_active || running.size() < _imp->max_active) &&
+                    find_next(_imp->queues, running, last_queue, q, x))
             {
-                ++q;
-                continue;
+                const std::tr1::shared_ptr<Executive> executive(*x);
+                last_queue = q->first;
+                q->second.erase(x);
+                if (q->second.empty())
+                    _imp->queues.erase(q);
+
+                ++_imp->active;
+                --_imp->pending;
+                executive->pre_execute_exclusive();
+                running.insert(std::make_pair(last_queue, executive));
+
+                _imp->ready_to_run.push_back(executive);
+                if (pool.number_of_threads() < running.size())
+                    pool.create_thread(std::tr1::bind(&Executor::_work, this));
+                _imp->work_condition.signal();
             }
 
-            ++_imp->active;
-            --_imp->pending;
-            q->second->pre_execute_exclusive();
-            running.insert(std::make_pair(q->first, std::make_pair(make_shared_ptr(new Thread(
-                                std::tr1::bind(&Executor::_one, this, q->second))), q->second)));
-            _imp->queues.erase(q++);
-            any = true;
-        }
+            if (running.empty())
+                break;
 
-        if ((! any) && running.empty())
-            break;
+            /* we only need to wake up for a flush if nothing finishes first */
+            if (_imp->ready_for_post.empty())
+            {
+                const time_t now(Timestamp::now().seconds());
+                if (next_flush > now)
+                    _imp->condition.timed_wait(_imp->mutex, next_flush - now);
+            }
 
-        _imp->condition.timed_wait(_imp->mutex, 1);
+            if (Timestamp::now().seconds() >= next_flush)
+            {
+                for (Running::iterator r(running.begin()), r_end(running.end()) ;
+                        r != r_end ; ++r)
+                    r->second->flush_threaded();
+                next_flush = Timestamp::now().seconds() + 1;
+            }
 
-        for (Running::iterator r(running.begin()), r_end(running.end()) ;
-                r != r_end ; ++r)
-            r->second.second->flush_threaded();
+            for (ReadyForPost::iterator p(_imp->ready_for_post.begin()), p_end(_imp->ready_for_post.end()) ;
+                    p != p_end ; ++p)
+            {
+                --_imp->active;
+                ++_imp->done;
+                running.erase((*p)->queue_name());
+                (*p)->post_execute_exclusive();
+            }
 
-        for (ReadyForPost::iterator p(_imp->ready_for_post.begin()), p_end(_imp->ready_for_post.end()) ;
-                p != p_end ; ++p)
-        {
-            --_imp->active;
-            ++_imp->done;
-            running.erase((*p)->queue_name());
-            (*p)->post_execute_exclusive();
+            _imp->ready_for_post.clear();
         }
-
-        _imp->ready_for_post.clear();
     }
+    catch (...)
+    {
+        _imp->finished = true;
+        _imp->work_condition.broadcast();
+        throw;
+    }
+
+    _imp->finished = true;
+    _imp->work_condition.broadcast();
 }
 
 template class PrivateImplementationPattern<Executor>;
-
@@ -42,14 +42,36 @@ namespace paludis
             virtual void post_execute_exclusive() = 0;
     };
 
+    /**
+     * Runs a number of Executive instances, with at most one from any given
+     * queue running at once.
+     *
+     * Work is done on a pool of threads, which never grows beyond the
+     * maximum number of active executives. When that limit means not every
+     * queue can run, queues take it in turns. Completed executives are
+     * handled as soon as they finish, and the running ones are asked to
+     * flush their output about once a second.
+     */
     class PALUDIS_VISIBLE Executor :
         private PrivateImplementationPattern<Executor>
     {
         private:
-            void _one(const std::tr1::shared_ptr<Executive>);
+            void _work() throw ();
 
         public:
+            /**
+             * Run as many executives at once as there are queues.
+             */
             Executor();
+
+            /**
+             * Run at most max_active executives at once, or as many as
+             * there are queues if max_active is zero.
+             *
+             * \since 0.48
+             */
+            explicit Executor(const unsigned max_active);
+
             ~Executor();
 
             int pending() const;
@@ -0,0 +1,191 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/util/executor.hh>
+#include <paludis/util/mutex.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/make_shared_ptr.hh>
+#include <test/test_runner.hh>
+#include <test/test_framework.hh>
+#include <algorithm>
+#include <list>
+#include <string>
+#include <unistd.h>
+
+using namespace test;
+using namespace paludis;
+
+namespace
+{
+    struct Counts
+    {
+        Mutex mutex;
+        int running;
+        int max_running;
+        std::string started;
+
+        Counts() :
+            running(0),
+            max_running(0)
+        {
+        }
+    };
+
+    struct TestExecutive :
+        Executive
+    {
+        Counts & counts;
+        const std::string queue;
+        const std::string id;
+        int pre, executed, post;
+
+        TestExecutive(Counts & c, const std::string & q, const std::string & i) :
+            counts(c),
+            queue(q),
+            id(i),
+            pre(0),
+            executed(0),
+            post(0)
+        {
+        }
+
+        virtual std::string queue_name() const
+        {
+            return queue;
+        }
+
+        virtual std::string unique_id() const
+        {
+            return id;
+        }
+
+        virtual bool can_run() const
+        {
+            return true;
+        }
+
+        virtual void pre_execute_exclusive()
+        {
+            ++pre;
+            counts.started.append(id);
+        }
+
+        virtual void execute_threaded()
+        {
+            {
+                Lock lock(counts.mutex);
+                counts.max_running = std::max(counts.max_running, ++counts.running);
+            }
+
+            usleep(10000);
+            ++executed;
+
+            Lock lock(counts.mutex);
+            --counts.running;
+        }
+
+        virtual void flush_threaded()
+        {
+        }
+
+        virtual void post_execute_exclusive()
+        {
+            ++post;
+        }
+    };
+}
+
+namespace test_cases
+{
+    struct ExecutorTest : TestCase
+    {
+        ExecutorTest() : TestCase("executor") { }
+
+        void run()
+        {
+            Counts counts;
+            std::list<std::tr1::shared_ptr<TestExecutive> > executives;
+
+            Executor executor;
+            for (int n(0) ; n < 12 ; ++n)
+            {
+                executives.push_back(make_shared_ptr(new TestExecutive(counts, stringify(n % 4), stringify(n))));
+                executor.add(executives.back());
+            }
+
+            TEST_CHECK_EQUAL(executor.pending(), 12);
+            executor.execute();
+            TEST_CHECK_EQUAL(executor.pending(), 0);
+            TEST_CHECK_EQUAL(executor.active(), 0);
+            TEST_CHECK_EQUAL(executor.done(), 12);
+
+            for (std::list<std::tr1::shared_ptr<TestExecutive> >::const_iterator x(executives.begin()), x_end(executives.end()) ;
+                    x != x_end ; ++x)
+            {
+                TEST_CHECK_EQUAL((*x)->pre, 1);
+                TEST_CHECK_EQUAL((*x)->executed, 1);
+                TEST_CHECK_EQUAL((*x)->post, 1);
+            }
+
+            /* one per queue */
+            TEST_CHECK(counts.max_running <= 4);
+        }
+    } test_executor;
+
+    struct ExecutorLimitTest : TestCase
+    {
+        ExecutorLimitTest() : TestCase("executor limit") { }
+
+        void run()
+        {
+            Counts counts;
+
+            Executor executor(2);
+            for (int n(0) ; n < 8 ; ++n)
+                executor.add(make_shared_ptr(new TestExecutive(counts, stringify(n), stringify(n))));
+
+            executor.execute();
+            TEST_CHECK_EQUAL(executor.done(), 8);
+            TEST_CHECK(counts.max_running <= 2);
+        }
+    } test_executor_limit;
+
+    struct ExecutorFairnessTest : TestCase
+    {
+        ExecutorFairnessTest() : TestCase("executor fairness") { }
+
+        void run()
+        {
+            Counts counts;
+
+            Executor executor(1);
+            executor.add(make_shared_ptr(new TestExecutive(counts, "a", "1")));
+            executor.add(make_shared_ptr(new TestExecutive(counts, "a", "2")));
+            executor.add(make_shared_ptr(new TestExecutive(counts, "a", "3")));
+            executor.add(make_shared_ptr(new TestExecutive(counts, "b", "4")));
+            executor.add(make_shared_ptr(new TestExecutive(counts, "b", "5")));
+            executor.add(make_shared_ptr(new TestExecutive(counts, "c", "6")));
+
+            executor.execute();
+            TEST_CHECK_EQUAL(executor.done(), 6);
+            TEST_CHECK_EQUAL(counts.max_running, 1);
+            TEST_CHECK_EQUAL(counts.started, "146253");
+        }
+    } test_executor_fairness;
+}
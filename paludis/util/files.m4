@@ -23,6 +23,8 @@ add(`cookie',                            `hh', `cc')
 add(`create_iterator',                   `hh', `fwd', `impl', `test')
 add(`damerau_levenshtein',               `hh', `cc', `test')
 add(`destringify',                       `hh', `cc', `test')
+add(`digest_blocks',                     `hhx')
+add(`digests',                           `hh', `cc', `fwd', `se', `test', `testscript')
 add(`deferred_construction_ptr',         `hh', `cc', `fwd', `test')
 add(`dir_iterator',                      `hh', `cc', `fwd', `se', `test', `testscript')
 add(`discard_output_stream',             `hh', `cc')
@@ -33,8 +35,8 @@ add(`elf_sections',                      `hh', `cc')
 add(`elf_symbol_section',                `hh', `cc')
 add(`elf_types',                         `hh')
 add(`enum_iterator',                     `hh', `cc', `fwd', `test')
-add(`exception',                         `hh', `cc')
-add(`executor',                          `hh', `cc', `fwd')
+add(`exception',                         `hh', `cc', `test')
+add(`executor',                          `hh', `cc', `fwd', `test')
 add(`extract_host_from_url',             `hh', `cc', `fwd', `test')
 add(`fast_unique_copy',                  `hh', `test')
 add(`forward_parallel_for_each',         `hh', `test')
@@ -45,6 +47,7 @@ add(`hashes',                            `hh', `cc')
 add(`iterator_funcs',                    `hh', `test')
 add(`indirect_iterator',                 `hh', `fwd', `impl', `test')
 add(`instantiation_policy',              `hh', `impl', `test')
+add(`intern_table',                      `hh', `cc', `test')
 add(`is_file_with_extension',            `hh', `cc', `se', `test', `testscript')
 add(`join',                              `hh', `test')
 add(`log',                               `hh', `cc', `se', `test')
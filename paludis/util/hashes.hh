@@ -88,6 +88,8 @@ namespace paludis
     {
         std::size_t operator() (const Validated<D_, V_, b_, C_> & v) const
         {
+            if (ValidatedInterning<V_>::value)
+                return reinterpret_cast<std::size_t>(&v.data());
             return Hash<D_>()(v.data());
         }
     };
@@ -0,0 +1,93 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/util/intern_table.hh>
+#include <paludis/util/mutex.hh>
+#include <paludis/util/hashes.hh>
+#include <paludis/util/private_implementation_pattern-impl.hh>
+#include <tr1/unordered_set>
+
+using namespace paludis;
+
+namespace
+{
+    typedef std::tr1::unordered_set<std::string, Hash<std::string> > Values;
+
+    /* names are interned from every thread that parses or loads anything, so
+     * spread them over several locks rather than making everyone wait for
+     * one */
+    const unsigned number_of_shards(16);
+
+    struct Shard
+    {
+        Mutex mutex;
+
+        /* nodes never move, so pointers to the values stay valid */
+        Values values;
+    };
+}
+
+namespace paludis
+{
+    template <>
+    struct Implementation<InternTable>
+    {
+        mutable Shard shards[number_of_shards];
+    };
+}
+
+InternTable::InternTable() :
+    PrivateImplementationPattern<InternTable>(new Implementation<InternTable>)
+{
+}
+
+InternTable::~InternTable()
+{
+}
+
+const std::string *
+InternTable::intern(const std::string & s, void (* validate)(const std::string &))
+{
+    Shard & shard(_imp->shards[Hash<std::string>()(s) % number_of_shards]);
+    Lock lock(shard.mutex);
+
+    Values::const_iterator i(shard.values.find(s));
+    if (shard.values.end() == i)
+    {
+        validate(s);
+        i = shard.values.insert(s).first;
+    }
+
+    return &*i;
+}
+
+std::size_t
+InternTable::size() const
+{
+    std::size_t result(0);
+    for (unsigned n(0) ; n < number_of_shards ; ++n)
+    {
+        Lock lock(_imp->shards[n].mutex);
+        result += _imp->shards[n].values.size();
+    }
+    return result;
+}
+
+template class PrivateImplementationPattern<InternTable>;
+
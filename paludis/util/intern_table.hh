@@ -0,0 +1,89 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_UTIL_INTERN_TABLE_HH
+#define PALUDIS_GUARD_PALUDIS_UTIL_INTERN_TABLE_HH 1
+
+#include <paludis/util/attributes.hh>
+#include <paludis/util/private_implementation_pattern.hh>
+#include <paludis/util/instantiation_policy.hh>
+#include <string>
+
+/** \file
+ * Declarations for the InternTable class.
+ *
+ * \ingroup g_data_structures
+ *
+ * \section Examples
+ *
+ * - None at this time.
+ */
+
+namespace paludis
+{
+    /**
+     * An InternTable holds a single copy of every distinct string it has been
+     * asked about, so that the strings can be compared by address.
+     *
+     * Strings are validated only when they are first added, and are never
+     * removed, so an InternTable should only be used for things like names,
+     * where the number of distinct values is small.
+     *
+     * Safe to use from multiple threads.
+     *
+     * \see ValidatedInterning
+     * \ingroup g_data_structures
+     * \nosubgrouping
+     * \since 0.48
+     */
+    class PALUDIS_VISIBLE InternTable :
+        private PrivateImplementationPattern<InternTable>,
+        private InstantiationPolicy<InternTable, instantiation_method::NonCopyableTag>
+    {
+        public:
+            ///\name Basic operations
+            ///\{
+
+            InternTable();
+            ~InternTable();
+
+            ///\}
+
+            /**
+             * Return our copy of the given string, adding it if we don't
+             * already have it.
+             *
+             * If the string needs to be added, validate is called on it
+             * first, and any exception it throws is passed on.
+             */
+            const std::string * intern(const std::string &, void (* validate)(const std::string &))
+                PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * How many strings do we hold?
+             */
+            std::size_t size() const PALUDIS_ATTRIBUTE((warn_unused_result));
+    };
+
+#ifdef PALUDIS_HAVE_EXTERN_TEMPLATE
+    extern template class PrivateImplementationPattern<InternTable>;
+#endif
+}
+
+#endif
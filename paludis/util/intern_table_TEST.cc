@@ -0,0 +1,69 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/util/intern_table.hh>
+#include <paludis/util/exception.hh>
+#include <test/test_runner.hh>
+#include <test/test_framework.hh>
+
+using namespace test;
+using namespace paludis;
+
+namespace
+{
+    int validate_count(0);
+
+    void validate_not_empty(const std::string & s)
+    {
+        ++validate_count;
+        if (s.empty())
+            throw InternalError(PALUDIS_HERE, "empty");
+    }
+}
+
+namespace test_cases
+{
+    struct InternTableTest : TestCase
+    {
+        InternTableTest() : TestCase("intern table") { }
+
+        void run()
+        {
+            InternTable t;
+            validate_count = 0;
+
+            const std::string * a(t.intern("foo", &validate_not_empty));
+            const std::string * b(t.intern(std::string("fo") + "o", &validate_not_empty));
+            const std::string * c(t.intern("bar", &validate_not_empty));
+
+            TEST_CHECK_EQUAL(*a, "foo");
+            TEST_CHECK_EQUAL(*c, "bar");
+            TEST_CHECK(a == b);
+            TEST_CHECK(a != c);
+            TEST_CHECK_EQUAL(validate_count, 2);
+            TEST_CHECK_EQUAL(t.size(), 2u);
+
+            TEST_CHECK_THROWS(c = t.intern("", &validate_not_empty), InternalError);
+            TEST_CHECK_EQUAL(t.size(), 2u);
+            TEST_CHECK_THROWS(c = t.intern("", &validate_not_empty), InternalError);
+            TEST_CHECK_EQUAL(validate_count, 4);
+        }
+    } test_intern_table;
+}
+
@@ -19,11 +19,13 @@
 
 #include <iostream>
 #include <exception>
+#include <list>
 #include <paludis/util/log.hh>
 #include <paludis/util/private_implementation_pattern-impl.hh>
 #include <paludis/util/instantiation_policy-impl.hh>
 #include <paludis/util/exception.hh>
 #include <paludis/util/action_queue.hh>
+#include <paludis/util/mutex.hh>
 #include "config.h"
 
 #ifdef __linux__
@@ -39,16 +41,44 @@ using namespace paludis;
 
 template class InstantiationPolicy<Log, instantiation_method::SingletonTag>;
 
+namespace
+{
+    struct PendingMessage
+    {
+        std::string id;
+        LogLevel log_level;
+        LogContext log_context;
+        std::string context;
+        std::string message;
+    };
+
+    typedef std::list<PendingMessage> PendingMessages;
+}
+
 namespace paludis
 {
     template<>
     struct Implementation<Log>
     {
+        /* read without locking, so we can check it before doing any work for
+         * a message that won't be shown. racing with set_log_level is benign:
+         * a LogLevel is a single aligned word, so a reader sees either the old
+         * or the new level, and nothing else is published through it. a
+         * message logged at the same time as the level changes is treated as
+         * if it had been logged just before or just after the change. */
         LogLevel log_level;
+
+        /* only touched from the action queue */
         std::ostream * stream;
         std::string program_name;
         std::string previous_context;
 
+        /* messages are written in batches, so a burst of messages only needs
+         * one trip to the action queue. anything else enqueued starts a new
+         * batch, so everything is still written in order. */
+        Mutex pending_mutex;
+        std::tr1::shared_ptr<PendingMessages> pending;
+
         mutable ActionQueue action_queue;
 
         Implementation() :
@@ -59,59 +89,77 @@ namespace paludis
         {
         }
 
-        void message(const std::string id, const LogLevel l, const LogContext c, const std::string cs, const std::string s)
+        void message(const PendingMessage & m)
         {
-            if (l >= log_level)
+            *stream << program_name << "@" << ::time(0) << ": ";
+            do
             {
-                *stream << program_name << "@" << ::time(0) << ": ";
-                do
+                switch (m.log_level)
                 {
-                    switch (l)
-                    {
-                        case ll_debug:
-                            *stream << "[DEBUG " << id << "] ";
-                            continue;
+                    case ll_debug:
+                        *stream << "[DEBUG " << m.id << "] ";
+                        continue;
 
-                        case ll_qa:
-                            *stream << "[QA " << id << "] ";
-                            continue;
+                    case ll_qa:
+                        *stream << "[QA " << m.id << "] ";
+                        continue;
 
-                        case ll_warning:
-                            *stream << "[WARNING " << id << "] ";
-                            continue;
+                    case ll_warning:
+                        *stream << "[WARNING " << m.id << "] ";
+                        continue;
 
-                        case ll_silent:
-                            throw InternalError(PALUDIS_HERE, "ll_silent used for a message");
+                    case ll_silent:
+                        throw InternalError(PALUDIS_HERE, "ll_silent used for a message");
 
-                        case last_ll:
-                            break;
-                    }
+                    case last_ll:
+                        break;
+                }
 
-                    throw InternalError(PALUDIS_HERE, "Bad value for log_level");
+                throw InternalError(PALUDIS_HERE, "Bad value for log_level");
 
-                } while (false);
+            } while (false);
 
-                if (lc_context == c)
-                {
-                    if (previous_context == cs)
-                        *stream << "(same context) " << s << std::endl;
-                    else
-                        *stream << cs << s << std::endl;
-                    previous_context = cs;
-                }
+            if (lc_context == m.log_context)
+            {
+                if (previous_context == m.context)
+                    *stream << "(same context) " << m.message << std::endl;
                 else
-                    *stream << s << std::endl;
+                    *stream << m.context << m.message << std::endl;
+                previous_context = m.context;
+            }
+            else
+                *stream << m.message << std::endl;
+        }
+
+        void write_pending(const std::tr1::shared_ptr<PendingMessages> & messages)
+        {
+            {
+                Lock lock(pending_mutex);
+                if (pending == messages)
+                    pending.reset();
             }
+
+            for (PendingMessages::const_iterator m(messages->begin()), m_end(messages->end()) ;
+                    m != m_end ; ++m)
+                message(*m);
         }
 
-        void set_log_level(const LogLevel l)
+        void add_pending(const PendingMessage & m)
         {
-            log_level = l;
+            Lock lock(pending_mutex);
+            if (! pending)
+            {
+                pending.reset(new PendingMessages);
+                action_queue.enqueue(std::tr1::bind(std::tr1::mem_fn(&Implementation<Log>::write_pending), this, pending));
+            }
+            pending->push_back(m);
         }
 
-        void get_log_level(LogLevel & l) const
+        void enqueue(const std::tr1::function<void () throw ()> & f)
         {
-            l = log_level;
+            Lock lock(pending_mutex);
+            pending.reset();
+            action_queue.enqueue(f);
         }
 
         void set_program_name(const std::string & s)
@@ -138,38 +186,48 @@ Log::~Log()
 void
 Log::set_log_level(const LogLevel l)
 {
-    _imp->action_queue.enqueue(std::tr1::bind(std::tr1::mem_fn(&Implementation<Log>::set_log_level), _imp.get(), l));
+    _imp->log_level = l;
 }
 
 LogLevel
 Log::log_level() const
 {
-    LogLevel result(static_cast<LogLevel>(1337));
-    _imp->action_queue.enqueue(std::tr1::bind(std::tr1::mem_fn(&Implementation<Log>::get_log_level), _imp.get(), std::tr1::ref(result)));
-    _imp->action_queue.complete_pending();
-    return result;
+    return _imp->log_level;
+}
+
+bool
+Log::is_enabled(const LogLevel l) const
+{
+    return l >= _imp->log_level;
 }
 
 void
 Log::_message(const std::string & id, const LogLevel l, const LogContext c, const std::string & s)
 {
+    PendingMessage m;
+    m.id = id;
+    m.log_level = l;
+    m.log_context = c;
+    m.message = s;
+
     if (lc_context == c)
-        _imp->action_queue.enqueue(std::tr1::bind(std::tr1::mem_fn(&Implementation<Log>::message), _imp.get(), id, l, c,
+        m.context =
 #ifdef __linux__
-                    "In thread ID '" + stringify(syscall(SYS_gettid)) + "':\n  ... " +
+            "In thread ID '" + stringify(syscall(SYS_gettid)) + "':\n  ... " +
 #else
 #  warning "Don't know how to get a thread ID on your platform"
 #endif
-                    Context::backtrace("\n  ... "), s));
-    else
-        _imp->action_queue.enqueue(std::tr1::bind(std::tr1::mem_fn(&Implementation<Log>::message), _imp.get(), id, l, c, "", s));
+            Context::backtrace("\n  ... ");
+
+    _imp->add_pending(m);
 }
 
 LogMessageHandler::LogMessageHandler(const LogMessageHandler & o) :
     _id(o._id),
     _message(o._message),
     _log_level(o._log_level),
-    _log_context(o._log_context)
+    _log_context(o._log_context),
+    _enabled(o._enabled)
 {
 }
 
@@ -179,10 +237,16 @@ Log::message(const std::string & id, const LogLevel l, const LogContext c)
     return LogMessageHandler(this, id, l, c);
 }
 
+LogMessageHandler
+Log::message(const char * const id, const LogLevel l, const LogContext c)
+{
+    return LogMessageHandler(this, is_enabled(l) ? std::string(id) : std::string(), l, c);
+}
+
 void
 Log::set_log_stream(std::ostream * const s)
 {
-    _imp->action_queue.enqueue(std::tr1::bind(std::tr1::mem_fn(&Implementation<Log>::set_log_stream), _imp.get(), s));
+    _imp->enqueue(std::tr1::bind(std::tr1::mem_fn(&Implementation<Log>::set_log_stream), _imp.get(), s));
 }
 
 void
@@ -194,15 +258,17 @@ Log::complete_pending() const
 void
 Log::set_program_name(const std::string & s)
 {
-    _imp->action_queue.enqueue(std::tr1::bind(std::tr1::mem_fn(&Implementation<Log>::set_program_name), _imp.get(), s));
+    _imp->enqueue(std::tr1::bind(std::tr1::mem_fn(&Implementation<Log>::set_program_name), _imp.get(), s));
 }
 
 LogMessageHandler::LogMessageHandler(Log * const ll, const std::string & id, const LogLevel l, const LogContext c) :
     _log(ll),
-    _id(id),
     _log_level(l),
-    _log_context(c)
+    _log_context(c),
+    _enabled(ll->is_enabled(l))
 {
+    if (_enabled)
+        _id = id;
 }
 
 void
@@ -213,7 +279,6 @@ LogMessageHandler::_append(const std::string & s)
 
 LogMessageHandler::~LogMessageHandler()
 {
-    if (! std::uncaught_exception() && ! _message.empty())
+    if (_enabled && ! std::uncaught_exception() && ! _message.empty())
         _log->_message(_id, _log_level, _log_context, _message);
 }
-
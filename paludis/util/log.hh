@@ -67,6 +67,9 @@ namespace paludis
 
             /**
              * Only display messages of at least this level.
+             *
+             * Messages logged by other threads whilst the level is being
+             * changed may be judged by either the old or the new level.
              */
             void set_log_level(const LogLevel);
 
@@ -76,6 +79,17 @@ namespace paludis
             LogLevel log_level() const
                 PALUDIS_ATTRIBUTE((warn_unused_result));
 
+            /**
+             * Would a message at this level be displayed?
+             *
+             * This is cheap, and is checked before a message is formatted,
+             * so only use it directly if working out what to log is expensive.
+             *
+             * \since 0.48
+             */
+            bool is_enabled(const LogLevel) const
+                PALUDIS_ATTRIBUTE((warn_unused_result));
+
             /**
              * Log a message.
              *
@@ -83,10 +97,22 @@ namespace paludis
              * LogMessageHandler::operator<<(). When the return value is
              * destroyed (that is to say, at the end of the statement), the log
              * message is written.
+             *
+             * If the message's level is not enabled, nothing appended is
+             * stringified, and nothing is written.
              */
             LogMessageHandler message(const std::string & id,
                     const LogLevel, const LogContext) PALUDIS_ATTRIBUTE((warn_unused_result));
 
+            /**
+             * Log a message, without making a string for the id unless the
+             * message's level is enabled.
+             *
+             * \since 0.48
+             */
+            LogMessageHandler message(const char * const id,
+                    const LogLevel, const LogContext) PALUDIS_ATTRIBUTE((warn_unused_result));
+
             /**
              * Change the log stream.
              */
@@ -112,6 +138,7 @@ namespace paludis
     class PALUDIS_VISIBLE LogMessageHandler
     {
         friend LogMessageHandler Log::message(const std::string &, const LogLevel, const LogContext);
+        friend LogMessageHandler Log::message(const char * const, const LogLevel, const LogContext);
 
         private:
             Log * _log;
@@ -119,6 +146,7 @@ namespace paludis
             std::string _message;
             LogLevel _log_level;
             LogContext _log_context;
+            bool _enabled;
 
             LogMessageHandler(const LogMessageHandler &);
             LogMessageHandler(Log * const, const std::string &, const LogLevel, const LogContext);
@@ -141,7 +169,8 @@ namespace paludis
             LogMessageHandler &
             operator<< (const T_ & t)
             {
-                _append(stringify(t));
+                if (_enabled)
+                    _append(stringify(t));
                 return *this;
             }
     };
@@ -0,0 +1,150 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2010 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Measures what a log message costs when its level is disabled, compared to
+ * one that is written. Built but not run by 'make check'; use:
+ *
+ *     make benchmark BENCHMARK_OPTIONS="[--count N]"
+ *
+ * For each case we report the time and the number of allocations per
+ * message.
+ */
+
+#include <paludis/util/log.hh>
+#include <paludis/util/exception.hh>
+#include <paludis/util/destringify.hh>
+#include <paludis/util/fs_entry.hh>
+#include <paludis/util/benchmark_extras.hh>
+
+#include <iostream>
+#include <iomanip>
+#include <streambuf>
+#include <cstdlib>
+#include <string>
+#include <sys/time.h>
+
+using namespace paludis;
+using namespace paludis::benchmark_extras;
+
+namespace
+{
+    struct DiscardBuf :
+        std::streambuf
+    {
+        int overflow(int c)
+        {
+            return c;
+        }
+
+        std::streamsize xsputn(const char *, std::streamsize n)
+        {
+            return n;
+        }
+    };
+
+    double now()
+    {
+        struct timeval tv;
+        gettimeofday(&tv, 0);
+        return tv.tv_sec + tv.tv_usec / 1000000.0;
+    }
+
+    void report(const std::string & name, const unsigned count, const double seconds, const unsigned long allocated)
+    {
+        std::cout << std::left << std::setw(12) << name << std::right
+            << std::setw(12) << std::fixed << std::setprecision(1) << (seconds * 1000000000.0 / count)
+            << std::setw(16) << std::setprecision(2) << (static_cast<double>(allocated) / count)
+            << std::endl;
+    }
+
+    /* the sort of thing EbuildFlatMetadataCache::load logs for every eclass */
+    void log_one(const unsigned n, const std::string & name, const FSEntry & f)
+    {
+        Log::get_instance()->message("e.cache.flat_list.eclass.path", ll_debug, lc_context)
+            << "Cache-requested eclass '" << name << "' maps to '" << f << "' (" << n << ")";
+    }
+
+    void run(const std::string & name, const unsigned count, const LogLevel level, const bool probe)
+    {
+        Context context("When benchmarking '" + name + "':");
+        const std::string eclass("toolchain-funcs");
+        const FSEntry f("/var/db/repos/gentoo/eclass/toolchain-funcs.eclass");
+
+        Log::get_instance()->set_log_level(level);
+        Log::get_instance()->complete_pending();
+
+        unsigned long before_allocations(allocations());
+        double before(now());
+        unsigned enabled(0);
+        for (unsigned n(0) ; n < count ; ++n)
+        {
+            if (probe)
+                enabled += Log::get_instance()->is_enabled(ll_debug);
+            else
+                log_one(n, eclass, f);
+        }
+        Log::get_instance()->complete_pending();
+        report(name, count, now() - before, allocations() - before_allocations);
+
+        if (enabled != 0 && enabled != count)
+            throw InternalError(PALUDIS_HERE, "log level changed underneath us");
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    unsigned count(1000000);
+
+    for (int a(1) ; a < argc ; ++a)
+    {
+        const std::string arg(argv[a]);
+        if (arg == "--count" && a + 1 < argc)
+            count = destringify<unsigned>(argv[++a]);
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--count N]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    try
+    {
+        DiscardBuf discard_buf;
+        std::ostream discard(&discard_buf);
+        Log::get_instance()->set_log_stream(&discard);
+
+        std::cout << std::left << std::setw(12) << "case" << std::right
+            << std::setw(12) << "ns/message" << std::setw(16) << "allocs/message" << std::endl;
+
+        run("probe", count, ll_qa, true);
+        run("suppressed", count, ll_qa, false);
+        run("written", count / 10, ll_debug, false);
+
+        Log::get_instance()->set_log_stream(&std::cerr);
+        Log::get_instance()->complete_pending();
+    }
+    catch (const Exception & e)
+    {
+        std::cerr << "Caught exception " << e.message() << " (" << e.what() << ")" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -18,6 +18,7 @@
  */
 
 #include <paludis/util/md5.hh>
+#include <paludis/util/digest_blocks.hh>
 #include <sstream>
 #include <istream>
 #include <iomanip>
@@ -140,45 +141,47 @@ MD5::_update(const uint8_t * const block)
     _r[3] += d;
 }
 
+MD5::MD5() :
+    _buffer_used(0),
+    _size(0)
+{
+    _r[0] = 0x67452301;
+    _r[1] = 0xefcdab89;
+    _r[2] = 0x98badcfe;
+    _r[3] = 0x10325476;
+}
+
 MD5::MD5(std::istream & stream) :
-    _size(0),
-    _done_one_pad(false)
+    _buffer_used(0),
+    _size(0)
 {
     _r[0] = 0x67452301;
     _r[1] = 0xefcdab89;
     _r[2] = 0x98badcfe;
     _r[3] = 0x10325476;
 
-    uint8_t buffer[64];
-    int c, s(0);
-    while (-1 != ((c = _get(stream))))
-    {
-        buffer[s++] = c;
-        if (64 == s)
-        {
-            _update(&buffer[0]);
-            s = 0;
-        }
-    }
-    while (56 != s)
-    {
-        buffer[s++] = 0;
-        if (64 == s)
-        {
-            _update(&buffer[0]);
-            s = 0;
-        }
-    }
+    digest_blocks::update_from_stream(*this, stream);
+    finish();
+}
 
-    buffer[56] = static_cast<uint8_t>(_size >> (0 * 8));
-    buffer[57] = static_cast<uint8_t>(_size >> (1 * 8));
-    buffer[58] = static_cast<uint8_t>(_size >> (2 * 8));
-    buffer[59] = static_cast<uint8_t>(_size >> (3 * 8));
-    buffer[60] = static_cast<uint8_t>(_size >> (4 * 8));
-    buffer[61] = static_cast<uint8_t>(_size >> (5 * 8));
-    buffer[62] = static_cast<uint8_t>(_size >> (6 * 8));
-    buffer[63] = static_cast<uint8_t>(_size >> (7 * 8));
-    _update(&buffer[0]);
+void
+MD5::_update_blocks(const uint8_t * const blocks, std::size_t count)
+{
+    for (const uint8_t * b(blocks) ; count ; --count, b += 64)
+        _update(b);
+}
+
+void
+MD5::update(const void * const data, const std::size_t length)
+{
+    digest_blocks::update(*this, &MD5::_update_blocks, _buffer, _buffer_used, _size,
+            static_cast<const uint8_t *>(data), length);
+}
+
+void
+MD5::finish()
+{
+    digest_blocks::finish(*this, &MD5::_update_blocks, _buffer, _buffer_used, _size, false);
 }
 
 std::string
@@ -193,24 +196,6 @@ MD5::hexsum() const
     return result.str();
 }
 
-int
-MD5::_get(std::istream & stream)
-{
-    char c;
-    if (stream.get(c))
-    {
-        _size += 8;
-        return static_cast<unsigned char>(c);
-    }
-    else if (! _done_one_pad)
-    {
-        _done_one_pad = true;
-        return 0x80;
-    }
-    else
-        return -1;
-}
-
 const uint8_t MD5::_s[64] = {
     7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,
     5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,
@@ -22,6 +22,7 @@
 
 #include <iosfwd>
 #include <string>
+#include <cstddef>
 #include <inttypes.h>
 #include <paludis/util/attributes.hh>
 
@@ -48,19 +49,41 @@ namespace paludis
             static const PALUDIS_HIDDEN uint32_t _t[64];
             static const PALUDIS_HIDDEN uint8_t _s[64];
             uint32_t _r[4];
+            uint8_t _buffer[64];
+            unsigned _buffer_used;
             uint64_t _size;
-            bool _done_one_pad;
 
             void PALUDIS_HIDDEN _update(const uint8_t * const block);
-
-            inline int PALUDIS_HIDDEN _get(std::istream & stream);
+            void PALUDIS_HIDDEN _update_blocks(const uint8_t * const blocks, std::size_t count);
 
         public:
             /**
-             * Constructor.
+             * Constructor, for use with update() and finish().
+             *
+             * \since 0.48
+             */
+            MD5();
+
+            /**
+             * Constructor, digesting everything in a stream.
              */
             MD5(std::istream & stream);
 
+            /**
+             * Add more data to the digest.
+             *
+             * \since 0.48
+             */
+            void update(const void * const data, const std::size_t length);
+
+            /**
+             * Finish the digest, after which hexsum() may be called and
+             * update() may not.
+             *
+             * \since 0.48
+             */
+            void finish();
+
             /**
              * Our checksum, as a string of hex characters.
              */
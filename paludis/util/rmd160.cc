@@ -18,6 +18,7 @@
  */
 
 #include "rmd160.hh"
+#include <paludis/util/digest_blocks.hh>
 #include <paludis/util/attributes.hh>
 #include <sstream>
 #include <istream>
@@ -117,9 +118,27 @@ RMD160::_update(const uint8_t * const block)
     _h[0] = t;
 }
 
+void
+RMD160::_update_blocks(const uint8_t * const blocks, std::size_t count)
+{
+    for (const uint8_t * b(blocks) ; count ; --count, b += 64)
+        _update(b);
+}
+
+RMD160::RMD160() :
+    _buffer_used(0),
+    _size(0)
+{
+    _h[0] = 0x67452301;
+    _h[1] = 0xefcdab89;
+    _h[2] = 0x98badcfe;
+    _h[3] = 0x10325476;
+    _h[4] = 0xc3d2e1f0;
+}
+
 RMD160::RMD160(std::istream & stream) :
-    _size(0),
-    _done_one_pad(false)
+    _buffer_used(0),
+    _size(0)
 {
     _h[0] = 0x67452301;
     _h[1] = 0xefcdab89;
@@ -127,36 +146,21 @@ RMD160::RMD160(std::istream & stream) :
     _h[3] = 0x10325476;
     _h[4] = 0xc3d2e1f0;
 
-    uint8_t buffer[64];
-    int c, s(0);
-    while (-1 != ((c = _get(stream))))
-    {
-        buffer[s++] = c;
-        if (64 == s)
-        {
-            _update(&buffer[0]);
-            s = 0;
-        }
-    }
-    while (56 != s)
-    {
-        buffer[s++] = 0;
-        if (64 == s)
-        {
-            _update(&buffer[0]);
-            s = 0;
-        }
-    }
+    digest_blocks::update_from_stream(*this, stream);
+    finish();
+}
 
-    buffer[56] = static_cast<uint8_t>(_size >> (0 * 8));
-    buffer[57] = static_cast<uint8_t>(_size >> (1 * 8));
-    buffer[58] = static_cast<uint8_t>(_size >> (2 * 8));
-    buffer[59] = static_cast<uint8_t>(_size >> (3 * 8));
-    buffer[60] = static_cast<uint8_t>(_size >> (4 * 8));
-    buffer[61] = static_cast<uint8_t>(_size >> (5 * 8));
-    buffer[62] = static_cast<uint8_t>(_size >> (6 * 8));
-    buffer[63] = static_cast<uint8_t>(_size >> (7 * 8));
-    _update(&buffer[0]);
+void
+RMD160::update(const void * const data, const std::size_t length)
+{
+    digest_blocks::update(*this, &RMD160::_update_blocks, _buffer, _buffer_used, _size,
+            static_cast<const uint8_t *>(data), length);
+}
+
+void
+RMD160::finish()
+{
+    digest_blocks::finish(*this, &RMD160::_update_blocks, _buffer, _buffer_used, _size, false);
 }
 
 std::string
@@ -171,24 +175,6 @@ RMD160::hexsum() const
     return result.str();
 }
 
-int
-RMD160::_get(std::istream & stream)
-{
-    char c;
-    if (stream.get(c))
-    {
-        _size += 8;
-        return static_cast<unsigned char>(c);
-    }
-    else if (! _done_one_pad)
-    {
-        _done_one_pad = true;
-        return 0x80;
-    }
-    else
-        return -1;
-}
-
 const uint8_t RMD160::_r[80] = {
     0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
     7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
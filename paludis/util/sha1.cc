@@ -21,10 +21,16 @@
 
 #include <paludis/util/sha1.hh>
 #include <paludis/util/byte_swap.hh>
+#include <paludis/util/digest_blocks.hh>
 #include <sstream>
 #include <istream>
 #include <iomanip>
 #include <algorithm>
+#include <cstring>
+
+#ifdef HAVE_X86_SHA_EXTENSIONS
+#  include <immintrin.h>
+#endif
 
 using namespace paludis;
 
@@ -39,21 +45,11 @@ namespace
     {
         return x;
     }
-
-    inline uint32_t to_bigendian(uint32_t x)
-    {
-        return x;
-    }
 #else
     inline uint32_t from_bigendian(uint32_t x)
     {
         return byte_swap(x);
     }
-
-    inline uint32_t to_bigendian(uint32_t x)
-    {
-        return byte_swap(x);
-    }
 #endif
 
     template <int n_>
@@ -129,6 +125,69 @@ namespace
         {
         }
     };
+
+#ifdef HAVE_X86_SHA_EXTENSIONS
+    const bool use_x86_sha_extensions(digest_blocks::have_x86_sha_extensions());
+
+#  pragma GCC push_options
+#  pragma GCC target("sha,ssse3,sse4.1")
+
+    /*
+     * Process blocks using the x86 SHA extensions. Each sha1rnds4 does four
+     * rounds, using the round function selected by its immediate, and the
+     * message schedule is kept in four registers, each holding four words.
+     */
+    void x86_update_blocks(uint32_t * const h, const uint8_t * blocks, std::size_t count)
+    {
+        const __m128i byte_swap_mask(_mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL));
+
+        __m128i abcd(_mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(h)), 0x1b));
+        __m128i e0(_mm_set_epi32(h[4], 0, 0, 0)), e1;
+
+        for ( ; count ; --count, blocks += 64)
+        {
+            const __m128i abcd_save(abcd), e0_save(e0);
+            __m128i w[4];
+
+            for (int g(0) ; g < 20 ; ++g)
+            {
+                if (g < 4)
+                    w[g] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks + 16 * g)),
+                            byte_swap_mask);
+
+                __m128i & e(0 == g % 2 ? e0 : e1);
+                if (0 == g)
+                    e0 = _mm_add_epi32(e0, w[0]);
+                else
+                    e = _mm_sha1nexte_epu32(e, w[g % 4]);
+                (0 == g % 2 ? e1 : e0) = abcd;
+
+                switch (g / 5)
+                {
+                    case 0: abcd = _mm_sha1rnds4_epu32(abcd, e, 0); break;
+                    case 1: abcd = _mm_sha1rnds4_epu32(abcd, e, 1); break;
+                    case 2: abcd = _mm_sha1rnds4_epu32(abcd, e, 2); break;
+                    default: abcd = _mm_sha1rnds4_epu32(abcd, e, 3); break;
+                }
+
+                if (g >= 3 && g <= 18)
+                    w[(g + 1) % 4] = _mm_sha1msg2_epu32(w[(g + 1) % 4], w[g % 4]);
+                if (g >= 1 && g <= 16)
+                    w[(g + 3) % 4] = _mm_sha1msg1_epu32(w[(g + 3) % 4], w[g % 4]);
+                if (g >= 2 && g <= 17)
+                    w[(g + 2) % 4] = _mm_xor_si128(w[(g + 2) % 4], w[g % 4]);
+            }
+
+            e0 = _mm_sha1nexte_epu32(e0, e0_save);
+            abcd = _mm_add_epi32(abcd, abcd_save);
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(h), _mm_shuffle_epi32(abcd, 0x1b));
+        h[4] = _mm_extract_epi32(e0, 3);
+    }
+
+#  pragma GCC pop_options
+#endif
 }
 
 void
@@ -154,46 +213,66 @@ SHA1::process_block(uint32_t * w)
 }
 
 
-SHA1::SHA1(std::istream & s) :
-    h0(0x67452301U),
-    h1(0xEFCDAB89U),
-    h2(0x98BADCFEU),
-    h3(0x10325476U),
-    h4(0xC3D2E1F0U)
+void
+SHA1::_update_blocks(const uint8_t * const blocks, std::size_t count)
 {
-    std::streambuf * buf(s.rdbuf());
-    uint64_t size(0);
-
-    union
+#ifdef HAVE_X86_SHA_EXTENSIONS
+    if (use_x86_sha_extensions)
     {
-        uint8_t  m[64];
-        uint32_t w[80];
-    } block;
-    std::streamsize block_size;
+        uint32_t h[5] = { h0, h1, h2, h3, h4 };
+        x86_update_blocks(h, blocks, count);
+        h0 = h[0];
+        h1 = h[1];
+        h2 = h[2];
+        h3 = h[3];
+        h4 = h[4];
+        return;
+    }
+#endif
 
-    do
+    uint32_t w[80];
+    for (const uint8_t * b(blocks) ; count ; --count, b += 64)
     {
-        block_size = buf->sgetn(reinterpret_cast<char *>(block.m), 64);
-        size += block_size * 8;
+        std::memcpy(w, b, 64);
+        process_block(w);
+    }
+}
 
-        if (64 != block_size)
-        {
-            block.m[block_size++] = 0x80U;
+SHA1::SHA1() :
+    h0(0x67452301U),
+    h1(0xEFCDAB89U),
+    h2(0x98BADCFEU),
+    h3(0x10325476U),
+    h4(0xC3D2E1F0U),
+    _buffer_used(0),
+    _size(0)
+{
+}
 
-            if (56 < block_size)
-            {
-                std::fill(&block.m[block_size], &block.m[64], 0);
-                process_block(block.w);
-                block_size = 0;
-            }
+SHA1::SHA1(std::istream & s) :
+    h0(0x67452301U),
+    h1(0xEFCDAB89U),
+    h2(0x98BADCFEU),
+    h3(0x10325476U),
+    h4(0xC3D2E1F0U),
+    _buffer_used(0),
+    _size(0)
+{
+    digest_blocks::update_from_stream(*this, s);
+    finish();
+}
 
-            std::fill(&block.m[block_size], &block.m[56], 0);
-            block.w[14] = to_bigendian((size >> 32) & 0xFFFFFFFFU);
-            block.w[15] = to_bigendian(size & 0xFFFFFFFFU);
-        }
+void
+SHA1::update(const void * const data, const std::size_t length)
+{
+    digest_blocks::update(*this, &SHA1::_update_blocks, _buffer, _buffer_used, _size,
+            static_cast<const uint8_t *>(data), length);
+}
 
-        process_block(block.w);
-    } while (64 == block_size);
+void
+SHA1::finish()
+{
+    digest_blocks::finish(*this, &SHA1::_update_blocks, _buffer, _buffer_used, _size, true);
 }
 
 std::string
@@ -23,6 +23,7 @@
 
 #include <iosfwd>
 #include <string>
+#include <cstddef>
 #include <inttypes.h>
 #include <paludis/util/attributes.hh>
 
@@ -47,15 +48,41 @@ namespace paludis
     {
         private:
             uint32_t h0, h1, h2, h3, h4;
+            uint8_t _buffer[64];
+            unsigned _buffer_used;
+            uint64_t _size;
 
             void PALUDIS_HIDDEN process_block(uint32_t *);
+            void PALUDIS_HIDDEN _update_blocks(const uint8_t * const blocks, std::size_t count);
 
         public:
             /**
-             * Constructor.
+             * Constructor, for use with update() and finish().
+             *
+             * \since 0.48
+             */
+            SHA1();
+
+            /**
+             * Constructor, digesting everything in a stream.
              */
             SHA1(std::istream & stream);
 
+            /**
+             * Add more data to the digest.
+             *
+             * \since 0.48
+             */
+            void update(const void * const data, const std::size_t length);
+
+            /**
+             * Finish the digest, after which hexsum() may be called and
+             * update() may not.
+             *
+             * \since 0.48
+             */
+            void finish();
+
             /**
              * Our checksum, as a string of hex characters.
              */
@@ -17,12 +17,19 @@
  * Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include "config.h"
+
 #include "sha256.hh"
 #include <paludis/util/attributes.hh>
+#include <paludis/util/digest_blocks.hh>
 #include <istream>
 #include <iomanip>
 #include <sstream>
 
+#ifdef HAVE_X86_SHA_EXTENSIONS
+#  include <immintrin.h>
+#endif
+
 using namespace paludis;
 
 /*
@@ -91,6 +98,72 @@ namespace
     {
         dest[j] = lsigma1(dest[j - 2]) + dest[j - 7] + lsigma0(dest[j - 15]) + dest[j - 16];
     }
+
+#ifdef HAVE_X86_SHA_EXTENSIONS
+    const bool use_x86_sha_extensions(digest_blocks::have_x86_sha_extensions());
+
+#  pragma GCC push_options
+#  pragma GCC target("sha,ssse3,sse4.1")
+
+    /*
+     * Process blocks using the x86 SHA extensions. The state is kept as
+     * ABEF and CDGH, which is what sha256rnds2 wants, and the message
+     * schedule is kept in four registers, each holding four words.
+     */
+    void x86_update_blocks(uint32_t * const h, const uint32_t * const k,
+            const uint8_t * blocks, std::size_t count)
+    {
+        const __m128i byte_swap_mask(_mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL));
+
+        __m128i tmp(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&h[0])));
+        __m128i state1(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&h[4])));
+        tmp = _mm_shuffle_epi32(tmp, 0xb1);
+        state1 = _mm_shuffle_epi32(state1, 0x1b);
+        __m128i state0(_mm_alignr_epi8(tmp, state1, 8));
+        state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+        for ( ; count ; --count, blocks += 64)
+        {
+            const __m128i abef_save(state0), cdgh_save(state1);
+            __m128i w[4];
+
+            for (int g(0) ; g < 16 ; ++g)
+            {
+                if (g < 4)
+                    w[g] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks + 16 * g)),
+                            byte_swap_mask);
+
+                __m128i msg(_mm_add_epi32(w[g % 4], _mm_loadu_si128(reinterpret_cast<const __m128i *>(&k[4 * g]))));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+
+                if (g >= 3 && g <= 14)
+                {
+                    tmp = _mm_alignr_epi8(w[g % 4], w[(g + 3) % 4], 4);
+                    w[(g + 1) % 4] = _mm_sha256msg2_epu32(_mm_add_epi32(w[(g + 1) % 4], tmp), w[g % 4]);
+                }
+
+                msg = _mm_shuffle_epi32(msg, 0x0e);
+                state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+                if (g >= 1 && g <= 12)
+                    w[(g + 3) % 4] = _mm_sha256msg1_epu32(w[(g + 3) % 4], w[g % 4]);
+            }
+
+            state0 = _mm_add_epi32(state0, abef_save);
+            state1 = _mm_add_epi32(state1, cdgh_save);
+        }
+
+        tmp = _mm_shuffle_epi32(state0, 0x1b);
+        state1 = _mm_shuffle_epi32(state1, 0xb1);
+        state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+        state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&h[0]), state0);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&h[4]), state1);
+    }
+
+#  pragma GCC pop_options
+#endif
 }
 
 void
@@ -131,9 +204,38 @@ SHA256::_update(const uint8_t * const block)
     _h[7] += h;
 }
 
+void
+SHA256::_update_blocks(const uint8_t * const blocks, std::size_t count)
+{
+#ifdef HAVE_X86_SHA_EXTENSIONS
+    if (use_x86_sha_extensions)
+    {
+        x86_update_blocks(_h, _k, blocks, count);
+        return;
+    }
+#endif
+
+    for (const uint8_t * b(blocks) ; count ; --count, b += 64)
+        _update(b);
+}
+
+SHA256::SHA256() :
+    _buffer_used(0),
+    _size(0)
+{
+    _h[0] = 0x6a09e667;
+    _h[1] = 0xbb67ae85;
+    _h[2] = 0x3c6ef372;
+    _h[3] = 0xa54ff53a;
+    _h[4] = 0x510e527f;
+    _h[5] = 0x9b05688c;
+    _h[6] = 0x1f83d9ab;
+    _h[7] = 0x5be0cd19;
+}
+
 SHA256::SHA256(std::istream & stream) :
-    _size(0),
-    _done_one_pad(false)
+    _buffer_used(0),
+    _size(0)
 {
     _h[0] = 0x6a09e667;
     _h[1] = 0xbb67ae85;
@@ -144,36 +246,21 @@ SHA256::SHA256(std::istream & stream) :
     _h[6] = 0x1f83d9ab;
     _h[7] = 0x5be0cd19;
 
-    uint8_t buffer[64];
-    int c, s(0);
-    while (-1 != ((c = _get(stream))))
-    {
-        buffer[s++] = c;
-        if (64 == s)
-        {
-            _update(&buffer[0]);
-            s = 0;
-        }
-    }
-    while (56 != s)
-    {
-        buffer[s++] = 0;
-        if (64 == s)
-        {
-            _update(&buffer[0]);
-            s = 0;
-        }
-    }
+    digest_blocks::update_from_stream(*this, stream);
+    finish();
+}
+
+void
+SHA256::update(const void * const data, const std::size_t length)
+{
+    digest_blocks::update(*this, &SHA256::_update_blocks, _buffer, _buffer_used, _size,
+            static_cast<const uint8_t *>(data), length);
+}
 
-    buffer[56] = static_cast<uint8_t>(_size >> (7 * 8));
-    buffer[57] = static_cast<uint8_t>(_size >> (6 * 8));
-    buffer[58] = static_cast<uint8_t>(_size >> (5 * 8));
-    buffer[59] = static_cast<uint8_t>(_size >> (4 * 8));
-    buffer[60] = static_cast<uint8_t>(_size >> (3 * 8));
-    buffer[61] = static_cast<uint8_t>(_size >> (2 * 8));
-    buffer[62] = static_cast<uint8_t>(_size >> (1 * 8));
-    buffer[63] = static_cast<uint8_t>(_size >> (0 * 8));
-    _update(&buffer[0]);
+void
+SHA256::finish()
+{
+    digest_blocks::finish(*this, &SHA256::_update_blocks, _buffer, _buffer_used, _size, true);
 }
 
 std::string
@@ -188,24 +275,6 @@ SHA256::hexsum() const
     return result.str();
 }
 
-int
-SHA256::_get(std::istream & stream)
-{
-    char c;
-    if (stream.get(c))
-    {
-        _size += 8;
-        return static_cast<unsigned char>(c);
-    }
-    else if (! _done_one_pad)
-    {
-        _done_one_pad = true;
-        return 0x80;
-    }
-    else
-        return -1;
-}
-
 const uint32_t
 paludis::SHA256::_k[64] = {
     0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
@@ -36,6 +36,29 @@ namespace paludis
     template <typename D_, typename, bool = true, typename = DefaultValidatedComparator<D_> >
     class Validated;
 
+    /**
+     * Specialise ValidatedInterning for a validator, with value set to true,
+     * to make every Validated instance using that validator share a single
+     * copy of each distinct value.
+     *
+     * An interning validator must provide a static intern function taking
+     * the data and returning a pointer to the shared copy, validating it
+     * if it has not been seen before. Equality and hashing are then done by
+     * address.
+     *
+     * The specialisation must be visible wherever the Validated type is
+     * used, so it should be next to the typedef.
+     *
+     * \see InternTable
+     * \ingroup g_data_structures
+     * \since 0.48
+     */
+    template <typename Validator_>
+    struct ValidatedInterning
+    {
+        enum { value = false };
+    };
+
     template <typename D_, typename V_, bool c_, typename C_>
     std::ostream &
     operator<< (std::ostream & s, const Validated<D_, V_, c_, C_> & v);
@@ -51,10 +51,49 @@ namespace paludis
     {
     };
 
+    namespace validated_internals
+    {
+        template <typename ValidatedDataType_, typename Validator_, bool interned_>
+        struct ValidatedStorage
+        {
+            ValidatedDataType_ value;
+
+            explicit ValidatedStorage(const ValidatedDataType_ & v) :
+                value(v)
+            {
+                Validator_::validate(value);
+            }
+
+            const ValidatedDataType_ & get() const
+            {
+                return value;
+            }
+        };
+
+        template <typename ValidatedDataType_, typename Validator_>
+        struct ValidatedStorage<ValidatedDataType_, Validator_, true>
+        {
+            const ValidatedDataType_ * value;
+
+            explicit ValidatedStorage(const ValidatedDataType_ & v) :
+                value(Validator_::intern(v))
+            {
+            }
+
+            const ValidatedDataType_ & get() const
+            {
+                return *value;
+            }
+        };
+    }
+
     /**
      * A Validated wraps a particular class instance, ensuring that it always
      * meets certain validation criteria.
      *
+     * If ValidatedInterning is specialised for Validator_, the data is held
+     * by pointer to a shared copy.
+     *
      * \ingroup g_data_structures
      */
     template <typename ValidatedDataType_, typename Validator_, bool full_comparison_, typename Comparator_>
@@ -64,7 +103,8 @@ namespace paludis
             equality_operators::HasEqualityOperators>::Type
     {
         private:
-            ValidatedDataType_ _value;
+            validated_internals::ValidatedStorage<ValidatedDataType_, Validator_,
+                ValidatedInterning<Validator_>::value> _value;
 
         public:
             ///\name Basic operations
@@ -98,7 +138,7 @@ namespace paludis
              */
             const ValidatedDataType_ & data() const
             {
-                return _value;
+                return _value.get();
             }
     };
 
@@ -114,7 +154,6 @@ namespace paludis
             const ValidatedDataType_ & value) :
         _value(value)
     {
-        Validator_::validate(_value);
     }
 
     template <typename ValidatedDataType_, typename Validator_, bool full_comparison_, typename Comparator_>
@@ -122,7 +161,10 @@ namespace paludis
             const Validated<ValidatedDataType_, Validator_, full_comparison_, Comparator_> & a,
             const Validated<ValidatedDataType_, Validator_, full_comparison_, Comparator_> & b)
     {
-        return a.data() == b.data();
+        if (ValidatedInterning<Validator_>::value)
+            return &a.data() == &b.data();
+        else
+            return a.data() == b.data();
     }
 
     template <typename ValidatedDataType_, typename Validator_, typename Comparator_>
@@ -130,6 +172,8 @@ namespace paludis
             const Validated<ValidatedDataType_, Validator_, true, Comparator_> & a,
             const Validated<ValidatedDataType_, Validator_, true, Comparator_> & b)
     {
+        if (ValidatedInterning<Validator_>::value && &a.data() == &b.data())
+            return false;
         return Comparator_()(a.data(), b.data());
     }
 
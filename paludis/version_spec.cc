@@ -34,6 +34,7 @@
 #include <paludis/version_spec.hh>
 #include <vector>
 #include <limits>
+#include <stdint.h>
 
 using namespace paludis;
 
@@ -51,6 +52,70 @@ BadVersionSpecError::BadVersionSpecError(const std::string & name, const std::st
 
 typedef std::vector<VersionSpecComponent> Parts;
 
+namespace
+{
+    /**
+     * A precomputed comparison key for a VersionSpecComponent.
+     *
+     * If packed is true, value orders the same way as the number_value()
+     * comparison rules do, for components of the same type. Otherwise the
+     * number is too long to fit, and we have to compare strings.
+     */
+    struct ComponentKey
+    {
+        VersionSpecComponentType type;
+        bool packed;
+        uint64_t value;
+    };
+
+    typedef std::vector<ComponentKey> Keys;
+
+    /* enough that any string of this many digits fits, with room for "MAX" */
+    const std::string::size_type max_packed_digits(19);
+
+    ComponentKey make_component_key(const VersionSpecComponent & c)
+    {
+        ComponentKey result;
+        result.type = c.type();
+        result.packed = false;
+        result.value = 0;
+
+        const std::string & v(c.number_value());
+        if (vsct_floatlike == c.type())
+        {
+            /* trailing zeroes don't count, and the rest is compared as a
+             * string, so pad to a fixed width */
+            std::string::size_type l(v.find_last_not_of('0'));
+            l = (std::string::npos == l) ? 0 : l + 1;
+            if (l > max_packed_digits)
+                return result;
+
+            for (std::string::size_type i(0) ; i < max_packed_digits ; ++i)
+                result.value = result.value * 10 + (i < l ? v[i] - '0' : 0);
+        }
+        else if (v == "MAX")
+            result.value = std::numeric_limits<uint64_t>::max();
+        else if (vsct_letter == c.type())
+        {
+            if (v.length() != 1)
+                return result;
+            result.value = static_cast<unsigned char>(v[0]) + 1;
+        }
+        else
+        {
+            if (v.length() > max_packed_digits || (v.length() > 1 && '0' == v[0])
+                    || std::string::npos != v.find_first_not_of("0123456789"))
+                return result;
+
+            for (std::string::const_iterator i(v.begin()), i_end(v.end()) ; i != i_end ; ++i)
+                result.value = result.value * 10 + (*i - '0');
+        }
+
+        result.packed = true;
+        return result;
+    }
+}
+
 namespace paludis
 {
     template<>
@@ -58,6 +123,8 @@ namespace paludis
     {
         std::string text;
         Parts parts;
+        Keys keys;
+        bool all_keys_packed;
 
         mutable Mutex hash_mutex;
         mutable bool has_hash;
@@ -70,11 +137,25 @@ namespace paludis
         const VersionSpecOptions options;
 
         Implementation(const VersionSpecOptions & o) :
+            all_keys_packed(false),
             has_hash(false),
             has_is_scm(false),
             options(o)
         {
         }
+
+        void make_keys()
+        {
+            keys.clear();
+            keys.reserve(parts.size());
+            all_keys_packed = true;
+            for (Parts::const_iterator i(parts.begin()), i_end(parts.end()) ;
+                    i != i_end ; ++i)
+            {
+                keys.push_back(make_component_key(*i));
+                all_keys_packed = all_keys_packed && keys.back().packed;
+            }
+        }
     };
 
     template <>
@@ -289,6 +370,9 @@ VersionSpec::VersionSpec(const std::string & text, const VersionSpecOptions & op
     /* trailing stuff? */
     if (! parser.eof())
         throw BadVersionSpecError(text, "unexpected trailing text '" + text.substr(parser.offset()) + "'");
+
+    /* comparisons are done a lot, so don't do string work for each one */
+    _imp->make_keys();
 }
 
 VersionSpec::VersionSpec(const VersionSpec & other) :
@@ -296,6 +380,8 @@ VersionSpec::VersionSpec(const VersionSpec & other) :
 {
     _imp->text = other._imp->text;
     _imp->parts = other._imp->parts;
+    _imp->keys = other._imp->keys;
+    _imp->all_keys_packed = other._imp->all_keys_packed;
 }
 
 const VersionSpec &
@@ -305,6 +391,8 @@ VersionSpec::operator= (const VersionSpec & other)
     {
         _imp->text = other._imp->text;
         _imp->parts = other._imp->parts;
+        _imp->keys = other._imp->keys;
+        _imp->all_keys_packed = other._imp->all_keys_packed;
         _imp->has_hash = other._imp->has_hash;
         _imp->hash = other._imp->hash;
         _imp->has_is_scm = other._imp->has_is_scm;
@@ -319,14 +407,54 @@ VersionSpec::~VersionSpec()
 
 namespace
 {
+    /* the key for an empty component, as a constant so it's usable during
+     * static initialisation */
+    const ComponentKey end_key = { vsct_empty, true, 0 };
+
+    bool is_zero_revision(const ComponentKey & k)
+    {
+        return vsct_revision == k.type && k.packed && 0 == k.value;
+    }
+
+    /**
+     * Equivalent to componentwise_compare with compare_comparator, for when
+     * every key is packed.
+     */
+    int packed_compare(const Keys & a, const Keys & b)
+    {
+        Keys::const_iterator k1(a.begin()), k1_end(a.end()), k2(b.begin()), k2_end(b.end());
+        while (true)
+        {
+            const ComponentKey & q1(k1 == k1_end ? end_key : *k1);
+            const ComponentKey & q2(k2 == k2_end ? end_key : *k2);
+
+            if (k1 == k1_end && k2 == k2_end)
+                return 0;
+
+            if (! ((k1 == k1_end && is_zero_revision(q2)) || (k2 == k2_end && is_zero_revision(q1))))
+            {
+                if (q1.type != q2.type)
+                    return q1.type < q2.type ? -1 : 1;
+                if (q1.value != q2.value)
+                    return q1.value < q2.value ? -1 : 1;
+            }
+
+            if (k1_end != k1)
+                ++k1;
+            if (k2_end != k2)
+                ++k2;
+        }
+    }
+
     template <typename R_>
     R_
-    componentwise_compare(const Parts & a, const Parts & b,
+    componentwise_compare(const Parts & a, const Keys & a_keys, const Parts & b, const Keys & b_keys,
             std::pair<R_, bool> (*comparator)(const VersionSpecComponent &, Parts::const_iterator, Parts::const_iterator,
                     const VersionSpecComponent &, Parts::const_iterator, Parts::const_iterator, int))
     {
         std::vector<VersionSpecComponent>::const_iterator
             v1(a.begin()), v1_end(a.end()), v2(b.begin()), v2_end(b.end());
+        Keys::const_iterator k1(a_keys.begin()), k2(b_keys.begin());
 
         VersionSpecComponent end_part(make_named_values<VersionSpecComponent>(
                     value_for<n::number_value>(""),
@@ -337,6 +465,8 @@ namespace
         {
             const VersionSpecComponent * const p1(v1 == v1_end ? &end_part : &*v1);
             const VersionSpecComponent * const p2(v2 == v2_end ? &end_part : &*v2);
+            const ComponentKey & q1(v1 == v1_end ? end_key : *k1);
+            const ComponentKey & q2(v2 == v2_end ? end_key : *k2);
 
             if (&end_part == p1 && &end_part == p2)
             {
@@ -349,17 +479,20 @@ namespace
 
             int compared(-2);
 
-            if (p1 == &end_part && (*p2).type() == vsct_revision && (*p2).number_value() == "0")
+            if (p1 == &end_part && is_zero_revision(q2))
                 compared = 0;
 
-            else if (p2 == &end_part && (*p1).type() == vsct_revision && (*p1).number_value() == "0")
+            else if (p2 == &end_part && is_zero_revision(q1))
                 compared = 0;
 
-            else if ((*p1).type() < (*p2).type())
+            else if (q1.type < q2.type)
                 compared = -1;
-            else if ((*p1).type() > (*p2).type())
+            else if (q1.type > q2.type)
                 compared = 1;
 
+            else if (q1.packed && q2.packed)
+                compared = q1.value < q2.value ? -1 : q1.value > q2.value ? 1 : 0;
+
             else
             {
                 std::string p1s((*p1).number_value()), p2s((*p2).number_value());
@@ -404,9 +537,15 @@ namespace
                 return result.first;
 
             if (v1_end != v1)
+            {
                 ++v1;
+                ++k1;
+            }
             if (v2_end != v2)
+            {
                 ++v2;
+                ++k2;
+            }
         }
     }
 
@@ -451,19 +590,22 @@ namespace
 int
 VersionSpec::compare(const VersionSpec & other) const
 {
-    return componentwise_compare(_imp->parts, other._imp->parts, compare_comparator);
+    if (_imp->all_keys_packed && other._imp->all_keys_packed)
+        return packed_compare(_imp->keys, other._imp->keys);
+
+    return componentwise_compare(_imp->parts, _imp->keys, other._imp->parts, other._imp->keys, compare_comparator);
 }
 
 bool
 VersionSpec::tilde_compare(const VersionSpec & other) const
 {
-    return componentwise_compare(_imp->parts, other._imp->parts, tilde_compare_comparator);
+    return componentwise_compare(_imp->parts, _imp->keys, other._imp->parts, other._imp->keys, tilde_compare_comparator);
 }
 
 bool
 VersionSpec::nice_equal_star_compare(const VersionSpec & other) const
 {
-    return componentwise_compare(_imp->parts, other._imp->parts, nice_equal_star_compare_comparator);
+    return componentwise_compare(_imp->parts, _imp->keys, other._imp->parts, other._imp->keys, nice_equal_star_compare_comparator);
 }
 
 bool
@@ -559,6 +701,7 @@ VersionSpec::remove_revision() const
                 result._imp->parts.begin(),
                 result._imp->parts.end(),
                 IsVersionSpecComponentType<vsct_revision>()), result._imp->parts.end());
+    result._imp->make_keys();
 
     std::string::size_type p;
     if (std::string::npos != ((p = result._imp->text.rfind("-r"))))
@@ -461,6 +461,15 @@ namespace test_cases
             TEST_CHECK(VersionSpec("1.2", VersionSpecOptions()) != VersionSpec("1.2-r0.1", VersionSpecOptions()));
             TEST_CHECK(VersionSpec("1.2-r0.1", VersionSpecOptions()) != VersionSpec("1.2", VersionSpecOptions()));
 
+            TEST_CHECK(VersionSpec("12345678901234567890", VersionSpecOptions()) > VersionSpec("9999999999999999999", VersionSpecOptions()));
+            TEST_CHECK(VersionSpec("12345678901234567890", VersionSpecOptions()) < VersionSpec("12345678901234567891", VersionSpecOptions()));
+            TEST_CHECK(VersionSpec("1.12345678901234567890", VersionSpecOptions()) > VersionSpec("1.2", VersionSpecOptions()));
+            TEST_CHECK(VersionSpec("1.012345678901234567891", VersionSpecOptions()) > VersionSpec("1.01234567890123456789", VersionSpecOptions()));
+            TEST_CHECK(VersionSpec("1.0123456789012345678900", VersionSpecOptions()) == VersionSpec("1.01234567890123456789", VersionSpecOptions()));
+            TEST_CHECK(VersionSpec("1_p12345678901234567890", VersionSpecOptions()) > VersionSpec("1_p99", VersionSpecOptions()));
+            TEST_CHECK(VersionSpec("1_p12345678901234567890-scm", VersionSpecOptions()) < VersionSpec("1_p-scm", VersionSpecOptions()));
+            TEST_CHECK(VersionSpec("1-r12345678901234567890", VersionSpecOptions()) > VersionSpec("1", VersionSpecOptions()));
+
             TEST_CHECK(VersionSpec("1_alpha_beta-scm", VersionSpecOptions()) == VersionSpec("1_alpha0_beta-scm", VersionSpecOptions()));
             TEST_CHECK(VersionSpec("1_alpha_beta000_rc3-scm", VersionSpecOptions()) == VersionSpec("1_alpha00_beta_rc3-scm", VersionSpecOptions()));
 
@@ -0,0 +1,217 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Measures VersionSpec comparisons over every pair of a set of generated
+ * versions. Built but not run by 'make check'; use:
+ *
+ *     make benchmark BENCHMARK_OPTIONS="[--count N] [--repeat N]"
+ *
+ * The 'typical' versions look like those found in a real tree. In the 'long'
+ * versions, a third of the numeric components are too long to pack, so the
+ * string comparison fallback gets used. For each case and comparison we
+ * report the time and the number of allocations per comparison, and a sum of
+ * the results so that changes in behaviour show up. Versions are generated
+ * from a fixed seed, so numbers are comparable between builds.
+ */
+
+#include <paludis/version_spec.hh>
+#include <paludis/user_dep_spec.hh>
+#include <paludis/util/exception.hh>
+#include <paludis/util/destringify.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/options.hh>
+#include <paludis/util/benchmark_extras.hh>
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+
+using namespace paludis;
+using namespace paludis::benchmark_extras;
+
+namespace
+{
+    typedef std::vector<VersionSpec> Versions;
+
+    double now()
+    {
+        struct timeval tv;
+        gettimeofday(&tv, 0);
+        return tv.tv_sec + tv.tv_usec / 1000000.0;
+    }
+
+    struct Random
+    {
+        unsigned long state;
+
+        Random() :
+            state(12345)
+        {
+        }
+
+        unsigned operator() (const unsigned n)
+        {
+            state = state * 1103515245 + 12345;
+            return (state / 65536) % n;
+        }
+    };
+
+    std::string number(Random & random, const bool allow_long)
+    {
+        if (allow_long && 0 == random(3))
+            return stringify(1 + random(9)) + std::string(19 + random(5), '0' + random(10));
+        else
+            return stringify(random(random(2) ? 20 : 2000));
+    }
+
+    std::string make_version(Random & random, const bool allow_long)
+    {
+        static const char * const suffixes[] = { "_alpha", "_beta", "_pre", "_rc", "_p" };
+
+        std::string result(number(random, allow_long));
+        for (unsigned n(random(4)) ; n > 0 ; --n)
+        {
+            /* a leading zero makes a float-like part */
+            if (0 == random(5))
+                result.append(".0" + stringify(random(100)));
+            else
+                result.append("." + number(random, allow_long));
+        }
+
+        if (0 == random(8))
+            result.append(1, 'a' + random(26));
+
+        if (0 == random(4))
+        {
+            result.append(suffixes[random(5)]);
+            if (random(2))
+                result.append(number(random, allow_long));
+        }
+
+        if (0 == random(20))
+            result.append("-scm");
+
+        if (0 == random(3))
+            result.append("-r" + stringify(random(10)));
+
+        return result;
+    }
+
+    void make_versions(Versions & versions, const unsigned count, const bool allow_long)
+    {
+        Random random;
+        versions.clear();
+        versions.reserve(count);
+        for (unsigned n(0) ; n < count ; ++n)
+            versions.push_back(VersionSpec(make_version(random, allow_long), user_version_spec_options()));
+    }
+
+    void report(const std::string & name, const std::string & comparison, const unsigned long count,
+            const double seconds, const unsigned long allocated, const long result)
+    {
+        std::cout << std::left << std::setw(10) << name << std::setw(12) << comparison << std::right
+            << std::setw(12) << std::fixed << std::setprecision(1) << (seconds * 1000000000.0 / count)
+            << std::setw(16) << std::setprecision(2) << (static_cast<double>(allocated) / count)
+            << std::setw(12) << result
+            << std::endl;
+    }
+
+    template <typename F_>
+    void run(const std::string & name, const std::string & comparison, const Versions & versions,
+            const unsigned repeat, F_ f)
+    {
+        unsigned long before_allocations(allocations());
+        double before(now());
+        long result(0);
+        for (unsigned r(0) ; r < repeat ; ++r)
+            for (Versions::const_iterator a(versions.begin()), a_end(versions.end()) ; a != a_end ; ++a)
+                for (Versions::const_iterator b(versions.begin()), b_end(versions.end()) ; b != b_end ; ++b)
+                    result += f(*a, *b);
+        report(name, comparison, static_cast<unsigned long>(repeat) * versions.size() * versions.size(),
+                now() - before, allocations() - before_allocations, result);
+    }
+
+    int compare(const VersionSpec & a, const VersionSpec & b)
+    {
+        return a.compare(b);
+    }
+
+    int tilde(const VersionSpec & a, const VersionSpec & b)
+    {
+        return a.tilde_compare(b);
+    }
+
+    int equal_star(const VersionSpec & a, const VersionSpec & b)
+    {
+        return a.nice_equal_star_compare(b);
+    }
+
+    void run_case(const std::string & name, const unsigned count, const unsigned repeat, const bool allow_long)
+    {
+        Context context("When benchmarking '" + name + "':");
+
+        Versions versions;
+        make_versions(versions, count, allow_long);
+
+        run(name, "compare", versions, repeat, compare);
+        run(name, "tilde", versions, repeat, tilde);
+        run(name, "equal-star", versions, repeat, equal_star);
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    unsigned count(1500), repeat(5);
+
+    for (int a(1) ; a < argc ; ++a)
+    {
+        const std::string arg(argv[a]);
+        if (arg == "--count" && a + 1 < argc)
+            count = destringify<unsigned>(argv[++a]);
+        else if (arg == "--repeat" && a + 1 < argc)
+            repeat = destringify<unsigned>(argv[++a]);
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--count N] [--repeat N]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    try
+    {
+        std::cout << std::left << std::setw(10) << "case" << std::setw(12) << "comparison" << std::right
+            << std::setw(12) << "ns/compare" << std::setw(16) << "allocs/compare" << std::setw(12) << "checksum"
+            << std::endl;
+
+        run_case("typical", count, repeat, false);
+        run_case("long", count, repeat, true);
+    }
+    catch (const Exception & e)
+    {
+        std::cerr << "Caught exception " << e.message() << " (" << e.what() << ")" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
@@ -360,7 +360,7 @@ class EnvironmentImplementationWrapper :
                 throw PythonMethodNotImplemented("EnvironmentImplementation", "remove_from_world");
         }
 
-        virtual std::tr1::shared_ptr<PackageIDSequence> operator[] (const Selection & fg) const
+        virtual std::tr1::shared_ptr<const PackageIDSequence> operator[] (const Selection & fg) const
             PALUDIS_ATTRIBUTE((warn_unused_result))
         {
             Lock l(get_mutex());
@@ -370,7 +370,7 @@ class EnvironmentImplementationWrapper :
             return EnvironmentImplementation::operator[] (fg);
         }
 
-        virtual std::tr1::shared_ptr<PackageIDSequence> default_operator_square_brackets(const Selection & fg) const
+        virtual std::tr1::shared_ptr<const PackageIDSequence> default_operator_square_brackets(const Selection & fg) const
             PALUDIS_ATTRIBUTE((warn_unused_result))
         {
             return EnvironmentImplementation::operator[] (fg);
@@ -18,6 +18,7 @@
  */
 
 #include "cmd_find_candidates.hh"
+#include "cmd_match.hh"
 #include <paludis/args/args.hh>
 #include <paludis/args/do_help.hh>
 #include <paludis/name.hh>
@@ -38,6 +39,9 @@
 #include <paludis/user_dep_spec.hh>
 #include <paludis/package_id.hh>
 #include <paludis/mask.hh>
+#include <paludis/action.hh>
+#include <paludis/util/fs_entry.hh>
+#include <output/search_index.hh>
 #include <cstdlib>
 #include <iostream>
 #include <algorithm>
@@ -126,8 +130,8 @@ void
 FindCandidatesCommand::run_hosted(
         const std::tr1::shared_ptr<Environment> & env,
         const SearchCommandLineCandidateOptions & search_options,
-        const SearchCommandLineMatchOptions &,
-        const std::tr1::shared_ptr<const Set<std::string> > &,
+        const SearchCommandLineMatchOptions & match_options,
+        const std::tr1::shared_ptr<const Set<std::string> > & patterns,
         const std::tr1::function<void (const PackageDepSpec &)> & yield,
         const std::tr1::function<void (const std::string &)> & step)
 {
@@ -164,6 +168,68 @@ FindCandidatesCommand::run_hosted(
         }
     }
 
+    /* the index knows about names, descriptions and HOMEPAGE, but not
+     * arbitrary keys */
+    bool index_has_keys(true);
+    for (args::StringSetArg::ConstIterator a(match_options.a_key.begin_args()),
+            a_end(match_options.a_key.end_args()) ;
+            a != a_end ; ++a)
+        if (*a != "HOMEPAGE")
+            index_has_keys = false;
+
+    if (search_options.a_index.specified() && index_has_keys)
+    {
+        step("Searching index");
+
+        bool default_names_and_descriptions((! match_options.a_name.specified()) &&
+                (! match_options.a_description.specified()) && (! match_options.a_key.specified()));
+
+        MatchCommand match_command;
+        SearchIndex index(env.get(), FSEntry(search_options.a_index.argument()));
+        for (QualifiedPackageNames::iterator q(package_names.begin()), q_end(package_names.end()) ;
+                q != q_end ; )
+        {
+            if (index.excludes(*q,
+                        default_names_and_descriptions || match_options.a_name.specified(),
+                        default_names_and_descriptions || match_options.a_description.specified(),
+                        match_options.a_key.specified(),
+                        std::tr1::bind(&MatchCommand::match_texts, &match_command, std::tr1::cref(match_options),
+                            patterns, std::tr1::placeholders::_1)))
+                package_names.erase(q++);
+            else
+                ++q;
+        }
+    }
+
+    /* looking for every version doesn't need any metadata. otherwise, the
+     * selections below check whether every version of the package in every
+     * repository that can install things is masked, so that's what's worth
+     * loading in bulk. */
+    if (! search_options.a_all_versions.specified())
+    {
+        step("Loading metadata");
+
+        for (RepositoryNames::const_iterator r(repository_names.begin()), r_end(repository_names.end()) ;
+                r != r_end ; ++r)
+        {
+            const std::tr1::shared_ptr<const Repository> repo(env->package_database()->fetch_repository(*r));
+            if (! repo->some_ids_might_support_action(SupportsActionTest<InstallAction>()))
+                continue;
+
+            const std::tr1::shared_ptr<PackageIDSequence> ids(new PackageIDSequence);
+            for (QualifiedPackageNames::const_iterator q(package_names.begin()), q_end(package_names.end()) ;
+                    q != q_end ; ++q)
+            {
+                if (! repo->has_package_named(*q))
+                    continue;
+
+                const std::tr1::shared_ptr<const PackageIDSequence> q_ids(repo->package_ids(*q));
+                std::copy(q_ids->begin(), q_ids->end(), ids->back_inserter());
+            }
+            repo->prefetch_metadata(ids);
+        }
+    }
+
     step("Searching versions");
 
     for (QualifiedPackageNames::const_iterator q(package_names.begin()), q_end(package_names.end()) ;
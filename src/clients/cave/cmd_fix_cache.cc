@@ -28,6 +28,8 @@
 #include <paludis/repository.hh>
 #include <paludis/util/make_shared_ptr.hh>
 #include <paludis/util/indirect_iterator-impl.hh>
+#include <paludis/util/fs_entry.hh>
+#include <output/search_index.hh>
 
 #include <iostream>
 #include <set>
@@ -68,6 +70,9 @@ namespace
         args::SwitchArg a_installable;
         args::SwitchArg a_installed;
 
+        args::ArgsGroup g_search_index;
+        args::StringArg a_search_index;
+
         FixCacheCommandLine() :
             g_repositories(main_options_section(), "Repositories", "Select repositories whose cache is to be "
                     "regenerated. If none of these restrictions are specified, all repositories are selected. "
@@ -75,7 +80,11 @@ namespace
             a_repository(&g_repositories, "repository", 'r', "Select the repository with the specified name. May "
                     "be specified multiple times."),
             a_installable(&g_repositories, "installable", 'i', "Select all installable repositories.", true),
-            a_installed(&g_repositories, "installed", 'I', "Select all installed repositories", true)
+            a_installed(&g_repositories, "installed", 'I', "Select all installed repositories", true),
+            g_search_index(main_options_section(), "Search Index", "Options for creating a search index."),
+            a_search_index(&g_search_index, "search-index", '\0', "After fixing caches, write a search index "
+                    "for use with 'cave search --index' to the specified file. The index covers every repository, "
+                    "not just those selected.")
         {
         }
     };
@@ -146,6 +155,12 @@ FixCacheCommand::run(
         repo->regenerate_cache();
     }
 
+    if (cmdline.a_search_index.specified())
+    {
+        cout << format_general_s(f::fix_cache_search_index(), cmdline.a_search_index.argument());
+        SearchIndex::create(env.get(), FSEntry(cmdline.a_search_index.argument()));
+    }
+
     return EXIT_SUCCESS;
 }
 
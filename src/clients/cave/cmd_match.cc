@@ -365,6 +365,15 @@ MatchCommand::run_hosted(
         (*i)->accept(m);
     }
 
+    return match_texts(match_options, patterns, texts);
+}
+
+bool
+MatchCommand::match_texts(
+        const SearchCommandLineMatchOptions & match_options,
+        const std::tr1::shared_ptr<const Set<std::string> > & patterns,
+        const std::list<std::string> & texts)
+{
     bool any(false), all(true);
     for (std::list<std::string>::const_iterator t(texts.begin()), t_end(texts.end()) ;
             t != t_end ; ++t)
@@ -25,6 +25,7 @@
 #include <paludis/dep_spec-fwd.hh>
 #include <paludis/util/set-fwd.hh>
 #include <tr1/functional>
+#include <list>
 
 namespace paludis
 {
@@ -45,6 +46,11 @@ namespace paludis
                         const std::tr1::shared_ptr<const Set<std::string> > &,
                         const PackageDepSpec &);
 
+                bool match_texts(
+                        const SearchCommandLineMatchOptions &,
+                        const std::tr1::shared_ptr<const Set<std::string> > &,
+                        const std::list<std::string> &);
+
                 std::tr1::shared_ptr<args::ArgsHandler> make_doc_cmdline();
         };
     }
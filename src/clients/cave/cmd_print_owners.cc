@@ -37,11 +37,15 @@
 #include <paludis/util/indirect_iterator-impl.hh>
 #include <paludis/util/make_shared_ptr.hh>
 #include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/util/set.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/exception.hh>
 
 #include <iostream>
 #include <algorithm>
 #include <cstdlib>
 #include <tr1/functional>
+#include <set>
 
 using namespace paludis;
 using namespace cave;
@@ -125,21 +129,55 @@ PrintOwnersCommand::run(
     const std::string match(cmdline.a_match.argument());
     const std::string query(*cmdline.begin_parameters());
     std::tr1::function<bool (const std::string &, const std::tr1::shared_ptr<const ContentsEntry> &)> handler;
+    OwnersMatch owners_match;
 
     if ("full" == match)
-        handler = handle_full;
+        owners_match = om_full;
     else if ("basename" == match)
-        handler = handle_basename;
+        owners_match = om_basename;
     else if ("partial" == match)
-        handler = handle_partial;
+        owners_match = om_partial;
     else
     {
         if (! query.empty() && '/' == query.at(0))
-            handler = handle_full;
+            owners_match = om_full;
         else if (std::string::npos != query.find("/"))
-            handler = handle_partial;
+            owners_match = om_partial;
         else
+            owners_match = om_basename;
+    }
+
+    switch (owners_match)
+    {
+        case om_full:
+            handler = handle_full;
+            break;
+        case om_basename:
             handler = handle_basename;
+            break;
+        case om_partial:
+            handler = handle_partial;
+            break;
+        case last_om:
+            throw InternalError(PALUDIS_HERE, "Bad OwnersMatch");
+    }
+
+    /* repositories that can answer the question themselves don't need us to
+     * load the contents of everything they have installed */
+    std::set<RepositoryName, RepositoryNameComparator> indexed_repositories;
+    PackageIDSet indexed_owners;
+    for (PackageDatabase::RepositoryConstIterator r(env->package_database()->begin_repositories()),
+            r_end(env->package_database()->end_repositories()) ; r != r_end ; ++r)
+    {
+        if ((! (*r)->installed_root_key()) || (! (*r)->owners_interface()))
+            continue;
+
+        indexed_repositories.insert((*r)->name());
+        const std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence> owners(
+                (*r)->owners_interface()->owners(query, owners_match));
+        for (RepositoryOwnersInterface::OwnersSequence::ConstIterator o(owners->begin()), o_end(owners->end()) ;
+                o != o_end ; ++o)
+            indexed_owners.insert(o->package_id());
     }
 
     std::tr1::shared_ptr<const PackageIDSequence> ids((*env)[selection::AllVersionsSorted(generator::All() |
@@ -147,6 +185,16 @@ PrintOwnersCommand::run(
 
     for (PackageIDSequence::ConstIterator p(ids->begin()), p_end(ids->end()); p != p_end; ++p)
     {
+        if (indexed_repositories.end() != indexed_repositories.find((*p)->repository()->name()))
+        {
+            if (0 != indexed_owners.count(*p))
+            {
+                cout << **p << endl;
+                found = true;
+            }
+            continue;
+        }
+
         if (! (*p)->contents_key())
             continue;
 
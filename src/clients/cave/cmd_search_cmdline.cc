@@ -26,7 +26,12 @@ SearchCommandLineCandidateOptions::SearchCommandLineCandidateOptions(args::ArgsH
     ArgsSection(h, "Search Candidate Options"),
     g_candidate_options(this, "Candidate Options", "Control which packages and versions are selected as "
             "candidates for matching."),
-    a_all_versions(&g_candidate_options, "all-versions", 'a', "Search in every version of packages", true)
+    a_all_versions(&g_candidate_options, "all-versions", 'a', "Search in every version of packages", true),
+    a_index(&g_candidate_options, "index", '\0', "Use the specified search index, as created by 'cave fix-cache "
+            "--search-index' or 'cave sync --search-index', to skip packages whose names, descriptions and "
+            "homepages cannot match. Packages which are not in the index are always searched. Ignored if --key "
+            "is specified for any key other than HOMEPAGE, or if any repository has changed since the index was "
+            "created.")
 {
 }
 
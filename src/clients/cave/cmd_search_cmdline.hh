@@ -35,6 +35,7 @@ namespace paludis
 
             args::ArgsGroup g_candidate_options;
             args::SwitchArg a_all_versions;
+            args::StringArg a_index;
         };
 
         struct SearchCommandLineMatchOptions :
@@ -804,6 +804,8 @@ namespace
         if (ids->empty())
             throw NothingMatching(s);
 
+        env->package_database()->prefetch_metadata(ids);
+
         std::tr1::shared_ptr<const PackageID> best_installable, best_masked_installable;
         std::tr1::shared_ptr<PackageIDSequence> all_installed(new PackageIDSequence);
         std::set<RepositoryName, RepositoryNameComparator> repos;
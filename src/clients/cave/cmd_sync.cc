@@ -40,6 +40,7 @@
 #include <paludis/syncer.hh>
 #include <paludis/metadata_key.hh>
 #include <paludis/create_output_manager_info.hh>
+#include <output/search_index.hh>
 #include <tr1/functional>
 #include <cstdlib>
 #include <iostream>
@@ -64,6 +65,9 @@ namespace
         args::ArgsGroup g_job_options;
         args::SwitchArg a_sequential;
 
+        args::ArgsGroup g_search_index;
+        args::StringArg a_search_index;
+
         virtual std::string app_name() const
         {
             return "cave sync";
@@ -82,7 +86,11 @@ namespace
 
         SyncCommandLine() :
             g_job_options(main_options_section(), "Job Options", "Job options."),
-            a_sequential(&g_job_options, "sequential", '\0', "Only perform one sync at a time.", false)
+            a_sequential(&g_job_options, "sequential", '\0', "Only perform one sync at a time.", false),
+            g_search_index(main_options_section(), "Search Index", "Options for refreshing a search index."),
+            a_search_index(&g_search_index, "search-index", '\0', "After syncing, write a search index for use "
+                    "with 'cave search --index' to the specified file. Setting this in CAVE_SYNC_OPTIONS keeps the "
+                    "index up to date. The index covers every repository, not just those synced.")
         {
             add_usage_line("[ --sequential ] [repository ...]");
         }
@@ -401,6 +409,12 @@ SyncCommand::run(
         (*r)->purge_invalid_cache();
     }
 
+    if (cmdline.a_search_index.specified())
+    {
+        cout << format_general_s(f::sync_search_index(), cmdline.a_search_index.argument());
+        SearchIndex::create(env.get(), FSEntry(cmdline.a_search_index.argument()));
+    }
+
     if (0 != env->perform_hook(Hook("sync_all_post")
                 ("TARGETS", join(repos.begin(), repos.end(), " ")
                 )).max_exit_status())
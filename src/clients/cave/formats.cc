@@ -321,6 +321,12 @@ paludis::cave::f::fix_cache_fixing()
     return "Fixing cache for " + c::blue_or_pink() + "%s" + c::normal() + "...\\n";
 }
 
+const std::string
+paludis::cave::f::fix_cache_search_index()
+{
+    return "Writing search index to " + c::blue_or_pink() + "%s" + c::normal() + "...\\n";
+}
+
 const std::string
 paludis::cave::f::colour_formatter_keyword_name_plain()
 {
@@ -627,3 +633,9 @@ paludis::cave::f::sync_repo_tail()
     return "    ... %s\\n";
 }
 
+const std::string
+paludis::cave::f::sync_search_index()
+{
+    return "Writing search index to " + c::blue_or_pink() + "%s" + c::normal() + "...\\n";
+}
+
@@ -98,6 +98,7 @@ namespace paludis
             const std::string info_heading();
 
             const std::string fix_cache_fixing();
+            const std::string fix_cache_search_index();
 
             const std::string colour_formatter_keyword_name_plain();
             const std::string colour_formatter_keyword_name_accepted();
@@ -157,6 +158,7 @@ namespace paludis
             const std::string sync_repo_active();
             const std::string sync_repo_active_quiet();
             const std::string sync_repo_tail();
+            const std::string sync_search_index();
         }
     }
 }
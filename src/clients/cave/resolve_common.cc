@@ -28,6 +28,7 @@
 
 #include <paludis/util/make_shared_ptr.hh>
 #include <paludis/util/mutex.hh>
+#include <paludis/util/log.hh>
 #include <paludis/util/stringify.hh>
 #include <paludis/util/make_named_values.hh>
 #include <paludis/util/system.hh>
@@ -1704,9 +1705,11 @@ paludis::cave::resolve_common(
                 ));
 
     ScopedSelectionCache selection_cache(env.get());
-    std::tr1::shared_ptr<Resolver> resolver(new Resolver(env.get(), resolver_functions));
+    const std::tr1::shared_ptr<SanitisedDependenciesCache> sanitised_dependencies_cache(new SanitisedDependenciesCache);
+    std::tr1::shared_ptr<Resolver> resolver(new Resolver(env.get(), resolver_functions, sanitised_dependencies_cache));
     bool is_set(false);
     std::list<SuggestRestart> restarts;
+    int restarts_avoided(0);
 
     try
     {
@@ -1727,11 +1730,12 @@ paludis::cave::resolve_common(
                 catch (const SuggestRestart & e)
                 {
                     restarts.push_back(e);
+                    restarts_avoided += resolver->restarts_avoided();
                     display_callback(ResolverRestart());
                     initial_constraints.insert(std::make_pair(e.resolvent(), make_initial_constraints_for(
                                     env.get(), resolution_options, without, e.resolvent()))).first->second->add(
                             e.suggested_preset());
-                    resolver = make_shared_ptr(new Resolver(env.get(), resolver_functions));
+                    resolver = make_shared_ptr(new Resolver(env.get(), resolver_functions, sanitised_dependencies_cache));
 
                     if (restarts.size() > 9000)
                         throw InternalError(PALUDIS_HERE, "Restarted over nine thousand times. Something's "
@@ -1741,6 +1745,14 @@ paludis::cave::resolve_common(
             }
         }
 
+        Log::get_instance()->message("cave.resolve.sanitised_dependencies_cache", ll_debug, lc_context)
+            << "Sanitised dependencies cache: " << sanitised_dependencies_cache->hits() << " hits, "
+            << sanitised_dependencies_cache->misses() << " misses, " << sanitised_dependencies_cache->stale()
+            << " stale, over " << restarts.size() << " restarts";
+
+        Log::get_instance()->message("cave.resolve.restarts_avoided", ll_debug, lc_context)
+            << "Avoided " << (restarts_avoided + resolver->restarts_avoided()) << " restarts by undoing decisions";
+
         if (! restarts.empty())
             display_restarts_if_requested(restarts, resolution_options);
 
@@ -75,6 +75,9 @@ CommandLine::CommandLine() :
             ("installed",          "Installed packages")
             ("all",                "All packages (default if --repository specified)"),
             "installable"),
+    a_index(&filter_args, "index", '\0', "Use this search index, as created by 'cave fix-cache --search-index', "
+            "to skip packages whose names and descriptions cannot match (ignored if --keys is specified, or if "
+            "any repository has changed since the index was created)"),
 
     output_args(main_options_section(), "Output options",
             "Options that control how output is generated."),
@@ -91,6 +91,7 @@ class CommandLine :
         paludis::args::SwitchArg a_visible_only;
         paludis::args::SwitchArg a_all_versions;
         paludis::args::EnumArg a_kind;
+        paludis::args::StringArg a_index;
 
         ///\}
 
@@ -25,6 +25,8 @@
 #include "name_description_extractor.hh"
 #include "query_task.hh"
 
+#include <output/search_index.hh>
+
 #include <paludis/environment.hh>
 #include <paludis/package_database.hh>
 #include <paludis/action.hh>
@@ -38,6 +40,7 @@
 #include <paludis/util/forward_parallel_for_each.hh>
 #include <paludis/util/system.hh>
 #include <paludis/util/destringify.hh>
+#include <paludis/util/fs_entry.hh>
 #include <tr1/functional>
 #include <list>
 #include <set>
@@ -228,6 +231,21 @@ namespace
         }
     };
 
+    bool match_texts(
+            const std::list<std::tr1::shared_ptr<Matcher> > & matchers,
+            const bool invert_match,
+            const std::list<std::string> & texts)
+    {
+        for (std::list<std::string>::const_iterator t(texts.begin()), t_end(texts.end()) ;
+                t != t_end ; ++t)
+            for (std::list<std::tr1::shared_ptr<Matcher> >::const_iterator m(matchers.begin()), m_end(matchers.end()) ;
+                    m != m_end ; ++m)
+                if ((**m)(*t))
+                    return ! invert_match;
+
+        return invert_match;
+    }
+
     std::tr1::shared_ptr<const PackageID> fetch_id(
             const Environment & env,
             const std::tr1::shared_ptr<const Repository> & r,
@@ -419,6 +437,21 @@ do_search(Environment & env)
             }
     }
 
+    if (CommandLine::get_instance()->a_index.specified() &&
+            CommandLine::get_instance()->a_keys.begin_args() == CommandLine::get_instance()->a_keys.end_args())
+    {
+        SearchIndex index(&env, FSEntry(CommandLine::get_instance()->a_index.argument()));
+        for (std::map<QualifiedPackageName, std::tr1::shared_ptr<const PackageID> >::iterator
+                i(ids.begin()), i_end(ids.end()) ; i != i_end ; )
+        {
+            if (index.excludes(i->first, true, true, false, std::tr1::bind(&match_texts, std::tr1::cref(matchers),
+                            CommandLine::get_instance()->a_not.specified(), _1)))
+                ids.erase(i++);
+            else
+                ++i;
+        }
+    }
+
     Eligible eligible(
             CommandLine::get_instance()->a_visible_only.specified(),
             CommandLine::get_instance()->a_kind.argument());
@@ -42,6 +42,8 @@
 #include <paludis/util/safe_ofstream.hh>
 #include <paludis/util/pretty_print.hh>
 #include <paludis/util/indirect_iterator-impl.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/util/wrapped_output_iterator.hh>
 #include <paludis/util/timestamp.hh>
 #include <paludis/environments/no_config/no_config_environment.hh>
 #include <paludis/package_database.hh>
@@ -49,6 +51,7 @@
 #include <tr1/functional>
 #include <iostream>
 #include <map>
+#include <algorithm>
 
 using namespace paludis;
 using std::cout;
@@ -341,8 +344,11 @@ main(int argc, char *argv[])
                     value_for<n::write_cache>(CommandLine::get_instance()->a_output_directory.argument())
                 ));
 
-        std::tr1::shared_ptr<PackageIDSequence> ids(env[selection::AllVersionsSorted(
+        /* the workers take IDs off the front as they go, so they need a copy */
+        const std::tr1::shared_ptr<const PackageIDSequence> all_ids(env[selection::AllVersionsSorted(
                     generator::InRepository(env.main_repository()->name()))]);
+        const std::tr1::shared_ptr<PackageIDSequence> ids(new PackageIDSequence);
+        std::copy(all_ids->begin(), all_ids->end(), ids->back_inserter());
         Results results(env.package_database().get());
         unsigned success(0), total(0);
         CategoryNamePart old_cat("OLDCAT");
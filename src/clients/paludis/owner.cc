@@ -25,6 +25,7 @@
 #include <iostream>
 #include <algorithm>
 #include <set>
+#include <map>
 
 using namespace paludis;
 using std::cout;
@@ -79,6 +80,33 @@ namespace
             handle(stringify(e.location_key()->value()));
         }
     };
+
+    bool show_indexed_owners(const Environment & env, const Repository & repo, const std::string & query)
+    {
+        const bool full(CommandLine::get_instance()->a_full_match.specified());
+        const std::tr1::shared_ptr<const RepositoryOwnersInterface::OwnersSequence> owners(
+                repo.owners_interface()->owners(query, full ? om_full : om_partial));
+
+        std::map<std::tr1::shared_ptr<const PackageID>, std::set<std::string>, PackageIDComparator> matches(
+                PackageIDComparator(env.package_database().get()));
+        for (RepositoryOwnersInterface::OwnersSequence::ConstIterator o(owners->begin()), o_end(owners->end()) ;
+                o != o_end ; ++o)
+            matches[o->package_id()].insert(stringify(o->path()));
+
+        for (std::map<std::tr1::shared_ptr<const PackageID>, std::set<std::string>, PackageIDComparator>::const_iterator
+                m(matches.begin()), m_end(matches.end()) ; m != m_end ; ++m)
+        {
+            cout << "    " << *m->first << endl;
+            if (! full)
+            {
+                for (std::set<std::string>::const_iterator f(m->second.begin()), f_end(m->second.end()) ;
+                        f != f_end ; ++f)
+                    cout << "        " << *f << endl;
+            }
+        }
+
+        return ! matches.empty();
+    }
 }
 
 int
@@ -95,6 +123,12 @@ do_one_owner(
         if (! (*r)->installed_root_key())
             continue;
 
+        if ((*r)->owners_interface())
+        {
+            found_owner = show_indexed_owners(*env, **r, query) || found_owner;
+            continue;
+        }
+
         std::tr1::shared_ptr<const CategoryNamePartSet> cats((*r)->category_names());
         for (CategoryNamePartSet::ConstIterator c(cats->begin()),
                 c_end(cats->end()) ; c != c_end ; ++c)
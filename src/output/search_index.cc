@@ -0,0 +1,405 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "search_index.hh"
+#include <paludis/util/private_implementation_pattern-impl.hh>
+#include <paludis/util/fs_entry.hh>
+#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/tokeniser.hh>
+#include <paludis/util/iterator_funcs.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/set.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/util/wrapped_output_iterator.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/md5.hh>
+#include <paludis/util/join.hh>
+#include <paludis/util/dir_iterator.hh>
+#include <paludis/util/indirect_iterator-impl.hh>
+#include <paludis/util/accept_visitor.hh>
+#include <paludis/util/timestamp.hh>
+#include <paludis/environment.hh>
+#include <paludis/package_database.hh>
+#include <paludis/repository.hh>
+#include <paludis/package_id.hh>
+#include <paludis/metadata_key.hh>
+#include <paludis/name.hh>
+#include <paludis/dep_spec.hh>
+#include <paludis/spec_tree.hh>
+#include <vector>
+#include <set>
+#include <map>
+#include <sstream>
+#include <iterator>
+#include <algorithm>
+
+using namespace paludis;
+
+namespace
+{
+    const std::string magic("paludis-search-index-3");
+
+    struct Entry
+    {
+        std::tr1::shared_ptr<const std::string> short_description;
+        std::tr1::shared_ptr<const std::string> long_description;
+        std::tr1::shared_ptr<const std::string> homepages;
+    };
+
+    typedef std::map<QualifiedPackageName, std::list<Entry> > Entries;
+
+    std::string escape(const std::tr1::shared_ptr<const std::string> & s)
+    {
+        if (! s)
+            return "-";
+
+        std::string result("+");
+        for (std::string::const_iterator c(s->begin()), c_end(s->end()) ;
+                c != c_end ; ++c)
+            switch (*c)
+            {
+                case '\\':
+                    result.append("\\\\");
+                    break;
+                case '\t':
+                    result.append("\\t");
+                    break;
+                case '\n':
+                    result.append("\\n");
+                    break;
+                default:
+                    result.append(1, *c);
+            }
+
+        return result;
+    }
+
+    std::tr1::shared_ptr<const std::string> unescape(const std::string & s)
+    {
+        if (s == "-")
+            return std::tr1::shared_ptr<const std::string>();
+
+        if (s.empty() || s[0] != '+')
+            throw InternalError(PALUDIS_HERE, "bad text '" + s + "'");
+
+        std::tr1::shared_ptr<std::string> result(new std::string);
+        for (std::string::const_iterator c(next(s.begin())), c_end(s.end()) ;
+                c != c_end ; ++c)
+        {
+            if (*c == '\\' && next(c) != c_end)
+            {
+                ++c;
+                switch (*c)
+                {
+                    case 't':
+                        result->append(1, '\t');
+                        continue;
+                    case 'n':
+                        result->append(1, '\n');
+                        continue;
+                }
+            }
+            result->append(1, *c);
+        }
+
+        return result;
+    }
+
+    const std::tr1::shared_ptr<PackageIDSequence> all_ids(const std::tr1::shared_ptr<const Repository> & repo)
+    {
+        const std::tr1::shared_ptr<PackageIDSequence> result(new PackageIDSequence);
+        const std::tr1::shared_ptr<const CategoryNamePartSet> cats(repo->category_names());
+        for (CategoryNamePartSet::ConstIterator c(cats->begin()), c_end(cats->end()) ;
+                c != c_end ; ++c)
+        {
+            const std::tr1::shared_ptr<const QualifiedPackageNameSet> qpns(repo->package_names(*c));
+            for (QualifiedPackageNameSet::ConstIterator q(qpns->begin()), q_end(qpns->end()) ;
+                    q != q_end ; ++q)
+            {
+                const std::tr1::shared_ptr<const PackageIDSequence> q_ids(repo->package_ids(*q));
+                std::copy(q_ids->begin(), q_ids->end(), result->back_inserter());
+            }
+        }
+
+        return result;
+    }
+
+    void add_mtime(std::ostream & s, const FSEntry & f)
+    {
+        try
+        {
+            Timestamp t(f.mtim());
+            s << f << " " << t.seconds() << "." << t.nanoseconds() << std::endl;
+        }
+        catch (const FSError &)
+        {
+        }
+    }
+
+    /* something that changes whenever a repository gains, loses or modifies
+     * an ID, or an eclass or similar changes, worked out without loading any
+     * metadata. for repositories that live on disk, we only stat the top two
+     * levels of the tree (categories and packages, or eclasses and exlibs, or
+     * what a sync touches), since anything that adds, removes or replaces a
+     * file further down changes the mtime of its package directory. */
+    std::string stamp(const std::tr1::shared_ptr<const Repository> & repo)
+    {
+        std::stringstream s;
+
+        if (repo->location_key())
+        {
+            const FSEntry location(repo->location_key()->value());
+            add_mtime(s, location);
+
+            if (location.is_directory())
+                for (DirIterator d(location, DirIteratorOptions() + dio_include_dotfiles), d_end ;
+                        d != d_end ; ++d)
+                {
+                    add_mtime(s, *d);
+                    if (d->is_directory())
+                        for (DirIterator e(*d, DirIteratorOptions() + dio_include_dotfiles), e_end ;
+                                e != e_end ; ++e)
+                            add_mtime(s, *e);
+                }
+        }
+        else
+        {
+            /* things like virtuals repositories don't have anything we can
+             * stat, but they're cheap to list */
+            const std::tr1::shared_ptr<const PackageIDSequence> ids(all_ids(repo));
+            for (PackageIDSequence::ConstIterator i(ids->begin()), i_end(ids->end()) ;
+                    i != i_end ; ++i)
+                s << **i << std::endl;
+        }
+
+        return MD5(s).hexsum();
+    }
+
+    std::tr1::shared_ptr<const std::string> description(const std::tr1::shared_ptr<const MetadataValueKey<std::string> > & k)
+    {
+        if (! k)
+            return std::tr1::shared_ptr<const std::string>();
+        return std::tr1::shared_ptr<const std::string>(new std::string(k->value()));
+    }
+
+    struct HomepagesCollector
+    {
+        std::list<std::string> & texts;
+
+        void visit(const SimpleURISpecTree::NodeType<AllDepSpec>::Type & node)
+        {
+            std::for_each(indirect_iterator(node.begin()), indirect_iterator(node.end()), accept_visitor(*this));
+        }
+
+        void visit(const SimpleURISpecTree::NodeType<ConditionalDepSpec>::Type & node)
+        {
+            std::for_each(indirect_iterator(node.begin()), indirect_iterator(node.end()), accept_visitor(*this));
+        }
+
+        void visit(const SimpleURISpecTree::NodeType<SimpleURIDepSpec>::Type & node)
+        {
+            texts.push_back(stringify(*node.spec()));
+        }
+    };
+
+    /* URIs can't contain spaces, so we store them space separated */
+    std::tr1::shared_ptr<const std::string> homepages(const std::tr1::shared_ptr<const MetadataSpecTreeKey<SimpleURISpecTree> > & k)
+    {
+        if (! k)
+            return std::tr1::shared_ptr<const std::string>();
+
+        std::list<std::string> texts;
+        HomepagesCollector c = { texts };
+        k->value()->root()->accept(c);
+        return std::tr1::shared_ptr<const std::string>(new std::string(join(texts.begin(), texts.end(), " ")));
+    }
+}
+
+namespace paludis
+{
+    template <>
+    struct Implementation<SearchIndex>
+    {
+        Entries entries;
+    };
+}
+
+SearchIndex::SearchIndex(const Environment * const env, const FSEntry & f) :
+    PrivateImplementationPattern<SearchIndex>(new Implementation<SearchIndex>)
+{
+    Context context("When loading search index '" + stringify(f) + "':");
+
+    try
+    {
+        SafeIFStream file(f);
+
+        std::string line;
+        if ((! std::getline(file, line)) || line != magic)
+        {
+            Log::get_instance()->message("search_index.bad_format", ll_warning, lc_context)
+                << "Search index '" << f << "' is not in a supported format, ignoring it";
+            return;
+        }
+
+        std::map<std::string, std::string> stamps;
+        while (std::getline(file, line))
+        {
+            std::vector<std::string> tokens;
+            tokenise<delim_kind::AnyOfTag, delim_mode::DelimiterTag>(line, "\t", "", std::back_inserter(tokens));
+            if (tokens.size() == 3 && tokens[0] == "repository")
+            {
+                stamps.insert(std::make_pair(tokens[1], tokens[2]));
+                continue;
+            }
+
+            if (tokens.size() != 4)
+                throw InternalError(PALUDIS_HERE, "bad line '" + line + "'");
+
+            Entry entry;
+            entry.short_description = unescape(tokens[1]);
+            entry.long_description = unescape(tokens[2]);
+            entry.homepages = unescape(tokens[3]);
+            _imp->entries[QualifiedPackageName(tokens[0])].push_back(entry);
+        }
+
+        /* an entry is only any good if nothing that went into it has changed
+         * since the index was created */
+        unsigned repositories(0);
+        for (PackageDatabase::RepositoryConstIterator r(env->package_database()->begin_repositories()),
+                r_end(env->package_database()->end_repositories()) ; r != r_end ; ++r, ++repositories)
+        {
+            std::map<std::string, std::string>::const_iterator m(stamps.find(stringify((*r)->name())));
+            if (m == stamps.end() || m->second != stamp(*r))
+            {
+                Log::get_instance()->message("search_index.stale", ll_warning, lc_context)
+                    << "Search index '" << f << "' is out of date for repository '" << (*r)->name() << "', ignoring it";
+                _imp->entries.clear();
+                return;
+            }
+        }
+
+        if (repositories != stamps.size())
+        {
+            Log::get_instance()->message("search_index.stale", ll_warning, lc_context)
+                << "Search index '" << f << "' was created for different repositories, ignoring it";
+            _imp->entries.clear();
+        }
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("search_index.broken", ll_warning, lc_context)
+            << "Search index '" << f << "' is broken, ignoring it: '" << e.message() << "' (" << e.what() << ")";
+        _imp->entries.clear();
+    }
+}
+
+SearchIndex::~SearchIndex()
+{
+}
+
+void
+SearchIndex::create(const Environment * const env, const FSEntry & f)
+{
+    Context context("When creating search index '" + stringify(f) + "':");
+
+    typedef std::set<std::string> Seen;
+    std::map<QualifiedPackageName, Seen> seen;
+    Entries entries;
+    std::map<RepositoryName, std::string, RepositoryNameComparator> stamps;
+
+    for (PackageDatabase::RepositoryConstIterator r(env->package_database()->begin_repositories()),
+            r_end(env->package_database()->end_repositories()) ; r != r_end ; ++r)
+    {
+        stamps.insert(std::make_pair((*r)->name(), stamp(*r)));
+        const std::tr1::shared_ptr<PackageIDSequence> ids(all_ids(*r));
+
+        (*r)->prefetch_metadata(ids);
+
+        for (PackageIDSequence::ConstIterator i(ids->begin()), i_end(ids->end()) ;
+                i != i_end ; ++i)
+        {
+            Entry entry;
+            entry.short_description = description((*i)->short_description_key());
+            entry.long_description = description((*i)->long_description_key());
+            entry.homepages = homepages((*i)->homepage_key());
+
+            /* an absent key and an empty key are different to a matcher, so
+             * escape before deciding whether we've seen it already */
+            if (seen[(*i)->name()].insert(escape(entry.short_description) + "\t" +
+                        escape(entry.long_description) + "\t" + escape(entry.homepages)).second)
+                entries[(*i)->name()].push_back(entry);
+
+            (*i)->can_drop_in_memory_cache();
+        }
+    }
+
+    FSEntry tmp(f.dirname() / ("." + f.basename() + ".tmp"));
+    {
+        SafeOFStream file(tmp);
+        file << magic << std::endl;
+        for (std::map<RepositoryName, std::string, RepositoryNameComparator>::const_iterator m(stamps.begin()),
+                m_end(stamps.end()) ; m != m_end ; ++m)
+            file << "repository\t" << m->first << "\t" << m->second << std::endl;
+        for (Entries::const_iterator e(entries.begin()), e_end(entries.end()) ;
+                e != e_end ; ++e)
+            for (std::list<Entry>::const_iterator i(e->second.begin()), i_end(e->second.end()) ;
+                    i != i_end ; ++i)
+                file << e->first << "\t" << escape(i->short_description) << "\t" << escape(i->long_description)
+                    << "\t" << escape(i->homepages) << std::endl;
+    }
+    tmp.rename(f);
+}
+
+bool
+SearchIndex::excludes(const QualifiedPackageName & q, const bool names, const bool descriptions,
+        const bool homepage, const TextsMatcher & m) const
+{
+    Entries::const_iterator e(_imp->entries.find(q));
+    if (e == _imp->entries.end())
+        return false;
+
+    for (std::list<Entry>::const_iterator i(e->second.begin()), i_end(e->second.end()) ;
+            i != i_end ; ++i)
+    {
+        std::list<std::string> texts;
+
+        if (names)
+            texts.push_back(stringify(q));
+
+        if (descriptions)
+        {
+            if (i->short_description)
+                texts.push_back(*i->short_description);
+            if (i->long_description)
+                texts.push_back(*i->long_description);
+        }
+
+        if (homepage && i->homepages)
+            tokenise_whitespace(*i->homepages, std::back_inserter(texts));
+
+        if (m(texts))
+            return false;
+    }
+
+    return true;
+}
+
+template class PrivateImplementationPattern<SearchIndex>;
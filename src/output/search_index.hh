@@ -0,0 +1,79 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_SRC_OUTPUT_SEARCH_INDEX_HH
+#define PALUDIS_GUARD_PALUDIS_SRC_OUTPUT_SEARCH_INDEX_HH 1
+
+#include <paludis/util/private_implementation_pattern.hh>
+#include <paludis/util/fs_entry-fwd.hh>
+#include <paludis/environment-fwd.hh>
+#include <paludis/name-fwd.hh>
+#include <tr1/functional>
+#include <string>
+#include <list>
+
+namespace paludis
+{
+    /**
+     * An on-disk index of package names, descriptions and homepages, used by search
+     * clients to avoid loading metadata for packages that cannot match.
+     *
+     * The index holds one entry for every distinct name, description and
+     * homepage combination of every version of a package, so it can only rule
+     * out packages. Packages that are not in the index are never ruled out.
+     *
+     * The index also records a stamp for each repository, made from the
+     * modification times of the top two levels of its directory (or from its
+     * IDs, for repositories that aren't on disk). If any stamp has changed
+     * since the index was created, the whole index is ignored.
+     */
+    class SearchIndex :
+        private PrivateImplementationPattern<SearchIndex>
+    {
+        public:
+            typedef std::tr1::function<bool (const std::list<std::string> &)> TextsMatcher;
+
+            ///\name Basic operations
+            ///\{
+
+            SearchIndex(const Environment * const, const FSEntry &);
+            ~SearchIndex();
+
+            ///\}
+
+            /**
+             * Write an index for every package in every repository to the
+             * specified file.
+             */
+            static void create(const Environment * const, const FSEntry &);
+
+            /**
+             * Can we be sure that no version of the named package matches?
+             *
+             * The matcher is called with the texts for each index entry: the
+             * name if names is true, followed by whichever descriptions are
+             * present if descriptions is true, followed by each HOMEPAGE
+             * URI if homepage is true.
+             */
+            bool excludes(const QualifiedPackageName &, const bool names, const bool descriptions,
+                    const bool homepage, const TextsMatcher &) const PALUDIS_ATTRIBUTE((warn_unused_result));
+    };
+}
+
+#endif